@@ -0,0 +1,866 @@
+/*************************************************************************
+
+   Program:    makecadb/searchcadb
+   File:       cadb.c
+
+   Version:    V1.9
+   Date:       16.10.26
+   Function:   Routines for reading and writing the binary CA distance
+               database format
+
+   Copyright:  (c) UCL, Dr. Andrew C. R. Martin 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See cadb.h for a description of the file format.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  16.10.26 Original
+   V1.1  16.10.26 CADBInitHeader() takes the layout
+   V1.2  16.10.26 Added CADBQuantizeColumn() and CADBQuantDist()
+   V1.3  16.10.26 Added CADBReadAliases()
+   V1.4  16.10.26 Added CADBReadIndexHeader() and CADBIndexBin()
+   V1.5  16.10.26 Added CADBReadHistograms() and CADBHistBin()
+   V1.6  16.10.26 Added CADBWindowFilename() and CADBReadWindowHeader()
+   V1.7  16.10.26 Added CADBCaAngles()
+   V1.8  16.10.26 Added CADBCompareKeys(), CADBReadKeyHeader() and
+                  CADBFindKey()
+   V1.9  16.10.26 Added CADBFindWindowTables(). The separate files are
+                  checked against the build fingerprint
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <dirent.h>
+
+#include "cadb.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MAXBUFF 160
+
+/************************************************************************/
+/*>void CADBInitHeader(CADBHEADER *header, int ndist, int layout,
+                       char *pdbdir, time_t date)
+   ----------------------------------------------------------------
+   Outputs:    CADBHEADER *header    Header to initialize
+   Inputs:     int        ndist      Number of distances
+               int        layout     CADB_LAYOUT_ROW, _COLUMN,
+                                     _COORD or _QUANT
+               char       *pdbdir    PDB directory
+               time_t     date       Date of the build
+
+   Initializes a header for a new database. The counts and chain table
+   offset are filled in once the database has been written.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added layout
+*/
+void CADBInitHeader(CADBHEADER *header, int ndist, int layout,
+                    char *pdbdir, time_t date)
+{
+   memset(header, 0, sizeof(CADBHEADER));
+   memcpy(header->magic, CADB_MAGIC, 4);
+   header->byteOrder = CADB_BYTEORDER;
+   header->version   = CADB_VERSION;
+   header->ndist     = (uint32_t)ndist;
+   header->layout    = (uint32_t)layout;
+   header->date      = (uint64_t)date;
+   strncpy(header->pdbdir, pdbdir, CADB_MAXDIR-1);
+}
+
+
+/************************************************************************/
+/*>BOOL CADBWriteHeader(FILE *fp, CADBHEADER *header)
+   --------------------------------------------------
+   Inputs:     FILE       *fp        Database file pointer
+               CADBHEADER *header    Header to write
+   Returns:    BOOL                  Success?
+
+   Writes the header at the start of the file. The file pointer is left
+   after the header.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL CADBWriteHeader(FILE *fp, CADBHEADER *header)
+{
+   if(fseek(fp, 0L, SEEK_SET))
+      return(FALSE);
+   if(fwrite(header, sizeof(CADBHEADER), 1, fp) != 1)
+      return(FALSE);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int CADBReadHeader(FILE *fp, CADBHEADER *header)
+   ------------------------------------------------
+   Inputs:     FILE       *fp        Database file pointer
+   Outputs:    CADBHEADER *header    Header read from the file
+   Returns:    int                   CADB_OK or an error code
+
+   Reads and checks the header from the start of the file. If the file
+   is not a binary database, CADB_ERR_MAGIC is returned and the file is
+   rewound so that it may be read as a text database.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Terminates the PDB directory, which may run into the 
+            fingerprint in a database written before it was added
+*/
+int CADBReadHeader(FILE *fp, CADBHEADER *header)
+{
+   if(fseek(fp, 0L, SEEK_SET))
+      return(CADB_ERR_READ);
+
+   if((fread(header, sizeof(CADBHEADER), 1, fp) != 1) ||
+      strncmp(header->magic, CADB_MAGIC, 4))
+   {
+      rewind(fp);
+      return(CADB_ERR_MAGIC);
+   }
+   if(header->byteOrder != CADB_BYTEORDER)
+      return(CADB_ERR_BYTEORDER);
+   if(header->version != CADB_VERSION)
+      return(CADB_ERR_VERSION);
+   header->pdbdir[CADB_MAXDIR-1] = '\0';
+
+   return(CADB_OK);
+}
+
+
+/************************************************************************/
+/*>char *CADBError(int err)
+   ------------------------
+   Inputs:     int    err       Error code from CADBReadHeader(),
+                                CADBReadIndexHeader() or
+                                CADBReadWindowHeader()
+   Returns:    char *           Error message
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added CADB_ERR_STALE
+   16.10.26 CADB_ERR_STALE message also covers loop window tables
+*/
+char *CADBError(int err)
+{
+   switch(err)
+   {
+   case CADB_OK:
+      return("No error");
+   case CADB_ERR_READ:
+      return("Unable to read database header");
+   case CADB_ERR_MAGIC:
+      return("Not a binary CA database");
+   case CADB_ERR_BYTEORDER:
+      return("Database was written on a machine of different byte order");
+   case CADB_ERR_VERSION:
+      return("Unsupported binary database version");
+   case CADB_ERR_STALE:
+      return("Index or window table does not match the database");
+   }
+   return("Unknown error");
+}
+
+
+/************************************************************************/
+/*>CADBCHAIN *CADBReadChainTable(FILE *fp, CADBHEADER *header)
+   -----------------------------------------------------------
+   Inputs:     FILE       *fp        Database file pointer
+               CADBHEADER *header    Header for this file
+   Returns:    CADBCHAIN  *          Malloc'd chain table (NULL on error)
+
+   Reads the chain table from the end of the database.
+
+   16.10.26 Original   By: ACRM
+*/
+CADBCHAIN *CADBReadChainTable(FILE *fp, CADBHEADER *header)
+{
+   CADBCHAIN *chains;
+
+   if((chains = (CADBCHAIN *)malloc((header->nchains + 1) *
+                                    sizeof(CADBCHAIN)))==NULL)
+      return(NULL);
+
+   if(fseeko(fp, (off_t)header->chainTable, SEEK_SET) ||
+      (fread(chains, sizeof(CADBCHAIN), header->nchains, fp) !=
+       header->nchains))
+   {
+      free(chains);
+      return(NULL);
+   }
+
+   return(chains);
+}
+
+
+/************************************************************************/
+/*>CADBALIAS *CADBReadAliases(FILE *fp, CADBHEADER *header, 
+                              uint64_t *naliases)
+   ---------------------------------------------------------
+   Inputs:     FILE       *fp        Database file pointer
+               CADBHEADER *header    Header for this file
+   Outputs:    uint64_t   *naliases  Number of aliases
+   Returns:    CADBALIAS  *          Malloc'd alias table (NULL on error)
+
+   Reads the alias table which follows the chain table. Should only be
+   called if CADB_FLAG_ALIASES is set in the header.
+
+   16.10.26 Original   By: ACRM
+*/
+CADBALIAS *CADBReadAliases(FILE *fp, CADBHEADER *header, 
+                           uint64_t *naliases)
+{
+   CADBALIAS *aliases;
+
+   *naliases = 0;
+   if(fseeko(fp, (off_t)(header->chainTable + 
+                         header->nchains * sizeof(CADBCHAIN)), SEEK_SET) ||
+      (fread(naliases, sizeof(uint64_t), 1, fp) != 1))
+      return(NULL);
+
+   if((aliases = (CADBALIAS *)malloc((*naliases + 1) * 
+                                     sizeof(CADBALIAS)))==NULL)
+      return(NULL);
+
+   if(fread(aliases, sizeof(CADBALIAS), *naliases, fp) != *naliases)
+   {
+      free(aliases);
+      return(NULL);
+   }
+
+   return(aliases);
+}
+
+
+/************************************************************************/
+/*>uint16_t CADBEncodeDist(REAL dist)
+   ----------------------------------
+   Inputs:     REAL      dist       Distance (-ve if not available)
+   Returns:    uint16_t             Distance in hundredths of an Angstrom
+
+   Converts a distance to the fixed point form stored in the database.
+   Distances too large to store are clamped to CADB_MAXDIST.
+
+   16.10.26 Original   By: ACRM
+*/
+uint16_t CADBEncodeDist(REAL dist)
+{
+   REAL scaled;
+
+   if(dist < 0.0)
+      return(CADB_MISSING);
+
+   scaled = dist * CADB_SCALE + 0.5;
+   if(scaled >= (REAL)CADB_MAXDIST)
+      return(CADB_MAXDIST);
+
+   return((uint16_t)scaled);
+}
+
+
+/************************************************************************/
+/*>void CADBCaAngles(REAL *x, REAL *y, REAL *z, int nres, REAL *angles)
+   --------------------------------------------------------------------
+   Inputs:     REAL   *x, *y, *z   CA coordinates for a chain
+               int    nres         Number of residues in the chain
+   Outputs:    REAL   *angles      The nres CA virtual bond angles 
+                                   followed by the nres CA 
+                                   pseudo-torsions in degrees (-1 if 
+                                   not defined)
+
+   Calculates the angle CA(i-1)-CA(i)-CA(i+1) and the torsion 
+   CA(i-1)-CA(i)-CA(i+1)-CA(i+2) for each residue i of a chain. The 
+   torsion uses the IUPAC sign convention (about +50 degrees for an 
+   alpha helix) and is returned in the range 0 to 360.
+
+   16.10.26 Original   By: ACRM
+*/
+void CADBCaAngles(REAL *x, REAL *y, REAL *z, int nres, REAL *angles)
+{
+   REAL *torsions = angles + nres,
+        b1[3], b2[3], b3[3],
+        n1[3], n2[3],
+        len1, len2, cosine, torsion;
+   int  i;
+
+   for(i=0; i<nres; i++)
+   {
+      angles[i] = torsions[i] = (-1.0);
+      if((i < 1) || (i+1 >= nres))
+         continue;
+
+      b1[0] = x[i]   - x[i-1];  b1[1] = y[i]   - y[i-1];  
+      b1[2] = z[i]   - z[i-1];
+      b2[0] = x[i+1] - x[i];    b2[1] = y[i+1] - y[i];    
+      b2[2] = z[i+1] - z[i];
+      len1  = sqrt(b1[0]*b1[0] + b1[1]*b1[1] + b1[2]*b1[2]);
+      len2  = sqrt(b2[0]*b2[0] + b2[1]*b2[1] + b2[2]*b2[2]);
+      if((len1 == 0.0) || (len2 == 0.0))
+         continue;
+
+      cosine = -(b1[0]*b2[0] + b1[1]*b2[1] + b1[2]*b2[2]) / (len1*len2);
+      if(cosine > 1.0)  cosine = 1.0;
+      if(cosine < -1.0) cosine = -1.0;
+      angles[i] = acos(cosine) * CADB_RADTODEG;
+
+      if(i+2 >= nres)
+         continue;
+
+      b3[0] = x[i+2] - x[i+1];  b3[1] = y[i+2] - y[i+1];  
+      b3[2] = z[i+2] - z[i+1];
+      n1[0] = b1[1]*b2[2] - b1[2]*b2[1];
+      n1[1] = b1[2]*b2[0] - b1[0]*b2[2];
+      n1[2] = b1[0]*b2[1] - b1[1]*b2[0];
+      n2[0] = b2[1]*b3[2] - b2[2]*b3[1];
+      n2[1] = b2[2]*b3[0] - b2[0]*b3[2];
+      n2[2] = b2[0]*b3[1] - b2[1]*b3[0];
+
+      torsion = atan2(len2 * (b1[0]*n2[0] + b1[1]*n2[1] + b1[2]*n2[2]),
+                      n1[0]*n2[0] + n1[1]*n2[1] + n1[2]*n2[2]) * 
+                CADB_RADTODEG;
+      if(torsion < 0.0)
+         torsion += 360.0;
+      torsions[i] = torsion;
+   }
+}
+
+
+/************************************************************************/
+/*>void CADBMakeKey(char *key, CADBCHAIN *chain, CADBRESID *resid)
+   ---------------------------------------------------------------
+   Outputs:    char      *key       Residue identifier
+   Inputs:     CADBCHAIN *chain     Chain containing the residue
+               CADBRESID *resid     The residue
+
+   Builds the residue identifier in the same form as is reported from
+   the text database (e.g. "1abc.A.52" or "1abc.A.52A")
+
+   16.10.26 Original   By: ACRM
+*/
+void CADBMakeKey(char *key, CADBCHAIN *chain, CADBRESID *resid)
+{
+   if((resid->insert == ' ') || (resid->insert == '\0'))
+      sprintf(key, "%4s.%s.%d",
+              chain->pdbcode, chain->chain, (int)resid->resnum);
+   else
+      sprintf(key, "%4s.%s.%d%c",
+              chain->pdbcode, chain->chain, (int)resid->resnum,
+              resid->insert);
+}
+
+
+/************************************************************************/
+/*>void CADBQuantizeColumn(uint16_t *dist, int nres, CADBQBLOCK *block,
+                           unsigned char *raw)
+   ----------------------------------------------------------------------
+   Inputs:     uint16_t      *dist     A column of distances for a chain
+               int           nres      Number of residues in the chain
+   Outputs:    CADBQBLOCK    *block    Column block header. stored is set
+                                       to the uncompressed size
+               unsigned char *raw      Bins followed by residuals. Must
+                                       have space for 3*nres bytes
+
+   Quantizes a column of distances for CADB_LAYOUT_QUANT. The base is
+   the smallest distance in the column and the shift the smallest which
+   fits the range into CADB_QMAXBIN+1 bins. The low shift bits of each
+   distance are packed into the residuals.
+
+   16.10.26 Original   By: ACRM
+*/
+void CADBQuantizeColumn(uint16_t *dist, int nres, CADBQBLOCK *block,
+                        unsigned char *raw)
+{
+   unsigned char *resid = raw + nres;
+   int           min = CADB_MISSING,
+                 max = 0,
+                 mask,
+                 bit,
+                 res,
+                 d;
+
+   for(res=0; res<nres; res++)
+   {
+      if(dist[res] != CADB_MISSING)
+      {
+         if(dist[res] < min) min = dist[res];
+         if(dist[res] > max) max = dist[res];
+      }
+   }
+   if(min > max)
+      min = max = 0;
+
+   memset(block, 0, sizeof(CADBQBLOCK));
+   block->base = (uint16_t)min;
+   while(((max - min) >> block->shift) > CADB_QMAXBIN)
+      block->shift++;
+   mask = (1 << block->shift) - 1;
+
+   memset(resid, 0, CADB_QRAWSIZE(nres, block->shift) - nres);
+   for(res=0; res<nres; res++)
+   {
+      if(dist[res] == CADB_MISSING)
+      {
+         raw[res] = CADB_QMISSING;
+         d        = 0;
+      }
+      else
+      {
+         d        = dist[res] - min;
+         raw[res] = (unsigned char)(d >> block->shift);
+         d       &= mask;
+      }
+
+      for(bit=res*block->shift; d; d >>= 1, bit++)
+      {
+         if(d & 1)
+            resid[bit >> 3] |= (unsigned char)(1 << (bit & 7));
+      }
+   }
+
+   block->stored = (uint32_t)CADB_QRAWSIZE(nres, block->shift);
+}
+
+
+/************************************************************************/
+/*>int CADBQuantDist(CADBQBLOCK *block, unsigned char *raw, int nres,
+                     int res)
+   ------------------------------------------------------------------
+   Inputs:     CADBQBLOCK    *block    Column block header
+               unsigned char *raw      Uncompressed bins and residuals
+               int           nres      Number of residues in the chain
+               int           res       Residue of interest
+   Returns:    int                     Distance in hundredths of an 
+                                       Angstrom or CADB_MISSING
+
+   Decodes the exact distance for a residue from a quantized column.
+
+   16.10.26 Original   By: ACRM
+*/
+int CADBQuantDist(CADBQBLOCK *block, unsigned char *raw, int nres,
+                  int res)
+{
+   unsigned char *resid = raw + nres;
+   int           d,
+                 bit,
+                 i;
+
+   if(raw[res] == CADB_QMISSING)
+      return(CADB_MISSING);
+
+   d   = block->base + (raw[res] << block->shift);
+   bit = res * block->shift;
+   for(i=0; i<block->shift; i++, bit++)
+   {
+      if(resid[bit >> 3] & (1 << (bit & 7)))
+         d += (1 << i);
+   }
+   return(d);
+}
+
+
+/************************************************************************/
+/*>int CADBReadIndexHeader(FILE *fp, CADBINDEXHEADER *index,
+                           CADBHEADER *header)
+   ---------------------------------------------------------
+   Inputs:     FILE            *fp       Index file pointer
+               CADBHEADER      *header   Header of the database
+   Outputs:    CADBINDEXHEADER *index    Header read from the index
+   Returns:    int                       CADB_OK or an error code
+
+   Reads and checks the header of a range index. CADB_ERR_STALE is
+   returned if the index was not built from this database (e.g. the
+   database has since been rebuilt).
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Checks the build fingerprint
+*/
+int CADBReadIndexHeader(FILE *fp, CADBINDEXHEADER *index,
+                        CADBHEADER *header)
+{
+   if(fseek(fp, 0L, SEEK_SET) ||
+      (fread(index, sizeof(CADBINDEXHEADER), 1, fp) != 1))
+      return(CADB_ERR_READ);
+   if(strncmp(index->magic, CADB_INDEX_MAGIC, 4))
+      return(CADB_ERR_MAGIC);
+   if(index->byteOrder != CADB_BYTEORDER)
+      return(CADB_ERR_BYTEORDER);
+   if((index->version != CADB_INDEX_VERSION) || !index->binWidth)
+      return(CADB_ERR_VERSION);
+   if((index->ndist      != header->ndist)      ||
+      (index->nrecords   != header->nrecords)   ||
+      (index->nchains    != header->nchains)    ||
+      (index->chainTable  != header->chainTable)  ||
+      (index->date        != header->date)        ||
+      (index->fingerprint != header->fingerprint))
+      return(CADB_ERR_STALE);
+
+   return(CADB_OK);
+}
+
+
+/************************************************************************/
+/*>int CADBIndexBin(CADBINDEXHEADER *index, int dist)
+   --------------------------------------------------
+   Inputs:     CADBINDEXHEADER *index    Header of the range index
+               int             dist      Distance in hundredths of an
+                                         Angstrom or CADB_MISSING
+   Returns:    int                       Bin of the index
+
+   Finds the bin of the range index in which a distance is listed.
+
+   16.10.26 Original   By: ACRM
+*/
+int CADBIndexBin(CADBINDEXHEADER *index, int dist)
+{
+   int bin;
+
+   if(dist == CADB_MISSING)
+      return((int)index->nbins);
+   bin = dist / (int)index->binWidth;
+   return((bin < (int)index->nbins) ? bin : (int)index->nbins - 1);
+}
+
+
+/************************************************************************/
+/*>uint64_t *CADBReadHistograms(FILE *fp, CADBHEADER *header,
+                                CADBHISTHEADER *hist)
+   -------------------------------------------------------------
+   Inputs:     FILE           *fp       Database file pointer
+               CADBHEADER     *header   Header for this file
+   Outputs:    CADBHISTHEADER *hist     Header of the histograms
+   Returns:    uint64_t       *         Malloc'd counts (NULL on error or
+                                        if there are no histograms)
+
+   Reads the distance histograms from the end of a binary database. The
+   count for bin b of DP column k is counts[k*(nbins+1) + b].
+
+   16.10.26 Original   By: ACRM
+*/
+uint64_t *CADBReadHistograms(FILE *fp, CADBHEADER *header,
+                             CADBHISTHEADER *hist)
+{
+   uint64_t *counts,
+            naliases = 0,
+            offset;
+   size_t   ncounts;
+
+   if(!(header->flags & CADB_FLAG_HISTOGRAMS))
+      return(NULL);
+
+   /* The histograms follow the alias table if there is one             */
+   offset = header->chainTable + header->nchains * sizeof(CADBCHAIN);
+   if(header->flags & CADB_FLAG_ALIASES)
+   {
+      if(fseeko(fp, (off_t)offset, SEEK_SET) ||
+         (fread(&naliases, sizeof(uint64_t), 1, fp) != 1))
+         return(NULL);
+      offset += sizeof(uint64_t) + naliases * sizeof(CADBALIAS);
+   }
+
+   if(fseeko(fp, (off_t)offset, SEEK_SET) ||
+      (fread(hist, sizeof(CADBHISTHEADER), 1, fp) != 1) ||
+      (hist->ndist != header->ndist) || !hist->binWidth || !hist->nbins)
+      return(NULL);
+
+   ncounts = (size_t)hist->ndist * (hist->nbins + 1);
+   if((counts = (uint64_t *)malloc((ncounts + 1) * 
+                                   sizeof(uint64_t)))==NULL)
+      return(NULL);
+   if(fread(counts, sizeof(uint64_t), ncounts, fp) != ncounts)
+   {
+      free(counts);
+      return(NULL);
+   }
+
+   return(counts);
+}
+
+
+/************************************************************************/
+/*>int CADBHistBin(CADBHISTHEADER *hist, int dist)
+   -----------------------------------------------
+   Inputs:     CADBHISTHEADER *hist    Header of the histograms
+               int            dist     Distance in hundredths of an
+                                       Angstrom or CADB_MISSING
+   Returns:    int                     Bin of the histogram
+
+   Finds the histogram bin in which a distance is counted.
+
+   16.10.26 Original   By: ACRM
+*/
+int CADBHistBin(CADBHISTHEADER *hist, int dist)
+{
+   int bin;
+
+   if(dist == CADB_MISSING)
+      return((int)hist->nbins);
+   bin = dist / (int)hist->binWidth;
+   return((bin < (int)hist->nbins) ? bin : (int)hist->nbins - 1);
+}
+
+
+/************************************************************************/
+/*>void CADBWindowFilename(char *filename, char *dbfile, int length)
+   -----------------------------------------------------------------
+   Outputs:    char   *filename   Filename of the loop window table
+   Inputs:     char   *dbfile     Database file
+               int    length      Loop length
+
+   Makes the filename of the loop window table for a loop length.
+   filename must have room for dbfile plus 16 characters.
+
+   16.10.26 Original   By: ACRM
+*/
+void CADBWindowFilename(char *filename, char *dbfile, int length)
+{
+   sprintf(filename, "%s%s%d", dbfile, CADB_WINDOW_EXT, length);
+}
+
+
+/************************************************************************/
+/*>int CADBFindWindowTables(char *dbfile, int *lengths, int maxLengths)
+   --------------------------------------------------------------------
+   Inputs:     char   *dbfile       Database file name
+               int    maxLengths    Size of the lengths array
+   Outputs:    int    *lengths      Loop lengths of the tables found
+   Returns:    int                  Number of tables found
+
+   Finds the loop window tables present for a database. Since the loop
+   lengths are not recorded in the database, the directory is searched
+   for files named dbfile.wL. At most maxLengths are returned, in order
+   of loop length.
+
+   16.10.26 Original   By: ACRM
+*/
+int CADBFindWindowTables(char *dbfile, int *lengths, int maxLengths)
+{
+   char          dirname[MAXBUFF],
+                 *base,
+                 *c;
+   DIR           *dp;
+   struct dirent *entry;
+   size_t        baseLen,
+                 extLen = strlen(CADB_WINDOW_EXT);
+   int           length,
+                 nfound = 0,
+                 i;
+
+   strncpy(dirname, dbfile, MAXBUFF-1);
+   dirname[MAXBUFF-1] = '\0';
+   if((base = strrchr(dirname, '/')) != NULL)
+   {
+      *(base++) = '\0';
+      if(!dirname[0])
+         strcpy(dirname, "/");
+   }
+   else
+   {
+      base = dirname;
+   }
+   baseLen = strlen(base);
+
+   if((dp = opendir((base == dirname) ? "." : dirname))==NULL)
+      return(0);
+
+   while(((entry = readdir(dp)) != NULL) && (nfound < maxLengths))
+   {
+      if(strncmp(entry->d_name, base, baseLen) ||
+         strncmp(entry->d_name + baseLen, CADB_WINDOW_EXT, extLen))
+         continue;
+
+      c = entry->d_name + baseLen + extLen;
+      if(!*c)
+         continue;
+      for(length=0; (*c >= '0') && (*c <= '9') && (length < 100000); c++)
+         length = 10*length + (*c - '0');
+      if(*c || (length < 1))
+         continue;
+
+      /* Insert in order of loop length                                 */
+      for(i=nfound; (i > 0) && (lengths[i-1] > length); i--)
+         lengths[i] = lengths[i-1];
+      lengths[i] = length;
+      nfound++;
+   }
+   closedir(dp);
+
+   return(nfound);
+}
+
+
+/************************************************************************/
+/*>int CADBReadWindowHeader(FILE *fp, CADBWINDOWHEADER *win,
+                            CADBHEADER *header)
+   ---------------------------------------------------------
+   Inputs:     FILE             *fp       Window table file pointer
+               CADBHEADER       *header   Header of the database
+   Outputs:    CADBWINDOWHEADER *win      Header read from the table
+   Returns:    int                        CADB_OK or an error code
+
+   Reads and checks the header of a loop window table. As for the 
+   range index, CADB_ERR_STALE is returned if the table was not built
+   from this database.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Checks the build fingerprint
+*/
+int CADBReadWindowHeader(FILE *fp, CADBWINDOWHEADER *win,
+                         CADBHEADER *header)
+{
+   if(fseek(fp, 0L, SEEK_SET) ||
+      (fread(win, sizeof(CADBWINDOWHEADER), 1, fp) != 1))
+      return(CADB_ERR_READ);
+   if(strncmp(win->magic, CADB_WINDOW_MAGIC, 4))
+      return(CADB_ERR_MAGIC);
+   if(win->byteOrder != CADB_BYTEORDER)
+      return(CADB_ERR_BYTEORDER);
+   if((win->version != CADB_WINDOW_VERSION) || !win->length ||
+      (win->rowSize != 2 * win->ndist * sizeof(uint16_t)))
+      return(CADB_ERR_VERSION);
+   if((win->ndist      != header->ndist)      ||
+      (win->nrecords   != header->nrecords)   ||
+      (win->nchains    != header->nchains)    ||
+      (win->chainTable  != header->chainTable)  ||
+      (win->date        != header->date)        ||
+      (win->fingerprint != header->fingerprint))
+      return(CADB_ERR_STALE);
+
+   return(CADB_OK);
+}
+
+
+/************************************************************************/
+/*>int CADBCompareKeys(const void *key1, const void *key2)
+   -------------------------------------------------------
+   Inputs:     const void *key1     First CADBKEY
+               const void *key2     Second CADBKEY
+   Returns:    int                  Comparison for qsort()
+
+   Sorts the entries of a key index by PDB code and then chain label.
+
+   16.10.26 Original   By: ACRM
+*/
+int CADBCompareKeys(const void *key1, const void *key2)
+{
+   int cmp;
+
+   if((cmp = strncmp(((CADBKEY *)key1)->pdbcode, 
+                     ((CADBKEY *)key2)->pdbcode, 8)) != 0)
+      return(cmp);
+   return(strncmp(((CADBKEY *)key1)->chain, ((CADBKEY *)key2)->chain, 8));
+}
+
+
+/************************************************************************/
+/*>int CADBReadKeyHeader(FILE *fp, CADBKEYHEADER *keys, 
+                         CADBHEADER *header)
+   ----------------------------------------------------
+   Inputs:     FILE          *fp       Key index file pointer
+               CADBHEADER    *header   Header of the database
+   Outputs:    CADBKEYHEADER *keys     Header read from the key index
+   Returns:    int                     CADB_OK or an error code
+
+   Reads and checks the header of a key index. As for the range index,
+   CADB_ERR_STALE is returned if the key index was not built from this
+   database.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Checks the build fingerprint
+*/
+int CADBReadKeyHeader(FILE *fp, CADBKEYHEADER *keys, CADBHEADER *header)
+{
+   if(fseek(fp, 0L, SEEK_SET) ||
+      (fread(keys, sizeof(CADBKEYHEADER), 1, fp) != 1))
+      return(CADB_ERR_READ);
+   if(strncmp(keys->magic, CADB_KEY_MAGIC, 4))
+      return(CADB_ERR_MAGIC);
+   if(keys->byteOrder != CADB_BYTEORDER)
+      return(CADB_ERR_BYTEORDER);
+   if(keys->version != CADB_KEY_VERSION)
+      return(CADB_ERR_VERSION);
+   if((keys->nrecords    != header->nrecords)    ||
+      (keys->nchains     != header->nchains)     ||
+      (keys->chainTable  != header->chainTable)  ||
+      (keys->date        != header->date)        ||
+      (keys->fingerprint != header->fingerprint))
+      return(CADB_ERR_STALE);
+
+   return(CADB_OK);
+}
+
+
+/************************************************************************/
+/*>BOOL CADBFindKey(FILE *fp, CADBKEYHEADER *keys, CADBKEY *probe,
+                    uint64_t *pos)
+   ---------------------------------------------------------------
+   Inputs:     FILE          *fp       Key index file pointer
+               CADBKEYHEADER *keys     Header of the key index
+               CADBKEY       *probe    Key to find
+   Outputs:    uint64_t      *pos      Position of the first entry that
+                                       does not sort before probe
+                                       (nkeys if there is none)
+   Returns:    BOOL                    Success?
+
+   Binary search of a key index on disk, so only about log2(nkeys) 
+   entries are read. If the chain label of probe is empty, pos is the
+   first entry for the PDB code. The entries from pos onwards may then
+   be read in turn.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL CADBFindKey(FILE *fp, CADBKEYHEADER *keys, CADBKEY *probe,
+                 uint64_t *pos)
+{
+   CADBKEY  key;
+   uint64_t lo = 0,
+            hi = keys->nkeys,
+            mid;
+
+   while(lo < hi)
+   {
+      mid = lo + (hi - lo) / 2;
+      if(fseeko(fp, (off_t)(sizeof(CADBKEYHEADER) + 
+                            mid * sizeof(CADBKEY)), SEEK_SET) ||
+         (fread(&key, sizeof(CADBKEY), 1, fp) != 1))
+         return(FALSE);
+
+      if(CADBCompareKeys(&key, probe) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   *pos = lo;
+   return(TRUE);
+}
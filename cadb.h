@@ -0,0 +1,471 @@
+/*************************************************************************
+
+   Program:    makecadb/searchcadb
+   File:       cadb.h
+
+   Version:    V1.16
+   Date:       16.10.26
+   Function:   Definitions for the binary CA distance database format
+
+   Copyright:  (c) UCL, Dr. Andrew C. R. Martin 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   A binary database consists of:
+
+   CADBHEADER     Fixed size header. Identifies the file, gives the
+                  number of distances, records and chains, the file
+                  offset of the chain table and the build fingerprint.
+                  The fingerprint is a hash of the chain blocks and 
+                  tables written by makecadb (never 0, other than in 
+                  databases written before it was added) so that a 
+                  separate file built from another database, even one 
+                  with the same counts, can be detected
+   Chain blocks   One per chain. Each has a CADBRESID for each residue
+                  followed by the distances. There are 2*ndist uint16
+                  distance columns: DP 1..ndist then DM 1..ndist
+                  (only the ndist DP columns if CADB_FLAG_FORWARD is
+                  set in the header flags).
+                  With CADB_LAYOUT_ROW, the distances are stored a
+                  residue at a time (all the columns for the first
+                  residue, then all the columns for the second, etc.)
+                  With CADB_LAYOUT_COLUMN, they are stored a column at
+                  a time (column 1 for every residue in the chain, then
+                  column 2, etc.) so that a search need only read the
+                  columns for which it has constraints
+                  With CADB_LAYOUT_COORD, no distances are stored. 
+                  Instead there are nres float x coordinates, followed
+                  by nres y and nres z coordinates and ndist is 0
+                  With CADB_LAYOUT_QUANT, the distances are quantized a
+                  column at a time. The CADBRESIDs are followed by a 
+                  directory of ncol+1 uint32 offsets (from the start of 
+                  the chain block) of the column blocks. Each column
+                  block is a CADBQBLOCK followed by nres uint8 bins and
+                  then nres residuals of shift bits packed into bytes 
+                  (least significant bit first). A distance is
+                  base + (bin << shift) + residual; bin CADB_QMISSING
+                  marks a missing distance. The shift is the smallest
+                  which fits the range of the column into 
+                  CADB_QMAXBIN+1 bins, so it is 0 (and there are no
+                  residuals) for columns such as offset 1 where the 
+                  range is narrow. If stored is less than the raw size
+                  (CADB_QRAWSIZE()), the bins and residuals are zlib
+                  compressed. Each column block can be decoded on
+                  its own so a search only reads and decompresses the
+                  columns that it constrains
+                  If CADB_FLAG_ANGLES is set in the header flags, each
+                  chain block (other than with CADB_LAYOUT_COORD) ends
+                  with nres uint16 CA virtual bond angles followed by 
+                  nres uint16 CA pseudo-torsions. Being the last 
+                  4*nres bytes of the block, they are found from the 
+                  chain's size whatever the layout
+   Chain table    A CADBCHAIN for each chain giving the PDB code, chain
+                  label, file offset of the chain block and the number
+                  of residues
+   Alias table    Only if CADB_FLAG_ALIASES is set in the header flags.
+                  A uint64 count followed by a CADBALIAS for each chain
+                  which was not stored because it duplicates a chain in
+                  the chain table. The alias has the same residue
+                  identifiers as that chain, so a hit in the chain is 
+                  also reported for each of its aliases
+   Histograms     Only if CADB_FLAG_HISTOGRAMS is set in the header
+                  flags. Follows the alias table (or the chain table if
+                  there is none). A CADBHISTHEADER followed, for each DP
+                  column, by nbins+1 uint64 counts. Bin b counts the 
+                  distances from b*binWidth to (b+1)*binWidth-1 (the 
+                  last distance bin also counts any larger distances)
+                  and bin nbins counts the missing distances. Records
+                  in a chain with aliases are counted once for the 
+                  chain and once for each alias, so the counts describe
+                  the records that a search reports
+
+   If CADB_FLAG_SEQUENCE is set in the header flags (makecadb -s), the
+   restype field of each CADBRESID holds the one-letter code of the
+   residue (X if it is not a standard amino acid). Otherwise it is 
+   zero. In a text database (with !SEQUENCE in the header), the 
+   one-letter code is the last word of each record, after any angles
+
+   Distances are stored in hundredths of an Angstrom (i.e. the same
+   precision as the text format). CADB_MISSING is used where the text
+   format would have -1.00
+
+   Angles are stored in hundredths of a degree. The angle at residue i
+   is that between CA(i-1), CA(i) and CA(i+1); the torsion is that 
+   about CA(i)-CA(i+1) for CA(i-1) to CA(i+2) and is stored in the range
+   0 to 360 so that CADB_MISSING (or -1.00 in a text database, where 
+   they follow the distances of each record) can mark the residues at 
+   the ends of a chain for which they are not defined
+
+   The file is written in the native byte order of the machine; the
+   byteOrder field allows a reader to detect a file written on a
+   machine of the other byte order.
+
+   A database split into shards is described by a text shard manifest.
+   The first line starts with CADB_SHARD_MAGIC and each following line
+   gives the filename of a shard (relative to the directory containing
+   the manifest) and its number of records. Each shard is a complete 
+   text or binary database.
+
+   A range index for a binary database (makecadb -x) is written to a
+   separate file named from the database with CADB_INDEX_EXT. It 
+   consists of:
+
+   CADBINDEXHEADER Fixed size header. The fingerprint, date, counts and
+                  chain table offset are copied from the database header
+                  so that an index which does not belong to the database
+                  can be detected
+   Bin directory  For each DP column, nbins+2 uint32 values giving the
+                  start of each bin in that column's record list. Bin b
+                  holds the distances from b*binWidth to 
+                  (b+1)*binWidth-1 (the last distance bin also holds 
+                  any larger distances), bin nbins holds the missing 
+                  distances and the final value is nrecords
+   Record lists   For each DP column, nrecords uint32 record numbers
+                  sorted by bin and ascending within each bin. The 
+                  record number of residue i of a chain is the chain's
+                  firstRecord + i
+
+   The records whose distance lies in a range of bins are therefore a
+   single contiguous run of the column's record list. Since the DM
+   distance at offset k of a residue is the DP distance at offset k of
+   the residue k before it, the DP lists also serve DM constraints.
+
+   A loop window table for loops of length L (makecadb -w) is written
+   to a separate file named from the database with CADB_WINDOW_EXT 
+   followed by L (e.g. pdb.cadb.w12). It consists of:
+
+   CADBWINDOWHEADER Fixed size header. The fingerprint, date, counts 
+                  and chain table offset are copied from the database
+                  header so that a table which does not belong to the
+                  database can be detected
+   Rows           One per record, in record order. A row holds the 
+                  ndist DP distances of the record followed by the ndist
+                  DM distances of the record L-1 further along the 
+                  chain, so a loop of length L starting at the record
+                  can be tested against all of its constraints from the
+                  one row. Where the loop would run off the end of the
+                  chain, the DM distances are CADB_MISSING (a search
+                  does not test them)
+
+   A key index for a binary database (makecadb -K) is written to a
+   separate file named from the database with CADB_KEY_EXT. It 
+   consists of:
+
+   CADBKEYHEADER  Fixed size header. As for the range index, the 
+                  fingerprint, date, counts and chain table offset are
+                  copied from the database header
+   Keys           A CADBKEY for each chain in the chain table and each
+                  alias, sorted by PDB code and then chain label (see 
+                  CADBCompareKeys()). target is the index in the chain
+                  table of the chain (or, for an alias, of the chain 
+                  that it duplicates)
+
+   A chain is found by a binary search of the keys (CADBFindKey()) and
+   its chain table entry then gives the offset of its chain block. The
+   residues of a chain are found from the CADBRESIDs at the start of 
+   its block, so the index does not need an entry for every record.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  16.10.26 Original
+   V1.1  16.10.26 Added CADB_LAYOUT_COLUMN
+   V1.2  16.10.26 Added CADB_FLAG_FORWARD
+   V1.3  16.10.26 Added CADB_LAYOUT_COORD
+   V1.4  16.10.26 Added CADB_SHARD_MAGIC
+   V1.5  16.10.26 Added CADB_LAYOUT_QUANT
+   V1.6  16.10.26 Added the alias table
+   V1.7  16.10.26 Added the range index
+   V1.8  16.10.26 Added the distance histograms
+   V1.9  16.10.26 Added the loop window tables
+   V1.10 16.10.26 Added CADB_FLAG_ANGLES
+   V1.11 16.10.26 Added the residue type to CADBRESID and 
+                  CADB_FLAG_SEQUENCE
+   V1.12 16.10.26 Added the key index
+   V1.13 16.10.26 Corrected the size given for CADBCHAIN. Added 
+                  CADB_CHECKSIZE() and CADB_MAXCODE
+   V1.14 16.10.26 Added the build fingerprint to the header and the 
+                  loop window tables. Added CADBFindWindowTables()
+   V1.15 16.10.26 Added the build fingerprint to the range index header
+   V1.16 16.10.26 Added the build fingerprint to the key index header
+
+*************************************************************************/
+#ifndef _CADB_H
+#define _CADB_H
+
+/************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "bioplib/MathType.h"
+#include "bioplib/SysDefs.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define CADB_MAGIC       "CADB"
+#define CADB_BYTEORDER   0x01020304
+#define CADB_VERSION     1
+
+#define CADB_LAYOUT_ROW    0
+#define CADB_LAYOUT_COLUMN 1
+#define CADB_LAYOUT_COORD  2
+#define CADB_LAYOUT_QUANT  3
+
+/* Header flags                                                         */
+#define CADB_FLAG_FORWARD  0x0001
+#define CADB_FLAG_ALIASES  0x0002
+#define CADB_FLAG_HISTOGRAMS 0x0004
+#define CADB_FLAG_ANGLES   0x0008
+#define CADB_FLAG_SEQUENCE 0x0010
+
+#define CADB_SCALE       100.0
+#define CADB_RADTODEG    (180.0 / 3.14159265358979323846)
+#define CADB_MISSING     0xFFFF
+#define CADB_MAXDIST     0xFFFE
+
+#define CADB_QMISSING    255
+#define CADB_QMAXBIN     254
+#define CADB_QMAXSHIFT   9
+
+/* Size of the uncompressed bins and residuals of a quantized column    */
+#define CADB_QRAWSIZE(nres, shift) \
+        ((size_t)(nres) + (((size_t)(nres) * (shift) + 7) / 8))
+
+/* Fails to compile unless an on-disk structure has the given size     */
+#define CADB_CHECKSIZE(type, size) \
+        typedef char type##_SizeCheck[(sizeof(type) == (size)) ? 1 : -1]
+
+#define CADB_SHARD_MAGIC "#CADB-SHARDS"
+
+#define CADB_INDEX_MAGIC    "CIDX"
+#define CADB_INDEX_VERSION  1
+#define CADB_INDEX_EXT      ".idx"
+#define CADB_INDEX_BINWIDTH 25
+
+#define CADB_HIST_BINWIDTH  10
+
+#define CADB_WINDOW_MAGIC   "CWIN"
+#define CADB_WINDOW_VERSION 1
+#define CADB_WINDOW_EXT     ".w"
+#define CADB_MAXWINDOWS     16
+
+#define CADB_KEY_MAGIC      "CKEY"
+#define CADB_KEY_VERSION    1
+#define CADB_KEY_EXT        ".key"
+
+#define CADB_MAXKEY      32
+#define CADB_MAXCODE     7     /* Longest PDB code or chain label      */
+#define CADB_MAXDIR      192
+
+/* Return codes from CADBReadHeader()                                   */
+#define CADB_OK            0
+#define CADB_ERR_READ      1
+#define CADB_ERR_MAGIC     2
+#define CADB_ERR_BYTEORDER 3
+#define CADB_ERR_VERSION   4
+#define CADB_ERR_STALE     5
+
+/* Fixed size file header (256 bytes)                                   */
+typedef struct
+{
+   char     magic[4];
+   uint32_t byteOrder,
+            version,
+            ndist,
+            layout,
+            flags;
+   uint64_t nrecords,
+            nchains,
+            chainTable,
+            date;
+   char     pdbdir[CADB_MAXDIR];
+   uint64_t fingerprint;
+}  CADBHEADER;
+CADB_CHECKSIZE(CADBHEADER, 256);
+
+/* Residue identifier stored for each record (8 bytes). restype is the
+   one-letter residue type if CADB_FLAG_SEQUENCE is set
+*/
+typedef struct
+{
+   int32_t  resnum;
+   char     insert,
+            restype,
+            spare[2];
+}  CADBRESID;
+CADB_CHECKSIZE(CADBRESID, 8);
+
+/* Chain table entry (40 bytes)                                         */
+typedef struct
+{
+   char     pdbcode[8],
+            chain[8];
+   uint64_t offset,
+            firstRecord;
+   uint32_t nres,
+            size;
+}  CADBCHAIN;
+CADB_CHECKSIZE(CADBCHAIN, 40);
+
+/* Alias table entry (24 bytes). target is the index of the chain in the
+   chain table
+*/
+typedef struct
+{
+   char     pdbcode[8],
+            chain[8];
+   uint64_t target;
+}  CADBALIAS;
+CADB_CHECKSIZE(CADBALIAS, 24);
+
+/* Header of a range index file (64 bytes)                              */
+typedef struct
+{
+   char     magic[4];
+   uint32_t byteOrder,
+            version,
+            ndist,
+            binWidth,
+            nbins;
+   uint64_t nrecords,
+            nchains,
+            chainTable,
+            date,
+            fingerprint;
+}  CADBINDEXHEADER;
+CADB_CHECKSIZE(CADBINDEXHEADER, 64);
+
+/* Header of a loop window table (64 bytes). rowSize is the size of a
+   row in bytes
+*/
+typedef struct
+{
+   char     magic[4];
+   uint32_t byteOrder,
+            version,
+            ndist,
+            length,
+            rowSize;
+   uint64_t nrecords,
+            nchains,
+            chainTable,
+            date,
+            fingerprint;
+}  CADBWINDOWHEADER;
+CADB_CHECKSIZE(CADBWINDOWHEADER, 64);
+
+/* Header of a key index file (64 bytes)                                */
+typedef struct
+{
+   char     magic[4];
+   uint32_t byteOrder,
+            version,
+            spare;
+   uint64_t fingerprint,
+            nrecords,
+            nchains,
+            chainTable,
+            date,
+            nkeys;
+}  CADBKEYHEADER;
+CADB_CHECKSIZE(CADBKEYHEADER, 64);
+
+/* Key index entry (24 bytes). target is the index of the chain in the
+   chain table
+*/
+typedef struct
+{
+   char     pdbcode[8],
+            chain[8];
+   uint64_t target;
+}  CADBKEY;
+CADB_CHECKSIZE(CADBKEY, 24);
+
+/* Header of the distance histograms (32 bytes). nrecords and nchains
+   include the aliases
+*/
+typedef struct
+{
+   uint32_t ndist,
+            binWidth,
+            nbins,
+            spare;
+   uint64_t nrecords,
+            nchains;
+}  CADBHISTHEADER;
+CADB_CHECKSIZE(CADBHISTHEADER, 32);
+
+/* Header of a column block in a CADB_LAYOUT_QUANT chain (8 bytes)      */
+typedef struct
+{
+   uint16_t base;
+   uint8_t  shift,
+            spare;
+   uint32_t stored;
+}  CADBQBLOCK;
+CADB_CHECKSIZE(CADBQBLOCK, 8);
+
+/************************************************************************/
+/* Prototypes
+*/
+void      CADBInitHeader(CADBHEADER *header, int ndist, int layout,
+                         char *pdbdir, time_t date);
+BOOL      CADBWriteHeader(FILE *fp, CADBHEADER *header);
+int       CADBReadHeader(FILE *fp, CADBHEADER *header);
+char      *CADBError(int err);
+CADBCHAIN *CADBReadChainTable(FILE *fp, CADBHEADER *header);
+CADBALIAS *CADBReadAliases(FILE *fp, CADBHEADER *header, 
+                           uint64_t *naliases);
+uint16_t  CADBEncodeDist(REAL dist);
+void      CADBCaAngles(REAL *x, REAL *y, REAL *z, int nres, REAL *angles);
+void      CADBMakeKey(char *key, CADBCHAIN *chain, CADBRESID *resid);
+void      CADBQuantizeColumn(uint16_t *dist, int nres, CADBQBLOCK *block,
+                             unsigned char *raw);
+int       CADBQuantDist(CADBQBLOCK *block, unsigned char *raw, int nres,
+                        int res);
+int       CADBReadIndexHeader(FILE *fp, CADBINDEXHEADER *index,
+                              CADBHEADER *header);
+int       CADBIndexBin(CADBINDEXHEADER *index, int dist);
+uint64_t  *CADBReadHistograms(FILE *fp, CADBHEADER *header,
+                              CADBHISTHEADER *hist);
+int       CADBHistBin(CADBHISTHEADER *hist, int dist);
+void      CADBWindowFilename(char *filename, char *dbfile, int length);
+int       CADBFindWindowTables(char *dbfile, int *lengths, int maxLengths);
+int       CADBReadWindowHeader(FILE *fp, CADBWINDOWHEADER *win,
+                               CADBHEADER *header);
+int       CADBCompareKeys(const void *key1, const void *key2);
+int       CADBReadKeyHeader(FILE *fp, CADBKEYHEADER *keys,
+                            CADBHEADER *header);
+BOOL      CADBFindKey(FILE *fp, CADBKEYHEADER *keys, CADBKEY *probe,
+                      uint64_t *pos);
+
+#endif
@@ -0,0 +1,703 @@
+/*************************************************************************
+
+   Program:    cadbstat
+   File:       cadbstat.c
+
+   Version:    V1.4
+   Date:       16.10.26
+   Function:   Print statistics for a binary CA distance database
+
+   Copyright:  (c) UCL, Dr. Andrew C. R. Martin 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Prints a summary of a binary database written by makecadb: the
+   layout and counts from the header, a breakdown of the file size into
+   its sections (see cadb.h) and, from the distance histograms, the
+   spread of the distances at each DP offset. With -h, the full
+   histograms are also printed.
+
+   This is intended to help choose constraint tolerances (together
+   with the searchcadb ESTIMATE command) and to see where the space in
+   a database goes.
+
+**************************************************************************
+
+   Usage:
+   ======
+   cadbstat [-h] dbfile
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  16.10.26 Original
+   V1.1  16.10.26 Reports the CA angles stored by makecadb -a
+   V1.2  16.10.26 Reports the sizes of the loop window tables
+   V1.3  16.10.26 Reports the size of the key index
+   V1.4  16.10.26 Uses CADBFindWindowTables()
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "cadb.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MAXBUFF 160
+
+/* Sizes of the sections of a database                                  */
+typedef struct
+{
+   uint64_t resids,
+            distances,
+            angles,
+            qdir,
+            qheaders,
+            qstored,
+            qraw,
+            chainTable,
+            aliasTable,
+            histograms,
+            total,
+            index,
+            keys,
+            windowSize[CADB_MAXWINDOWS];
+   int      nwindows,
+            windowLength[CADB_MAXWINDOWS];
+}  SIZES;
+
+/************************************************************************/
+/* Prototypes
+*/
+int  main(int argc, char **argv);
+BOOL ParseCmdLine(int argc, char **argv, char *dbfile, BOOL *showHist);
+BOOL GetSizes(FILE *fp, char *dbfile, CADBHEADER *header,
+              CADBCHAIN *chains, SIZES *sizes);
+BOOL AddQuantSizes(FILE *fp, CADBHEADER *header, CADBCHAIN *chain,
+                   SIZES *sizes);
+void GetWindowSizes(char *dbfile, SIZES *sizes);
+void PrintSummary(FILE *out, char *dbfile, CADBHEADER *header,
+                  CADBHISTHEADER *hist, uint64_t *counts);
+void PrintSizes(FILE *out, CADBHEADER *header, SIZES *sizes);
+void PrintDistanceSpread(FILE *out, CADBHISTHEADER *hist,
+                         uint64_t *counts);
+void PrintHistograms(FILE *out, CADBHISTHEADER *hist, uint64_t *counts);
+REAL HistQuantile(uint64_t *col, CADBHISTHEADER *hist, REAL q);
+void Usage(void);
+
+
+/************************************************************************/
+/*>int main(int argc, char **argv)
+   -------------------------------
+   Main program
+
+   16.10.26 Original   By: ACRM
+*/
+int main(int argc, char **argv)
+{
+   FILE           *fp;
+   char           dbfile[MAXBUFF];
+   CADBHEADER     header;
+   CADBHISTHEADER hist;
+   CADBCHAIN      *chains;
+   SIZES          sizes;
+   uint64_t       *counts;
+   BOOL           showHist;
+   int            err;
+
+   if(!ParseCmdLine(argc, argv, dbfile, &showHist))
+   {
+      Usage();
+      return(0);
+   }
+
+   if((fp=fopen(dbfile,"rb"))==NULL)
+   {
+      fprintf(stderr,"Can't open database: %s\n",dbfile);
+      return(1);
+   }
+   if((err=CADBReadHeader(fp, &header)) != CADB_OK)
+   {
+      if(err == CADB_ERR_MAGIC)
+         fprintf(stderr,"Not a binary database (a text database or \
+shard manifest?): %s\n", dbfile);
+      else
+         fprintf(stderr,"%s: %s\n",CADBError(err),dbfile);
+      fclose(fp);
+      return(1);
+   }
+   if((chains = CADBReadChainTable(fp, &header))==NULL)
+   {
+      fprintf(stderr,"Unable to read chain table from %s\n",dbfile);
+      fclose(fp);
+      return(1);
+   }
+
+   if(!GetSizes(fp, dbfile, &header, chains, &sizes))
+   {
+      fprintf(stderr,"Unable to read chain blocks from %s\n",dbfile);
+      free(chains);
+      fclose(fp);
+      return(1);
+   }
+
+   counts = CADBReadHistograms(fp, &header, &hist);
+   PrintSummary(stdout, dbfile, &header, &hist, counts);
+   PrintSizes(stdout, &header, &sizes);
+   if(counts != NULL)
+   {
+      PrintDistanceSpread(stdout, &hist, counts);
+      if(showHist)
+         PrintHistograms(stdout, &hist, counts);
+      free(counts);
+   }
+   else if(header.layout != CADB_LAYOUT_COORD)
+   {
+      printf("\nThe database has no distance histograms\n");
+   }
+
+   free(chains);
+   fclose(fp);
+   return(0);
+}
+
+
+/************************************************************************/
+/*>BOOL ParseCmdLine(int argc, char **argv, char *dbfile,
+                     BOOL *showHist)
+   ----------------------------------------------------
+   Input:   int    argc         Argument count
+            char   **argv       Argument array
+   Output:  char   *dbfile      Database file
+            BOOL   *showHist    Print the full histograms
+   Returns: BOOL                Success?
+
+   Parse the command line
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL ParseCmdLine(int argc, char **argv, char *dbfile, BOOL *showHist)
+{
+   argc--;
+   argv++;
+
+   *showHist = FALSE;
+
+   while(argc)
+   {
+      if(argv[0][0] == '-')
+      {
+         switch(argv[0][1])
+         {
+         case 'h':
+            *showHist = TRUE;
+            break;
+         default:
+            return(FALSE);
+            break;
+         }
+      }
+      else
+      {
+         /* Check that there is exactly 1 argument left                 */
+         if((argc != 1) || (strlen(argv[0]) >= MAXBUFF))
+            return(FALSE);
+
+         strcpy(dbfile, argv[0]);
+         return(TRUE);
+      }
+      argc--;
+      argv++;
+   }
+
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>BOOL GetSizes(FILE *fp, char *dbfile, CADBHEADER *header,
+                 CADBCHAIN *chains, SIZES *sizes)
+   ---------------------------------------------------------
+   Inputs:     FILE       *fp       Database file pointer
+               char       *dbfile   Database file name
+               CADBHEADER *header   Header of the database
+               CADBCHAIN  *chains   The chain table
+   Outputs:    SIZES      *sizes    Sizes of the sections of the file
+   Returns:    BOOL                 Success?
+
+   Works out how many bytes of the database are taken by each section.
+   For a quantized database, the directory and header of each column
+   block are read to split the distances into the directory, block
+   headers and the (possibly compressed) bins and residuals. The CA
+   angles at the end of each chain block (makecadb -a) are counted 
+   separately from the distances.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added angles
+   16.10.26 Added the loop window tables
+   16.10.26 Added the key index
+*/
+BOOL GetSizes(FILE *fp, char *dbfile, CADBHEADER *header,
+              CADBCHAIN *chains, SIZES *sizes)
+{
+   char        filename[MAXBUFF+8];
+   struct stat statbuf;
+   uint64_t    chainNum,
+               naliases = 0,
+               block;
+
+   memset(sizes, 0, sizeof(SIZES));
+
+   for(chainNum=0; chainNum<header->nchains; chainNum++)
+   {
+      block = (uint64_t)chains[chainNum].nres * sizeof(CADBRESID);
+      sizes->resids    += block;
+      sizes->distances += chains[chainNum].size - block;
+      if(header->flags & CADB_FLAG_ANGLES)
+      {
+         sizes->angles    += 4 * (uint64_t)chains[chainNum].nres;
+         sizes->distances -= 4 * (uint64_t)chains[chainNum].nres;
+      }
+
+      if((header->layout == CADB_LAYOUT_QUANT) &&
+         !AddQuantSizes(fp, header, &(chains[chainNum]), sizes))
+         return(FALSE);
+   }
+
+   sizes->chainTable = header->nchains * sizeof(CADBCHAIN);
+   if(header->flags & CADB_FLAG_ALIASES)
+   {
+      if(fseeko(fp, (off_t)(header->chainTable + sizes->chainTable),
+                SEEK_SET) ||
+         (fread(&naliases, sizeof(uint64_t), 1, fp) != 1))
+         return(FALSE);
+      sizes->aliasTable = sizeof(uint64_t) +
+                          naliases * sizeof(CADBALIAS);
+   }
+
+   if(stat(dbfile, &statbuf))
+      return(FALSE);
+   sizes->total = (uint64_t)statbuf.st_size;
+
+   /* Whatever follows the alias table is the histograms                */
+   if(header->flags & CADB_FLAG_HISTOGRAMS)
+      sizes->histograms = sizes->total - header->chainTable -
+                          sizes->chainTable - sizes->aliasTable;
+
+   sprintf(filename, "%s%s", dbfile, CADB_INDEX_EXT);
+   if(!stat(filename, &statbuf))
+      sizes->index = (uint64_t)statbuf.st_size;
+
+   sprintf(filename, "%s%s", dbfile, CADB_KEY_EXT);
+   if(!stat(filename, &statbuf))
+      sizes->keys = (uint64_t)statbuf.st_size;
+
+   GetWindowSizes(dbfile, sizes);
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void GetWindowSizes(char *dbfile, SIZES *sizes)
+   -----------------------------------------------
+   Inputs:     char   *dbfile   Database file name
+   I/O:        SIZES  *sizes    The lengths and sizes of the loop window
+                                tables are filled in
+
+   Finds the loop window tables written by makecadb -w. At most 
+   CADB_MAXWINDOWS are listed, in order of loop length.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 The search is done by CADBFindWindowTables()
+*/
+void GetWindowSizes(char *dbfile, SIZES *sizes)
+{
+   char        filename[MAXBUFF+16];
+   struct stat statbuf;
+   int         lengths[CADB_MAXWINDOWS],
+               nfound,
+               i;
+
+   nfound = CADBFindWindowTables(dbfile, lengths, CADB_MAXWINDOWS);
+   for(i=0; i<nfound; i++)
+   {
+      CADBWindowFilename(filename, dbfile, lengths[i]);
+      if(stat(filename, &statbuf))
+         continue;
+      sizes->windowLength[sizes->nwindows] = lengths[i];
+      sizes->windowSize[sizes->nwindows]   = (uint64_t)statbuf.st_size;
+      sizes->nwindows++;
+   }
+}
+
+
+/************************************************************************/
+/*>BOOL AddQuantSizes(FILE *fp, CADBHEADER *header, CADBCHAIN *chain,
+                      SIZES *sizes)
+   ------------------------------------------------------------------
+   Inputs:     FILE       *fp       Database file pointer
+               CADBHEADER *header   Header of the database
+               CADBCHAIN  *chain    Chain table entry
+   I/O:        SIZES      *sizes    Sizes of the sections of the file.
+                                    The quantized column sizes of this
+                                    chain are added. qraw counts the
+                                    bins and residuals before any
+                                    compression
+
+   Adds the sizes of the column directory and column blocks of a chain
+   in a quantized database.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL AddQuantSizes(FILE *fp, CADBHEADER *header, CADBCHAIN *chain,
+                   SIZES *sizes)
+{
+   uint32_t   *qdir;
+   CADBQBLOCK block;
+   int        ncol = (int)((header->flags & CADB_FLAG_FORWARD) ?
+                           header->ndist : 2 * header->ndist),
+              col;
+   BOOL       ok   = TRUE;
+
+   if((qdir = (uint32_t *)malloc((ncol + 1) * sizeof(uint32_t)))==NULL)
+      return(FALSE);
+
+   if(fseeko(fp, (off_t)(chain->offset +
+                         (uint64_t)chain->nres * sizeof(CADBRESID)),
+             SEEK_SET) ||
+      (fread(qdir, sizeof(uint32_t), ncol+1, fp) != (size_t)(ncol+1)))
+      ok = FALSE;
+   sizes->qdir += (ncol + 1) * sizeof(uint32_t);
+
+   for(col=0; ok && (col<ncol); col++)
+   {
+      if(fseeko(fp, (off_t)(chain->offset + qdir[col]), SEEK_SET) ||
+         (fread(&block, sizeof(CADBQBLOCK), 1, fp) != 1))
+      {
+         ok = FALSE;
+         break;
+      }
+      sizes->qheaders += sizeof(CADBQBLOCK);
+      sizes->qstored  += block.stored;
+      sizes->qraw     += CADB_QRAWSIZE(chain->nres, block.shift);
+   }
+
+   free(qdir);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>void PrintSummary(FILE *out, char *dbfile, CADBHEADER *header,
+                     CADBHISTHEADER *hist, uint64_t *counts)
+   ---------------------------------------------------------------
+   Inputs:     FILE           *out     Output file
+               char           *dbfile  Database file name
+               CADBHEADER     *header  Header of the database
+               CADBHISTHEADER *hist    Header of the histograms
+               uint64_t       *counts  Histogram counts (NULL if there
+                                       are none)
+
+   Prints the layout and counts of the database. The counts including
+   aliases are taken from the histograms.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Notes whether the CA angles are stored
+*/
+void PrintSummary(FILE *out, char *dbfile, CADBHEADER *header,
+                  CADBHISTHEADER *hist, uint64_t *counts)
+{
+   static char *layouts[] = {"row", "column", "coordinate", "quantized"};
+   char        date[MAXBUFF];
+   time_t      built = (time_t)header->date;
+
+   strftime(date, MAXBUFF, "%Y-%m-%d %H:%M:%S", gmtime(&built));
+
+   fprintf(out,"Database:      %s\n", dbfile);
+   fprintf(out,"Built:         %s UTC\n", date);
+   fprintf(out,"PDB directory: %s\n", header->pdbdir);
+   fprintf(out,"Layout:        %s%s%s\n",
+           ((header->layout <= CADB_LAYOUT_QUANT) ?
+            layouts[header->layout] : "unknown"),
+           ((header->flags & CADB_FLAG_FORWARD) ? ", forward only" : ""),
+           ((header->flags & CADB_FLAG_ANGLES) ? ", CA angles" : ""));
+   fprintf(out,"Offsets:       %u\n", header->ndist);
+   fprintf(out,"Chains:        %llu",
+           (unsigned long long)header->nchains);
+   if((counts != NULL) && (hist->nchains > header->nchains))
+      fprintf(out," (and %llu aliases)",
+              (unsigned long long)(hist->nchains - header->nchains));
+   fprintf(out,"\nRecords:       %llu",
+           (unsigned long long)header->nrecords);
+   if((counts != NULL) && (hist->nrecords > header->nrecords))
+      fprintf(out," (and %llu in aliases)",
+              (unsigned long long)(hist->nrecords - header->nrecords));
+   fprintf(out,"\n");
+}
+
+
+/************************************************************************/
+/*>void PrintSizes(FILE *out, CADBHEADER *header, SIZES *sizes)
+   ------------------------------------------------------------
+   Inputs:     FILE       *out     Output file
+               CADBHEADER *header  Header of the database
+               SIZES      *sizes   Sizes of the sections of the file
+
+   Prints the size of each section of the database.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added angles
+   16.10.26 Added the loop window tables
+   16.10.26 Added the key index
+*/
+void PrintSizes(FILE *out, CADBHEADER *header, SIZES *sizes)
+{
+   char label[MAXBUFF];
+   int  i;
+
+   fprintf(out,"\nSize (bytes)\n");
+   fprintf(out,"   Header               %12llu\n",
+           (unsigned long long)sizeof(CADBHEADER));
+   fprintf(out,"   Residue identifiers  %12llu\n",
+           (unsigned long long)sizes->resids);
+   if(header->layout == CADB_LAYOUT_QUANT)
+   {
+      fprintf(out,"   Column directories   %12llu\n",
+              (unsigned long long)sizes->qdir);
+      fprintf(out,"   Column headers       %12llu\n",
+              (unsigned long long)sizes->qheaders);
+      fprintf(out,"   Bins and residuals   %12llu",
+              (unsigned long long)sizes->qstored);
+      if(sizes->qraw)
+         fprintf(out,"  (%.1f%% of %llu uncompressed)",
+                 100.0 * (REAL)sizes->qstored / (REAL)sizes->qraw,
+                 (unsigned long long)sizes->qraw);
+      fprintf(out,"\n");
+   }
+   else
+   {
+      fprintf(out,"   %-20s %12llu\n",
+              ((header->layout == CADB_LAYOUT_COORD) ?
+               "Coordinates" : "Distances"),
+              (unsigned long long)sizes->distances);
+   }
+   if(sizes->angles)
+      fprintf(out,"   CA angles            %12llu\n",
+              (unsigned long long)sizes->angles);
+   fprintf(out,"   Chain table          %12llu\n",
+           (unsigned long long)sizes->chainTable);
+   if(sizes->aliasTable)
+      fprintf(out,"   Alias table          %12llu\n",
+              (unsigned long long)sizes->aliasTable);
+   if(sizes->histograms)
+      fprintf(out,"   Histograms           %12llu\n",
+              (unsigned long long)sizes->histograms);
+   fprintf(out,"   Total                %12llu\n",
+           (unsigned long long)sizes->total);
+   if(sizes->index)
+   {
+      sprintf(label, "Range index (%s)", CADB_INDEX_EXT);
+      fprintf(out,"   %-20s %12llu\n", label,
+              (unsigned long long)sizes->index);
+   }
+   for(i=0; i<sizes->nwindows; i++)
+   {
+      sprintf(label, "Window table (%s%d)", CADB_WINDOW_EXT,
+              sizes->windowLength[i]);
+      fprintf(out,"   %-20s %12llu\n", label,
+              (unsigned long long)sizes->windowSize[i]);
+   }
+   if(sizes->keys)
+   {
+      sprintf(label, "Key index (%s)", CADB_KEY_EXT);
+      fprintf(out,"   %-20s %12llu\n", label,
+              (unsigned long long)sizes->keys);
+   }
+}
+
+
+/************************************************************************/
+/*>void PrintDistanceSpread(FILE *out, CADBHISTHEADER *hist,
+                            uint64_t *counts)
+   ---------------------------------------------------------
+   Inputs:     FILE           *out     Output file
+               CADBHISTHEADER *hist    Header of the histograms
+               uint64_t       *counts  Histogram counts
+
+   Prints the number of distances and missing distances at each DP
+   offset with the 5th, 50th and 95th percentiles and the range of the
+   distances. Aliases are included. Values are interpolated within the
+   histogram bins so are approximate.
+
+   16.10.26 Original   By: ACRM
+*/
+void PrintDistanceSpread(FILE *out, CADBHISTHEADER *hist,
+                         uint64_t *counts)
+{
+   uint64_t *col;
+   int      nbins = (int)hist->nbins,
+            first,
+            last,
+            k;
+   REAL     width = hist->binWidth / CADB_SCALE;
+
+   fprintf(out,"\nDistances (Angstroms, to %.2f)\n", width);
+   fprintf(out,"Offset      Present     Missing      Min      5%%     \
+50%%     95%%      Max\n");
+   for(k=0; k<(int)hist->ndist; k++)
+   {
+      col = counts + (size_t)k * (nbins + 1);
+      for(first=0; (first<nbins) && !col[first]; first++);
+      for(last=nbins-1; (last>=0) && !col[last]; last--);
+
+      fprintf(out,"%6d %12llu %11llu", k+1,
+              (unsigned long long)(hist->nrecords - col[nbins]),
+              (unsigned long long)col[nbins]);
+      if(last < 0)
+      {
+         fprintf(out,"\n");
+         continue;
+      }
+      fprintf(out," %8.2f %7.2f %7.2f %7.2f %8.2f\n",
+              first * width,
+              HistQuantile(col, hist, 0.05),
+              HistQuantile(col, hist, 0.50),
+              HistQuantile(col, hist, 0.95),
+              (last + 1) * width);
+   }
+}
+
+
+/************************************************************************/
+/*>void PrintHistograms(FILE *out, CADBHISTHEADER *hist,
+                        uint64_t *counts)
+   -----------------------------------------------------
+   Inputs:     FILE           *out     Output file
+               CADBHISTHEADER *hist    Header of the histograms
+               uint64_t       *counts  Histogram counts
+
+   Prints the full histogram for each DP offset. Empty bins are left
+   out.
+
+   16.10.26 Original   By: ACRM
+*/
+void PrintHistograms(FILE *out, CADBHISTHEADER *hist, uint64_t *counts)
+{
+   uint64_t *col;
+   int      nbins = (int)hist->nbins,
+            bin,
+            k;
+   REAL     width = hist->binWidth / CADB_SCALE;
+
+   for(k=0; k<(int)hist->ndist; k++)
+   {
+      col = counts + (size_t)k * (nbins + 1);
+      fprintf(out,"\nHistogram for offset %d\n", k+1);
+      for(bin=0; bin<nbins; bin++)
+      {
+         if(col[bin])
+            fprintf(out,"%8.2f - %8.2f %12llu\n", bin * width,
+                    (bin + 1) * width, (unsigned long long)col[bin]);
+      }
+      fprintf(out,"   Missing          %12llu\n",
+              (unsigned long long)col[nbins]);
+   }
+}
+
+
+/************************************************************************/
+/*>REAL HistQuantile(uint64_t *col, CADBHISTHEADER *hist, REAL q)
+   --------------------------------------------------------------
+   Inputs:     uint64_t       *col     Histogram counts for one offset
+               CADBHISTHEADER *hist    Header of the histograms
+               REAL           q        Quantile (0..1)
+   Returns:    REAL                    The distance (Angstroms) below
+                                       which a fraction q of the
+                                       distances lie
+
+   Finds a quantile of the distances (ignoring the missing distances),
+   interpolating within the bin in which it falls.
+
+   16.10.26 Original   By: ACRM
+*/
+REAL HistQuantile(uint64_t *col, CADBHISTHEADER *hist, REAL q)
+{
+   uint64_t total = 0;
+   REAL     target,
+            sum   = 0.0,
+            width = hist->binWidth / CADB_SCALE;
+   int      nbins = (int)hist->nbins,
+            bin;
+
+   for(bin=0; bin<nbins; bin++)
+      total += col[bin];
+   target = q * (REAL)total;
+
+   for(bin=0; bin<nbins; bin++)
+   {
+      if(col[bin] && (sum + (REAL)col[bin] >= target))
+         return((bin + (target - sum) / (REAL)col[bin]) * width);
+      sum += (REAL)col[bin];
+   }
+   return(nbins * width);
+}
+
+
+/************************************************************************/
+/*>void Usage(void)
+   ----------------
+   Print a usage message
+
+   16.10.26 Original   By: ACRM
+   16.10.26 V1.1
+   16.10.26 V1.2
+   16.10.26 V1.3
+*/
+void Usage(void)
+{
+   fprintf(stderr,"\ncadbstat V1.3 (c) 2026, UCL, Dr. Andrew C.R. \
+Martin\n");
+
+   fprintf(stderr,"\nUsage: cadbstat [-h] dbfile\n");
+   fprintf(stderr,"       -h Print the full distance histograms\n");
+
+   fprintf(stderr,"\nPrints the layout, counts and a breakdown of the \
+size of a binary\n");
+   fprintf(stderr,"database written by makecadb and, from its distance \
+histograms, the\n");
+   fprintf(stderr,"spread of the distances at each offset.\n\n");
+}
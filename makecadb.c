@@ -3,11 +3,11 @@
    Program:    makecadb
    File:       makecadb.c
    
-   Version:    V1.2
-   Date:       18.01.02
+   Version:    V1.27
+   Date:       16.10.26
    Function:   Create a CA distance matrix database from a PDB directory
    
-   Copyright:  (c) UCL, Dr. Andrew C. R. Martin 1998-2002
+   Copyright:  (c) UCL, Dr. Andrew C. R. Martin 1998-2026
    Author:     Dr. Andrew C. R. Martin
    Address:    Biomolecular Structure & Modelling Unit,
                Department of Biochemistry & Molecular Biology,
@@ -41,6 +41,111 @@
    As a rough estimate, using 20 distances, the resulting database file
    is 25% larger than the source PDB files.
 
+   With -b, a binary database is written instead (see cadb.h). This
+   stores distances as 16-bit fixed point values and is about a third
+   of the size of the text form. With -c, the binary database stores
+   the distances for each chain a column at a time so that searches
+   only need to read the columns that they constrain.
+
+   With -F, only the DP (forward) distances are written. The DM 
+   distance for residue i at offset k is the DP distance for residue
+   i-k at offset k, so searchcadb reconstructs the DM distances from 
+   the preceding records. This halves the size of the database.
+
+   With -q, the distances in each column are stored as 8-bit bins 
+   with a residual (see cadb.h) and each column is compressed 
+   separately. The residuals are only needed when a distance falls in a
+   bin at the edge of a constraint so searchcadb decodes them for 
+   those records alone. The database is typically less than a quarter
+   of the size of the -b database so it stays in the page cache across
+   repeated searches.
+
+   With -C, a binary database of CA coordinates is written instead of
+   distances. searchcadb calculates the distances that it needs, so 
+   there is no limit on the offsets that may be searched.
+
+   With -res, -maxb and -minocc, structures with a poor resolution and
+   CA atoms with a high B-factor or low occupancy are left out of the 
+   database as the files are read, rather than every search having to 
+   check them. Reading a file stops as soon as its resolution is found 
+   to be too poor. Only the first model of a multi-model file is used
+   and, by default, the alternative position with the highest occupancy
+   is kept; -alt prefers a given alternative position instead.
+
+   With -x, a range index (see cadb.h) is written alongside a binary
+   distance database. For each DP offset, this lists the records 
+   sorted into bins of distance, so searchcadb can find the records 
+   which might satisfy a tight constraint without reading the whole 
+   database.
+
+   With -w, a loop window table (see cadb.h) is written alongside a 
+   binary distance database for each loop length given. Each row holds
+   the DP distances of a record and the DM distances of the record at
+   the other end of the loop, so searchcadb can test a loop of that 
+   length from a single row without reading the database itself.
+
+   With -K, a key index (see cadb.h) is written alongside a binary 
+   database. This lists the chains (and aliases) sorted by PDB code and
+   chain label, so searchcadb can go straight to the chain block for a
+   LOOKUP without reading the chain table.
+
+   With -a, the CA virtual bond angle CA(i-1)-CA(i)-CA(i+1) and the CA
+   pseudo-torsion CA(i-1)-CA(i)-CA(i+1)-CA(i+2) of each residue are 
+   calculated along with its distances. In the text database, they 
+   follow the distances of each record; in a binary distance database,
+   they are a block at the end of each chain (see cadb.h). searchcadb
+   tests them with the ANGLE and TORSION commands. A coordinate 
+   database does not need them since searchcadb calculates them.
+
+   With -s, the one-letter residue type of each record is stored in 
+   the spare bytes of its residue identifier in a binary database, or
+   at the end of the record (after any angles) in the text database, so
+   that searchcadb can restrict a search by sequence (SEQ) without 
+   going back to the PDB files. Without -s, the output is the same as 
+   before the residue types were added.
+
+   A binary distance database ends with a histogram of the distances 
+   at each DP offset (see cadb.h), counting the records of aliases as
+   well. searchcadb uses these to estimate the number of hits for a 
+   set of constraints without searching and cadbstat prints them.
+
+   With -shards N, the database is split into N complete databases
+   (outfile.0 ... outfile.N-1), each with its own header. Each PDB file
+   is assigned to a shard by a hash of its PDB code or, with -balance,
+   to the shard with the fewest records so far. outfile itself is then 
+   a shard manifest listing the shards, which searchcadb searches in
+   parallel.
+
+   With -R, a chain which duplicates a chain already written (as in a
+   homo-oligomer or a repeated deposition) is not stored. Instead, it
+   is added to the alias table at the end of the database and 
+   searchcadb reports its hits from those of the stored chain. Chains 
+   are compared by their residue identifiers and DP distances, which
+   are independent of orientation so no superposition is needed. The
+   distances must agree to within the tolerance given with -R. Only 
+   the hash table of stored chains is kept in memory; their distances 
+   are kept in a temporary file for comparison. With -shards, 
+   duplicates are only found within each shard.
+
+   mmCIF files are recognized from the data_ line at the start of the
+   file and the CA atoms are read from the _atom_site loop. The author
+   chain labels are used and may have up to MAXCIFCHAIN characters.
+
+   With -p N, up to N of the upcoming PDB files are read into memory 
+   while the current ones are processed, so the workers are not held 
+   up waiting for each file to be opened and read (as on a network 
+   file system). The reads are queued with io_uring when compiled with
+   HAVE_LIBURING and otherwise by a pool of reader threads. Files are 
+   parsed from the memory buffers (gzipped files are decompressed in 
+   memory with zlib) so the database is the same as without -p.
+
+   With -trace file, the time taken by each stage (read, decompress, 
+   parse, distances and write) for each PDB file is written to file in
+   the Chrome trace event format (which may be loaded into 
+   chrome://tracing or Perfetto) and a summary is printed at the end 
+   of the build. So that the stages may be timed separately, files are
+   read into memory before they are parsed as with -p.
+
 **************************************************************************
 
    Usage:
@@ -53,43 +158,693 @@
    V1.0  06.10.98 Original
    V1.1  11.01.02 Added check that structure contains some CA atoms
    V1.2  18.01.02 Added limit on maximum number of PDB files read
+   V1.3  16.10.26 Added -t to process files in multiple threads. Files
+                  are now handed out largest first and the output is
+                  written in that same order so the database is
+                  independent of readdir() order and thread count
+   V1.4  16.10.26 Added -b to write the binary database format
+   V1.5  16.10.26 Added -c to write the binary database in column layout
+   V1.6  16.10.26 Added -F to write only the forward distances
+   V1.7  16.10.26 Added -C to write a coordinate database
+   V1.8  16.10.26 Text records are formatted into a buffer and written
+                  a chain at a time rather than with an fprintf() for
+                  each distance
+   V1.9  16.10.26 Distances are calculated a chain at a time from 
+                  coordinate arrays using SSE2 or AVX where available
+   V1.10 16.10.26 CA atoms are read directly into a reusable arena 
+                  rather than with ReadPDBAtoms()
+   V1.11 16.10.26 Gzipped PDB files are decompressed in-process using
+                  zlib when compiled with HAVE_ZLIB
+   V1.12 16.10.26 Added -r to scan subdirectories, -e to select files
+                  by extension and -f to read a list of files. Hidden
+                  files and directories are no longer processed
+   V1.13 16.10.26 Added -m to write a manifest and -u to update a 
+                  database, reusing the blocks for unchanged files
+   V1.14 16.10.26 Writes checkpoints while building a database. Added 
+                  -resume to continue a build that stopped and -k to
+                  set the checkpoint interval
+   V1.15 16.10.26 Added -shards to split the database into several 
+                  files listed in a shard manifest
+   V1.16 16.10.26 Reads mmCIF files. Chain labels may now have more 
+                  than one character
+   V1.17 16.10.26 Added -q to write a quantized and compressed 
+                  database
+   V1.18 16.10.26 Added -R to store duplicate chains once with an 
+                  alias table
+   V1.19 16.10.26 Added -res, -maxb, -minocc and -alt to filter the
+                  structures and CA atoms while reading. Reports what
+                  the filters removed
+   V1.20 16.10.26 Added -x to write a range index
+   V1.21 16.10.26 Writes distance histograms at the end of a binary
+                  distance database
+   V1.22 16.10.26 Added -w to write loop window tables
+   V1.23 16.10.26 Added -a to store CA angles and torsions
+   V1.24 16.10.26 Added -s to store the one-letter residue type of each
+                  record
+   V1.25 16.10.26 Added -p to read the PDB files ahead of processing
+   V1.26 16.10.26 Added -trace to time each stage of the build
+   V1.27 16.10.26 Added -K to write a key index
 
 *************************************************************************/
 /* Includes
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
 #include <math.h>
 #include <time.h>
+#include <pthread.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
 #include <dirent.h>
+#include <unistd.h>
+
+/* Vector distance kernels are available on x86 with GCC or clang. The
+   one to use is chosen at run time
+*/
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_LIBURING
+#include <errno.h>
+#include <fcntl.h>
+#include <liburing.h>
+#endif
 
 #include "bioplib/MathType.h"
 #include "bioplib/SysDefs.h"
 #include "bioplib/pdb.h"
 #include "bioplib/macros.h"
 #include "bioplib/general.h"
+#include "bioplib/seq.h"
+
+#include "cadb.h"
 
 /************************************************************************/
 /* Defines and macros
 */
 #define MAXBUFF 160
 #define DEF_NDIST 20
+#define MAXEXT     16
+#define MAXEXTLEN  16
+#define MAXDEPTH   16
+#define DEF_EXTENSIONS ".ent,.pdb,.brk,.cif,.ent.gz,.pdb.gz,.brk.gz,.cif.gz"
+#define MANIFEST_EXT   ".manifest"
+#define MANIFEST_MAGIC "#CADB-MANIFEST"
+#define HASHBUFFSIZE   65536
+#define CKPT_EXT       ".ckpt"
+#define CKPT_MAGIC     "CKPT"
+#define CKPT_VERSION   6
+#define DEF_CKPT_INTERVAL 60
+#define MAXSHARDS  256
+#define MAXTHREADS 256
+#define MAXPDBLINE 160
+#define ARENACHUNK 1024
+#define GZBUFFSIZE (128*1024)
+#define REPHASHSIZE 65536
+#define MAXFILTERSTRING 64
+#define INDEX_MAXMEM    (256*1024*1024)
+#define MAXPREFETCH     1024
+#define MAXPREFETCHREADERS 16
+#define JOBSAHEAD       4     /* Jobs per thread that may be finished
+                                 ahead of the writer                   */
+
+/* Build stages timed with -trace. TRACE_TOPN is the number of slowest
+   files listed in the summary
+*/
+#define TRACE_READ      0
+#define TRACE_INFLATE   1
+#define TRACE_PARSE     2
+#define TRACE_DIST      3
+#define TRACE_WRITE     4
+#define TRACE_NSTAGES   5
+#define TRACE_TOPN      10
+
+/* mmCIF reading. MAXCIFCOL is the highest column of the _atom_site loop
+   that may be used and MAXCIFCHAIN the longest chain label. The CIF_
+   values index the columns that are needed
+*/
+#define MAXCIFLINE  1024
+#define MAXCIFCOL   64
+#define MAXCIFCHAIN 7
+#define CIF_GROUP       0
+#define CIF_AUTH_ATOM   1
+#define CIF_ATOM        2
+#define CIF_ALT         3
+#define CIF_AUTH_CHAIN  4
+#define CIF_CHAIN       5
+#define CIF_AUTH_SEQ    6
+#define CIF_SEQ         7
+#define CIF_INSERT      8
+#define CIF_X           9
+#define CIF_Y          10
+#define CIF_Z          11
+#define CIF_OCC        12
+#define CIF_MODEL      13
+#define CIF_BVAL       14
+#define CIF_COMP       15
+#define CIF_NFIELDS    16
+
+/* Text output buffer. MAXTEXTKEY allows for the residue identifier at 
+   the start of a record and MAXTEXTDIST for each "%.2f " distance up
+   to MAXTEXTVALUE
+*/
+#define TEXTBUFFSIZE 65536
+#define MAXTEXTKEY   64
+#define MAXTEXTDIST  12
+#define MAXTEXTVALUE 1.0e6
+
+/* Build filters. A value of 0 (or a blank altloc) means that the 
+   filter is not used
+*/
+typedef struct
+{
+   REAL maxResol,
+        maxBval,
+        minOcc;
+   char altloc;
+}  FILTER;
+
+/* What the filters dropped from a file. resolution is -1 if the file
+   does not give one
+*/
+typedef struct
+{
+   REAL resolution;
+   int  nBval,
+        nOcc,
+        nAltPos;
+   BOOL poorResol,
+        laterModels;
+}  FILTERSTATS;
+
+/* Command line options                                                 */
+typedef struct
+{
+   char pdbdir[MAXBUFF],
+        outfile[MAXBUFF],
+        listfile[MAXBUFF],
+        prevdb[MAXBUFF],
+        tracefile[MAXBUFF],
+        extensions[MAXEXT][MAXEXTLEN];
+   int  ndist,
+        limit,
+        nthreads,
+        layout,
+        nextensions,
+        ckptInterval,
+        nshards,
+        windows[CADB_MAXWINDOWS],
+        nwindows,
+        prefetch;
+   REAL dedupeTol;
+   FILTER filter;
+   BOOL binary,
+        forward,
+        recurse,
+        manifest,
+        resume,
+        balance,
+        dedupe,
+        index,
+        keys,
+        angles,
+        sequence;
+}  OPTIONS;
+
+/* An entry in a database manifest. Records a PDB file and the position
+   of its block in the database (offset and length in bytes, the first 
+   record and number of records and the first chain table entry and 
+   number of chains)
+*/
+typedef struct
+{
+   char     filename[MAXBUFF];
+   off_t    size;
+   time_t   mtime;
+   uint64_t hash,
+            offset,
+            length,
+            firstRecord,
+            nrecords,
+            firstChain,
+            nchains;
+}  MANIFESTENTRY;
+
+/* The previous database when updating with -u                          */
+typedef struct
+{
+   FILE          *fp;
+   MANIFESTENTRY *entries;
+   CADBCHAIN     *chains;
+   uint64_t      nchains;
+   int           nentries;
+}  PREVDB;
+
+/* Timing of a PDB file for -trace. For each stage, start is when it
+   started (seconds from the start of the build), time how long it 
+   took and thread the thread that did it (0 if the stage was not done
+   for this file)
+*/
+typedef struct
+{
+   double   start[TRACE_NSTAGES],
+            time[TRACE_NSTAGES];
+   int      thread[TRACE_NSTAGES],
+            natoms;
+   uint64_t bytesRead,
+            bytesWritten;
+}  JOBTRACE;
+
+/* A PDB file to be processed and, once it has been processed, the
+   output generated for that file. For binary output, the chain table
+   entries have offsets and record numbers relative to the start of
+   this file's data. When updating a database, prev is the file's entry
+   in the previous manifest. When removing duplicate chains, sigs holds
+   the signature of each chain (see AddJobSignature()). When reading 
+   ahead with -p, buffer holds the contents of the file once fetched is
+   set (NULL if it could not be read, in which case the file is read as
+   usual). For binary output, dataHash is the hash of the output which
+   goes into the build fingerprint (see HashJobData())
+*/
+typedef struct
+{
+   char          filename[MAXBUFF],
+                 pdbcode[16];
+   off_t         size;
+   time_t        mtime;
+   uint64_t      hash,
+                 dataHash;
+   MANIFESTENTRY *prev;
+   char          *data;
+   size_t        length;
+   CADBCHAIN     *chains;
+   uint16_t      *sigs;
+   size_t        nsigs;
+   int           nchains,
+                 maxChains;
+   uint64_t      nrecords;
+   FILTERSTATS   stats;
+   JOBTRACE      trace;
+   char          *buffer;
+   size_t        bufferLength;
+   BOOL          done,
+                 reused,
+                 fetched;
+}  PDBJOB;
+
+/* A PDB file being read by ReadCaAtoms(). If gz is set, the file is 
+   gzipped and is decompressed as it is read. If mem is set, the file
+   has been read into memory (see OpenPrefetched()) and is read from
+   there; inflated is set if mem was allocated to hold the 
+   decompressed contents of a gzipped file
+*/
+typedef struct
+{
+   FILE   *fp;
+#ifdef HAVE_ZLIB
+   gzFile gz;
+#endif
+   char   *mem;
+   size_t memLength,
+          memPos;
+   BOOL   inflated;
+}  PDBFILE;
+
+/* Identifier for a CA atom read from a PDB file. chain is a string 
+   since mmCIF chain labels may be several characters. restype is the
+   one-letter residue type; it is not part of the identifier so comes
+   last and alternative positions are compared up to RESIDSIZE
+*/
+typedef struct
+{
+   char chain[MAXCIFCHAIN+1];
+   int  resnum;
+   char insert,
+        restype;
+}  CARESID;
+#define RESIDSIZE offsetof(CARESID, restype)
+
+/* The CA atoms read from a PDB file. Each worker thread has its own
+   arena which is reused for every file so that it only grows to the 
+   size of the largest file. The coordinates are stored as separate
+   x, y and z arrays for the distance kernels. stats records what the
+   filters dropped from the file
+*/
+typedef struct
+{
+   REAL    *x, *y, *z;
+   CARESID *resids;
+   int     natoms,
+           maxAtoms;
+   FILTERSTATS stats;
+}  CAARENA;
+
+/* Working storage for calculating the distances for a chain. pair 
+   holds the distances at one offset, dists the rows of distances for
+   the chain and angles its CA angles and torsions
+*/
+typedef struct
+{
+   REAL *pair,
+        *dists,
+        *angles;
+}  DISTWORK;
+
+/* Distance kernel                                                      */
+typedef void (*PAIRDISTFN)(REAL *x, REAL *y, REAL *z, int npair, int k,
+                           REAL *dist);
+
+/* Buffer for formatting text records                                  */
+typedef struct
+{
+   FILE   *fp;
+   char   *buffer;
+   size_t length,
+          size,
+          maxRecord;
+}  TEXTOUT;
+
+/* A list of jobs while it is being built                              */
+typedef struct
+{
+   PDBJOB *jobs;
+   int    njobs,
+          maxJobs;
+}  JOBLIST;
+
+/* The list of jobs shared between the worker threads. A job is only
+   started if it is less than maxAhead jobs ahead of nextWritten, the
+   next job to be written, so that the output waiting to be written is
+   bounded
+*/
+typedef struct
+{
+   PDBJOB          *jobs;
+   OPTIONS         *opts;
+   int             njobs,
+                   nextJob,
+                   nextWritten,
+                   maxAhead;
+   pthread_mutex_t mutex;
+   pthread_cond_t  jobDone,
+                   written;
+}  JOBQUEUE;
+
+/* Reading ahead of the PDB files (-p). Jobs are fetched in job order
+   from nextRead and nbuffers counts those that have been started but
+   not yet released by ReleasePrefetch(), which is limited to depth. 
+   The reads are done by nreaders threads or, if uring is set, by a
+   single thread using io_uring
+*/
+typedef struct
+{
+   PDBJOB          *jobs;
+   int             njobs,
+                   nextRead,
+                   nbuffers,
+                   depth,
+                   nreaders;
+   BOOL            stop,
+                   uring;
+   pthread_t       readers[MAXPREFETCHREADERS];
+   pthread_mutex_t mutex;
+   pthread_cond_t  fetched,
+                   space;
+#ifdef HAVE_LIBURING
+   struct io_uring ring;
+#endif
+}  PREFETCH;
+
+#ifdef HAVE_LIBURING
+/* A file being read by io_uring. nread is the number of bytes read so
+   far
+*/
+typedef struct
+{
+   PDBJOB *job;
+   int    fd;
+   size_t nread;
+   double start;
+}  URINGREAD;
+#endif
+
+/* Tracing with -trace. start is the time at which the build started.
+   Each thread is given a number (from 1) the first time that it 
+   records a stage, which is kept with threadKey
+*/
+typedef struct
+{
+   struct timespec start;
+   pthread_key_t   threadKey;
+   pthread_mutex_t mutex;
+   int             nthreads;
+   BOOL            on;
+}  TRACE;
+
+/* A chain stored in the database when removing duplicate chains. hash
+   is the hash of the residue identifiers and sigOffset the position of
+   the residue identifiers and signature in the signature file
+*/
+typedef struct _repchain
+{
+   struct _repchain *next;
+   uint64_t         hash,
+                    chain;
+   off_t            sigOffset;
+}  REPCHAIN;
+
+/* The database being written. When the database is split into shards,
+   there is one of these for each shard. fingerprint accumulates the
+   build fingerprint stored in the header
+*/
+typedef struct
+{
+   FILE       *fp;
+   CADBHEADER header;
+   CADBCHAIN  *chains;
+   uint64_t   offset,
+              nrecords,
+              nchains,
+              maxChains;
+   MANIFESTENTRY *entries;
+   int        nentries,
+              maxEntries,
+              ndist,
+              firstJob,
+              ckptInterval;
+   char       filename[MAXBUFF+16],
+              ckptFile[MAXBUFF+16],
+              filters[MAXFILTERSTRING];
+   time_t     lastCheckpoint;
+   uint64_t   listHash,
+              fingerprint;
+   REPCHAIN   **repHash;
+   CADBALIAS  *aliases;
+   uint64_t   naliases,
+              maxAliases,
+              nAliasRecords;
+   FILE       *sigFp;
+   unsigned char *sigBuffer;
+   size_t     sigBufferSize;
+   int        dedupeTol;
+   BOOL       binary,
+              forward,
+              angles,
+              sequence,
+              manifest,
+              dedupe,
+              error;
+}  DBOUT;
+
+/* Header of a checkpoint file. This is followed by the chain table and
+   manifest entries written so far
+*/
+typedef struct
+{
+   char     magic[4];
+   uint32_t version,
+            binary,
+            layout,
+            ndist,
+            forward,
+            angles,
+            sequence;
+   char     filters[MAXFILTERSTRING];
+   uint64_t njobsDone,
+            listHash,
+            fingerprint,
+            offset,
+            nrecords,
+            nchains,
+            nentries;
+}  CKPTHEADER;
+
+/* Workspace used when reading back the DP distances of a chain to 
+   write the range index or the histograms
+*/
+typedef struct
+{
+   uint16_t      *dist,
+                 *rowBuffer;
+   unsigned char *qraw,
+                 *qstored;
+   int           ndist;
+}  DPWORK;
 
 /************************************************************************/
 /* Globals
 */
+PAIRDISTFN gPairDistances = NULL;
+PREVDB     gPrevDB;
+PREFETCH   gPrefetch;
+TRACE      gTrace;
 
 /************************************************************************/
 /* Prototypes
 */
 int main(int argc, char **argv);
-void ProcessAllFiles(FILE *out, char *pdbdir, int ndist, int limit);
-void ProcessFile(FILE *out, char *filename, int ndist);
-void CalcDistances(FILE *out, char *pdbcode, PDB **pdbidx, 
-                   int natoms, int ndist);
-BOOL ParseCmdLine(int argc, char **argv, char *pdbdir, char *outfile, 
-                  int *ndist, int *limit);
+void WriteHeader(DBOUT *db, OPTIONS *opts);
+void InitDatabase(DBOUT *db, OPTIONS *opts);
+BOOL FinishDatabase(DBOUT *db);
+BOOL WriteIndex(char *dbfile);
+BOOL WriteKeyIndex(char *dbfile);
+BOOL WriteWindows(char *dbfile, OPTIONS *opts);
+void RemoveStaleFiles(char *dbfile);
+void FillWindowRows(uint16_t *dist, int nres, int ndist, int length,
+                    uint16_t *rows);
+BOOL SetWindowLengths(char *lenlist, OPTIONS *opts);
+uint32_t *CountIndexBins(FILE *fp, CADBHEADER *header, 
+                         CADBCHAIN *chains, CADBINDEXHEADER *index,
+                         DPWORK *work);
+BOOL FillIndexRecords(FILE *fp, FILE *out, CADBHEADER *header, 
+                      CADBCHAIN *chains, CADBINDEXHEADER *index,
+                      uint32_t *bins, DPWORK *work);
+BOOL ReadDPColumns(FILE *fp, CADBHEADER *header, CADBCHAIN *chain,
+                   DPWORK *work);
+BOOL AllocDPWork(DPWORK *work, int ndist, int maxres);
+void FreeDPWork(DPWORK *work);
+BOOL WriteHistograms(DBOUT *db);
+void ProcessAllFiles(DBOUT *db, OPTIONS *opts);
+PDBJOB *ListPDBFiles(OPTIONS *opts, int *njobs);
+BOOL ScanPDBDir(char *dirname, OPTIONS *opts, int depth, JOBLIST *list);
+BOOL ReadPDBList(char *listfile, OPTIONS *opts, JOBLIST *list);
+BOOL MatchExtension(char *filename, OPTIONS *opts);
+BOOL AddJob(JOBLIST *list, char *filename, struct stat *statbuf);
+BOOL SetExtensions(char *extlist, OPTIONS *opts);
+BOOL OpenPrevDB(OPTIONS *opts);
+BOOL ReadManifest(char *filename, OPTIONS *opts);
+int  CompareEntries(const void *entry1, const void *entry2);
+MANIFESTENTRY *FindPrevEntry(char *filename);
+BOOL ReusePrevBlock(PDBJOB *job);
+BOOL ReuseOrHash(PDBJOB *job);
+BOOL HashFile(char *filename, uint64_t *hash);
+BOOL AddManifestEntry(DBOUT *db, PDBJOB *job);
+BOOL WriteManifest(DBOUT *db, OPTIONS *opts);
+BOOL OpenShards(DBOUT *db, OPTIONS *opts);
+DBOUT *ShardForJob(DBOUT *db, PDBJOB *job, OPTIONS *opts);
+BOOL WriteShardManifest(DBOUT *db, OPTIONS *opts);
+void ReportReuse(PDBJOB *jobs, int njobs, OPTIONS *opts);
+uint64_t HashJobList(PDBJOB *jobs, int njobs);
+uint64_t HashBytes(uint64_t h, const void *data, size_t length);
+void HashJobData(PDBJOB *job, OPTIONS *opts);
+void MaybeCheckpoint(DBOUT *db, int njobsDone);
+BOOL WriteCheckpoint(DBOUT *db, int njobsDone);
+BOOL ResumeDatabase(DBOUT *db, OPTIONS *opts);
+int CompareJobs(const void *job1, const void *job2);
+void *WorkerThread(void *arg);
+void StartPrefetch(PDBJOB *jobs, int njobs, int firstJob, int depth);
+void StopPrefetch(void);
+void *PrefetchThread(void *arg);
+BOOL ReadWholeFile(PDBJOB *job);
+void FinishFetch(PDBJOB *job);
+void WaitPrefetch(PDBJOB *job);
+void ReleasePrefetch(PDBJOB *job);
+BOOL OpenPrefetched(PDBJOB *job, PDBFILE *in);
+#ifdef HAVE_LIBURING
+void *PrefetchUringThread(void *arg);
+BOOL StartUringRead(PDBJOB *job, URINGREAD *rd);
+BOOL QueueUringRead(URINGREAD *rd);
+#endif
+#ifdef HAVE_ZLIB
+BOOL InflateBuffer(char *data, size_t length, char **out, 
+                   size_t *outLength);
+#endif
+void StartTrace(void);
+double TraceClock(void);
+int  TraceThread(void);
+void TraceStage(PDBJOB *job, int stage, double start);
+BOOL WriteTrace(char *filename, PDBJOB *jobs, int njobs);
+void WriteJSONString(FILE *fp, char *string);
+void ReportTrace(PDBJOB *jobs, int njobs);
+int  CompareDoubles(const void *d1, const void *d2);
+double JobTraceTime(PDBJOB *job);
+void WriteJob(DBOUT *db, PDBJOB *job);
+BOOL GrowChainTable(DBOUT *db, int nchains);
+void FreeDedupe(DBOUT *db);
+void WriteDedupedJob(DBOUT *db, PDBJOB *job);
+uint64_t HashResids(CADBRESID *resids, int nres);
+int64_t FindRepChain(DBOUT *db, CADBRESID *resids, uint16_t *sig,
+                     int nres, uint64_t hash);
+BOOL AddRepChain(DBOUT *db, uint64_t chain, CADBRESID *resids, 
+                 uint16_t *sig, int nres, uint64_t hash);
+BOOL AddAlias(DBOUT *db, CADBCHAIN *chain, uint64_t target);
+BOOL AddJobSignature(PDBJOB *job, REAL *dists, int nres, int ncol,
+                     int ndist);
+void ProcessFile(PDBJOB *job, OPTIONS *opts, CAARENA *arena);
+BOOL ReadCaAtoms(PDBFILE *in, CAARENA *arena, FILTER *filter);
+BOOL ReadCifCaAtoms(PDBFILE *in, CAARENA *arena, FILTER *filter);
+BOOL FilterAtom(FILTER *filter, FILTERSTATS *stats, REAL occ, 
+                REAL bval);
+BOOL BetterAltPos(FILTER *filter, char alt, REAL occ, char lastAlt,
+                  REAL lastOcc);
+BOOL FilterResolution(FILTER *filter, CAARENA *arena, REAL resolution);
+void ReportFilters(PDBJOB *jobs, int njobs, OPTIONS *opts);
+void FilterString(FILTER *filter, char *buffer);
+int  SplitCifRow(char **rest, char **tokens, int ntok, int upto);
+char *ChainLabel(CARESID *resid);
+char *ReadPDBLine(char *buffer, int size, PDBFILE *in);
+REAL PDBField(char *buffer, int start, int width);
+BOOL ReadCaAtomsBioplib(FILE *fp, CAARENA *arena, FILTER *filter);
+BOOL AddArenaAtom(CAARENA *arena, CARESID *resid, REAL x, REAL y, 
+                  REAL z);
+void FreeArena(CAARENA *arena);
+BOOL IsGzipped(FILE *fp);
+void CalcDistances(FILE *out, char *pdbcode, CAARENA *arena, 
+                   OPTIONS *opts);
+BOOL InitTextOut(TEXTOUT *text, FILE *fp, int ncol);
+void FlushTextOut(TEXTOUT *text);
+void WriteTextDist(TEXTOUT *text, REAL dist);
+BOOL CalcBinaryDistances(FILE *out, PDBJOB *job, CAARENA *arena,
+                         OPTIONS *opts);
+int  FindChainEnd(CAARENA *arena, int firstAtom);
+int  MaxChainLength(CAARENA *arena);
+BOOL WriteQuantChain(FILE *out, uint16_t *matrix, int nres, int ncol);
+BOOL AllocDistWork(DISTWORK *work, int natoms, int ndist);
+void FreeDistWork(DISTWORK *work);
+void CalcChainDistances(CAARENA *arena, int firstAtom, int nres, 
+                        int ndist, BOOL forward, DISTWORK *work);
+void PairDistances(REAL *x, REAL *y, REAL *z, int npair, int k,
+                   REAL *dist);
+#ifdef X86_KERNELS
+void PairDistancesSSE2(REAL *x, REAL *y, REAL *z, int npair, int k,
+                       REAL *dist);
+void PairDistancesAVX(REAL *x, REAL *y, REAL *z, int npair, int k,
+                      REAL *dist);
+#endif
+void SelectDistanceKernel(void);
+BOOL AddJobChain(PDBJOB *job, char *chain, uint64_t offset,
+                 uint64_t firstRecord, int nres);
+BOOL ParseCmdLine(int argc, char **argv, OPTIONS *opts);
 void Usage(void);
 
 
@@ -100,27 +855,155 @@ void Usage(void);
 
    06.10.98 Original   By: ACRM
    18.01.02 Added limit
+   16.10.26 Added nthreads. Options are now in an OPTIONS structure.
+            Added binary output
+   16.10.26 Added shards. db is now an array with one entry per shard
+   16.10.26 Added checks for -R
+   16.10.26 Added -x
+   16.10.26 Added -w
+   16.10.26 Added -trace
+   16.10.26 Added -K
+   16.10.26 Removes separate files left from an earlier build of the
+            output
 */
 int main(int argc, char **argv)
 {
-   FILE *out = stdout;
-   char outfile[MAXBUFF],
-        pdbdir[MAXBUFF];
-   int  ndist,
-        limit = 0;
-   time_t tm;
+   OPTIONS opts;
+   DBOUT   *db;
+   FILE    *fp;
+   int     i;
    
-   if(ParseCmdLine(argc, argv, pdbdir, outfile, &ndist, &limit))
+   SelectDistanceKernel();
+   
+   if(ParseCmdLine(argc, argv, &opts))
    {
-      if(OpenStdFiles(NULL, outfile, NULL, &out))
+      if(opts.binary && !opts.outfile[0])
       {
-         fprintf(out,"!PDBDIR %s\n",pdbdir);
-         fprintf(out,"!NDIST  %d\n",ndist);
-         time(&tm);
-         fprintf(out,"!DATE   %s\n",ctime(&tm));
-         
-         ProcessAllFiles(out, pdbdir, ndist, limit);
+         fprintf(stderr,"A binary database must be written to a file\n");
+         return(1);
+      }
+      if(opts.manifest && !opts.outfile[0])
+      {
+         fprintf(stderr,"A database with a manifest must be written to \
+a file\n");
+         return(1);
+      }
+      if(opts.resume && !opts.outfile[0])
+      {
+         fprintf(stderr,"-resume requires the output file\n");
+         return(1);
+      }
+      if(opts.dedupe)
+      {
+         if(!opts.binary)
+         {
+            fprintf(stderr,"-R requires a binary database\n");
+            return(1);
+         }
+         if(opts.manifest || opts.resume)
+         {
+            fprintf(stderr,"-m, -u and -resume may not be used with \
+-R\n");
+            return(1);
+         }
+      }
+      if((opts.index || opts.nwindows) && 
+         (!opts.binary || (opts.layout == CADB_LAYOUT_COORD)))
+      {
+         fprintf(stderr,"-x and -w require a binary distance database \
+(-b, -c or -q)\n");
+         return(1);
+      }
+      if(opts.keys && !opts.binary)
+      {
+         fprintf(stderr,"-K requires a binary database\n");
+         return(1);
+      }
+      if(opts.nshards > 1)
+      {
+         if(!opts.outfile[0])
+         {
+            fprintf(stderr,"A sharded database must be written to \
+files\n");
+            return(1);
+         }
+         if(opts.prevdb[0] || opts.resume)
+         {
+            fprintf(stderr,"-u and -resume may not be used with \
+-shards\n");
+            return(1);
+         }
+      }
+
+      /* Check that the trace file can be written before starting      */
+      if(opts.tracefile[0])
+      {
+         if((fp = fopen(opts.tracefile, "w"))==NULL)
+         {
+            fprintf(stderr,"Unable to write trace file %s\n", 
+                    opts.tracefile);
+            return(1);
+         }
+         fclose(fp);
+         StartTrace();
+      }
+
+      if((db = (DBOUT *)calloc(opts.nshards, sizeof(DBOUT)))==NULL)
+      {
+         fprintf(stderr,"No memory for database\n");
+         return(1);
+      }
+      db->fp = stdout;
+
+      /* This must be done before the output file is opened           */
+      if(opts.prevdb[0] && !OpenPrevDB(&opts))
+         return(1);
+      
+      if(opts.resume)
+      {
+         if(!ResumeDatabase(db, &opts))
+            return(1);
+      }
+      else if(opts.nshards > 1)
+      {
+         if(!OpenShards(db, &opts))
+            return(1);
+      }
+      else if(OpenStdFiles(NULL, opts.outfile, NULL, &(db->fp)))
+      {
+         WriteHeader(db, &opts);
       }
+      else
+      {
+         return(1);
+      }
+      for(i=0; i<opts.nshards; i++)
+         RemoveStaleFiles(db[i].filename);
+
+      ProcessAllFiles(db, &opts);
+      for(i=0; i<opts.nshards; i++)
+      {
+         if(!FinishDatabase(&(db[i])))
+         {
+            fprintf(stderr,"Error writing database\n");
+            return(1);
+         }
+         if(opts.manifest && !WriteManifest(&(db[i]), &opts))
+            return(1);
+         if(opts.index && !WriteIndex(db[i].filename))
+            return(1);
+         if(opts.keys && !WriteKeyIndex(db[i].filename))
+            return(1);
+         if(opts.nwindows && !WriteWindows(db[i].filename, &opts))
+            return(1);
+      }
+      if((opts.nshards > 1) && !WriteShardManifest(db, &opts))
+         return(1);
+
+      /* The build is complete so the checkpoint is no longer needed   */
+      if(db->ckptFile[0])
+         unlink(db->ckptFile);
+      free(db);
    }
    else
    {
@@ -132,235 +1015,6196 @@ int main(int argc, char **argv)
 
 
 /************************************************************************/
-/*>void ProcessAllFiles(FILE *out, char *pdbdir, int ndist, int limit)
-   -------------------------------------------------------------------
-   Inputs:     FILE   *out     Output file pointer
-               char   *pdbdir  String pointer containing name of PDB
-                               directory
-               int    ndist    Number of distances to calculate
-               int    limit    Max number of files to process
+/*>void WriteHeader(DBOUT *db, OPTIONS *opts)
+   ------------------------------------------
+   Inputs:     DBOUT   *db      The database being written
+               OPTIONS *opts    Command line options
 
-   Steps through each file in the specified directory calling 
-   ProcessFile() on each one.
+   Initializes the database structure and writes the header. For the 
+   binary format, the header is rewritten by FinishDatabase() once the
+   counts are known.
 
-   06.10.98 Original   By: ACRM
-   18.01.02 Added limit
+   The date is taken from SOURCE_DATE_EPOCH if that is set so that 
+   rebuilds can be byte-identical.
+
+   db->offset is set to the size of the header so that it gives the
+   file offset of each block for the manifest.
+
+   16.10.26 Original (split from main())   By: ACRM
+   16.10.26 Flags forward-only databases. ndist is 0 for coordinates
+   16.10.26 Flags databases with angles
+   16.10.26 Flags the residue types
+   16.10.26 Only flags the residue types with -s
 */
-void ProcessAllFiles(FILE *out, char *pdbdir, int ndist, int limit)
+void WriteHeader(DBOUT *db, OPTIONS *opts)
 {
-   DIR           *dp;
-   struct dirent *dent;
-   char          filename[MAXBUFF];
-   int           count = 0;
-   
+   char   *epoch;
+   time_t tm;
+
+   if((epoch=getenv("SOURCE_DATE_EPOCH"))!=NULL)
+      tm = (time_t)atol(epoch);
+   else
+      time(&tm);
+
+   InitDatabase(db, opts);
    
-   if((dp=opendir(pdbdir))!=NULL)
+   if(db->binary)
    {
-      while((dent=readdir(dp))!=NULL)
-      {
-         if((!limit) || (count < limit))
-         {
-            sprintf(filename,"%s/%s",pdbdir,dent->d_name);
-            ProcessFile(out, filename, ndist);
-            count++;
-         }
-      }
-      closedir(dp);
+      CADBInitHeader(&(db->header), 
+                     ((opts->layout == CADB_LAYOUT_COORD) ? 0 : 
+                      opts->ndist), 
+                     opts->layout, opts->pdbdir, tm);
+      if(opts->forward)
+         db->header.flags |= CADB_FLAG_FORWARD;
+      if(db->angles)
+         db->header.flags |= CADB_FLAG_ANGLES;
+      if(db->sequence)
+         db->header.flags |= CADB_FLAG_SEQUENCE;
+      if(!CADBWriteHeader(db->fp, &(db->header)))
+         db->error = TRUE;
+      db->offset = sizeof(CADBHEADER);
+   }
+   else
+   {
+      db->offset += fprintf(db->fp,"!PDBDIR %s\n",opts->pdbdir);
+      if(opts->forward)
+         db->offset += fprintf(db->fp,"!FORWARD\n");
+      if(db->angles)
+         db->offset += fprintf(db->fp,"!ANGLES\n");
+      if(db->sequence)
+         db->offset += fprintf(db->fp,"!SEQUENCE\n");
+      db->offset += fprintf(db->fp,"!NDIST  %d\n",opts->ndist);
+      db->offset += fprintf(db->fp,"!DATE   %s\n",ctime(&tm));
    }
 }
 
 
 /************************************************************************/
-/*>void ProcessFile(FILE *out, char *filename, int ndist)
-   ------------------------------------------------------
-   Inputs:     FILE   *out         Output file pointer
-               char   *filename    PDB file to be processed
-               int    ndist        Number of constraints to calculate
+/*>void InitDatabase(DBOUT *db, OPTIONS *opts)
+   -------------------------------------------
+   Outputs:    DBOUT   *db      The database being written
+   Inputs:     OPTIONS *opts    Command line options
 
-   Reads the specified PDB file, select out the CA atoms and call
-   CalcDistances() to calculate distance constraints and write results 
-   to the outfile.
+   Initializes the database structure. Checkpoints are written if the
+   database is being written to a file. OpenShards() changes the
+   filename for each shard. With -R, the hash table of stored chains
+   and the temporary signature file are created and checkpoints are 
+   not written.
 
-   06.10.98 Original   By: ACRM
-   11.01.02 Added check that SelectCaPDB() found some atoms
+   16.10.26 Original (split from WriteHeader())   By: ACRM
+   16.10.26 Added removal of duplicate chains
+   16.10.26 Records the build filters for the checkpoint
+   16.10.26 Added angles. These are not stored for coordinates
+   16.10.26 Added residue types
 */
-void ProcessFile(FILE *out, char *filename, int ndist)
+void InitDatabase(DBOUT *db, OPTIONS *opts)
 {
-   FILE *fp;
-   PDB  *pdb, **pdbidx;
-   int  natoms;
-   char *pdbcode;
+   db->binary     = opts->binary;
+   db->forward    = opts->forward;
+   db->angles     = (opts->angles && 
+                     (!opts->binary || 
+                      (opts->layout != CADB_LAYOUT_COORD)));
+   db->sequence   = opts->sequence;
+   db->ndist      = opts->ndist;
+   db->chains     = NULL;
+   db->offset     = 0;
+   db->nrecords   = 0;
+   db->nchains    = 0;
+   db->maxChains  = 0;
+   db->error      = FALSE;
+   db->manifest   = opts->manifest;
+   db->entries    = NULL;
+   db->nentries   = 0;
+   db->maxEntries = 0;
+   db->firstJob   = 0;
+   db->listHash   = 0;
+   db->fingerprint  = HashBytes(0, NULL, 0);
+   db->ckptFile[0]  = '\0';
+   db->ckptInterval = opts->ckptInterval;
+   FilterString(&(opts->filter), db->filters);
+   time(&(db->lastCheckpoint));
+   strcpy(db->filename, opts->outfile);
+   if(opts->outfile[0] && !opts->dedupe)
+      sprintf(db->ckptFile, "%s%s", opts->outfile, CKPT_EXT);
+   db->header.layout = (uint32_t)opts->layout;
 
-   if((fp=fopen(filename,"r"))!=NULL)
+   db->dedupe        = opts->dedupe;
+   db->dedupeTol     = (int)(opts->dedupeTol * CADB_SCALE + 0.5);
+   db->repHash       = NULL;
+   db->aliases       = NULL;
+   db->naliases      = 0;
+   db->maxAliases    = 0;
+   db->nAliasRecords = 0;
+   db->sigFp         = NULL;
+   db->sigBuffer     = NULL;
+   db->sigBufferSize = 0;
+   if(db->dedupe)
    {
-      if((pdbcode = FNam2PDB(filename))!=NULL)
+      if(((db->repHash = (REPCHAIN **)calloc(REPHASHSIZE, 
+                                             sizeof(REPCHAIN *)))==NULL) ||
+         ((db->sigFp = tmpfile())==NULL))
       {
-         if((pdb=ReadPDBAtoms(fp,&natoms))!=NULL)
-         {
-            if((pdb=SelectCaPDB(pdb))!=NULL)
-            {
-               pdbidx=IndexPDB(pdb, &natoms);
-               
-               CalcDistances(out, pdbcode, pdbidx, natoms, ndist);
-               
-               free(pdbidx);
-               FREELIST(pdb, PDB);
-            }
-         }
+         fprintf(stderr,"Unable to set up removal of duplicate \
+chains\n");
+         db->error = TRUE;
+         db->dedupe = FALSE;
       }
-      fclose(fp);
    }
 }
 
 
 /************************************************************************/
-/*>void CalcDistances(FILE *out, char *pdbcode, PDB **pdbidx, 
-                      int natoms, int ndist)
-   ----------------------------------------------------------
-   Inputs:     FILE   *out         Output file pointer
-               char   *pdbcode     PDB code derived from filename
-               PDB    **pdbidx     Array of PDB pointers
-               int    natoms       Number of atoms in array
-               int    ndist        Number of constraints to calculate
+/*>BOOL FinishDatabase(DBOUT *db)
+   ------------------------------
+   Inputs:     DBOUT   *db      The database being written
+   Returns:    BOOL             Success?
 
-   Calculate the ndist distances between CA atoms and write them to
-   the output file.
+   For the binary format, writes the chain table (followed by the alias
+   table if any duplicate chains were removed and the distance 
+   histograms) and rewrites the header with the final counts.
 
-   06.10.98 Original   By: ACRM
+   16.10.26 Original   By: ACRM
+   16.10.26 Writes the alias table
+   16.10.26 Writes the histograms
+   16.10.26 Sets the build fingerprint from the data written for each
+            job and the chain and alias tables. It is never 0 since 
+            that is the value in a database written before it was added
 */
-void CalcDistances(FILE *out, char *pdbcode, PDB **pdbidx, 
-                   int natoms, int ndist)
+BOOL FinishDatabase(DBOUT *db)
 {
-   int  atnum, 
-        currentAtom = 0,
-        i = 0,
-        firstAtom = 0;
-   char chain = pdbidx[0]->chain[0],
-        PrintChain;
-   REAL dist;
-
-   PrintChain = ((chain==' ')?'-':chain);
-   
-   for(atnum=0; atnum<natoms; atnum++)
+   if(db->binary)
    {
-      if(pdbidx[atnum]->chain[0] != chain)
+      db->header.nrecords   = db->nrecords;
+      db->header.nchains    = db->nchains;
+      db->header.chainTable = db->offset;
+
+      db->fingerprint = HashBytes(db->fingerprint, db->chains,
+                                  db->nchains * sizeof(CADBCHAIN));
+      db->fingerprint = HashBytes(db->fingerprint, db->aliases,
+                                  db->naliases * sizeof(CADBALIAS));
+      db->header.fingerprint = db->fingerprint ? db->fingerprint : 1;
+
+      if(db->nchains &&
+         (fwrite(db->chains, sizeof(CADBCHAIN), db->nchains, db->fp) !=
+          db->nchains))
+         db->error = TRUE;
+
+      if(db->naliases)
       {
-         chain = pdbidx[atnum]->chain[0];
-         firstAtom = atnum;
-         PrintChain = ((chain==' ')?'-':chain);
+         db->header.flags |= CADB_FLAG_ALIASES;
+         if((fwrite(&(db->naliases), sizeof(uint64_t), 1, db->fp) != 1) ||
+            (fwrite(db->aliases, sizeof(CADBALIAS), db->naliases, 
+                    db->fp) != db->naliases))
+            db->error = TRUE;
       }
-      fprintf(out,"%4s.%c.%d%c ",
-              pdbcode,
-              PrintChain,
-              pdbidx[atnum]->resnum,
-              pdbidx[atnum]->insert[0]);
-
-      /* Do the DP (forward) distances                                */
-      for(i=1; i<=ndist; i++)
+      if(!db->error && (db->header.layout != CADB_LAYOUT_COORD))
       {
-         currentAtom = atnum+i;
-         if((currentAtom >= natoms) ||
-            (pdbidx[currentAtom]->chain[0] != chain))
-         {
-            dist = (-1.0);
-         }
+         if(WriteHistograms(db))
+            db->header.flags |= CADB_FLAG_HISTOGRAMS;
          else
-         {
-            dist = DIST(pdbidx[atnum], pdbidx[currentAtom]);
-         }
-         fprintf(out, "%.2f ", dist);
+            db->error = TRUE;
       }
-
-      /* Do the DM (backward) distances                               */
-      for(i=1; i<=ndist; i++)
+      if(db->dedupe)
       {
-         currentAtom = atnum-i;
-         if(currentAtom < firstAtom)
-         {
-            dist = (-1.0);
-         }
-         else
-         {
-            dist = DIST(pdbidx[atnum], pdbidx[currentAtom]);
-         }
-         fprintf(out, "%.2f ", dist);
+         fprintf(stderr,"%s: %llu duplicate chains (%llu records) stored \
+as aliases\n", db->filename, (unsigned long long)db->naliases, 
+                 (unsigned long long)db->nAliasRecords);
+         FreeDedupe(db);
       }
+      if(!CADBWriteHeader(db->fp, &(db->header)))
+         db->error = TRUE;
       
-      fprintf(out,"\n");
+      if(db->chains != NULL)
+         free(db->chains);
    }
+
+   if(fflush(db->fp))
+      db->error = TRUE;
+
+   return(!db->error);
 }
 
 
 /************************************************************************/
-/*>BOOL ParseCmdLine(int argc, char **argv, char *pdbdir, char *outfile, 
-                     int *ndist, int *limit)
-   ---------------------------------------------------------------------
-   Input:   int    argc         Argument count
-            char   **argv       Argument array
-   Output:  char   *pdbdir      PDB directory to scan
-            char   *outfile     Output file (or blank string)
-            int    *ndist       Number of distances
-            int    *limit       Max number of PDB files to read
-   Returns: BOOL                Success?
+/*>BOOL WriteHistograms(DBOUT *db)
+   -------------------------------
+   Inputs:     DBOUT   *db      The database being written. The chain 
+                                and alias tables have been written
+   Returns:    BOOL             Success?
 
-   Parse the command line
-   
-   06.10.98 Original    By: ACRM
-   18.01.02 Added -l
+   Writes the histogram of the distances at each DP offset (see cadb.h)
+   to the end of a binary distance database. As for WriteIndex(), the
+   distances are read back from the file so that any layout can be 
+   handled. Each record is counted once for its chain and once for 
+   each alias of the chain. The counts are made with a bin for every
+   possible distance; the bins beyond the largest distance found are
+   then dropped.
+
+   16.10.26 Original   By: ACRM
 */
-BOOL ParseCmdLine(int argc, char **argv, char *pdbdir, char *outfile, 
-                  int *ndist, int *limit)
+BOOL WriteHistograms(DBOUT *db)
 {
-   argc--;
-   argv++;
+   FILE           *fp;
+   CADBHISTHEADER hist;
+   DPWORK         work;
+   uint64_t       *counts,
+                  *weights,
+                  chainNum;
+   size_t         ncounts;
+   int            maxBins = (CADB_MAXDIST / CADB_HIST_BINWIDTH) + 1,
+                  nbins   = 1,
+                  maxres  = 0,
+                  nres,
+                  col,
+                  res,
+                  bin;
+   BOOL           ok = TRUE;
 
-   if(argc == 0)
+   if(fflush(db->fp) || ((fp = fopen(db->filename, "rb"))==NULL))
+   {
+      fprintf(stderr,"Unable to read back %s to write the histograms\n",
+              db->filename);
       return(FALSE);
+   }
 
-   *ndist = DEF_NDIST;
-   outfile[0] = '\0';
-   
-   while(argc)
+   for(chainNum=0; chainNum<db->nchains; chainNum++)
+      maxres = MAX(maxres, (int)db->chains[chainNum].nres);
+
+   memset(&hist, 0, sizeof(CADBHISTHEADER));
+   hist.ndist    = db->header.ndist;
+   hist.binWidth = CADB_HIST_BINWIDTH;
+   hist.nbins    = (uint32_t)maxBins;
+   hist.nrecords = db->nrecords + db->nAliasRecords;
+   hist.nchains  = db->nchains + db->naliases;
+
+   counts  = (uint64_t *)calloc((size_t)hist.ndist * (maxBins + 1),
+                                sizeof(uint64_t));
+   weights = (uint64_t *)malloc((db->nchains + 1) * sizeof(uint64_t));
+   if((counts == NULL) || (weights == NULL) ||
+      !AllocDPWork(&work, (int)hist.ndist, maxres))
+   {
+      fprintf(stderr,"No memory for the histograms of %s\n", 
+              db->filename);
+      if(counts  != NULL) free(counts);
+      if(weights != NULL) free(weights);
+      fclose(fp);
+      return(FALSE);
+   }
+
+   /* Each chain is counted once for itself and once for each alias     */
+   for(chainNum=0; chainNum<db->nchains; chainNum++)
+      weights[chainNum] = 1;
+   for(chainNum=0; chainNum<db->naliases; chainNum++)
+      weights[db->aliases[chainNum].target]++;
+
+   for(chainNum=0; chainNum<db->nchains; chainNum++)
    {
-      if(argv[0][0] == '-')
+      nres = (int)db->chains[chainNum].nres;
+      if(!ReadDPColumns(fp, &(db->header), &(db->chains[chainNum]), 
+                        &work))
       {
-         switch(argv[0][1])
-         {
-         case 'd':
-            argc--;
-            argv++;
-            sscanf(argv[0],"%d",ndist);
-            break;
-         case 'l':
-            argc--;
-            argv++;
-            sscanf(argv[0],"%d",limit);
-            break;
-         default:
-            return(FALSE);
-            break;
-         }
+         fprintf(stderr,"Error reading chain %s.%s to write the \
+histograms\n", db->chains[chainNum].pdbcode, 
+                 db->chains[chainNum].chain);
+         ok = FALSE;
+         break;
       }
-      else
+      for(col=0; col<(int)hist.ndist; col++)
       {
-         /* Check that there is 1 or 2 arguments left                 */
-         if((argc < 1) || (argc > 2))
-            return(FALSE);
-         
-         strcpy(pdbdir, argv[0]);
-
-         argc--; argv++;
-         if(argc)
+         for(res=0; res<nres; res++)
          {
-            strcpy(outfile, argv[0]);
+            bin = CADBHistBin(&hist, work.dist[col*nres + res]);
+            counts[col*(maxBins+1) + bin] += weights[chainNum];
+            if((bin < maxBins) && (bin >= nbins))
+               nbins = bin + 1;
          }
+      }
+   }
 
-         return(TRUE);
+   if(ok)
+   {
+      /* Drop the unused bins, keeping the missing bin at the end       */
+      for(col=0; col<(int)hist.ndist; col++)
+      {
+         for(bin=0; bin<nbins; bin++)
+            counts[col*(nbins+1) + bin] = counts[col*(maxBins+1) + bin];
+         counts[col*(nbins+1) + nbins] = counts[col*(maxBins+1) + maxBins];
       }
-      argc--;
-      argv++;
+      hist.nbins = (uint32_t)nbins;
+      ncounts    = (size_t)hist.ndist * (nbins + 1);
+      if((fwrite(&hist, sizeof(CADBHISTHEADER), 1, db->fp) != 1) ||
+         (fwrite(counts, sizeof(uint64_t), ncounts, db->fp) != ncounts))
+         ok = FALSE;
    }
-   
+
+   fclose(fp);
+   free(counts);
+   free(weights);
+   FreeDPWork(&work);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL WriteIndex(char *dbfile)
+   -----------------------------
+   Inputs:     char    *dbfile  Binary database that has been written
+   Returns:    BOOL             Success?
+
+   Writes the range index (see cadb.h) for a binary database to 
+   dbfile.idx. The database is read back rather than the distances 
+   being kept while it is built, so the same code indexes any of the
+   distance layouts. CountIndexBins() counts the records in each bin 
+   of each DP column and FillIndexRecords() then writes the record 
+   lists.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Uses AllocDPWork()
+   16.10.26 Copies the build fingerprint
+*/
+BOOL WriteIndex(char *dbfile)
+{
+   FILE            *fp,
+                   *out;
+   char            filename[MAXBUFF+32];
+   CADBHEADER      header;
+   CADBINDEXHEADER index;
+   CADBCHAIN       *chains;
+   DPWORK          work;
+   uint64_t        chainNum;
+   uint32_t        *bins;
+   int             maxres = 0;
+   BOOL            ok     = FALSE;
+
+   if((fp = fopen(dbfile, "rb"))==NULL)
+   {
+      fprintf(stderr,"Unable to read %s to index it\n", dbfile);
+      return(FALSE);
+   }
+   if((CADBReadHeader(fp, &header) != CADB_OK) ||
+      ((chains = CADBReadChainTable(fp, &header))==NULL))
+   {
+      fprintf(stderr,"Unable to read %s to index it\n", dbfile);
+      fclose(fp);
+      return(FALSE);
+   }
+   if(header.nrecords >= (uint64_t)UINT32_MAX)
+   {
+      fprintf(stderr,"%s has too many records to index\n", dbfile);
+      free(chains);
+      fclose(fp);
+      return(FALSE);
+   }
+
+   for(chainNum=0; chainNum<header.nchains; chainNum++)
+      maxres = MAX(maxres, (int)chains[chainNum].nres);
+
+   memset(&index, 0, sizeof(CADBINDEXHEADER));
+   memcpy(index.magic, CADB_INDEX_MAGIC, 4);
+   index.byteOrder  = CADB_BYTEORDER;
+   index.version    = CADB_INDEX_VERSION;
+   index.ndist      = header.ndist;
+   index.binWidth   = CADB_INDEX_BINWIDTH;
+   index.nrecords   = header.nrecords;
+   index.nchains    = header.nchains;
+   index.chainTable = header.chainTable;
+   index.date       = header.date;
+   index.fingerprint = header.fingerprint;
+
+   sprintf(filename, "%s%s", dbfile, CADB_INDEX_EXT);
+   if(!AllocDPWork(&work, (int)header.ndist, maxres))
+   {
+      fprintf(stderr,"No memory to index %s\n", dbfile);
+   }
+   else if((bins = CountIndexBins(fp, &header, chains, &index, 
+                                  &work))!=NULL)
+   {
+      if((out = fopen(filename, "wb"))==NULL)
+      {
+         fprintf(stderr,"Unable to write index %s\n", filename);
+      }
+      else
+      {
+         ok = FillIndexRecords(fp, out, &header, chains, &index, bins,
+                               &work);
+         if(fclose(out))
+            ok = FALSE;
+         if(!ok)
+         {
+            fprintf(stderr,"Error writing index %s\n", filename);
+            unlink(filename);
+         }
+      }
+      free(bins);
+   }
+
+   fclose(fp);
+   free(chains);
+   FreeDPWork(&work);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL WriteKeyIndex(char *dbfile)
+   --------------------------------
+   Inputs:     char    *dbfile  Binary database that has been written
+   Returns:    BOOL             Success?
+
+   Writes the key index (see cadb.h) for a binary database to 
+   dbfile.key. There is a key for each chain in the chain table and 
+   for each alias, pointing to the chain that holds its data.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Copies the build fingerprint
+*/
+BOOL WriteKeyIndex(char *dbfile)
+{
+   FILE          *fp,
+                 *out;
+   char          filename[MAXBUFF+32];
+   CADBHEADER    header;
+   CADBKEYHEADER keyhdr;
+   CADBCHAIN     *chains;
+   CADBALIAS     *aliases  = NULL;
+   CADBKEY       *keys;
+   uint64_t      naliases  = 0,
+                 i;
+   BOOL          ok        = FALSE;
+
+   if((fp = fopen(dbfile, "rb"))==NULL)
+   {
+      fprintf(stderr,"Unable to read %s to index it\n", dbfile);
+      return(FALSE);
+   }
+   if((CADBReadHeader(fp, &header) != CADB_OK) ||
+      ((chains = CADBReadChainTable(fp, &header))==NULL))
+   {
+      fprintf(stderr,"Unable to read %s to index it\n", dbfile);
+      fclose(fp);
+      return(FALSE);
+   }
+   if((header.flags & CADB_FLAG_ALIASES) &&
+      ((aliases = CADBReadAliases(fp, &header, &naliases))==NULL))
+   {
+      fprintf(stderr,"Unable to read alias table from %s\n", dbfile);
+      free(chains);
+      fclose(fp);
+      return(FALSE);
+   }
+   fclose(fp);
+
+   memset(&keyhdr, 0, sizeof(CADBKEYHEADER));
+   memcpy(keyhdr.magic, CADB_KEY_MAGIC, 4);
+   keyhdr.byteOrder  = CADB_BYTEORDER;
+   keyhdr.version    = CADB_KEY_VERSION;
+   keyhdr.nrecords   = header.nrecords;
+   keyhdr.nchains    = header.nchains;
+   keyhdr.chainTable = header.chainTable;
+   keyhdr.date       = header.date;
+   keyhdr.fingerprint = header.fingerprint;
+   keyhdr.nkeys      = header.nchains + naliases;
+
+   sprintf(filename, "%s%s", dbfile, CADB_KEY_EXT);
+   if((keys = (CADBKEY *)malloc((keyhdr.nkeys + 1) * sizeof(CADBKEY)))
+      ==NULL)
+   {
+      fprintf(stderr,"No memory to index %s\n", dbfile);
+   }
+   else
+   {
+      for(i=0; i<header.nchains; i++)
+      {
+         memcpy(keys[i].pdbcode, chains[i].pdbcode, 8);
+         memcpy(keys[i].chain,   chains[i].chain,   8);
+         keys[i].target = i;
+      }
+      for(i=0; i<naliases; i++)
+      {
+         memcpy(keys[header.nchains+i].pdbcode, aliases[i].pdbcode, 8);
+         memcpy(keys[header.nchains+i].chain,   aliases[i].chain,   8);
+         keys[header.nchains+i].target = aliases[i].target;
+      }
+      qsort(keys, keyhdr.nkeys, sizeof(CADBKEY), CADBCompareKeys);
+
+      if((out = fopen(filename, "wb"))==NULL)
+      {
+         fprintf(stderr,"Unable to write key index %s\n", filename);
+      }
+      else
+      {
+         ok = ((fwrite(&keyhdr, sizeof(CADBKEYHEADER), 1, out) == 1) &&
+               (fwrite(keys, sizeof(CADBKEY), keyhdr.nkeys, out) ==
+                keyhdr.nkeys));
+         if(fclose(out))
+            ok = FALSE;
+         if(!ok)
+         {
+            fprintf(stderr,"Error writing key index %s\n", filename);
+            unlink(filename);
+         }
+      }
+      free(keys);
+   }
+
+   free(chains);
+   if(aliases != NULL) free(aliases);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>void RemoveStaleFiles(char *dbfile)
+   -----------------------------------
+   Inputs:     char    *dbfile  Database about to be written
+
+   Removes the range index, key index and loop window tables left from
+   an earlier build of the same output file. Only those requested for 
+   this build are written, so any others would be left describing the 
+   old database. searchcadb would reject them as their build fingerprint no
+   longer matches, but removing them avoids the warnings and the wasted
+   space.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Also removes the range index
+   16.10.26 Also removes the key index
+*/
+void RemoveStaleFiles(char *dbfile)
+{
+   char filename[MAXBUFF+32];
+   int  lengths[CADB_MAXWINDOWS],
+        nfound,
+        nremoved,
+        i;
+
+   if(!dbfile[0])
+      return;
+
+   sprintf(filename, "%s%s", dbfile, CADB_INDEX_EXT);
+   unlink(filename);
+   sprintf(filename, "%s%s", dbfile, CADB_KEY_EXT);
+   unlink(filename);
+
+   do
+   {
+      nremoved = 0;
+      nfound   = CADBFindWindowTables(dbfile, lengths, CADB_MAXWINDOWS);
+      for(i=0; i<nfound; i++)
+      {
+         CADBWindowFilename(filename, dbfile, lengths[i]);
+         if(!unlink(filename))
+            nremoved++;
+      }
+   }  while(nremoved && (nfound == CADB_MAXWINDOWS));
+}
+
+
+/************************************************************************/
+/*>BOOL WriteWindows(char *dbfile, OPTIONS *opts)
+   ----------------------------------------------
+   Inputs:     char    *dbfile  Binary database that has been written
+               OPTIONS *opts    Command line options
+   Returns:    BOOL             Success?
+
+   Writes a loop window table (see cadb.h) for each loop length given
+   with -w. As for WriteIndex(), the DP distances are read back from
+   the database; each chain is read once and its rows are then written
+   to every table.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Copies the build fingerprint
+*/
+BOOL WriteWindows(char *dbfile, OPTIONS *opts)
+{
+   FILE             *fp,
+                    *out[CADB_MAXWINDOWS];
+   char             filename[MAXBUFF+32];
+   CADBHEADER       header;
+   CADBWINDOWHEADER win;
+   CADBCHAIN        *chains;
+   DPWORK           work;
+   uint16_t         *rows;
+   uint64_t         chainNum;
+   size_t           nvals;
+   int              maxres = 0,
+                    nopen  = 0,
+                    w;
+   BOOL             ok     = TRUE;
+
+   if((fp = fopen(dbfile, "rb"))==NULL)
+   {
+      fprintf(stderr,"Unable to read %s to write the window tables\n",
+              dbfile);
+      return(FALSE);
+   }
+   if((CADBReadHeader(fp, &header) != CADB_OK) ||
+      ((chains = CADBReadChainTable(fp, &header))==NULL))
+   {
+      fprintf(stderr,"Unable to read %s to write the window tables\n",
+              dbfile);
+      fclose(fp);
+      return(FALSE);
+   }
+
+   for(chainNum=0; chainNum<header.nchains; chainNum++)
+      maxres = MAX(maxres, (int)chains[chainNum].nres);
+
+   if(((rows = (uint16_t *)malloc(((size_t)2 * header.ndist * maxres + 1)
+                                  * sizeof(uint16_t)))==NULL) ||
+      !AllocDPWork(&work, (int)header.ndist, maxres))
+   {
+      fprintf(stderr,"No memory to write the window tables of %s\n",
+              dbfile);
+      if(rows != NULL) free(rows);
+      free(chains);
+      fclose(fp);
+      return(FALSE);
+   }
+
+   memset(&win, 0, sizeof(CADBWINDOWHEADER));
+   memcpy(win.magic, CADB_WINDOW_MAGIC, 4);
+   win.byteOrder  = CADB_BYTEORDER;
+   win.version    = CADB_WINDOW_VERSION;
+   win.ndist      = header.ndist;
+   win.rowSize    = 2 * header.ndist * sizeof(uint16_t);
+   win.nrecords   = header.nrecords;
+   win.nchains    = header.nchains;
+   win.chainTable = header.chainTable;
+   win.date       = header.date;
+   win.fingerprint = header.fingerprint;
+
+   for(w=0; ok && (w<opts->nwindows); w++)
+   {
+      CADBWindowFilename(filename, dbfile, opts->windows[w]);
+      win.length = (uint32_t)opts->windows[w];
+      if((out[w] = fopen(filename, "wb"))==NULL)
+      {
+         fprintf(stderr,"Unable to write window table %s\n", filename);
+         ok = FALSE;
+         break;
+      }
+      nopen++;
+      if(fwrite(&win, sizeof(CADBWINDOWHEADER), 1, out[w]) != 1)
+         ok = FALSE;
+   }
+
+   for(chainNum=0; ok && (chainNum<header.nchains); chainNum++)
+   {
+      if(!ReadDPColumns(fp, &header, &(chains[chainNum]), &work))
+      {
+         fprintf(stderr,"Error reading chain %s.%s to write the window \
+tables\n", chains[chainNum].pdbcode, chains[chainNum].chain);
+         ok = FALSE;
+         break;
+      }
+      nvals = (size_t)2 * header.ndist * chains[chainNum].nres;
+      for(w=0; w<opts->nwindows; w++)
+      {
+         FillWindowRows(work.dist, (int)chains[chainNum].nres, 
+                        (int)header.ndist, opts->windows[w], rows);
+         if(fwrite(rows, sizeof(uint16_t), nvals, out[w]) != nvals)
+         {
+            ok = FALSE;
+            break;
+         }
+      }
+   }
+
+   for(w=0; w<nopen; w++)
+   {
+      if(fclose(out[w]))
+         ok = FALSE;
+   }
+   if(!ok)
+   {
+      fprintf(stderr,"Error writing the window tables of %s\n", dbfile);
+      for(w=0; w<nopen; w++)
+      {
+         CADBWindowFilename(filename, dbfile, opts->windows[w]);
+         unlink(filename);
+      }
+   }
+
+   fclose(fp);
+   free(chains);
+   free(rows);
+   FreeDPWork(&work);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>void FillWindowRows(uint16_t *dist, int nres, int ndist, int length,
+                       uint16_t *rows)
+   ---------------------------------------------------------------------
+   Inputs:     uint16_t *dist    DP distances of a chain from 
+                                 ReadDPColumns(), column k starting at
+                                 dist[k*nres]
+               int      nres     Number of residues in the chain
+               int      ndist    Number of distances
+               int      length   Loop length
+   Outputs:    uint16_t *rows    The window table rows for the chain
+
+   Builds the window table row for each residue of a chain. The DM 
+   distance at offset k of the last residue of the loop is the DP 
+   distance at offset k of the residue k before it.
+
+   16.10.26 Original   By: ACRM
+*/
+void FillWindowRows(uint16_t *dist, int nres, int ndist, int length,
+                    uint16_t *rows)
+{
+   uint16_t *row;
+   int      res,
+            last,
+            k;
+
+   for(res=0; res<nres; res++)
+   {
+      row  = rows + (size_t)res * 2 * ndist;
+      last = res + length - 1;
+      for(k=0; k<ndist; k++)
+      {
+         row[k] = dist[k*nres + res];
+         row[ndist + k] = ((last < nres) && (last - k - 1 >= 0)) ?
+                          dist[k*nres + last - k - 1] : CADB_MISSING;
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>uint32_t *CountIndexBins(FILE *fp, CADBHEADER *header, 
+                            CADBCHAIN *chains, CADBINDEXHEADER *index,
+                            DPWORK *work)
+   ----------------------------------------------------------------------
+   Inputs:     FILE            *fp      Database file pointer
+               CADBHEADER      *header  Header of the database
+               CADBCHAIN       *chains  The chain table
+   I/O:        CADBINDEXHEADER *index   Header of the index. nbins is
+                                        filled in
+               DPWORK          *work    Workspace
+   Returns:    uint32_t        *        Malloc'd bin directory (NULL on
+                                        error)
+
+   Counts the records in each bin of each DP column and returns the 
+   directory giving the start of each bin in the column's record list.
+   The counts are made with a bin for every possible distance; the bins
+   beyond the largest distance found are then dropped.
+
+   16.10.26 Original   By: ACRM
+*/
+uint32_t *CountIndexBins(FILE *fp, CADBHEADER *header, 
+                         CADBCHAIN *chains, CADBINDEXHEADER *index,
+                         DPWORK *work)
+{
+   uint32_t *counts,
+            *bins;
+   uint64_t chainNum,
+            start;
+   int      maxBins = (CADB_MAXDIST / CADB_INDEX_BINWIDTH) + 1,
+            nbins   = 1,
+            nres,
+            col,
+            res,
+            bin;
+
+   if((counts = (uint32_t *)calloc((size_t)work->ndist * (maxBins + 1),
+                                   sizeof(uint32_t)))==NULL)
+   {
+      fprintf(stderr,"No memory to index database\n");
+      return(NULL);
+   }
+
+   index->nbins = (uint32_t)maxBins;
+   for(chainNum=0; chainNum<header->nchains; chainNum++)
+   {
+      nres = (int)chains[chainNum].nres;
+      if(!ReadDPColumns(fp, header, &(chains[chainNum]), work))
+      {
+         fprintf(stderr,"Error reading chain %s.%s to index it\n",
+                 chains[chainNum].pdbcode, chains[chainNum].chain);
+         free(counts);
+         return(NULL);
+      }
+      for(col=0; col<work->ndist; col++)
+      {
+         for(res=0; res<nres; res++)
+         {
+            bin = CADBIndexBin(index, work->dist[col*nres + res]);
+            counts[col*(maxBins+1) + bin]++;
+            if((bin < maxBins) && (bin >= nbins))
+               nbins = bin + 1;
+         }
+      }
+   }
+
+   /* Convert the counts to the start of each bin. The missing bin 
+      follows the last bin used
+   */
+   index->nbins = (uint32_t)nbins;
+   if((bins = (uint32_t *)malloc((size_t)work->ndist * (nbins + 2) * 
+                                 sizeof(uint32_t)))!=NULL)
+   {
+      for(col=0; col<work->ndist; col++)
+      {
+         start = 0;
+         for(bin=0; bin<nbins; bin++)
+         {
+            bins[col*(nbins+2) + bin] = (uint32_t)start;
+            start += counts[col*(maxBins+1) + bin];
+         }
+         bins[col*(nbins+2) + nbins]     = (uint32_t)start;
+         start += counts[col*(maxBins+1) + maxBins];
+         bins[col*(nbins+2) + nbins + 1] = (uint32_t)start;
+      }
+   }
+   else
+   {
+      fprintf(stderr,"No memory to index database\n");
+   }
+
+   free(counts);
+   return(bins);
+}
+
+
+/************************************************************************/
+/*>BOOL FillIndexRecords(FILE *fp, FILE *out, CADBHEADER *header, 
+                         CADBCHAIN *chains, CADBINDEXHEADER *index,
+                         uint32_t *bins, DPWORK *work)
+   ----------------------------------------------------------------------
+   Inputs:     FILE            *fp      Database file pointer
+               FILE            *out     Index file pointer
+               CADBHEADER      *header  Header of the database
+               CADBCHAIN       *chains  The chain table
+               CADBINDEXHEADER *index   Header of the index
+   I/O:        uint32_t        *bins    Bin directory. Used as the next
+                                        free position in each bin so is
+                                        destroyed
+               DPWORK          *work    Workspace
+   Returns:    BOOL                     Success?
+
+   Writes the index header and bin directory and then fills in the 
+   record lists. Since the chains are read in order, the records in 
+   each bin are in ascending order. If the lists for all the columns
+   would need more than INDEX_MAXMEM bytes, the database is read once
+   for as many columns at a time as will fit.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL FillIndexRecords(FILE *fp, FILE *out, CADBHEADER *header, 
+                      CADBCHAIN *chains, CADBINDEXHEADER *index,
+                      uint32_t *bins, DPWORK *work)
+{
+   uint32_t *records,
+            *next;
+   uint64_t chainNum,
+            nrecords = header->nrecords;
+   size_t   ndir     = (size_t)work->ndist * (index->nbins + 2);
+   int      nbins    = (int)index->nbins,
+            ncolGroup,
+            firstCol,
+            lastCol,
+            nres,
+            col,
+            res;
+   BOOL     ok = TRUE;
+
+   if((fwrite(index, sizeof(CADBINDEXHEADER), 1, out) != 1) ||
+      (fwrite(bins, sizeof(uint32_t), ndir, out) != ndir))
+      return(FALSE);
+
+   ncolGroup = (int)MIN((uint64_t)work->ndist, 
+                        MAX(1, INDEX_MAXMEM / 
+                            ((nrecords + 1) * sizeof(uint32_t))));
+   if((records = (uint32_t *)malloc((size_t)ncolGroup * (nrecords + 1) *
+                                    sizeof(uint32_t)))==NULL)
+      return(FALSE);
+
+   for(firstCol=0; ok && (firstCol<work->ndist); firstCol+=ncolGroup)
+   {
+      lastCol = MIN(firstCol + ncolGroup, work->ndist);
+      for(chainNum=0; ok && (chainNum<header->nchains); chainNum++)
+      {
+         nres = (int)chains[chainNum].nres;
+         if(!ReadDPColumns(fp, header, &(chains[chainNum]), work))
+         {
+            ok = FALSE;
+            break;
+         }
+         for(col=firstCol; col<lastCol; col++)
+         {
+            next = bins + col*(nbins+2);
+            for(res=0; res<nres; res++)
+            {
+               records[(col - firstCol) * nrecords + 
+                       next[CADBIndexBin(index, 
+                                         work->dist[col*nres + res])]++] =
+                  (uint32_t)(chains[chainNum].firstRecord + res);
+            }
+         }
+      }
+
+      /* The lists for a group of columns are contiguous in the file    */
+      if(ok &&
+         (fwrite(records, sizeof(uint32_t), 
+                 (size_t)(lastCol - firstCol) * nrecords, out) !=
+          (size_t)(lastCol - firstCol) * nrecords))
+         ok = FALSE;
+   }
+
+   free(records);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadDPColumns(FILE *fp, CADBHEADER *header, CADBCHAIN *chain,
+                      DPWORK *work)
+   ----------------------------------------------------------------------
+   Inputs:     FILE       *fp       Database file pointer
+               CADBHEADER *header   Header of the database
+               CADBCHAIN  *chain    Chain table entry
+   I/O:        DPWORK     *work     Workspace. The DP distances are 
+                                    placed in work->dist, column k
+                                    starting at dist[k*nres]
+   Returns:    BOOL                 Success?
+
+   Reads the DP distances of a chain from a row, column or quantized
+   database for WriteIndex() and WriteHistograms().
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Renamed from ReadIndexColumns()
+   16.10.26 qstored is only declared when compiled with HAVE_ZLIB
+*/
+BOOL ReadDPColumns(FILE *fp, CADBHEADER *header, CADBCHAIN *chain,
+                   DPWORK *work)
+{
+   uint16_t      *dist      = work->dist,
+                 *rowBuffer = work->rowBuffer;
+   unsigned char *qraw      = work->qraw;
+   int        ndist = (int)header->ndist,
+              ncol  = ((header->flags & CADB_FLAG_FORWARD) ? 
+                       ndist : 2*ndist),
+              nres  = (int)chain->nres,
+              col,
+              res;
+   uint32_t   qdir[1];
+   CADBQBLOCK block;
+   size_t     count,
+              rawLength;
+#ifdef HAVE_ZLIB
+   unsigned char *qstored   = work->qstored;
+   uLongf     zlength;
+#endif
+
+   if(fseeko(fp, (off_t)(chain->offset + nres * sizeof(CADBRESID)),
+             SEEK_SET))
+      return(FALSE);
+
+   switch(header->layout)
+   {
+   case CADB_LAYOUT_ROW:
+      count = (size_t)nres * ncol;
+      if(fread(rowBuffer, sizeof(uint16_t), count, fp) != count)
+         return(FALSE);
+      for(col=0; col<ndist; col++)
+      {
+         for(res=0; res<nres; res++)
+            dist[col*nres + res] = rowBuffer[res*ncol + col];
+      }
+      break;
+   case CADB_LAYOUT_COLUMN:
+      /* The DP columns come first                                      */
+      count = (size_t)nres * ndist;
+      if(fread(dist, sizeof(uint16_t), count, fp) != count)
+         return(FALSE);
+      break;
+   case CADB_LAYOUT_QUANT:
+      for(col=0; col<ndist; col++)
+      {
+         if(fseeko(fp, (off_t)(chain->offset + nres * sizeof(CADBRESID) +
+                               col * sizeof(uint32_t)), SEEK_SET) ||
+            (fread(qdir, sizeof(uint32_t), 1, fp) != 1) ||
+            fseeko(fp, (off_t)(chain->offset + qdir[0]), SEEK_SET) ||
+            (fread(&block, sizeof(CADBQBLOCK), 1, fp) != 1) ||
+            (block.shift > CADB_QMAXSHIFT))
+            return(FALSE);
+
+         rawLength = CADB_QRAWSIZE(nres, block.shift);
+         if(block.stored > rawLength)
+            return(FALSE);
+         if(block.stored == rawLength)
+         {
+            if(fread(qraw, 1, rawLength, fp) != rawLength)
+               return(FALSE);
+         }
+         else
+         {
+#ifdef HAVE_ZLIB
+            if(fread(qstored, 1, block.stored, fp) != 
+               (size_t)block.stored)
+               return(FALSE);
+            zlength = (uLongf)rawLength;
+            if((uncompress(qraw, &zlength, qstored, 
+                           (uLong)block.stored) != Z_OK) ||
+               (zlength != (uLongf)rawLength))
+               return(FALSE);
+#else
+            return(FALSE);
+#endif
+         }
+         for(res=0; res<nres; res++)
+            dist[col*nres + res] = 
+               (uint16_t)CADBQuantDist(&block, qraw, nres, res);
+      }
+      break;
+   default:
+      return(FALSE);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL AllocDPWork(DPWORK *work, int ndist, int maxres)
+   -----------------------------------------------------
+   Outputs:    DPWORK  *work    Workspace
+   Inputs:     int     ndist    Number of distances
+               int     maxres   Number of residues in the longest chain
+   Returns:    BOOL             Success?
+
+   Allocates the workspace used by ReadDPColumns(). On failure, anything
+   allocated is freed.
+
+   16.10.26 Original (split from WriteIndex())   By: ACRM
+*/
+BOOL AllocDPWork(DPWORK *work, int ndist, int maxres)
+{
+   work->ndist     = ndist;
+   work->dist      = (uint16_t *)malloc((size_t)(ndist * maxres + 1) *
+                                        sizeof(uint16_t));
+   work->rowBuffer = (uint16_t *)malloc((size_t)(2 * ndist * maxres + 1) 
+                                        * sizeof(uint16_t));
+   work->qraw      = (unsigned char *)malloc(3 * maxres + 1);
+   work->qstored   = (unsigned char *)malloc(3 * maxres + 1);
+
+   if((work->dist == NULL) || (work->rowBuffer == NULL) ||
+      (work->qraw == NULL) || (work->qstored == NULL))
+   {
+      FreeDPWork(work);
+      return(FALSE);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void FreeDPWork(DPWORK *work)
+   -----------------------------
+   I/O:        DPWORK  *work    Workspace
+
+   Frees the workspace allocated by AllocDPWork().
+
+   16.10.26 Original (split from WriteIndex())   By: ACRM
+*/
+void FreeDPWork(DPWORK *work)
+{
+   if(work->dist      != NULL) free(work->dist);
+   if(work->rowBuffer != NULL) free(work->rowBuffer);
+   if(work->qraw      != NULL) free(work->qraw);
+   if(work->qstored   != NULL) free(work->qstored);
+   work->dist      = NULL;
+   work->rowBuffer = NULL;
+   work->qraw      = NULL;
+   work->qstored   = NULL;
+}
+
+
+/************************************************************************/
+/*>void ProcessAllFiles(DBOUT *db, OPTIONS *opts)
+   ----------------------------------------------
+   Inputs:     DBOUT   *db      The database being written (an array
+                                of opts->nshards shards)
+               OPTIONS *opts    Command line options
+
+   Lists the files in the specified directory and calls ProcessFile() 
+   on each one. 
+
+   The files are processed largest first so that a single huge entry
+   does not hold up the end of the run. Each file's results are written
+   to memory and are then written to the database in job order, so the
+   output is the same whatever the number of threads. The workers are
+   kept at most JOBSAHEAD jobs per thread ahead of the writer so that
+   a slow file cannot cause the results of all the later ones to be
+   held in memory.
+
+   06.10.98 Original   By: ACRM
+   18.01.02 Added limit
+   16.10.26 Files are now listed and sorted first. Added threads.
+            Takes DBOUT and OPTIONS structures
+   16.10.26 Writes checkpoints. When resuming, starts from the first
+            job not recorded in the checkpoint
+   16.10.26 Each job is written to the shard chosen by ShardForJob()
+   16.10.26 Starts reading ahead with -p
+   16.10.26 Writes the trace with -trace
+   16.10.26 Limits how far the workers may get ahead of the writer
+*/
+void ProcessAllFiles(DBOUT *db, OPTIONS *opts)
+{
+   PDBJOB    *jobs;
+   JOBQUEUE  queue;
+   CAARENA   arena;
+   pthread_t threads[MAXTHREADS];
+   int       njobs,
+             nthreads = opts->nthreads,
+             nstarted = 0,
+             i;
+   uint64_t  listHash;
+   
+   if((jobs = ListPDBFiles(opts, &njobs))==NULL)
+      return;
+
+   /* When resuming, the files must be the same as those of the build
+      that stopped
+   */
+   listHash = HashJobList(jobs, njobs);
+   if(db->firstJob && 
+      ((listHash != db->listHash) || (db->firstJob > njobs)))
+   {
+      fprintf(stderr,"The PDB files have changed since the checkpoint \
+was written. Unable to resume\n");
+      db->error = TRUE;
+      free(jobs);
+      return;
+   }
+   db->listHash = listHash;
+
+   if(opts->prevdb[0])
+   {
+      for(i=0; i<njobs; i++)
+         jobs[i].prev = FindPrevEntry(jobs[i].filename);
+   }
+
+   if(nthreads > (njobs - db->firstJob))
+      nthreads = njobs - db->firstJob;
+
+   if(opts->prefetch)
+      StartPrefetch(jobs, njobs, db->firstJob, opts->prefetch);
+
+   /* Single threaded - process and write each file in turn             */
+   if(nthreads <= 1)
+   {
+      memset(&arena, 0, sizeof(CAARENA));
+      for(i=db->firstJob; i<njobs; i++)
+      {
+         ProcessFile(&(jobs[i]), opts, &arena);
+         ReleasePrefetch(&(jobs[i]));
+         HashJobData(&(jobs[i]), opts);
+         WriteJob(ShardForJob(db, &(jobs[i]), opts), &(jobs[i]));
+         MaybeCheckpoint(db, i+1);
+      }
+      FreeArena(&arena);
+      StopPrefetch();
+      if(opts->tracefile[0])
+      {
+         WriteTrace(opts->tracefile, jobs+db->firstJob, 
+                    njobs-db->firstJob);
+         ReportTrace(jobs+db->firstJob, njobs-db->firstJob);
+      }
+      ReportReuse(jobs, njobs, opts);
+      ReportFilters(jobs, njobs, opts);
+      free(jobs);
+      return;
+   }
+   
+   queue.jobs        = jobs;
+   queue.opts        = opts;
+   queue.njobs       = njobs;
+   queue.nextJob     = db->firstJob;
+   queue.nextWritten = db->firstJob;
+   queue.maxAhead    = JOBSAHEAD * nthreads;
+   pthread_mutex_init(&(queue.mutex), NULL);
+   pthread_cond_init(&(queue.jobDone), NULL);
+   pthread_cond_init(&(queue.written), NULL);
+
+   for(i=0; i<nthreads; i++)
+   {
+      if(pthread_create(&(threads[i]), NULL, WorkerThread, &queue))
+      {
+         fprintf(stderr,"Warning: Unable to start thread %d\n", i+1);
+         break;
+      }
+      nstarted++;
+   }
+
+   /* Write the results in job order as they become available. If no
+      threads could be started, each job is done here before it is 
+      written
+   */
+   for(i=db->firstJob; i<njobs; i++)
+   {
+      if(!nstarted)
+      {
+         memset(&arena, 0, sizeof(CAARENA));
+         ProcessFile(&(jobs[i]), opts, &arena);
+         ReleasePrefetch(&(jobs[i]));
+         HashJobData(&(jobs[i]), opts);
+         FreeArena(&arena);
+      }
+      else
+      {
+         pthread_mutex_lock(&(queue.mutex));
+         while(!jobs[i].done)
+            pthread_cond_wait(&(queue.jobDone), &(queue.mutex));
+         pthread_mutex_unlock(&(queue.mutex));
+      }
+
+      WriteJob(ShardForJob(db, &(jobs[i]), opts), &(jobs[i]));
+      MaybeCheckpoint(db, i+1);
+
+      pthread_mutex_lock(&(queue.mutex));
+      queue.nextWritten = i+1;
+      pthread_cond_broadcast(&(queue.written));
+      pthread_mutex_unlock(&(queue.mutex));
+   }
+
+   for(i=0; i<nstarted; i++)
+      pthread_join(threads[i], NULL);
+
+   pthread_mutex_destroy(&(queue.mutex));
+   pthread_cond_destroy(&(queue.jobDone));
+   pthread_cond_destroy(&(queue.written));
+   StopPrefetch();
+   if(opts->tracefile[0])
+   {
+      WriteTrace(opts->tracefile, jobs+db->firstJob, njobs-db->firstJob);
+      ReportTrace(jobs+db->firstJob, njobs-db->firstJob);
+   }
+   ReportReuse(jobs, njobs, opts);
+   ReportFilters(jobs, njobs, opts);
+   free(jobs);
+}
+
+
+/************************************************************************/
+/*>PDBJOB *ListPDBFiles(OPTIONS *opts, int *njobs)
+   -----------------------------------------------
+   Inputs:     OPTIONS *opts   Command line options (PDB directory or
+                               file list, recursion, extensions and 
+                               limit)
+   Outputs:    int    *njobs   Number of files listed
+   Returns:    PDBJOB *        Malloc'd array of jobs (NULL if none)
+
+   Builds a job for each PDB file, either by scanning the PDB directory
+   or by reading the list of files. The jobs are sorted largest first.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Takes the OPTIONS. Directory scan moved to ScanPDBDir().
+            Added file list
+*/
+PDBJOB *ListPDBFiles(OPTIONS *opts, int *njobs)
+{
+   JOBLIST list;
+   BOOL    ok;
+
+   memset(&list, 0, sizeof(JOBLIST));
+
+   if(opts->listfile[0])
+      ok = ReadPDBList(opts->listfile, opts, &list);
+   else
+      ok = ScanPDBDir(opts->pdbdir, opts, 0, &list);
+
+   if(!ok)
+   {
+      fprintf(stderr,"No memory for list of PDB files\n");
+      if(list.jobs != NULL)
+         free(list.jobs);
+      *njobs = 0;
+      return(NULL);
+   }
+
+   *njobs = list.njobs;
+   if(list.njobs)
+      qsort(list.jobs, list.njobs, sizeof(PDBJOB), CompareJobs);
+
+   return(list.jobs);
+}
+
+
+/************************************************************************/
+/*>BOOL ScanPDBDir(char *dirname, OPTIONS *opts, int depth, 
+                   JOBLIST *list)
+   ---------------------------------------------------------
+   Inputs:     char    *dirname   Directory to scan
+               OPTIONS *opts      Command line options
+               int     depth      Depth of recursion
+   I/O:        JOBLIST *list      List of jobs
+   Returns:    BOOL               Success? (FALSE if out of memory)
+
+   Adds a job for each regular file in a directory whose name matches 
+   the extensions (if any were given). With -r, subdirectories (such 
+   as those of the wwPDB divided layout) are scanned as well. Hidden
+   files and directories are skipped as are symbolic links to 
+   directories (so that links cannot cause a loop).
+
+   The PDB code is obtained here since FNam2PDB() uses static storage 
+   and cannot be called from the worker threads.
+
+   16.10.26 Original (split from ListPDBFiles())   By: ACRM
+*/
+BOOL ScanPDBDir(char *dirname, OPTIONS *opts, int depth, JOBLIST *list)
+{
+   DIR           *dp;
+   struct dirent *dent;
+   struct stat   statbuf;
+   char          filename[MAXBUFF];
+   BOOL          ok = TRUE;
+
+   if((dp=opendir(dirname))==NULL)
+   {
+      if(depth)
+         fprintf(stderr,"Warning: Unable to read directory %s\n", 
+                 dirname);
+      return(TRUE);
+   }
+   
+   while(ok && ((dent=readdir(dp))!=NULL))
+   {
+      if(opts->limit && (list->njobs >= opts->limit))
+         break;
+      if(dent->d_name[0] == '.')
+         continue;
+
+      if(snprintf(filename, MAXBUFF, "%s/%s", dirname, dent->d_name) 
+         >= MAXBUFF)
+      {
+         fprintf(stderr,"Warning: Filename too long: %s/%s\n",
+                 dirname, dent->d_name);
+         continue;
+      }
+      
+      if(lstat(filename, &statbuf))
+         continue;
+
+      if(S_ISDIR(statbuf.st_mode))
+      {
+         if(opts->recurse && (depth < MAXDEPTH))
+            ok = ScanPDBDir(filename, opts, depth+1, list);
+         continue;
+      }
+      if(S_ISLNK(statbuf.st_mode) && stat(filename, &statbuf))
+         continue;
+      if(!S_ISREG(statbuf.st_mode) || !MatchExtension(filename, opts))
+         continue;
+
+      ok = AddJob(list, filename, &statbuf);
+   }
+   closedir(dp);
+
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadPDBList(char *listfile, OPTIONS *opts, JOBLIST *list)
+   --------------------------------------------------------------
+   Inputs:     char    *listfile  File containing a list of PDB files
+                                  (- for standard input)
+               OPTIONS *opts      Command line options
+   I/O:        JOBLIST *list      List of jobs
+   Returns:    BOOL               Success? (FALSE if out of memory)
+
+   Adds a job for each file named in the list (one per line). Blank 
+   lines and lines starting with a # are ignored. Files that do not
+   exist are reported and skipped.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL ReadPDBList(char *listfile, OPTIONS *opts, JOBLIST *list)
+{
+   FILE        *fp;
+   struct stat statbuf;
+   char        buffer[MAXBUFF],
+               *filename;
+   BOOL        ok = TRUE;
+
+   if(!strcmp(listfile, "-"))
+   {
+      fp = stdin;
+   }
+   else if((fp=fopen(listfile, "r"))==NULL)
+   {
+      fprintf(stderr,"Unable to read file list %s\n", listfile);
+      return(TRUE);
+   }
+   
+   while(ok && fgets(buffer, MAXBUFF, fp))
+   {
+      if(opts->limit && (list->njobs >= opts->limit))
+         break;
+
+      TERMINATE(buffer);
+      KILLTRAILSPACES(buffer);
+      filename = KillLeadSpaces(buffer);
+      if((filename[0] == '\0') || (filename[0] == '#'))
+         continue;
+
+      if(stat(filename, &statbuf) || !S_ISREG(statbuf.st_mode))
+      {
+         fprintf(stderr,"Warning: Unable to read %s\n", filename);
+         continue;
+      }
+      if(!MatchExtension(filename, opts))
+         continue;
+
+      ok = AddJob(list, filename, &statbuf);
+   }
+   
+   if(fp != stdin)
+      fclose(fp);
+   
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL MatchExtension(char *filename, OPTIONS *opts)
+   --------------------------------------------------
+   Inputs:     char    *filename  A filename
+               OPTIONS *opts      Command line options
+   Returns:    BOOL               Does the filename end with one of the
+                                  extensions? (TRUE if there are none)
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL MatchExtension(char *filename, OPTIONS *opts)
+{
+   int len = strlen(filename),
+       extlen,
+       i;
+
+   if(opts->nextensions == 0)
+      return(TRUE);
+   
+   for(i=0; i<opts->nextensions; i++)
+   {
+      extlen = strlen(opts->extensions[i]);
+      if((extlen <= len) &&
+         !strcmp(filename + len - extlen, opts->extensions[i]))
+         return(TRUE);
+   }
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>BOOL AddJob(JOBLIST *list, char *filename, struct stat *statbuf)
+   ----------------------------------------------------------------
+   I/O:        JOBLIST     *list      List of jobs
+   Inputs:     char        *filename  PDB file
+               struct stat *statbuf   Status of the file
+   Returns:    BOOL                   Success?
+
+   Adds a job to the list, expanding it as required.
+
+   16.10.26 Original (split from ListPDBFiles())   By: ACRM
+   16.10.26 Takes the file status and records the modification time
+*/
+BOOL AddJob(JOBLIST *list, char *filename, struct stat *statbuf)
+{
+   PDBJOB *newJobs;
+   char   *pdbcode;
+   
+   if((pdbcode = FNam2PDB(filename))==NULL)
+      return(TRUE);
+
+   if(list->njobs >= list->maxJobs)
+   {
+      list->maxJobs += 1024;
+      if((newJobs=(PDBJOB *)realloc(list->jobs, 
+                                    list->maxJobs*sizeof(PDBJOB)))==NULL)
+         return(FALSE);
+      list->jobs = newJobs;
+   }
+
+   memset(&(list->jobs[list->njobs]), 0, sizeof(PDBJOB));
+   strncpy(list->jobs[list->njobs].filename, filename, MAXBUFF-1);
+   strncpy(list->jobs[list->njobs].pdbcode, pdbcode, 15);
+   list->jobs[list->njobs].size  = statbuf->st_size;
+   list->jobs[list->njobs].mtime = statbuf->st_mtime;
+   list->njobs++;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL SetExtensions(char *extlist, OPTIONS *opts)
+   ------------------------------------------------
+   Inputs:     char    *extlist   Comma separated list of extensions
+   Outputs:    OPTIONS *opts      Extensions stored
+   Returns:    BOOL               Success?
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL SetExtensions(char *extlist, OPTIONS *opts)
+{
+   char buffer[MAXBUFF],
+        *ext;
+
+   strncpy(buffer, extlist, MAXBUFF-1);
+   buffer[MAXBUFF-1] = '\0';
+   opts->nextensions = 0;
+   
+   for(ext=strtok(buffer, ","); ext!=NULL; ext=strtok(NULL, ","))
+   {
+      if((opts->nextensions >= MAXEXT) || (strlen(ext) >= MAXEXTLEN))
+         return(FALSE);
+      strcpy(opts->extensions[opts->nextensions++], ext);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL SetWindowLengths(char *lenlist, OPTIONS *opts)
+   ---------------------------------------------------
+   Inputs:     char    *lenlist   Comma separated list of loop lengths
+   Outputs:    OPTIONS *opts      Loop lengths stored
+   Returns:    BOOL               Success?
+
+   Sets the loop lengths for which window tables are written. Repeated
+   lengths are only stored once.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL SetWindowLengths(char *lenlist, OPTIONS *opts)
+{
+   char buffer[MAXBUFF],
+        *len;
+   int  length,
+        i;
+
+   strncpy(buffer, lenlist, MAXBUFF-1);
+   buffer[MAXBUFF-1] = '\0';
+   opts->nwindows = 0;
+   
+   for(len=strtok(buffer, ","); len!=NULL; len=strtok(NULL, ","))
+   {
+      if((sscanf(len, "%d", &length) != 1) || (length < 1))
+         return(FALSE);
+      for(i=0; i<opts->nwindows; i++)
+      {
+         if(opts->windows[i] == length)
+            break;
+      }
+      if(i < opts->nwindows)
+         continue;
+      if(opts->nwindows >= CADB_MAXWINDOWS)
+         return(FALSE);
+      opts->windows[opts->nwindows++] = length;
+   }
+   return(opts->nwindows > 0);
+}
+
+
+/************************************************************************/
+/*>int CompareJobs(const void *job1, const void *job2)
+   ---------------------------------------------------
+   Inputs:     const void *job1    First PDBJOB
+               const void *job2    Second PDBJOB
+   Returns:    int                 qsort() comparison result
+
+   Sorts jobs by decreasing file size and then by filename so that the
+   order does not depend on the order in which readdir() returns files.
+
+   16.10.26 Original   By: ACRM
+*/
+int CompareJobs(const void *job1, const void *job2)
+{
+   const PDBJOB *j1 = (const PDBJOB *)job1,
+                *j2 = (const PDBJOB *)job2;
+
+   if(j1->size > j2->size)
+      return(-1);
+   if(j1->size < j2->size)
+      return(1);
+   return(strcmp(j1->filename, j2->filename));
+}
+
+
+/************************************************************************/
+/*>void *WorkerThread(void *arg)
+   -----------------------------
+   Inputs:     void   *arg     The JOBQUEUE
+   Returns:    void *          NULL
+
+   Worker thread. Takes the next job from the queue and processes it, 
+   then flags it as done. Repeats until there are no jobs left. Each
+   worker has its own arena for the CA atoms. A job is not started 
+   until it is less than queue->maxAhead jobs ahead of the next one to
+   be written.
+
+   Note that ReadPDBAtoms() (used for gzipped files) sets some Bioplib 
+   global flags (partial occupancy, multiple models) as it reads; these
+   are not used by this program so it is safe to call from several 
+   threads.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added arena
+   16.10.26 Releases the job's read-ahead buffer
+   16.10.26 Waits for the writer if too far ahead of it
+*/
+void *WorkerThread(void *arg)
+{
+   JOBQUEUE *queue = (JOBQUEUE *)arg;
+   PDBJOB   *job;
+   CAARENA  arena;
+
+   memset(&arena, 0, sizeof(CAARENA));
+
+   for(;;)
+   {
+      pthread_mutex_lock(&(queue->mutex));
+      while((queue->nextJob < queue->njobs) &&
+            ((queue->nextJob - queue->nextWritten) >= queue->maxAhead))
+         pthread_cond_wait(&(queue->written), &(queue->mutex));
+      if(queue->nextJob >= queue->njobs)
+      {
+         pthread_mutex_unlock(&(queue->mutex));
+         break;
+      }
+      job = &(queue->jobs[queue->nextJob++]);
+      pthread_mutex_unlock(&(queue->mutex));
+
+      ProcessFile(job, queue->opts, &arena);
+      ReleasePrefetch(job);
+      HashJobData(job, queue->opts);
+
+      pthread_mutex_lock(&(queue->mutex));
+      job->done = TRUE;
+      pthread_cond_broadcast(&(queue->jobDone));
+      pthread_mutex_unlock(&(queue->mutex));
+   }
+
+   FreeArena(&arena);
+   return(NULL);
+}
+
+
+/************************************************************************/
+/*>void StartPrefetch(PDBJOB *jobs, int njobs, int firstJob, int depth)
+   --------------------------------------------------------------------
+   Inputs:     PDBJOB   *jobs      The jobs
+               int      njobs      Number of jobs
+               int      firstJob   First job to be processed
+               int      depth      Maximum number of files to be held
+                                   in memory
+   Globals:    PREFETCH gPrefetch  Read-ahead state
+
+   Starts reading the PDB files into memory ahead of the workers. If 
+   compiled with HAVE_LIBURING and an io_uring can be set up, a single
+   thread queues the reads with io_uring; otherwise a pool of up to 
+   MAXPREFETCHREADERS threads each reads a file at a time. If no 
+   thread can be started, the files are simply read as usual.
+
+   16.10.26 Original   By: ACRM
+*/
+void StartPrefetch(PDBJOB *jobs, int njobs, int firstJob, int depth)
+{
+   int i;
+
+   memset(&gPrefetch, 0, sizeof(PREFETCH));
+   gPrefetch.jobs     = jobs;
+   gPrefetch.njobs    = njobs;
+   gPrefetch.nextRead = firstJob;
+   gPrefetch.depth    = depth;
+   pthread_mutex_init(&(gPrefetch.mutex), NULL);
+   pthread_cond_init(&(gPrefetch.fetched), NULL);
+   pthread_cond_init(&(gPrefetch.space), NULL);
+
+#ifdef HAVE_LIBURING
+   if(io_uring_queue_init(depth, &(gPrefetch.ring), 0) == 0)
+   {
+      if(!pthread_create(&(gPrefetch.readers[0]), NULL, 
+                         PrefetchUringThread, NULL))
+      {
+         gPrefetch.uring    = TRUE;
+         gPrefetch.nreaders = 1;
+         return;
+      }
+      io_uring_queue_exit(&(gPrefetch.ring));
+   }
+#endif
+
+   for(i=0; (i<depth) && (i<MAXPREFETCHREADERS); i++)
+   {
+      if(pthread_create(&(gPrefetch.readers[i]), NULL, PrefetchThread,
+                        NULL))
+         break;
+      gPrefetch.nreaders++;
+   }
+
+   if(!gPrefetch.nreaders)
+   {
+      fprintf(stderr,"Warning: Unable to start reading ahead\n");
+      StopPrefetch();
+   }
+}
+
+
+/************************************************************************/
+/*>void StopPrefetch(void)
+   -----------------------
+   Globals:    PREFETCH gPrefetch  Read-ahead state
+
+   Stops the reader threads and frees any buffers that were not used.
+
+   16.10.26 Original   By: ACRM
+*/
+void StopPrefetch(void)
+{
+   int i;
+
+   if(!gPrefetch.depth)
+      return;
+
+   pthread_mutex_lock(&(gPrefetch.mutex));
+   gPrefetch.stop = TRUE;
+   pthread_cond_broadcast(&(gPrefetch.space));
+   pthread_mutex_unlock(&(gPrefetch.mutex));
+
+   for(i=0; i<gPrefetch.nreaders; i++)
+      pthread_join(gPrefetch.readers[i], NULL);
+#ifdef HAVE_LIBURING
+   if(gPrefetch.uring)
+      io_uring_queue_exit(&(gPrefetch.ring));
+#endif
+
+   for(i=0; i<gPrefetch.njobs; i++)
+   {
+      if(gPrefetch.jobs[i].buffer != NULL)
+      {
+         free(gPrefetch.jobs[i].buffer);
+         gPrefetch.jobs[i].buffer = NULL;
+      }
+   }
+
+   pthread_mutex_destroy(&(gPrefetch.mutex));
+   pthread_cond_destroy(&(gPrefetch.fetched));
+   pthread_cond_destroy(&(gPrefetch.space));
+   memset(&gPrefetch, 0, sizeof(PREFETCH));
+}
+
+
+/************************************************************************/
+/*>void *PrefetchThread(void *arg)
+   -------------------------------
+   Inputs:     void     *arg       Not used
+   Returns:    void *              NULL
+   Globals:    PREFETCH gPrefetch  Read-ahead state
+
+   Reader thread used when io_uring is not available. Takes the next 
+   file to be read, waiting while depth files are already held, and 
+   reads it into memory. Repeats until all the files have been read.
+
+   16.10.26 Original   By: ACRM
+*/
+void *PrefetchThread(void *arg)
+{
+   PDBJOB *job;
+
+   (void)arg;
+
+   for(;;)
+   {
+      pthread_mutex_lock(&(gPrefetch.mutex));
+      while(!gPrefetch.stop && (gPrefetch.nextRead < gPrefetch.njobs) &&
+            (gPrefetch.nbuffers >= gPrefetch.depth))
+         pthread_cond_wait(&(gPrefetch.space), &(gPrefetch.mutex));
+      if(gPrefetch.stop || (gPrefetch.nextRead >= gPrefetch.njobs))
+      {
+         pthread_mutex_unlock(&(gPrefetch.mutex));
+         break;
+      }
+      job = &(gPrefetch.jobs[gPrefetch.nextRead++]);
+      gPrefetch.nbuffers++;
+      pthread_mutex_unlock(&(gPrefetch.mutex));
+
+      ReadWholeFile(job);
+      FinishFetch(job);
+   }
+
+   return(NULL);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadWholeFile(PDBJOB *job)
+   -------------------------------
+   I/O:        PDBJOB  *job     The job. buffer and bufferLength are set
+   Returns:    BOOL             Success?
+
+   Reads the job's file into a malloc'd buffer. Files which will be
+   reused from the previous database without being read (see 
+   ReuseOrHash()) are skipped.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Traced
+*/
+BOOL ReadWholeFile(PDBJOB *job)
+{
+   FILE        *fp;
+   struct stat statbuf;
+   size_t      nread;
+   double      start = TraceClock();
+
+   if((job->prev != NULL) && (job->prev->size == job->size) &&
+      (job->prev->mtime == job->mtime))
+      return(FALSE);
+
+   if((fp = fopen(job->filename, "r"))==NULL)
+      return(FALSE);
+
+   if((fstat(fileno(fp), &statbuf) != 0) ||
+      ((job->buffer = (char *)malloc(statbuf.st_size + 1))==NULL))
+   {
+      fclose(fp);
+      return(FALSE);
+   }
+
+   nread = fread(job->buffer, 1, statbuf.st_size, fp);
+   fclose(fp);
+   if(nread != (size_t)statbuf.st_size)
+   {
+      free(job->buffer);
+      job->buffer = NULL;
+      return(FALSE);
+   }
+
+   job->bufferLength        = nread;
+   job->trace.bytesRead = nread;
+   TraceStage(job, TRACE_READ, start);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void FinishFetch(PDBJOB *job)
+   -----------------------------
+   I/O:        PDBJOB   *job       The job which has been read
+   Globals:    PREFETCH gPrefetch  Read-ahead state
+
+   Flags that a job has been read (or that reading it failed) and wakes
+   any worker waiting for it.
+
+   16.10.26 Original   By: ACRM
+*/
+void FinishFetch(PDBJOB *job)
+{
+   pthread_mutex_lock(&(gPrefetch.mutex));
+   job->fetched = TRUE;
+   pthread_cond_broadcast(&(gPrefetch.fetched));
+   pthread_mutex_unlock(&(gPrefetch.mutex));
+}
+
+
+/************************************************************************/
+/*>void WaitPrefetch(PDBJOB *job)
+   ------------------------------
+   Inputs:     PDBJOB   *job       The job
+   Globals:    PREFETCH gPrefetch  Read-ahead state
+
+   Waits until the reader threads have finished with a job. Does 
+   nothing if not reading ahead.
+
+   16.10.26 Original   By: ACRM
+*/
+void WaitPrefetch(PDBJOB *job)
+{
+   if(!gPrefetch.depth)
+      return;
+
+   pthread_mutex_lock(&(gPrefetch.mutex));
+   while(!job->fetched)
+      pthread_cond_wait(&(gPrefetch.fetched), &(gPrefetch.mutex));
+   pthread_mutex_unlock(&(gPrefetch.mutex));
+}
+
+
+/************************************************************************/
+/*>void ReleasePrefetch(PDBJOB *job)
+   ---------------------------------
+   I/O:        PDBJOB   *job       The job which has been processed
+   Globals:    PREFETCH gPrefetch  Read-ahead state
+
+   Frees the memory copy of a job's file once it has been processed so
+   that the readers may start on another file. The workers take the 
+   jobs in the order in which they are read so a job that is being 
+   waited for is always within depth of the oldest job still held.
+
+   16.10.26 Original   By: ACRM
+*/
+void ReleasePrefetch(PDBJOB *job)
+{
+   if(!gPrefetch.depth)
+      return;
+
+   WaitPrefetch(job);
+
+   pthread_mutex_lock(&(gPrefetch.mutex));
+   if(job->buffer != NULL)
+   {
+      free(job->buffer);
+      job->buffer = NULL;
+   }
+   gPrefetch.nbuffers--;
+   pthread_cond_signal(&(gPrefetch.space));
+   pthread_mutex_unlock(&(gPrefetch.mutex));
+}
+
+
+/************************************************************************/
+/*>BOOL OpenPrefetched(PDBJOB *job, PDBFILE *in)
+   ---------------------------------------------
+   Inputs:     PDBJOB  *job     The job
+   Outputs:    PDBFILE *in      Set up to read from memory
+   Returns:    BOOL             Is the file in memory? If not, it must
+                                be read as usual
+
+   Waits for a job's file to be read ahead and sets up the PDBFILE to
+   read it from memory. A gzipped file is decompressed into a second
+   buffer (freed by the caller if in->inflated is set). Without zlib,
+   gzipped files are left to Bioplib as usual.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Traced
+   16.10.26 start is only declared when compiled with HAVE_ZLIB
+*/
+BOOL OpenPrefetched(PDBJOB *job, PDBFILE *in)
+{
+#ifdef HAVE_ZLIB
+   double start;
+#endif
+
+   WaitPrefetch(job);
+   if(job->buffer == NULL)
+      return(FALSE);
+
+   memset(in, 0, sizeof(PDBFILE));
+   if((job->bufferLength >= 2) &&
+      ((unsigned char)job->buffer[0] == 0x1f) &&
+      ((unsigned char)job->buffer[1] == 0x8b))
+   {
+#ifdef HAVE_ZLIB
+      start = TraceClock();
+      if(!InflateBuffer(job->buffer, job->bufferLength, 
+                        &(in->mem), &(in->memLength)))
+         return(FALSE);
+      TraceStage(job, TRACE_INFLATE, start);
+      in->inflated = TRUE;
+      return(TRUE);
+#else
+      return(FALSE);
+#endif
+   }
+
+   in->mem       = job->buffer;
+   in->memLength = job->bufferLength;
+   return(TRUE);
+}
+
+
+#ifdef HAVE_ZLIB
+/************************************************************************/
+/*>BOOL InflateBuffer(char *data, size_t length, char **out, 
+                      size_t *outLength)
+   ---------------------------------------------------------
+   Inputs:     char   *data       Gzipped data
+               size_t length      Length of data
+   Outputs:    char   **out       Malloc'd decompressed data
+               size_t *outLength  Length of out
+   Returns:    BOOL               Success?
+
+   Decompresses gzipped data held in memory. As with gzread(), several
+   concatenated gzip members are decompressed one after the other. 
+   Fails if the data are corrupt or truncated, in which case the file 
+   is read as usual.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL InflateBuffer(char *data, size_t length, char **out, 
+                   size_t *outLength)
+{
+   z_stream strm;
+   char     *buffer,
+            *newBuffer;
+   size_t   size = 4 * length + GZBUFFSIZE,
+            used = 0;
+   int      ret;
+
+   if(length > UINT_MAX)
+      return(FALSE);
+
+   memset(&strm, 0, sizeof(z_stream));
+   if(inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK)
+      return(FALSE);
+   if((buffer = (char *)malloc(size))==NULL)
+   {
+      inflateEnd(&strm);
+      return(FALSE);
+   }
+
+   strm.next_in  = (Bytef *)data;
+   strm.avail_in = (uInt)length;
+
+   for(;;)
+   {
+      if(used == size)
+      {
+         size *= 2;
+         if((newBuffer = (char *)realloc(buffer, size))==NULL)
+            break;
+         buffer = newBuffer;
+      }
+      strm.next_out  = (Bytef *)(buffer + used);
+      strm.avail_out = (uInt)MIN(size - used, UINT_MAX);
+
+      ret  = inflate(&strm, Z_NO_FLUSH);
+      used = (size_t)((char *)strm.next_out - buffer);
+
+      if(ret == Z_STREAM_END)
+      {
+         /* Finished unless another gzip member follows                 */
+         if(!strm.avail_in)
+         {
+            inflateEnd(&strm);
+            *out       = buffer;
+            *outLength = used;
+            return(TRUE);
+         }
+         if(inflateReset(&strm) != Z_OK)
+            break;
+      }
+      else if((ret != Z_OK) && 
+              !((ret == Z_BUF_ERROR) && (strm.avail_out == 0)))
+      {
+         break;
+      }
+   }
+
+   inflateEnd(&strm);
+   free(buffer);
+   return(FALSE);
+}
+#endif
+
+
+#ifdef HAVE_LIBURING
+/************************************************************************/
+/*>void *PrefetchUringThread(void *arg)
+   ------------------------------------
+   Inputs:     void     *arg       Not used
+   Returns:    void *              NULL
+   Globals:    PREFETCH gPrefetch  Read-ahead state
+
+   Reader thread using io_uring. Keeps reads of up to depth files in
+   flight at once, starting another as soon as a worker releases a
+   buffer. Files are opened here and read with io_uring; a short read 
+   is continued from where it stopped.
+
+   16.10.26 Original   By: ACRM
+*/
+void *PrefetchUringThread(void *arg)
+{
+   struct io_uring_cqe *cqe;
+   URINGREAD           *reads,
+                       *rd;
+   PDBJOB              *job;
+   int                 ninflight = 0,
+                       ret,
+                       i;
+   BOOL                allStarted;
+
+   (void)arg;
+
+   if((reads = (URINGREAD *)calloc(gPrefetch.depth, 
+                                   sizeof(URINGREAD)))==NULL)
+   {
+      /* Fall back to reading each file in turn in this thread         */
+      return(PrefetchThread(NULL));
+   }
+
+   for(;;)
+   {
+      /* Start reading as many of the upcoming files as there is room 
+         for. Wait for room only if there is nothing in flight
+      */
+      pthread_mutex_lock(&(gPrefetch.mutex));
+      while(!ninflight && !gPrefetch.stop && 
+            (gPrefetch.nextRead < gPrefetch.njobs) &&
+            (gPrefetch.nbuffers >= gPrefetch.depth))
+         pthread_cond_wait(&(gPrefetch.space), &(gPrefetch.mutex));
+      while(!gPrefetch.stop && (gPrefetch.nextRead < gPrefetch.njobs) &&
+            (gPrefetch.nbuffers < gPrefetch.depth))
+      {
+         job = &(gPrefetch.jobs[gPrefetch.nextRead++]);
+         gPrefetch.nbuffers++;
+         pthread_mutex_unlock(&(gPrefetch.mutex));
+
+         for(rd=reads; rd->job!=NULL; rd++);
+         if(StartUringRead(job, rd))
+            ninflight++;
+         else
+            FinishFetch(job);
+
+         pthread_mutex_lock(&(gPrefetch.mutex));
+      }
+      allStarted = (gPrefetch.stop || 
+                    (gPrefetch.nextRead >= gPrefetch.njobs));
+      pthread_mutex_unlock(&(gPrefetch.mutex));
+
+      if(!ninflight)
+      {
+         if(allStarted)
+            break;
+         continue;
+      }
+
+      /* Wait for a read to complete                                    */
+      io_uring_submit(&(gPrefetch.ring));
+      while((ret = io_uring_wait_cqe(&(gPrefetch.ring), &cqe)) == -EINTR);
+      if(ret < 0)
+      {
+         fprintf(stderr,"Warning: io_uring failed. Reading ahead \
+stopped\n");
+         break;
+      }
+      rd  = (URINGREAD *)io_uring_cqe_get_data(cqe);
+      ret = cqe->res;
+      io_uring_cqe_seen(&(gPrefetch.ring), cqe);
+
+      if(ret > 0)
+      {
+         rd->nread += ret;
+         if((rd->nread < rd->job->bufferLength) && QueueUringRead(rd))
+            continue;
+      }
+
+      /* The read is complete (or failed)                               */
+      job = rd->job;
+      close(rd->fd);
+      if(rd->nread != job->bufferLength)
+      {
+         free(job->buffer);
+         job->buffer = NULL;
+      }
+      else
+      {
+         job->trace.bytesRead = rd->nread;
+         TraceStage(job, TRACE_READ, rd->start);
+      }
+      rd->job = NULL;
+      ninflight--;
+      FinishFetch(job);
+   }
+
+   /* Only reached with reads in flight if io_uring failed. Finish with
+      the ring before freeing the buffers and read the remaining files
+      in this thread
+   */
+   if(ninflight)
+   {
+      io_uring_queue_exit(&(gPrefetch.ring));
+      gPrefetch.uring = FALSE;
+      for(i=0; i<gPrefetch.depth; i++)
+      {
+         if((job = reads[i].job) != NULL)
+         {
+            close(reads[i].fd);
+            free(job->buffer);
+            job->buffer = NULL;
+            ReadWholeFile(job);
+            FinishFetch(job);
+         }
+      }
+      free(reads);
+      return(PrefetchThread(NULL));
+   }
+
+   free(reads);
+   return(NULL);
+}
+
+
+/************************************************************************/
+/*>BOOL StartUringRead(PDBJOB *job, URINGREAD *rd)
+   -----------------------------------------------
+   I/O:        PDBJOB    *job     The job. buffer and bufferLength are
+                                  set
+   Outputs:    URINGREAD *rd      The read
+   Returns:    BOOL               Has the read been queued?
+
+   Opens a job's file, allocates its buffer and queues the read. Files 
+   which will be reused from the previous database are skipped as for
+   ReadWholeFile().
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL StartUringRead(PDBJOB *job, URINGREAD *rd)
+{
+   struct stat statbuf;
+
+   if((job->prev != NULL) && (job->prev->size == job->size) &&
+      (job->prev->mtime == job->mtime))
+      return(FALSE);
+
+   if((rd->fd = open(job->filename, O_RDONLY))<0)
+      return(FALSE);
+
+   if((fstat(rd->fd, &statbuf) != 0) || (statbuf.st_size == 0) ||
+      ((job->buffer = (char *)malloc(statbuf.st_size + 1))==NULL))
+   {
+      close(rd->fd);
+      return(FALSE);
+   }
+
+   job->bufferLength = (size_t)statbuf.st_size;
+   rd->job           = job;
+   rd->nread         = 0;
+   rd->start         = TraceClock();
+   if(!QueueUringRead(rd))
+   {
+      close(rd->fd);
+      free(job->buffer);
+      job->buffer = NULL;
+      rd->job     = NULL;
+      return(FALSE);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL QueueUringRead(URINGREAD *rd)
+   ----------------------------------
+   Inputs:     URINGREAD *rd      The read
+   Returns:    BOOL               Success?
+   Globals:    PREFETCH  gPrefetch  Read-ahead state
+
+   Queues a read of the rest of a file into its buffer. It is 
+   submitted by PrefetchUringThread().
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL QueueUringRead(URINGREAD *rd)
+{
+   struct io_uring_sqe *sqe;
+
+   if((sqe = io_uring_get_sqe(&(gPrefetch.ring)))==NULL)
+      return(FALSE);
+   io_uring_prep_read(sqe, rd->fd, rd->job->buffer + rd->nread,
+                      (unsigned)MIN(rd->job->bufferLength - rd->nread,
+                                    UINT_MAX),
+                      (uint64_t)rd->nread);
+   io_uring_sqe_set_data(sqe, rd);
+   return(TRUE);
+}
+#endif
+
+
+/************************************************************************/
+/*>void StartTrace(void)
+   ---------------------
+   Globals:    TRACE    gTrace     Trace state
+
+   Starts timing the build for -trace.
+
+   16.10.26 Original   By: ACRM
+*/
+void StartTrace(void)
+{
+   memset(&gTrace, 0, sizeof(TRACE));
+   clock_gettime(CLOCK_MONOTONIC, &(gTrace.start));
+   pthread_key_create(&(gTrace.threadKey), NULL);
+   pthread_mutex_init(&(gTrace.mutex), NULL);
+   gTrace.on = TRUE;
+}
+
+
+/************************************************************************/
+/*>double TraceClock(void)
+   -----------------------
+   Returns:    double              Seconds since the start of the build
+                                   (0 if not tracing)
+   Globals:    TRACE    gTrace     Trace state
+
+   16.10.26 Original   By: ACRM
+*/
+double TraceClock(void)
+{
+   struct timespec now;
+
+   if(!gTrace.on)
+      return(0.0);
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return((double)(now.tv_sec - gTrace.start.tv_sec) +
+          1.0e-9 * (double)(now.tv_nsec - gTrace.start.tv_nsec));
+}
+
+
+/************************************************************************/
+/*>int TraceThread(void)
+   ---------------------
+   Returns:    int                 Number of the calling thread
+   Globals:    TRACE    gTrace     Trace state
+
+   Returns the number of the calling thread, numbering it the first 
+   time that it is called from that thread.
+
+   16.10.26 Original   By: ACRM
+*/
+int TraceThread(void)
+{
+   void *thread;
+
+   if((thread = pthread_getspecific(gTrace.threadKey)) == NULL)
+   {
+      pthread_mutex_lock(&(gTrace.mutex));
+      thread = (void *)(intptr_t)(++gTrace.nthreads);
+      pthread_mutex_unlock(&(gTrace.mutex));
+      pthread_setspecific(gTrace.threadKey, thread);
+   }
+   return((int)(intptr_t)thread);
+}
+
+
+/************************************************************************/
+/*>void TraceStage(PDBJOB *job, int stage, double start)
+   -----------------------------------------------------
+   I/O:        PDBJOB   *job       The job
+   Inputs:     int      stage      The stage (TRACE_READ, etc.)
+               double   start      Value of TraceClock() when the 
+                                   stage started
+   Globals:    TRACE    gTrace     Trace state
+
+   Records that a stage of a job has finished. Does nothing if not 
+   tracing.
+
+   16.10.26 Original   By: ACRM
+*/
+void TraceStage(PDBJOB *job, int stage, double start)
+{
+   if(!gTrace.on)
+      return;
+
+   job->trace.start[stage]  = start;
+   job->trace.time[stage]   = TraceClock() - start;
+   job->trace.thread[stage] = TraceThread();
+}
+
+
+/************************************************************************/
+/*>BOOL WriteTrace(char *filename, PDBJOB *jobs, int njobs)
+   --------------------------------------------------------
+   Inputs:     char     *filename  Trace file
+               PDBJOB   *jobs      The jobs
+               int      njobs      Number of jobs
+   Returns:    BOOL                Success?
+
+   Writes a complete ("X") event in the Chrome trace event format for
+   each stage of each job. Times are in microseconds and each thread 
+   is shown separately. The file, number of residues and bytes read or
+   written are given as the event's arguments.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL WriteTrace(char *filename, PDBJOB *jobs, int njobs)
+{
+   static char *stageNames[TRACE_NSTAGES] =
+      {"read", "decompress", "parse", "distances", "write"};
+   FILE     *fp;
+   JOBTRACE *trace;
+   int      i,
+            stage;
+   BOOL     first = TRUE,
+            ok;
+
+   if((fp = fopen(filename, "w"))==NULL)
+   {
+      fprintf(stderr,"Unable to write trace file %s\n", filename);
+      return(FALSE);
+   }
+
+   fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+   for(i=0; i<njobs; i++)
+   {
+      trace = &(jobs[i].trace);
+      for(stage=0; stage<TRACE_NSTAGES; stage++)
+      {
+         if(!trace->thread[stage])
+            continue;
+
+         fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"makecadb\",\
+\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\
+\"args\":{\"file\":",
+                 (first ? "" : ","), stageNames[stage], 
+                 trace->thread[stage], 1.0e6 * trace->start[stage], 
+                 1.0e6 * trace->time[stage]);
+         WriteJSONString(fp, jobs[i].filename);
+         fprintf(fp, ",\"residues\":%d", trace->natoms);
+         if(stage == TRACE_READ)
+            fprintf(fp, ",\"bytes\":%llu", 
+                    (unsigned long long)trace->bytesRead);
+         else if(stage == TRACE_WRITE)
+            fprintf(fp, ",\"bytes\":%llu", 
+                    (unsigned long long)trace->bytesWritten);
+         fprintf(fp, "}}");
+         first = FALSE;
+      }
+   }
+   fprintf(fp, "\n]}\n");
+
+   ok = !ferror(fp);
+   if(fclose(fp) || !ok)
+   {
+      fprintf(stderr,"Error writing trace file %s\n", filename);
+      return(FALSE);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void WriteJSONString(FILE *fp, char *string)
+   --------------------------------------------
+   Inputs:     FILE     *fp        Output file
+               char     *string    String to write
+
+   Writes a string as a quoted JSON string.
+
+   16.10.26 Original   By: ACRM
+*/
+void WriteJSONString(FILE *fp, char *string)
+{
+   putc('"', fp);
+   for(; *string; string++)
+   {
+      if((*string == '"') || (*string == '\\'))
+         fprintf(fp, "\\%c", *string);
+      else if((unsigned char)*string < 0x20)
+         fprintf(fp, "\\u%04x", (unsigned char)*string);
+      else
+         putc(*string, fp);
+   }
+   putc('"', fp);
+}
+
+
+/************************************************************************/
+/*>void ReportTrace(PDBJOB *jobs, int njobs)
+   -----------------------------------------
+   Inputs:     PDBJOB   *jobs      The jobs
+               int      njobs      Number of jobs
+
+   Prints a summary of the trace: the total, median and 99th 
+   percentile time of each stage over the files for which it was done,
+   the number of residues processed per second of the build, the bytes
+   read from the PDB files and written for them (not counting the 
+   header and tables at the end of the database), the peak resident 
+   set size and the TRACE_TOPN files that took longest over all 
+   stages.
+
+   16.10.26 Original   By: ACRM
+*/
+void ReportTrace(PDBJOB *jobs, int njobs)
+{
+   static char *stageNames[TRACE_NSTAGES] =
+      {"read", "decompress", "parse", "distances", "write"};
+   double        *times,
+                 total,
+                 elapsed = TraceClock();
+   int           slowest[TRACE_TOPN],
+                 nslowest = 0,
+                 stage,
+                 n,
+                 i,
+                 j;
+   uint64_t      natoms       = 0,
+                 bytesRead    = 0,
+                 bytesWritten = 0;
+   struct rusage usage;
+
+   if((times = (double *)malloc(MAX(njobs, 1) * sizeof(double)))==NULL)
+   {
+      fprintf(stderr,"No memory for trace summary\n");
+      return;
+   }
+
+   fprintf(stderr,"Trace of %d files in %.3f seconds:\n", njobs, elapsed);
+   fprintf(stderr,"   Stage       Files   Total (s)  Median (ms)  \
+P99 (ms)\n");
+   for(stage=0; stage<TRACE_NSTAGES; stage++)
+   {
+      total = 0.0;
+      for(i=0, n=0; i<njobs; i++)
+      {
+         if(jobs[i].trace.thread[stage])
+         {
+            times[n++] = jobs[i].trace.time[stage];
+            total     += jobs[i].trace.time[stage];
+         }
+      }
+      if(!n)
+         continue;
+      qsort(times, n, sizeof(double), CompareDoubles);
+      fprintf(stderr,"   %-10s %6d %11.3f %12.3f %9.3f\n",
+              stageNames[stage], n, total, 1000.0 * times[(n-1)/2],
+              1000.0 * times[(int)ceil(0.99 * n) - 1]);
+   }
+
+   /* Totals and the slowest files, kept in order slowest first        */
+   for(i=0; i<njobs; i++)
+   {
+      natoms       += (uint64_t)jobs[i].trace.natoms;
+      bytesRead    += jobs[i].trace.bytesRead;
+      bytesWritten += jobs[i].trace.bytesWritten;
+
+      total = JobTraceTime(&(jobs[i]));
+      if((nslowest == TRACE_TOPN) &&
+         (total <= JobTraceTime(&(jobs[slowest[TRACE_TOPN-1]]))))
+         continue;
+      if(nslowest < TRACE_TOPN)
+         nslowest++;
+      for(j=nslowest-1; 
+          (j>0) && (total > JobTraceTime(&(jobs[slowest[j-1]]))); 
+          j--)
+         slowest[j] = slowest[j-1];
+      slowest[j] = i;
+   }
+
+   fprintf(stderr,"   Residues:      %llu (%.0f per second)\n",
+           (unsigned long long)natoms, 
+           ((elapsed > 0.0) ? (double)natoms / elapsed : 0.0));
+   fprintf(stderr,"   Bytes read:    %llu\n", 
+           (unsigned long long)bytesRead);
+   fprintf(stderr,"   Bytes written: %llu\n", 
+           (unsigned long long)bytesWritten);
+   if(!getrusage(RUSAGE_SELF, &usage))
+      fprintf(stderr,"   Peak RSS:      %ld KB\n", usage.ru_maxrss);
+
+   fprintf(stderr,"   Slowest files:\n");
+   for(i=0; i<nslowest; i++)
+   {
+      fprintf(stderr,"   %10.3f ms  %s (%d residues)\n", 
+              1000.0 * JobTraceTime(&(jobs[slowest[i]])),
+              jobs[slowest[i]].filename, 
+              jobs[slowest[i]].trace.natoms);
+   }
+
+   free(times);
+}
+
+
+/************************************************************************/
+/*>double JobTraceTime(PDBJOB *job)
+   --------------------------------
+   Inputs:     PDBJOB   *job       The job
+   Returns:    double              Total time of all its stages
+
+   16.10.26 Original   By: ACRM
+*/
+double JobTraceTime(PDBJOB *job)
+{
+   double total = 0.0;
+   int    stage;
+
+   for(stage=0; stage<TRACE_NSTAGES; stage++)
+      total += job->trace.time[stage];
+   return(total);
+}
+
+
+/************************************************************************/
+/*>int CompareDoubles(const void *d1, const void *d2)
+   --------------------------------------------------
+   Inputs:     const void  *d1     Pointer to first double
+               const void  *d2     Pointer to second double
+   Returns:    int                 -1, 0 or 1 for sorting into 
+                                   ascending order
+
+   16.10.26 Original   By: ACRM
+*/
+int CompareDoubles(const void *d1, const void *d2)
+{
+   double a = *(const double *)d1,
+          b = *(const double *)d2;
+
+   if(a < b)
+      return(-1);
+   if(a > b)
+      return(1);
+   return(0);
+}
+
+
+/************************************************************************/
+/*>void WriteJob(DBOUT *db, PDBJOB *job)
+   -------------------------------------
+   Inputs:     DBOUT   *db      The database being written
+               PDBJOB  *job     A processed job
+
+   Writes the output for a job to the database and frees it. For binary
+   output, the job's chain table entries are moved to the database chain
+   table with their offsets and record numbers made absolute.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Adds a manifest entry
+   16.10.26 Chain table expansion moved to GrowChainTable(). Jobs are
+            passed to WriteDedupedJob() when removing duplicate chains
+   16.10.26 Traced
+   16.10.26 Adds the job to the build fingerprint
+*/
+void WriteJob(DBOUT *db, PDBJOB *job)
+{
+   int       i;
+   uint64_t  offset = db->offset;
+   double    start  = TraceClock();
+
+   if(db->binary)
+      db->fingerprint = HashBytes(db->fingerprint, &(job->dataHash),
+                                  sizeof(uint64_t));
+
+   if(db->dedupe)
+   {
+      WriteDedupedJob(db, job);
+      job->trace.bytesWritten = db->offset - offset;
+      TraceStage(job, TRACE_WRITE, start);
+      return;
+   }
+
+   if(db->manifest && !AddManifestEntry(db, job))
+   {
+      fprintf(stderr,"No memory for manifest\n");
+      db->error = TRUE;
+   }
+
+   if(db->binary && job->nchains)
+   {
+      if(!GrowChainTable(db, job->nchains))
+         return;
+
+      for(i=0; i<job->nchains; i++)
+      {
+         db->chains[db->nchains] = job->chains[i];
+         db->chains[db->nchains].offset      += db->offset;
+         db->chains[db->nchains].firstRecord += db->nrecords;
+         db->nchains++;
+      }
+   }
+   
+   if(job->data != NULL)
+   {
+      if(fwrite(job->data, 1, job->length, db->fp) != job->length)
+         db->error = TRUE;
+      free(job->data);
+      job->data = NULL;
+   }
+   if(job->chains != NULL)
+   {
+      free(job->chains);
+      job->chains = NULL;
+   }
+
+   db->offset   += job->length;
+   db->nrecords += job->nrecords;
+
+   job->trace.bytesWritten = db->offset - offset;
+   TraceStage(job, TRACE_WRITE, start);
+}
+
+
+/************************************************************************/
+/*>BOOL GrowChainTable(DBOUT *db, int nchains)
+   -------------------------------------------
+   I/O:        DBOUT   *db      The database being written
+   Inputs:     int     nchains  Number of chains to be added
+   Returns:    BOOL             Success?
+
+   Makes sure that there is space in the chain table for another 
+   nchains chains. Sets the error flag if there is no memory.
+
+   16.10.26 Original (split from WriteJob())   By: ACRM
+*/
+BOOL GrowChainTable(DBOUT *db, int nchains)
+{
+   CADBCHAIN *newChains;
+
+   if(db->nchains + nchains > db->maxChains)
+   {
+      db->maxChains += nchains + 4096;
+      if((newChains=(CADBCHAIN *)realloc(db->chains,
+                       db->maxChains * sizeof(CADBCHAIN)))==NULL)
+      {
+         fprintf(stderr,"No memory for chain table\n");
+         db->error = TRUE;
+         return(FALSE);
+      }
+      db->chains = newChains;
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void WriteDedupedJob(DBOUT *db, PDBJOB *job)
+   --------------------------------------------
+   Inputs:     DBOUT   *db      The database being written
+               PDBJOB  *job     A processed job
+
+   Equivalent of WriteJob() used with -R. Each chain of the job is 
+   checked against the chains already stored. A chain which duplicates
+   one of them is added to the alias table rather than being written;
+   otherwise its block is written and it becomes a candidate for the 
+   chains that follow. Since the jobs are written in a fixed order, 
+   the database is independent of the number of threads.
+
+   16.10.26 Original   By: ACRM
+*/
+void WriteDedupedJob(DBOUT *db, PDBJOB *job)
+{
+   CADBCHAIN *chain;
+   CADBRESID *resids;
+   uint64_t  hash;
+   int64_t   target;
+   size_t    sigPos = 0;
+   int       nres,
+             i;
+   BOOL      hasSig;
+
+   if(job->nchains && !GrowChainTable(db, job->nchains))
+      job->nchains = 0;
+
+   for(i=0; i<job->nchains; i++)
+   {
+      chain  = &(job->chains[i]);
+      nres   = (int)chain->nres;
+      resids = (CADBRESID *)(job->data + chain->offset);
+      hash   = HashResids(resids, nres);
+
+      /* A chain without a signature (if the job ran out of memory) is
+         simply stored
+      */
+      hasSig = (sigPos + nres * db->ndist <= job->nsigs);
+      target = (hasSig ? 
+                FindRepChain(db, resids, job->sigs + sigPos, nres, hash) :
+                -1);
+
+      if(target >= 0)
+      {
+         if(!AddAlias(db, chain, (uint64_t)target))
+            db->error = TRUE;
+         db->nAliasRecords += nres;
+      }
+      else
+      {
+         if(hasSig && 
+            !AddRepChain(db, db->nchains, resids, job->sigs + sigPos,
+                         nres, hash))
+            db->error = TRUE;
+
+         db->chains[db->nchains] = *chain;
+         db->chains[db->nchains].offset      = db->offset;
+         db->chains[db->nchains].firstRecord = db->nrecords;
+         db->nchains++;
+
+         if(fwrite(job->data + chain->offset, 1, chain->size, db->fp) !=
+            chain->size)
+            db->error = TRUE;
+         db->offset   += chain->size;
+         db->nrecords += nres;
+      }
+      sigPos += nres * db->ndist;
+   }
+
+   if(job->data != NULL)
+   {
+      free(job->data);
+      job->data = NULL;
+   }
+   if(job->chains != NULL)
+   {
+      free(job->chains);
+      job->chains = NULL;
+   }
+   if(job->sigs != NULL)
+   {
+      free(job->sigs);
+      job->sigs = NULL;
+   }
+}
+
+
+/************************************************************************/
+/*>uint64_t HashResids(CADBRESID *resids, int nres)
+   ------------------------------------------------
+   Inputs:     CADBRESID *resids   Residue identifiers for a chain
+               int       nres      Number of residues
+   Returns:    uint64_t            64-bit FNV-1a hash
+
+   16.10.26 Original   By: ACRM
+*/
+uint64_t HashResids(CADBRESID *resids, int nres)
+{
+   uint64_t      h = 0xcbf29ce484222325ULL;
+   unsigned char *c   = (unsigned char *)resids,
+                 *end = c + nres * sizeof(CADBRESID);
+
+   for(; c<end; c++)
+   {
+      h ^= (uint64_t)*c;
+      h *= 0x100000001b3ULL;
+   }
+   return(h);
+}
+
+
+/************************************************************************/
+/*>int64_t FindRepChain(DBOUT *db, CADBRESID *resids, uint16_t *sig,
+                        int nres, uint64_t hash)
+   -----------------------------------------------------------------
+   Inputs:     DBOUT     *db      The database being written
+               CADBRESID *resids  Residue identifiers for a chain
+               uint16_t  *sig     Signature for the chain
+               int       nres     Number of residues
+               uint64_t  hash     Hash of the residue identifiers
+   Returns:    int64_t            Index in the chain table of a stored
+                                  chain which this duplicates or -1
+
+   Looks for a stored chain with the same residue identifiers whose
+   signature matches to within the tolerance. The candidates are read
+   back from the signature file so that only the hash table is kept in
+   memory.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Residue count compared as a uint32_t
+*/
+int64_t FindRepChain(DBOUT *db, CADBRESID *resids, uint16_t *sig,
+                     int nres, uint64_t hash)
+{
+   REPCHAIN      *rep;
+   unsigned char *newBuffer;
+   uint16_t      repSig;
+   size_t        residSize = nres * sizeof(CADBRESID),
+                 sigSize   = nres * db->ndist * sizeof(uint16_t);
+   int           i,
+                 diff;
+
+   for(rep=db->repHash[hash % REPHASHSIZE]; rep!=NULL; NEXT(rep))
+   {
+      if((rep->hash != hash) || 
+         (db->chains[rep->chain].nres != (uint32_t)nres))
+         continue;
+
+      if(residSize + sigSize > db->sigBufferSize)
+      {
+         if((newBuffer = (unsigned char *)realloc(db->sigBuffer, 
+                                            residSize + sigSize))==NULL)
+            return(-1);
+         db->sigBuffer     = newBuffer;
+         db->sigBufferSize = residSize + sigSize;
+      }
+      if(fseeko(db->sigFp, rep->sigOffset, SEEK_SET) ||
+         (fread(db->sigBuffer, 1, residSize + sigSize, db->sigFp) !=
+          residSize + sigSize))
+      {
+         db->error = TRUE;
+         return(-1);
+      }
+      if(memcmp(db->sigBuffer, resids, residSize))
+         continue;
+
+      for(i=0; i<nres*db->ndist; i++)
+      {
+         memcpy(&repSig, db->sigBuffer + residSize + i*sizeof(uint16_t),
+                sizeof(uint16_t));
+         if((repSig == CADB_MISSING) || (sig[i] == CADB_MISSING))
+         {
+            if(repSig != sig[i])
+               break;
+         }
+         else
+         {
+            diff = (int)repSig - (int)sig[i];
+            if((diff > db->dedupeTol) || (diff < -db->dedupeTol))
+               break;
+         }
+      }
+      if(i == nres*db->ndist)
+         return((int64_t)rep->chain);
+   }
+   return(-1);
+}
+
+
+/************************************************************************/
+/*>BOOL AddRepChain(DBOUT *db, uint64_t chain, CADBRESID *resids, 
+                    uint16_t *sig, int nres, uint64_t hash)
+   -------------------------------------------------------------
+   I/O:        DBOUT     *db      The database being written
+   Inputs:     uint64_t  chain    Index of the chain in the chain table
+               CADBRESID *resids  Residue identifiers for the chain
+               uint16_t  *sig     Signature for the chain
+               int       nres     Number of residues
+               uint64_t  hash     Hash of the residue identifiers
+   Returns:    BOOL               Success?
+
+   Adds a stored chain to the hash table and appends its residue
+   identifiers and signature to the signature file.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL AddRepChain(DBOUT *db, uint64_t chain, CADBRESID *resids, 
+                 uint16_t *sig, int nres, uint64_t hash)
+{
+   REPCHAIN *rep;
+
+   if((rep = (REPCHAIN *)malloc(sizeof(REPCHAIN)))==NULL)
+      return(FALSE);
+
+   if(fseeko(db->sigFp, 0, SEEK_END) ||
+      ((rep->sigOffset = ftello(db->sigFp)) < 0) ||
+      (fwrite(resids, sizeof(CADBRESID), nres, db->sigFp) != 
+       (size_t)nres) ||
+      (fwrite(sig, sizeof(uint16_t), nres * db->ndist, db->sigFp) != 
+       (size_t)(nres * db->ndist)))
+   {
+      free(rep);
+      return(FALSE);
+   }
+
+   rep->hash  = hash;
+   rep->chain = chain;
+   rep->next  = db->repHash[hash % REPHASHSIZE];
+   db->repHash[hash % REPHASHSIZE] = rep;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void FreeDedupe(DBOUT *db)
+   --------------------------
+   I/O:        DBOUT   *db      The database being written
+
+   Frees the hash table, alias table and signature file used to remove
+   duplicate chains.
+
+   16.10.26 Original   By: ACRM
+*/
+void FreeDedupe(DBOUT *db)
+{
+   REPCHAIN *rep,
+            *next;
+   int      i;
+
+   if(db->repHash != NULL)
+   {
+      for(i=0; i<REPHASHSIZE; i++)
+      {
+         for(rep=db->repHash[i]; rep!=NULL; rep=next)
+         {
+            next = rep->next;
+            free(rep);
+         }
+      }
+      free(db->repHash);
+      db->repHash = NULL;
+   }
+   if(db->aliases != NULL)
+   {
+      free(db->aliases);
+      db->aliases = NULL;
+   }
+   if(db->sigBuffer != NULL)
+   {
+      free(db->sigBuffer);
+      db->sigBuffer = NULL;
+   }
+   if(db->sigFp != NULL)
+   {
+      fclose(db->sigFp);
+      db->sigFp = NULL;
+   }
+}
+
+
+/************************************************************************/
+/*>BOOL AddAlias(DBOUT *db, CADBCHAIN *chain, uint64_t target)
+   -----------------------------------------------------------
+   I/O:        DBOUT     *db      The database being written
+   Inputs:     CADBCHAIN *chain   Chain which is not being stored
+               uint64_t  target   Index of the stored chain that it
+                                  duplicates
+   Returns:    BOOL               Success?
+
+   Adds an entry to the alias table, expanding it as required.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL AddAlias(DBOUT *db, CADBCHAIN *chain, uint64_t target)
+{
+   CADBALIAS *newAliases;
+
+   if(db->naliases >= db->maxAliases)
+   {
+      db->maxAliases += 1024;
+      if((newAliases=(CADBALIAS *)realloc(db->aliases,
+                        db->maxAliases * sizeof(CADBALIAS)))==NULL)
+         return(FALSE);
+      db->aliases = newAliases;
+   }
+
+   memset(&(db->aliases[db->naliases]), 0, sizeof(CADBALIAS));
+   memcpy(db->aliases[db->naliases].pdbcode, chain->pdbcode, 8);
+   memcpy(db->aliases[db->naliases].chain,   chain->chain,   8);
+   db->aliases[db->naliases].target = target;
+   db->naliases++;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void ProcessFile(PDBJOB *job, OPTIONS *opts, CAARENA *arena)
+   --------------------------------------------------------------
+   Inputs:     PDBJOB  *job     The PDB file to be processed
+               OPTIONS *opts    Command line options
+   I/O:        CAARENA *arena   Arena used for the CA atoms
+
+   Reads the CA atoms from the specified PDB file and call 
+   CalcDistances() to calculate distance constraints and write results 
+   to the job's memory buffer.
+
+   06.10.98 Original   By: ACRM
+   11.01.02 Added check that SelectCaPDB() found some atoms
+   16.10.26 Now works on a PDBJOB writing to memory. Added binary output
+   16.10.26 CA atoms are read into an arena by ReadCaAtoms(). Gzipped
+            files are still read by Bioplib
+   16.10.26 Gzipped files are read with zlib if compiled with HAVE_ZLIB
+   16.10.26 Files which are unchanged since the previous database are
+            reused
+   16.10.26 Sets the number of records for text output
+   16.10.26 Applies the build filters and records what they dropped
+   16.10.26 Reads the file from memory if it has been read ahead
+   16.10.26 Traced. When tracing, the file is read into memory first
+   16.10.26 Files whose PDB code is too long for a binary database are
+            skipped
+*/
+void ProcessFile(PDBJOB *job, OPTIONS *opts, CAARENA *arena)
+{
+   FILE    *fp,
+           *out;
+   PDBFILE in;
+   BOOL    ok   = FALSE,
+           read = FALSE;
+   double  start;
+
+   if(opts->binary && (strlen(job->pdbcode) > CADB_MAXCODE))
+   {
+      fprintf(stderr,"PDB code %s of %s is too long for a binary \
+database (max %d characters). File skipped\n", 
+              job->pdbcode, job->filename, CADB_MAXCODE);
+      return;
+   }
+
+   if(opts->manifest && ReuseOrHash(job))
+      return;
+
+   if((out = open_memstream(&(job->data), &(job->length)))==NULL)
+   {
+      fprintf(stderr,"No memory to process %s\n", job->filename);
+      return;
+   }
+   
+   /* When tracing, read the file into memory first so that reading is
+      timed separately from parsing
+   */
+   if(gTrace.on && !gPrefetch.depth)
+      ReadWholeFile(job);
+
+   if(OpenPrefetched(job, &in))
+   {
+      start = TraceClock();
+      ok    = ReadCaAtoms(&in, arena, &(opts->filter));
+      TraceStage(job, TRACE_PARSE, start);
+      read  = TRUE;
+      if(in.inflated)
+         free(in.mem);
+   }
+
+   if(gTrace.on && !gPrefetch.depth && (job->buffer != NULL))
+   {
+      free(job->buffer);
+      job->buffer = NULL;
+   }
+
+   if(!read && ((fp=fopen(job->filename,"r"))!=NULL))
+   {
+      memset(&in, 0, sizeof(PDBFILE));
+      read  = TRUE;
+      start = TraceClock();
+      job->trace.bytesRead = (uint64_t)job->size;
+      
+      if(IsGzipped(fp))
+      {
+#ifdef HAVE_ZLIB
+         fclose(fp);
+         fp = NULL;
+         if((in.gz = gzopen(job->filename, "rb"))==NULL)
+         {
+            fprintf(stderr,"Unable to read %s\n", job->filename);
+            fclose(out);
+            return;
+         }
+         gzbuffer(in.gz, GZBUFFSIZE);
+         ok = ReadCaAtoms(&in, arena, &(opts->filter));
+         gzclose(in.gz);
+#else
+         ok = ReadCaAtomsBioplib(fp, arena, &(opts->filter));
+#endif
+      }
+      else
+      {
+         in.fp = fp;
+         ok = ReadCaAtoms(&in, arena, &(opts->filter));
+      }
+      if(fp != NULL)
+         fclose(fp);
+      TraceStage(job, TRACE_PARSE, start);
+   }
+
+   if(read)
+   {
+      job->stats        = arena->stats;
+      job->trace.natoms = arena->natoms;
+
+      if(!ok)
+      {
+         fprintf(stderr,"No memory to process %s\n", job->filename);
+      }
+      else if(arena->natoms)
+      {
+         start = TraceClock();
+         if(opts->binary)
+         {
+            if(!CalcBinaryDistances(out, job, arena, opts))
+            {
+               fprintf(stderr,"No memory to process %s\n", 
+                       job->filename);
+            }
+         }
+         else
+         {
+            CalcDistances(out, job->pdbcode, arena, opts);
+            job->nrecords = (uint64_t)arena->natoms;
+         }
+         TraceStage(job, TRACE_DIST, start);
+      }
+   }
+
+   fclose(out);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadCaAtoms(PDBFILE *in, CAARENA *arena)
+   ----------------------------------------------
+   Inputs:     PDBFILE *in       PDB file
+   I/O:        CAARENA *arena    Arena into which the CA atoms are read.
+                                 Any atoms already there are discarded
+   Returns:    BOOL              Success? (FALSE if out of memory)
+
+   Reads the CA atoms from a PDB file directly into the arena without 
+   building a linked list of all the atoms. Only the fields that are
+   needed are decoded and the arena is reused from file to file, so
+   this is much faster and uses much less memory than reading the 
+   whole file with ReadPDBAtoms().
+
+   The atoms are selected in the same way as ReadPDBAtoms() followed by
+   SelectCaPDB(): only ATOM records are used, reading stops at the end
+   of the first model and, where a CA atom has alternative positions, 
+   the one with the highest occupancy is kept.
+
+   The build filters are then applied: reading stops as soon as the
+   resolution is found to be worse than the cutoff, CA atoms failing
+   the B-factor and occupancy cutoffs are skipped and the requested 
+   alternative position is preferred. What was dropped is recorded in
+   arena->stats.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Takes a PDBFILE so that gzipped files may be read
+   16.10.26 mmCIF files are passed to ReadCifCaAtoms()
+   16.10.26 Added filters
+   16.10.26 Records the residue type
+*/
+BOOL ReadCaAtoms(PDBFILE *in, CAARENA *arena, FILTER *filter)
+{
+   char    buffer[MAXPDBLINE],
+           resnam[4];
+   CARESID resid;
+   REAL    occ,
+           bval,
+           resol,
+           lastOcc = 0.0;
+   int     n;
+   char    lastAlt = ' ';
+   BOOL    firstLine = TRUE;
+
+   arena->natoms = 0;
+   memset(&(arena->stats), 0, sizeof(FILTERSTATS));
+   arena->stats.resolution = (-1.0);
+   
+   while(ReadPDBLine(buffer, MAXPDBLINE, in))
+   {
+      if(firstLine)
+      {
+         firstLine = FALSE;
+         if(!strncmp(buffer, "data_", 5))
+         {
+            if(!ReadCifCaAtoms(in, arena, filter))
+               return(FALSE);
+            break;
+         }
+      }
+      
+      if(!strncmp(buffer, "REMARK   2 RESOLUTION.", 22))
+      {
+         if((sscanf(buffer+22, "%lf", &resol) == 1) &&
+            !FilterResolution(filter, arena, resol))
+            return(TRUE);
+         continue;
+      }
+      if(!strncmp(buffer, "ENDMDL", 6))
+      {
+         if(ReadPDBLine(buffer, MAXPDBLINE, in) &&
+            !strncmp(buffer, "MODEL ", 6))
+            arena->stats.laterModels = TRUE;
+         break;
+      }
+      if(strncmp(buffer, "ATOM  ", 6) || 
+         strncmp(buffer+12, " CA ", 4) ||
+         (strlen(buffer) < 54))
+         continue;
+
+      occ  = (strlen(buffer) >= 60) ? PDBField(buffer, 54, 6) : 0.0;
+      bval = (strlen(buffer) >= 66) ? PDBField(buffer, 60, 6) : 0.0;
+      if(!FilterAtom(filter, &(arena->stats), occ, bval))
+         continue;
+
+      memset(&resid, 0, sizeof(CARESID));
+      resid.chain[0] = buffer[21];
+      resid.resnum   = (int)PDBField(buffer, 22, 4);
+      resid.insert   = buffer[26];
+      
+      /* An alternative position for the previous CA. Keep it if the
+         occupancy is higher or it is the requested alternative
+      */
+      n = arena->natoms;
+      if((buffer[16] != ' ') && (n > 0) &&
+         !memcmp(&resid, &(arena->resids[n-1]), RESIDSIZE))
+      {
+         arena->stats.nAltPos++;
+         if(BetterAltPos(filter, buffer[16], occ, lastAlt, lastOcc))
+         {
+            arena->x[n-1] = PDBField(buffer, 30, 8);
+            arena->y[n-1] = PDBField(buffer, 38, 8);
+            arena->z[n-1] = PDBField(buffer, 46, 8);
+            lastOcc       = occ;
+            lastAlt       = buffer[16];
+         }
+         continue;
+      }
+
+      strncpy(resnam, buffer+17, 3);
+      resnam[3] = '\0';
+      resid.restype = throne(resnam);
+      if(!AddArenaAtom(arena, &resid, PDBField(buffer, 30, 8),
+                       PDBField(buffer, 38, 8), PDBField(buffer, 46, 8)))
+         return(FALSE);
+      lastOcc = occ;
+      lastAlt = buffer[16];
+   }
+
+   /* A file which does not give a resolution (e.g. an NMR structure) 
+      is dropped by the resolution filter
+   */
+   if((filter->maxResol > 0.0) && (arena->stats.resolution < 0.0))
+      arena->natoms = 0;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL FilterAtom(FILTER *filter, FILTERSTATS *stats, REAL occ, 
+                   REAL bval)
+   -------------------------------------------------------------
+   Inputs:     FILTER      *filter   The build filters
+               REAL        occ       Occupancy of a CA atom
+               REAL        bval      B-factor of the CA atom
+   I/O:        FILTERSTATS *stats    Counts of dropped atoms
+   Returns:    BOOL                  Should the atom be kept?
+
+   Applies the minimum occupancy and maximum B-factor filters to an 
+   atom.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL FilterAtom(FILTER *filter, FILTERSTATS *stats, REAL occ, 
+                REAL bval)
+{
+   if((filter->minOcc > 0.0) && (occ < filter->minOcc))
+   {
+      stats->nOcc++;
+      return(FALSE);
+   }
+   if((filter->maxBval > 0.0) && (bval > filter->maxBval))
+   {
+      stats->nBval++;
+      return(FALSE);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL BetterAltPos(FILTER *filter, char alt, REAL occ, char lastAlt,
+                     REAL lastOcc)
+   -------------------------------------------------------------------
+   Inputs:     FILTER *filter    The build filters
+               char   alt        Alternative position indicator
+               REAL   occ        Occupancy of the alternative position
+               char   lastAlt    Indicator of the position kept so far
+               REAL   lastOcc    Occupancy of the position kept so far
+   Returns:    BOOL              Should this position replace the one
+                                 kept so far?
+
+   With -alt, the requested alternative position is preferred. 
+   Otherwise (or if neither is the requested one) the position with
+   the higher occupancy is kept.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL BetterAltPos(FILTER *filter, char alt, REAL occ, char lastAlt,
+                  REAL lastOcc)
+{
+   BOOL wanted     = (filter->altloc && (alt == filter->altloc)),
+        lastWanted = (filter->altloc && (lastAlt == filter->altloc));
+
+   if(wanted != lastWanted)
+      return(wanted);
+   return(occ > lastOcc);
+}
+
+
+/************************************************************************/
+/*>BOOL FilterResolution(FILTER *filter, CAARENA *arena, REAL resolution)
+   ----------------------------------------------------------------------
+   Inputs:     FILTER  *filter      The build filters
+               REAL    resolution   Resolution given in the file
+   I/O:        CAARENA *arena       The arena. The resolution is 
+                                    recorded in the stats and the atoms
+                                    are discarded if it is too poor
+   Returns:    BOOL                 Should the file be kept?
+
+   Applies the resolution cutoff. Only the first resolution given in a
+   file is used.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL FilterResolution(FILTER *filter, CAARENA *arena, REAL resolution)
+{
+   if(arena->stats.resolution >= 0.0)
+      return(TRUE);
+
+   arena->stats.resolution = resolution;
+   if((filter->maxResol > 0.0) && (resolution > filter->maxResol))
+   {
+      arena->stats.poorResol = TRUE;
+      arena->natoms = 0;
+      return(FALSE);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadCifCaAtoms(PDBFILE *in, CAARENA *arena)
+   -------------------------------------------------
+   Inputs:     PDBFILE *in       mmCIF file positioned after the data_
+                                 line
+   I/O:        CAARENA *arena    Arena into which the CA atoms are read
+   Returns:    BOOL              Success? (FALSE if out of memory)
+
+   Reads the CA atoms from the _atom_site loop of an mmCIF file in a
+   single pass. The loop header is used to find the column of each
+   field that is needed. Rows which do not contain "CA" are rejected
+   without being split; the others are split only as far as is needed
+   and rows that are not ATOM CA records are rejected as soon as the
+   group and atom name have been seen. Everything outside the 
+   _atom_site loop is skipped without being tokenized.
+
+   The author chain, residue number and insertion code are used (with
+   the label_ values as a fallback) so that the records are the same
+   as from the PDB format file. Chain labels may be up to MAXCIFCHAIN
+   characters. As for ReadCaAtoms(), reading stops at the end of the
+   first model, the alternative position with the highest occupancy 
+   is kept and the build filters are applied. The resolution is taken
+   from _refine.ls_d_res_high, _reflns.d_resolution_high or 
+   _em_3d_reconstruction.resolution, whichever comes first. The 
+   residue type is taken from label_comp_id.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added filters
+   16.10.26 Records the residue type
+*/
+BOOL ReadCifCaAtoms(PDBFILE *in, CAARENA *arena, FILTER *filter)
+{
+   char    buffer[MAXCIFLINE],
+           *tokens[MAXCIFCOL],
+           *rest,
+           firstModel[16];
+   int     col[CIF_NFIELDS],
+           ncol     = 0,
+           ntok,
+           needRow  = 0,
+           needName = 0,
+           i,
+           n;
+   BOOL    inHeader = FALSE,
+           inLoop   = FALSE;
+   CARESID resid;
+   REAL    occ,
+           bval,
+           resol,
+           lastOcc  = 0.0;
+   char    lastAlt  = ' ',
+           alt;
+   static char *fieldNames[CIF_NFIELDS] =
+      {"group_PDB", "auth_atom_id", "label_atom_id", "label_alt_id",
+       "auth_asym_id", "label_asym_id", "auth_seq_id", "label_seq_id",
+       "pdbx_PDB_ins_code", "Cartn_x", "Cartn_y", "Cartn_z",
+       "occupancy", "pdbx_PDB_model_num", "B_iso_or_equiv",
+       "label_comp_id"};
+   static char *resolNames[] =
+      {"_refine.ls_d_res_high", "_reflns.d_resolution_high",
+       "_em_3d_reconstruction.resolution", NULL};
+
+   for(i=0; i<CIF_NFIELDS; i++)
+      col[i] = (-1);
+   firstModel[0] = '\0';
+
+   while(ReadPDBLine(buffer, MAXCIFLINE, in))
+   {
+      if(inHeader)
+      {
+         /* Loop header: note the column number of each field needed   */
+         if(!strncmp(buffer, "_atom_site.", 11))
+         {
+            TERMINATE(buffer);
+            KILLTRAILSPACES(buffer);
+            for(i=0; i<CIF_NFIELDS; i++)
+            {
+               if(!strcmp(buffer+11, fieldNames[i]))
+                  col[i] = ncol;
+            }
+            ncol++;
+            continue;
+         }
+
+         /* End of the header of some other loop                       */
+         inHeader = FALSE;
+         if(!ncol)
+            continue;
+
+         /* End of the _atom_site header. Use the auth_ fields if 
+            present
+         */
+         if(col[CIF_AUTH_ATOM] < 0)  col[CIF_AUTH_ATOM]  = col[CIF_ATOM];
+         if(col[CIF_AUTH_CHAIN] < 0) col[CIF_AUTH_CHAIN] = col[CIF_CHAIN];
+         if(col[CIF_AUTH_SEQ] < 0)   col[CIF_AUTH_SEQ]   = col[CIF_SEQ];
+         if((col[CIF_GROUP] < 0) || (col[CIF_AUTH_ATOM] < 0) ||
+            (col[CIF_AUTH_CHAIN] < 0) || (col[CIF_AUTH_SEQ] < 0) ||
+            (col[CIF_X] < 0) || (col[CIF_Y] < 0) || (col[CIF_Z] < 0))
+            return(TRUE);
+
+         needName = MAX(col[CIF_GROUP], col[CIF_AUTH_ATOM]) + 1;
+         for(i=0; i<CIF_NFIELDS; i++)
+            needRow = MAX(needRow, col[i]+1);
+         if(needRow > MAXCIFCOL)
+            return(TRUE);
+         inLoop = TRUE;
+      }
+
+      if(inLoop)
+      {
+         /* The loop ends at the next category, loop or data block     */
+         if((buffer[0] == '#') || (buffer[0] == '_') ||
+            !strncmp(buffer, "loop_", 5) || !strncmp(buffer, "data_", 5))
+            break;
+
+         /* Most rows can be rejected without splitting them at all. 
+            Otherwise, split just enough of the row to check that it is
+            an ATOM CA and then the rest of the fields that we need
+         */
+         if(strstr(buffer, "CA") == NULL)
+            continue;
+         rest = buffer;
+         if(((ntok = SplitCifRow(&rest, tokens, 0, needName)) < needName)
+            || strcmp(tokens[col[CIF_GROUP]], "ATOM") ||
+            strcmp(tokens[col[CIF_AUTH_ATOM]], "CA"))
+            continue;
+         if(SplitCifRow(&rest, tokens, ntok, needRow) < needRow)
+            continue;
+
+         /* Stop at the end of the first model                         */
+         if(col[CIF_MODEL] >= 0)
+         {
+            if(!firstModel[0])
+               strncpy(firstModel, tokens[col[CIF_MODEL]], 15);
+            else if(strcmp(tokens[col[CIF_MODEL]], firstModel))
+            {
+               arena->stats.laterModels = TRUE;
+               break;
+            }
+         }
+
+         occ  = ((col[CIF_OCC] >= 0) ?
+                 (REAL)atof(tokens[col[CIF_OCC]]) : 0.0);
+         bval = ((col[CIF_BVAL] >= 0) ?
+                 (REAL)atof(tokens[col[CIF_BVAL]]) : 0.0);
+         if(!FilterAtom(filter, &(arena->stats), occ, bval))
+            continue;
+
+         memset(&resid, 0, sizeof(CARESID));
+         strncpy(resid.chain, tokens[col[CIF_AUTH_CHAIN]], MAXCIFCHAIN);
+         if(!strcmp(resid.chain, "?") || !strcmp(resid.chain, "."))
+            strcpy(resid.chain, " ");
+         resid.resnum = atoi(tokens[col[CIF_AUTH_SEQ]]);
+         resid.insert = ' ';
+         if((col[CIF_INSERT] >= 0) &&
+            strcmp(tokens[col[CIF_INSERT]], "?") &&
+            strcmp(tokens[col[CIF_INSERT]], "."))
+            resid.insert = tokens[col[CIF_INSERT]][0];
+         alt = ' ';
+         if((col[CIF_ALT] >= 0) &&
+            strcmp(tokens[col[CIF_ALT]], ".") &&
+            strcmp(tokens[col[CIF_ALT]], "?"))
+            alt = tokens[col[CIF_ALT]][0];
+
+         /* An alternative position for the previous CA. Keep it if the
+            occupancy is higher or it is the requested alternative
+         */
+         n = arena->natoms;
+         if((alt != ' ') && (n > 0) &&
+            !memcmp(&resid, &(arena->resids[n-1]), RESIDSIZE))
+         {
+            arena->stats.nAltPos++;
+            if(BetterAltPos(filter, alt, occ, lastAlt, lastOcc))
+            {
+               arena->x[n-1] = (REAL)atof(tokens[col[CIF_X]]);
+               arena->y[n-1] = (REAL)atof(tokens[col[CIF_Y]]);
+               arena->z[n-1] = (REAL)atof(tokens[col[CIF_Z]]);
+               lastOcc       = occ;
+               lastAlt       = alt;
+            }
+            continue;
+         }
+
+         resid.restype = ((col[CIF_COMP] >= 0) ? 
+                          throne(tokens[col[CIF_COMP]]) : 'X');
+         if(!AddArenaAtom(arena, &resid,
+                          (REAL)atof(tokens[col[CIF_X]]),
+                          (REAL)atof(tokens[col[CIF_Y]]),
+                          (REAL)atof(tokens[col[CIF_Z]])))
+            return(FALSE);
+         lastOcc = occ;
+         lastAlt = alt;
+         continue;
+      }
+
+      /* The resolution. Stop as soon as it is known to be too poor     */
+      if(buffer[0] == '_')
+      {
+         for(i=0; resolNames[i]!=NULL; i++)
+         {
+            n = strlen(resolNames[i]);
+            if(!strncmp(buffer, resolNames[i], n) &&
+               ((buffer[n] == ' ') || (buffer[n] == '\t')))
+            {
+               if((sscanf(buffer+n, "%lf", &resol) == 1) &&
+                  !FilterResolution(filter, arena, resol))
+                  return(TRUE);
+               break;
+            }
+         }
+         continue;
+      }
+
+      /* Look for the start of the _atom_site loop                      */
+      if(!strncmp(buffer, "loop_", 5))
+      {
+         inHeader = TRUE;
+         ncol     = 0;
+      }
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int SplitCifRow(char **rest, char **tokens, int ntok, int upto)
+   ---------------------------------------------------------------
+   I/O:        char   **rest    Position in the row from which to
+                                continue. Updated
+               char   **tokens  Pointers to the tokens
+   Inputs:     int    ntok      Number of tokens already split
+               int    upto      Number of tokens required
+   Returns:    int              Number of tokens split in total
+
+   Splits the next tokens of a row from an mmCIF loop in place until
+   upto tokens have been found or the row is exhausted. Tokens in single
+   or double quotes have the quotes removed.
+
+   16.10.26 Original   By: ACRM
+*/
+int SplitCifRow(char **rest, char **tokens, int ntok, int upto)
+{
+   char *c = *rest,
+        quote;
+
+   while(ntok < upto)
+   {
+      while((*c == ' ') || (*c == '\t'))
+         c++;
+      if((*c == '\0') || (*c == '\n') || (*c == '\r'))
+         break;
+
+      if((*c == '\'') || (*c == '"'))
+      {
+         /* A quote only closes the token if followed by a space       */
+         quote = *c++;
+         tokens[ntok++] = c;
+         while(*c && !((*c == quote) &&
+                       ((c[1] == ' ') || (c[1] == '\t') ||
+                        (c[1] == '\n') || (c[1] == '\r') ||
+                        (c[1] == '\0'))))
+            c++;
+      }
+      else
+      {
+         tokens[ntok++] = c;
+         while(*c && (*c != ' ') && (*c != '\t') && (*c != '\n') &&
+               (*c != '\r'))
+            c++;
+      }
+      if(*c)
+         *(c++) = '\0';
+   }
+
+   *rest = c;
+   return(ntok);
+}
+
+
+/************************************************************************/
+/*>char *ReadPDBLine(char *buffer, int size, PDBFILE *in)
+   ------------------------------------------------------
+   Outputs:    char    *buffer   Line read from the file
+   Inputs:     int     size      Size of buffer
+               PDBFILE *in       PDB file
+   Returns:    char *            buffer or NULL at end of file
+
+   Reads a line from a plain or gzipped PDB file or from a file that
+   has been read into memory. If the line is too long for the buffer, 
+   the rest of it is skipped.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Reads from memory
+*/
+char *ReadPDBLine(char *buffer, int size, PDBFILE *in)
+{
+   int    c;
+   char   *start,
+          *eol;
+   size_t length;
+
+   if(in->mem != NULL)
+   {
+      if(in->memPos >= in->memLength)
+         return(NULL);
+      start  = in->mem + in->memPos;
+      length = in->memLength - in->memPos;
+      if((eol = (char *)memchr(start, '\n', length)) != NULL)
+         length = (size_t)(eol - start) + 1;
+      in->memPos += length;
+      if(length > (size_t)(size-1))
+         length = size-1;
+      memcpy(buffer, start, length);
+      buffer[length] = '\0';
+      return(buffer);
+   }
+   
+#ifdef HAVE_ZLIB
+   if(in->gz != NULL)
+   {
+      if(gzgets(in->gz, buffer, size) == NULL)
+         return(NULL);
+      if(strchr(buffer, '\n') == NULL)
+         while(((c = gzgetc(in->gz)) != -1) && (c != '\n'));
+      return(buffer);
+   }
+#endif
+
+   if(fgets(buffer, size, in->fp) == NULL)
+      return(NULL);
+   if(strchr(buffer, '\n') == NULL)
+      while(((c = getc(in->fp)) != EOF) && (c != '\n'));
+   return(buffer);
+}
+
+
+/************************************************************************/
+/*>REAL PDBField(char *buffer, int start, int width)
+   -------------------------------------------------
+   Inputs:     char   *buffer     A PDB record
+               int    start       Start column (from 0)
+               int    width       Width of the field
+   Returns:    REAL               Value of the field
+
+   Extracts a numeric field from a fixed format PDB record.
+
+   16.10.26 Original   By: ACRM
+*/
+REAL PDBField(char *buffer, int start, int width)
+{
+   char field[16];
+
+   strncpy(field, buffer+start, width);
+   field[width] = '\0';
+   return((REAL)atof(field));
+}
+
+
+/************************************************************************/
+/*>BOOL ReadCaAtomsBioplib(FILE *fp, CAARENA *arena, FILTER *filter)
+   ------------------------------------------------------------------
+   Inputs:     FILE    *fp       PDB file pointer
+               FILTER  *filter   The build filters
+   I/O:        CAARENA *arena    Arena into which the CA atoms are read.
+                                 Any atoms already there are discarded
+   Returns:    BOOL              Success? (FALSE if out of memory)
+
+   Reads the CA atoms using the Bioplib routines. This is used for
+   gzipped files when makecadb is compiled without HAVE_ZLIB. Bioplib 
+   can read these if compiled with GUNZIP support.
+
+   Only the B-factor and occupancy filters are applied here since
+   Bioplib has already chosen the alternative positions and does not
+   give the resolution.
+
+   16.10.26 Original (split from ProcessFile())   By: ACRM
+   16.10.26 Added filters
+   16.10.26 Records the residue type
+*/
+BOOL ReadCaAtomsBioplib(FILE *fp, CAARENA *arena, FILTER *filter)
+{
+   PDB     *pdb, 
+           **pdbidx;
+   CARESID resid;
+   int     natoms,
+           i;
+   BOOL    ok = TRUE;
+
+   arena->natoms = 0;
+   memset(&(arena->stats), 0, sizeof(FILTERSTATS));
+   arena->stats.resolution = (-1.0);
+   
+   if((pdb=ReadPDBAtoms(fp,&natoms))!=NULL)
+   {
+      if((pdb=SelectCaPDB(pdb))!=NULL)
+      {
+         if((pdbidx=IndexPDB(pdb, &natoms))==NULL)
+            ok = FALSE;
+         
+         for(i=0; ok && i<natoms; i++)
+         {
+            if(!FilterAtom(filter, &(arena->stats), pdbidx[i]->occ,
+                           pdbidx[i]->bval))
+               continue;
+            memset(&resid, 0, sizeof(CARESID));
+            resid.chain[0] = pdbidx[i]->chain[0];
+            resid.resnum   = pdbidx[i]->resnum;
+            resid.insert   = pdbidx[i]->insert[0];
+            resid.restype  = throne(pdbidx[i]->resnam);
+            ok = AddArenaAtom(arena, &resid, 
+                              pdbidx[i]->x, pdbidx[i]->y, pdbidx[i]->z);
+         }
+
+         if(pdbidx != NULL)
+            free(pdbidx);
+         FREELIST(pdb, PDB);
+      }
+   }
+   
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL AddArenaAtom(CAARENA *arena, CARESID *resid, REAL x, REAL y, 
+                     REAL z)
+   -----------------------------------------------------------------
+   I/O:        CAARENA *arena    The arena
+   Inputs:     CARESID *resid    Residue identifier
+               REAL    x,y,z     Coordinates
+   Returns:    BOOL              Success?
+
+   Adds a CA atom to the arena, expanding it if necessary.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL AddArenaAtom(CAARENA *arena, CARESID *resid, REAL x, REAL y, 
+                  REAL z)
+{
+   int     n = arena->natoms,
+           maxAtoms;
+   REAL    *newX, *newY, *newZ;
+   CARESID *newResids;
+   
+   if(n >= arena->maxAtoms)
+   {
+      maxAtoms = (arena->maxAtoms ? 2 * arena->maxAtoms : ARENACHUNK);
+      newX      = (REAL *)realloc(arena->x, maxAtoms * sizeof(REAL));
+      if(newX != NULL) arena->x = newX;
+      newY      = (REAL *)realloc(arena->y, maxAtoms * sizeof(REAL));
+      if(newY != NULL) arena->y = newY;
+      newZ      = (REAL *)realloc(arena->z, maxAtoms * sizeof(REAL));
+      if(newZ != NULL) arena->z = newZ;
+      newResids = (CARESID *)realloc(arena->resids,
+                                     maxAtoms * sizeof(CARESID));
+      if(newResids != NULL) arena->resids = newResids;
+
+      if((newX == NULL) || (newY == NULL) || (newZ == NULL) ||
+         (newResids == NULL))
+         return(FALSE);
+      arena->maxAtoms = maxAtoms;
+   }
+
+   arena->x[n]      = x;
+   arena->y[n]      = y;
+   arena->z[n]      = z;
+   arena->resids[n] = *resid;
+   arena->natoms++;
+   
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void FreeArena(CAARENA *arena)
+   ------------------------------
+   I/O:        CAARENA *arena    The arena
+
+   16.10.26 Original   By: ACRM
+*/
+void FreeArena(CAARENA *arena)
+{
+   if(arena->x      != NULL) free(arena->x);
+   if(arena->y      != NULL) free(arena->y);
+   if(arena->z      != NULL) free(arena->z);
+   if(arena->resids != NULL) free(arena->resids);
+   memset(arena, 0, sizeof(CAARENA));
+}
+
+
+/************************************************************************/
+/*>BOOL IsGzipped(FILE *fp)
+   ------------------------
+   Inputs:     FILE   *fp        File pointer
+   Returns:    BOOL              Does the file start with the gzip 
+                                 magic number?
+
+   The file is rewound afterwards.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL IsGzipped(FILE *fp)
+{
+   unsigned char magic[2];
+   BOOL          gzipped;
+   
+   gzipped = ((fread(magic, 1, 2, fp) == 2) &&
+              (magic[0] == 0x1f) && (magic[1] == 0x8b));
+   rewind(fp);
+   return(gzipped);
+}
+
+
+/************************************************************************/
+/*>void CalcDistances(FILE *out, char *pdbcode, CAARENA *arena, 
+                      OPTIONS *opts)
+   ------------------------------------------------------------
+   Inputs:     FILE    *out         Output file pointer
+               char    *pdbcode     PDB code derived from filename
+               CAARENA *arena       The CA atoms
+               OPTIONS *opts        Options (number of constraints to 
+                                    calculate, forward only)
+
+   Calculate the ndist distances between CA atoms and write them to
+   the output file. With -a, the CA angle and torsion are written after
+   the distances of each record and, with -s, the one-letter residue
+   type comes last.
+
+   06.10.98 Original   By: ACRM
+   16.10.26 Distances now calculated by CalcResidueDistances(). 
+            Takes OPTIONS rather than ndist. Added forward only
+   16.10.26 Records are now formatted into a TEXTOUT buffer which is
+            written a chain at a time rather than by an fprintf() for
+            every distance. The output is unchanged
+   16.10.26 Distances are now calculated a chain at a time by 
+            CalcChainDistances()
+   16.10.26 Takes a CAARENA rather than a PDB index
+   16.10.26 Chain labels may have more than one character
+   16.10.26 Added angles
+   16.10.26 Writes the residue type after the identifier
+   16.10.26 The residue type is only written with -s and now comes at
+            the end of the record so that the distances are where they
+            always were
+   16.10.26 Working storage sized from the longest chain
+*/
+void CalcDistances(FILE *out, char *pdbcode, CAARENA *arena, 
+                   OPTIONS *opts)
+{
+   int      i,
+            res,
+            nres,
+            natoms = arena->natoms,
+            maxres = MaxChainLength(arena),
+            ndist  = opts->ndist,
+            ncol   = (opts->forward ? ndist : 2*ndist),
+            nval   = ncol + (opts->angles ? 2 : 0) + 
+                     (opts->sequence ? 1 : 0),
+            firstAtom,
+            lastAtom;
+   char     *PrintChain;
+   REAL     *row;
+   TEXTOUT  text;
+   DISTWORK work;
+
+   if(!AllocDistWork(&work, maxres, ndist))
+   {
+      fprintf(stderr,"No memory for distance array\n");
+      return;
+   }
+   if(!InitTextOut(&text, out, nval))
+   {
+      fprintf(stderr,"No memory for output buffer\n");
+      FreeDistWork(&work);
+      return;
+   }
+
+   for(firstAtom=0; firstAtom<natoms; firstAtom=lastAtom)
+   {
+      lastAtom   = FindChainEnd(arena, firstAtom);
+      nres       = lastAtom - firstAtom;
+      PrintChain = ChainLabel(&(arena->resids[firstAtom]));
+
+      CalcChainDistances(arena, firstAtom, nres, ndist, opts->forward,
+                         &work);
+      if(opts->angles)
+         CADBCaAngles(arena->x + firstAtom, arena->y + firstAtom,
+                      arena->z + firstAtom, nres, work.angles);
+
+      for(res=0; res<nres; res++)
+      {
+         /* Make sure there is room for a complete record              */
+         if(text.length + text.maxRecord > text.size)
+            FlushTextOut(&text);
+
+         text.length += sprintf(text.buffer + text.length, 
+                                "%4s.%s.%d%c ",
+                                pdbcode,
+                                PrintChain,
+                                arena->resids[firstAtom+res].resnum,
+                                arena->resids[firstAtom+res].insert);
+
+         /* Write the DP (forward) then the DM (backward) distances    */
+         row = work.dists + res*ncol;
+         for(i=0; i<ncol; i++)
+            WriteTextDist(&text, row[i]);
+
+         if(opts->angles)
+         {
+            WriteTextDist(&text, work.angles[res]);
+            WriteTextDist(&text, work.angles[nres + res]);
+         }
+
+         if(opts->sequence)
+         {
+            text.buffer[text.length++] = 
+               arena->resids[firstAtom+res].restype;
+            text.buffer[text.length++] = ' ';
+         }
+      
+         text.buffer[text.length++] = '\n';
+      }
+      FlushTextOut(&text);
+   }
+
+   free(text.buffer);
+   FreeDistWork(&work);
+}
+
+
+/************************************************************************/
+/*>BOOL InitTextOut(TEXTOUT *text, FILE *fp, int ncol)
+   ---------------------------------------------------
+   Outputs:    TEXTOUT *text        Output buffer to initialize
+   Inputs:     FILE    *fp          File to which it is written
+               int     ncol         Number of distances per record
+   Returns:    BOOL                 Success?
+
+   Sets up a buffer for writing text records. The buffer is always big
+   enough to hold at least two complete records.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL InitTextOut(TEXTOUT *text, FILE *fp, int ncol)
+{
+   text->fp        = fp;
+   text->length    = 0;
+   text->maxRecord = MAXTEXTKEY + ncol * MAXTEXTDIST + 1;
+   text->size      = TEXTBUFFSIZE;
+   if(text->size < 2 * text->maxRecord)
+      text->size = 2 * text->maxRecord;
+   
+   if((text->buffer = (char *)malloc(text->size))==NULL)
+      return(FALSE);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void FlushTextOut(TEXTOUT *text)
+   --------------------------------
+   I/O:        TEXTOUT *text        Output buffer
+
+   Writes anything in the buffer to the file and empties it.
+
+   16.10.26 Original   By: ACRM
+*/
+void FlushTextOut(TEXTOUT *text)
+{
+   if(text->length)
+   {
+      fwrite(text->buffer, 1, text->length, text->fp);
+      text->length = 0;
+   }
+}
+
+
+/************************************************************************/
+/*>void WriteTextDist(TEXTOUT *text, REAL dist)
+   --------------------------------------------
+   I/O:        TEXTOUT *text        Output buffer
+   Inputs:     REAL    dist         Distance to write
+
+   Adds a distance to the buffer in exactly the form written by 
+   fprintf("%.2f ") without the cost of a call to printf for every
+   distance. 
+
+   printf() rounds the exact binary value of the distance. The integer
+   conversion here rounds dist*100, which may differ in the last bit, 
+   so the result can only differ from printf() when dist*100 is within 
+   rounding error of half a hundredth. Those values, together with
+   negative values other than the -1 used for missing distances and 
+   values too large for MAXTEXTDIST, are handed to sprintf().
+
+   16.10.26 Original   By: ACRM
+*/
+void WriteTextDist(TEXTOUT *text, REAL dist)
+{
+   char  *p = text->buffer + text->length,
+         digits[16];
+   REAL  scaled;
+   long  hundredths;
+   int   ndigits = 0;
+
+   if(dist == -1.0)
+   {
+      memcpy(p, "-1.00 ", 6);
+      text->length += 6;
+      return;
+   }
+
+   /* Anything out of range (including NaN) goes to fprintf() directly */
+   if(!((dist >= 0.0) && (dist < MAXTEXTVALUE)))
+   {
+      FlushTextOut(text);
+      fprintf(text->fp, "%.2f ", dist);
+      return;
+   }
+
+   scaled = dist * 100.0;
+   if(fabs(scaled - floor(scaled) - 0.5) < 1.0e-6)
+   {
+      text->length += sprintf(p, "%.2f ", dist);
+      return;
+   }
+
+   hundredths = (long)(scaled + 0.5);
+
+   /* Build the digits backwards: two decimal places then the integer
+      part which always has at least one digit
+   */
+   digits[ndigits++] = (char)('0' + hundredths % 10);
+   hundredths /= 10;
+   digits[ndigits++] = (char)('0' + hundredths % 10);
+   hundredths /= 10;
+   do
+   {
+      digits[ndigits++] = (char)('0' + hundredths % 10);
+      hundredths /= 10;
+   }  while(hundredths);
+   
+   while(ndigits > 2)
+      *(p++) = digits[--ndigits];
+   *(p++) = '.';
+   *(p++) = digits[1];
+   *(p++) = digits[0];
+   *(p++) = ' ';
+
+   text->length = p - text->buffer;
+}
+
+
+/************************************************************************/
+/*>BOOL CalcBinaryDistances(FILE *out, PDBJOB *job, CAARENA *arena,
+                            OPTIONS *opts)
+   ----------------------------------------------------------------
+   Inputs:     FILE    *out         Output file pointer
+               PDBJOB  *job         The job being processed
+               CAARENA *arena       The CA atoms
+               OPTIONS *opts        Options (number of constraints to
+                                    calculate, layout, forward only)
+   Returns:    BOOL                 Success?
+
+   Binary equivalent of CalcDistances(). Writes a chain block for each 
+   chain and adds a chain table entry to the job. The distances for the
+   chain are built up in memory and written by row or by column as 
+   specified by the layout. For CADB_LAYOUT_COORD, the x, y and z 
+   coordinates for the chain are written instead. For 
+   CADB_LAYOUT_QUANT, the columns are quantized by WriteQuantChain().
+   With -R, the signature of each chain is also added to the job. With
+   -a, the CA angles and torsions follow the distances.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added layout and forward only. Takes OPTIONS
+   16.10.26 Added coordinates
+   16.10.26 Distances are now calculated by CalcChainDistances()
+   16.10.26 Takes a CAARENA rather than a PDB index
+   16.10.26 Chain labels may have more than one character
+   16.10.26 Added quantized layout
+   16.10.26 Adds the chain signatures for -R
+   16.10.26 Added angles
+   16.10.26 Stores the residue type
+   16.10.26 Only stores the residue type with -s
+   16.10.26 Working storage sized from the longest chain rather than 
+            the whole file
+*/
+BOOL CalcBinaryDistances(FILE *out, PDBJOB *job, CAARENA *arena,
+                         OPTIONS *opts)
+{
+   int       firstAtom,
+             lastAtom,
+             nres,
+             natoms = arena->natoms,
+             maxres = MaxChainLength(arena),
+             ndist  = opts->ndist,
+             ncol   = (opts->forward ? ndist : 2*ndist),
+             atnum,
+             res,
+             i;
+   uint16_t  *matrix,
+             *column;
+   float     *coords;
+   CADBRESID resid;
+   DISTWORK  work;
+
+   if(opts->layout == CADB_LAYOUT_COORD)
+      ncol = 1;
+   
+   if(!AllocDistWork(&work, maxres, ndist))
+      return(FALSE);
+   if((matrix = (uint16_t *)malloc(maxres * ncol * sizeof(uint16_t)))
+      ==NULL)
+   {
+      FreeDistWork(&work);
+      return(FALSE);
+   }
+   if((column = (uint16_t *)malloc(2 * maxres * sizeof(uint16_t)))
+      ==NULL)
+   {
+      FreeDistWork(&work);
+      free(matrix);
+      return(FALSE);
+   }
+   if((coords = (float *)malloc(3 * maxres * sizeof(float)))==NULL)
+   {
+      FreeDistWork(&work);
+      free(matrix);
+      free(column);
+      return(FALSE);
+   }
+   
+   for(firstAtom=0; firstAtom<natoms; firstAtom=lastAtom)
+   {
+      lastAtom = FindChainEnd(arena, firstAtom);
+      nres = lastAtom - firstAtom;
+
+      if(!AddJobChain(job, ChainLabel(&(arena->resids[firstAtom])),
+                      (uint64_t)ftello(out), job->nrecords, nres))
+      {
+         FreeDistWork(&work);
+         free(matrix);
+         free(column);
+         free(coords);
+         return(FALSE);
+      }
+
+      /* Residue identifiers                                           */
+      memset(&resid, 0, sizeof(CADBRESID));
+      for(atnum=firstAtom; atnum<lastAtom; atnum++)
+      {
+         resid.resnum = arena->resids[atnum].resnum;
+         resid.insert  = arena->resids[atnum].insert;
+         if(opts->sequence)
+            resid.restype = arena->resids[atnum].restype;
+         fwrite(&resid, sizeof(CADBRESID), 1, out);
+      }
+
+      if(opts->layout == CADB_LAYOUT_COORD)
+      {
+         for(atnum=firstAtom; atnum<lastAtom; atnum++)
+         {
+            res = atnum - firstAtom;
+            coords[res]          = (float)arena->x[atnum];
+            coords[nres + res]   = (float)arena->y[atnum];
+            coords[2*nres + res] = (float)arena->z[atnum];
+         }
+         fwrite(coords, sizeof(float), 3*nres, out);
+         job->chains[job->nchains-1].size = 
+            (uint32_t)(ftello(out) - job->chains[job->nchains-1].offset);
+         job->nrecords += nres;
+
+         if(opts->dedupe)
+         {
+            CalcChainDistances(arena, firstAtom, nres, ndist, TRUE, 
+                               &work);
+            if(!AddJobSignature(job, work.dists, nres, ndist, ndist))
+            {
+               FreeDistWork(&work);
+               free(matrix);
+               free(column);
+               free(coords);
+               return(FALSE);
+            }
+         }
+         continue;
+      }
+
+      /* Distance matrix for the chain, one row per residue            */
+      CalcChainDistances(arena, firstAtom, nres, ndist, opts->forward,
+                         &work);
+      for(i=0; i<nres*ncol; i++)
+         matrix[i] = CADBEncodeDist(work.dists[i]);
+
+      if(opts->dedupe && 
+         !AddJobSignature(job, work.dists, nres, ncol, ndist))
+      {
+         FreeDistWork(&work);
+         free(matrix);
+         free(column);
+         free(coords);
+         return(FALSE);
+      }
+
+      if(opts->layout == CADB_LAYOUT_QUANT)
+      {
+         if(!WriteQuantChain(out, matrix, nres, ncol))
+         {
+            FreeDistWork(&work);
+            free(matrix);
+            free(column);
+            free(coords);
+            return(FALSE);
+         }
+      }
+      else if(opts->layout == CADB_LAYOUT_COLUMN)
+      {
+         for(i=0; i<ncol; i++)
+         {
+            for(res=0; res<nres; res++)
+               column[res] = matrix[res*ncol + i];
+            fwrite(column, sizeof(uint16_t), nres, out);
+         }
+      }
+      else
+      {
+         fwrite(matrix, sizeof(uint16_t), nres*ncol, out);
+      }
+
+      if(opts->angles)
+      {
+         CADBCaAngles(arena->x + firstAtom, arena->y + firstAtom,
+                      arena->z + firstAtom, nres, work.angles);
+         for(i=0; i<2*nres; i++)
+            column[i] = CADBEncodeDist(work.angles[i]);
+         fwrite(column, sizeof(uint16_t), 2*nres, out);
+      }
+
+      job->chains[job->nchains-1].size = 
+         (uint32_t)(ftello(out) - job->chains[job->nchains-1].offset);
+      job->nrecords += nres;
+   }
+
+   FreeDistWork(&work);
+   free(matrix);
+   free(column);
+   free(coords);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL AddJobSignature(PDBJOB *job, REAL *dists, int nres, int ncol,
+                        int ndist)
+   ------------------------------------------------------------------
+   I/O:        PDBJOB   *job        The job being processed
+   Inputs:     REAL     *dists      Distances for a chain from
+                                    CalcChainDistances()
+               int      nres        Number of residues in the chain
+               int      ncol        Number of distances in each row
+               int      ndist       Number of DP distances
+   Returns:    BOOL                 Success? (FALSE if out of memory)
+
+   Appends the signature of a chain to the job. This is the encoded DP
+   distances for each residue. Since these do not depend on the
+   orientation of the chain, no superposition is needed: chains with
+   the same coordinates have the same signature and chains whose 
+   signatures match to within the tolerance have the same local 
+   structure. The signature is used for every layout so that 
+   duplicates are found in the same way for each.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL AddJobSignature(PDBJOB *job, REAL *dists, int nres, int ncol,
+                     int ndist)
+{
+   uint16_t *newSigs,
+            *sig;
+   int      res,
+            k;
+
+   if((newSigs = (uint16_t *)realloc(job->sigs, 
+                                     (job->nsigs + nres * ndist) * 
+                                     sizeof(uint16_t)))==NULL)
+      return(FALSE);
+   job->sigs = newSigs;
+
+   sig = job->sigs + job->nsigs;
+   for(res=0; res<nres; res++)
+   {
+      for(k=0; k<ndist; k++)
+         *(sig++) = CADBEncodeDist(dists[res*ncol + k]);
+   }
+   job->nsigs += nres * ndist;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL WriteQuantChain(FILE *out, uint16_t *matrix, int nres, int ncol)
+   ---------------------------------------------------------------------
+   Inputs:     FILE     *out        Output file pointer
+               uint16_t *matrix     Distance matrix for the chain, one
+                                    row per residue
+               int      nres        Number of residues in the chain
+               int      ncol        Number of distance columns
+   Returns:    BOOL                 Success? (FALSE if out of memory)
+
+   Writes the distances for a chain in the CADB_LAYOUT_QUANT layout 
+   (see cadb.h). The chain block must already contain the residue
+   identifiers. Each column is quantized by CADBQuantizeColumn() and,
+   when compiled with HAVE_ZLIB, compressed separately so that it can
+   be decoded on its own. A column is stored uncompressed if that is
+   no larger. The column blocks are built in memory since the 
+   directory that precedes them needs their sizes.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL WriteQuantChain(FILE *out, uint16_t *matrix, int nres, int ncol)
+{
+   uint32_t      *directory;
+   uint16_t      *column;
+   unsigned char *raw,
+                 *blocks,
+                 *stored;
+   size_t        maxStored = (size_t)(3 * nres),
+                 length    = 0;
+   CADBQBLOCK    block;
+   int           i,
+                 res;
+#ifdef HAVE_ZLIB
+   uLongf        zlength;
+
+   maxStored = (size_t)compressBound((uLong)maxStored);
+#endif
+
+   directory = (uint32_t *)malloc((ncol + 1) * sizeof(uint32_t));
+   column    = (uint16_t *)malloc(nres * sizeof(uint16_t));
+   raw       = (unsigned char *)malloc(3 * nres);
+   blocks    = (unsigned char *)malloc(ncol * 
+                                       (sizeof(CADBQBLOCK) + maxStored));
+   if((directory == NULL) || (column == NULL) || (raw == NULL) ||
+      (blocks == NULL))
+   {
+      if(directory != NULL) free(directory);
+      if(column    != NULL) free(column);
+      if(raw       != NULL) free(raw);
+      if(blocks    != NULL) free(blocks);
+      return(FALSE);
+   }
+
+   for(i=0; i<ncol; i++)
+   {
+      directory[i] = (uint32_t)(nres * sizeof(CADBRESID) + 
+                                (ncol + 1) * sizeof(uint32_t) + length);
+
+      for(res=0; res<nres; res++)
+         column[res] = matrix[res*ncol + i];
+      CADBQuantizeColumn(column, nres, &block, raw);
+
+      stored = blocks + length + sizeof(CADBQBLOCK);
+#ifdef HAVE_ZLIB
+      zlength = (uLongf)maxStored;
+      if((compress2(stored, &zlength, raw, (uLong)block.stored, 
+                    Z_BEST_COMPRESSION) == Z_OK) &&
+         (zlength < block.stored))
+         block.stored = (uint32_t)zlength;
+      else
+#endif
+         memcpy(stored, raw, block.stored);
+
+      memcpy(blocks + length, &block, sizeof(CADBQBLOCK));
+      length += sizeof(CADBQBLOCK) + block.stored;
+   }
+   directory[ncol] = (uint32_t)(nres * sizeof(CADBRESID) + 
+                                (ncol + 1) * sizeof(uint32_t) + length);
+
+   fwrite(directory, sizeof(uint32_t), ncol + 1, out);
+   fwrite(blocks, 1, length, out);
+
+   free(directory);
+   free(column);
+   free(raw);
+   free(blocks);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int FindChainEnd(CAARENA *arena, int firstAtom)
+   ------------------------------------------------
+   Inputs:     CAARENA *arena      The CA atoms
+               int     firstAtom   The first atom in a chain
+   Returns:    int                 The atom after the last atom in the
+                                   chain
+
+   16.10.26 Original (split from CalcBinaryDistances())   By: ACRM
+   16.10.26 Compares the whole chain label
+*/
+int FindChainEnd(CAARENA *arena, int firstAtom)
+{
+   int lastAtom;
+   
+   for(lastAtom=firstAtom+1; 
+       (lastAtom < arena->natoms) &&
+       !strcmp(arena->resids[lastAtom].chain, 
+               arena->resids[firstAtom].chain);
+       lastAtom++);
+   return(lastAtom);
+}
+
+
+/************************************************************************/
+/*>int MaxChainLength(CAARENA *arena)
+   ----------------------------------
+   Inputs:     CAARENA *arena      The CA atoms
+   Returns:    int                 Number of residues in the longest 
+                                   chain
+
+   Used to size the working storage, which is only needed for one chain
+   at a time.
+
+   16.10.26 Original   By: ACRM
+*/
+int MaxChainLength(CAARENA *arena)
+{
+   int firstAtom,
+       lastAtom,
+       maxres = 0;
+
+   for(firstAtom=0; firstAtom<arena->natoms; firstAtom=lastAtom)
+   {
+      lastAtom = FindChainEnd(arena, firstAtom);
+      if(lastAtom - firstAtom > maxres)
+         maxres = lastAtom - firstAtom;
+   }
+   return(maxres);
+}
+
+
+/************************************************************************/
+/*>char *ChainLabel(CARESID *resid)
+   --------------------------------
+   Inputs:     CARESID *resid      A residue identifier
+   Returns:    char    *           The chain label used in the database
+
+   A blank chain label is written as -
+
+   16.10.26 Original   By: ACRM
+*/
+char *ChainLabel(CARESID *resid)
+{
+   if((resid->chain[0] == ' ') || (resid->chain[0] == '\0'))
+      return("-");
+   return(resid->chain);
+}
+
+
+/************************************************************************/
+/*>BOOL AllocDistWork(DISTWORK *work, int natoms, int ndist)
+   ---------------------------------------------------------
+   Outputs:    DISTWORK *work      Working storage
+   Inputs:     int      natoms     Maximum number of residues in a chain
+               int      ndist      Number of distances
+
+   Allocates the working storage used by CalcChainDistances() and
+   CADBCaAngles().
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added angles
+*/
+BOOL AllocDistWork(DISTWORK *work, int natoms, int ndist)
+{
+   work->pair  = (REAL *)malloc(natoms * sizeof(REAL));
+   work->dists = (REAL *)malloc(natoms * 2 * ndist * sizeof(REAL));
+   work->angles = (REAL *)malloc(natoms * 2 * sizeof(REAL));
+   
+   if((work->pair == NULL) || (work->dists == NULL) || 
+      (work->angles == NULL))
+   {
+      FreeDistWork(work);
+      return(FALSE);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void FreeDistWork(DISTWORK *work)
+   ---------------------------------
+   I/O:        DISTWORK *work      Working storage
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added angles
+*/
+void FreeDistWork(DISTWORK *work)
+{
+   if(work->pair  != NULL) free(work->pair);
+   if(work->dists != NULL) free(work->dists);
+   if(work->angles != NULL) free(work->angles);
+   work->pair = work->dists = work->angles = NULL;
+}
+
+
+/************************************************************************/
+/*>void CalcChainDistances(CAARENA *arena, int firstAtom, int nres, 
+                           int ndist, BOOL forward, DISTWORK *work)
+   ------------------------------------------------------------------
+   Inputs:     CAARENA  *arena      The CA atoms
+               int      firstAtom   The first atom in the chain
+               int      nres        Number of residues in the chain
+               int      ndist       Number of constraints to calculate
+               BOOL     forward     Only calculate the DP distances
+   I/O:        DISTWORK *work       Working storage. On return, dists 
+                                    contains a row for each residue 
+                                    with the DP distances followed by 
+                                    the DM distances (-1 if not 
+                                    available)
+
+   Calculates the distances from each CA atom in a chain to the ndist
+   following and ndist preceding CA atoms. The coordinates are held in
+   x, y and z arrays so that the distances for each offset can be 
+   calculated by the vectorized gPairDistances() kernel. Since 
+   the DM distance at offset k for residue i+k is the DP distance at
+   offset k for residue i, each distance is only calculated once.
+
+   The kernels perform the same double precision operations as the 
+   DIST() macro, so the distances are identical to those calculated 
+   previously.
+
+   16.10.26 Original (replaces CalcResidueDistances())   By: ACRM
+   16.10.26 Takes the coordinates from the arena
+*/
+void CalcChainDistances(CAARENA *arena, int firstAtom, int nres, 
+                        int ndist, BOOL forward, DISTWORK *work)
+{
+   int  ncol = (forward ? ndist : 2*ndist),
+        npair,
+        res,
+        k;
+   REAL *dists = work->dists,
+        *x     = arena->x + firstAtom,
+        *y     = arena->y + firstAtom,
+        *z     = arena->z + firstAtom;
+
+   for(k=1; k<=ndist; k++)
+   {
+      npair = (k < nres) ? nres - k : 0;
+      if(npair)
+         (*gPairDistances)(x, y, z, npair, k, work->pair);
+
+      /* DP distance for residue res                                   */
+      for(res=0; res<npair; res++)
+         dists[res*ncol + k-1] = work->pair[res];
+      for(; res<nres; res++)
+         dists[res*ncol + k-1] = (-1.0);
+
+      if(!forward)
+      {
+         /* DM distance for residue res+k                              */
+         for(res=0; res<nres-npair; res++)
+            dists[res*ncol + ndist+k-1] = (-1.0);
+         for(res=0; res<npair; res++)
+            dists[(res+k)*ncol + ndist+k-1] = work->pair[res];
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>void PairDistances(REAL *x, REAL *y, REAL *z, int npair, int k,
+                      REAL *dist)
+   ---------------------------------------------------------------
+   Inputs:     REAL   *x, *y, *z   Coordinates for a chain
+               int    npair        Number of pairs
+               int    k            Offset between the atoms of a pair
+   Outputs:    REAL   *dist        Distance from atom i to atom i+k
+
+   Scalar distance kernel used where no vector version is available.
+
+   16.10.26 Original   By: ACRM
+*/
+void PairDistances(REAL *x, REAL *y, REAL *z, int npair, int k,
+                   REAL *dist)
+{
+   int  i;
+   REAL dx, dy, dz;
+   
+   for(i=0; i<npair; i++)
+   {
+      dx = x[i] - x[i+k];
+      dy = y[i] - y[i+k];
+      dz = z[i] - z[i+k];
+      dist[i] = sqrt(dx*dx + dy*dy + dz*dz);
+   }
+}
+
+
+#ifdef X86_KERNELS
+/************************************************************************/
+/*>void PairDistancesSSE2(REAL *x, REAL *y, REAL *z, int npair, int k,
+                          REAL *dist)
+   -------------------------------------------------------------------
+   SSE2 version of PairDistances() calculating 2 distances at a time.
+
+   16.10.26 Original   By: ACRM
+*/
+__attribute__ ((target ("sse2")))
+void PairDistancesSSE2(REAL *x, REAL *y, REAL *z, int npair, int k,
+                       REAL *dist)
+{
+   int     i;
+   __m128d dx, dy, dz;
+
+   for(i=0; i+2<=npair; i+=2)
+   {
+      dx = _mm_sub_pd(_mm_loadu_pd(x+i), _mm_loadu_pd(x+i+k));
+      dy = _mm_sub_pd(_mm_loadu_pd(y+i), _mm_loadu_pd(y+i+k));
+      dz = _mm_sub_pd(_mm_loadu_pd(z+i), _mm_loadu_pd(z+i+k));
+      _mm_storeu_pd(dist+i,
+                    _mm_sqrt_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(dx,dx),
+                                                      _mm_mul_pd(dy,dy)),
+                                           _mm_mul_pd(dz,dz))));
+   }
+   PairDistances(x+i, y+i, z+i, npair-i, k, dist+i);
+}
+
+
+/************************************************************************/
+/*>void PairDistancesAVX(REAL *x, REAL *y, REAL *z, int npair, int k,
+                         REAL *dist)
+   ------------------------------------------------------------------
+   AVX version of PairDistances() calculating 4 distances at a time.
+
+   16.10.26 Original   By: ACRM
+*/
+__attribute__ ((target ("avx")))
+void PairDistancesAVX(REAL *x, REAL *y, REAL *z, int npair, int k,
+                      REAL *dist)
+{
+   int     i;
+   __m256d dx, dy, dz;
+
+   for(i=0; i+4<=npair; i+=4)
+   {
+      dx = _mm256_sub_pd(_mm256_loadu_pd(x+i), _mm256_loadu_pd(x+i+k));
+      dy = _mm256_sub_pd(_mm256_loadu_pd(y+i), _mm256_loadu_pd(y+i+k));
+      dz = _mm256_sub_pd(_mm256_loadu_pd(z+i), _mm256_loadu_pd(z+i+k));
+      _mm256_storeu_pd(dist+i,
+         _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx,dx),
+                                                    _mm256_mul_pd(dy,dy)),
+                                      _mm256_mul_pd(dz,dz))));
+   }
+   PairDistances(x+i, y+i, z+i, npair-i, k, dist+i);
+}
+#endif
+
+
+/************************************************************************/
+/*>void SelectDistanceKernel(void)
+   -------------------------------
+   Globals:    gPairDistances      Set to the distance kernel to use
+
+   Chooses the fastest distance kernel supported by the processor. 
+   Must be called before any threads are started.
+
+   16.10.26 Original   By: ACRM
+*/
+void SelectDistanceKernel(void)
+{
+   gPairDistances = PairDistances;
+
+#ifdef X86_KERNELS
+   __builtin_cpu_init();
+   if(__builtin_cpu_supports("avx"))
+      gPairDistances = PairDistancesAVX;
+   else if(__builtin_cpu_supports("sse2"))
+      gPairDistances = PairDistancesSSE2;
+#endif
+}
+
+
+/************************************************************************/
+/*>BOOL AddJobChain(PDBJOB *job, char *chain, uint64_t offset,
+                    uint64_t firstRecord, int nres)
+   -----------------------------------------------------------
+   Inputs:     PDBJOB   *job          The job being processed
+               char     *chain        Chain label
+               uint64_t offset        Offset of chain block in job data
+               uint64_t firstRecord   First record number within job
+               int      nres          Number of residues in the chain
+   Returns:    BOOL                   Success? (FALSE if out of
+                                       memory or the PDB code or chain
+                                       label is too long)
+
+   Adds a chain table entry to a job. The size of the chain block is
+   filled in once it has been written.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Checks the lengths of the PDB code and chain label rather
+            than truncating them
+*/
+BOOL AddJobChain(PDBJOB *job, char *chain, uint64_t offset,
+                 uint64_t firstRecord, int nres)
+{
+   CADBCHAIN *newChains;
+   size_t    codeLen  = strlen(job->pdbcode),
+             chainLen = strlen(chain);
+
+   if((codeLen > CADB_MAXCODE) || (chainLen > CADB_MAXCODE))
+      return(FALSE);
+   
+   if(job->nchains >= job->maxChains)
+   {
+      job->maxChains += 16;
+      if((newChains=(CADBCHAIN *)realloc(job->chains,
+                       job->maxChains * sizeof(CADBCHAIN)))==NULL)
+         return(FALSE);
+      job->chains = newChains;
+   }
+
+   newChains = &(job->chains[job->nchains++]);
+   memset(newChains, 0, sizeof(CADBCHAIN));
+   memcpy(newChains->pdbcode, job->pdbcode, codeLen);
+   memcpy(newChains->chain,   chain,        chainLen);
+   newChains->offset      = offset;
+   newChains->firstRecord = firstRecord;
+   newChains->nres        = (uint32_t)nres;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL ParseCmdLine(int argc, char **argv, OPTIONS *opts)
+   --------------------------------------------------------
+   Input:   int     argc         Argument count
+            char    **argv       Argument array
+   Output:  OPTIONS *opts        The PDB directory, output file (or
+                                 blank string), number of distances,
+                                 max number of PDB files to read, 
+                                 number of threads, output format,
+                                 layout, forward only and coordinates,
+                                 file list, recursion, extensions,
+                                 manifest, previous database, resume,
+                                 checkpoint interval, shards, 
+                                 removal of duplicate chains, filters,
+                                 range index, loop window tables,
+                                 key index and residue types
+   Returns: BOOL                 Success?
+
+   Parse the command line
+   
+   06.10.98 Original    By: ACRM
+   18.01.02 Added -l
+   16.10.26 Added -t and -b. Options now returned in an OPTIONS 
+            structure
+   16.10.26 Added -c
+   16.10.26 Added -F
+   16.10.26 Added -C
+   16.10.26 Added -f, -r and -e
+   16.10.26 Added -m and -u
+   16.10.26 Added -resume and -k
+   16.10.26 Added -shards and -balance
+   16.10.26 Added -q
+   16.10.26 Added -R
+   16.10.26 Added -res, -maxb, -minocc and -alt
+   16.10.26 Added -x
+   16.10.26 Added -w
+   16.10.26 Added -a
+   16.10.26 Added -p
+   16.10.26 Added -trace
+   16.10.26 Added -K
+   16.10.26 Added -s
+*/
+BOOL ParseCmdLine(int argc, char **argv, OPTIONS *opts)
+{
+   argc--;
+   argv++;
+
+   if(argc == 0)
+      return(FALSE);
+
+   opts->pdbdir[0]   = '\0';
+   opts->outfile[0]  = '\0';
+   opts->listfile[0] = '\0';
+   opts->prevdb[0]   = '\0';
+   opts->tracefile[0] = '\0';
+   opts->manifest    = FALSE;
+   opts->resume      = FALSE;
+   opts->ckptInterval = DEF_CKPT_INTERVAL;
+   opts->nshards     = 1;
+   opts->balance     = FALSE;
+   opts->dedupe      = FALSE;
+   opts->dedupeTol   = 0.0;
+   opts->index       = FALSE;
+   opts->keys        = FALSE;
+   opts->nwindows    = 0;
+   opts->nextensions = 0;
+   opts->recurse     = FALSE;
+   opts->ndist      = DEF_NDIST;
+   opts->limit      = 0;
+   opts->nthreads   = 1;
+   opts->prefetch   = 0;
+   opts->binary     = FALSE;
+   opts->forward    = FALSE;
+   opts->angles     = FALSE;
+   opts->sequence   = FALSE;
+   opts->layout     = CADB_LAYOUT_ROW;
+   opts->filter.maxResol = 0.0;
+   opts->filter.maxBval  = 0.0;
+   opts->filter.minOcc   = 0.0;
+   opts->filter.altloc   = '\0';
+   
+   while(argc)
+   {
+      if(!strcmp(argv[0], "-resume"))
+      {
+         opts->resume = TRUE;
+      }
+      else if(!strcmp(argv[0], "-res"))
+      {
+         argc--;
+         argv++;
+         if(!argc ||
+            (sscanf(argv[0],"%lf",&(opts->filter.maxResol)) != 1) ||
+            (opts->filter.maxResol <= 0.0))
+            return(FALSE);
+      }
+      else if(!strcmp(argv[0], "-maxb"))
+      {
+         argc--;
+         argv++;
+         if(!argc ||
+            (sscanf(argv[0],"%lf",&(opts->filter.maxBval)) != 1) ||
+            (opts->filter.maxBval <= 0.0))
+            return(FALSE);
+      }
+      else if(!strcmp(argv[0], "-minocc"))
+      {
+         argc--;
+         argv++;
+         if(!argc ||
+            (sscanf(argv[0],"%lf",&(opts->filter.minOcc)) != 1) ||
+            (opts->filter.minOcc <= 0.0) || (opts->filter.minOcc > 1.0))
+            return(FALSE);
+      }
+      else if(!strcmp(argv[0], "-alt"))
+      {
+         argc--;
+         argv++;
+         if(!argc || (strlen(argv[0]) != 1) || (argv[0][0] == ' '))
+            return(FALSE);
+         opts->filter.altloc = argv[0][0];
+      }
+      else if(!strcmp(argv[0], "-shards"))
+      {
+         argc--;
+         argv++;
+         if(!argc || (sscanf(argv[0],"%d",&(opts->nshards)) != 1) ||
+            (opts->nshards < 1) || (opts->nshards > MAXSHARDS))
+            return(FALSE);
+      }
+      else if(!strcmp(argv[0], "-balance"))
+      {
+         opts->balance = TRUE;
+      }
+      else if(!strcmp(argv[0], "-trace"))
+      {
+         argc--;
+         argv++;
+         if(!argc)
+            return(FALSE);
+         strncpy(opts->tracefile, argv[0], MAXBUFF-1);
+      }
+      else if(argv[0][0] == '-')
+      {
+         switch(argv[0][1])
+         {
+         case 'k':
+            argc--;
+            argv++;
+            if(!argc || (sscanf(argv[0],"%d",&(opts->ckptInterval)) != 1)
+               || (opts->ckptInterval < 0))
+               return(FALSE);
+            break;
+         case 'd':
+            argc--;
+            argv++;
+            sscanf(argv[0],"%d",&(opts->ndist));
+            break;
+         case 'l':
+            argc--;
+            argv++;
+            sscanf(argv[0],"%d",&(opts->limit));
+            break;
+         case 't':
+            argc--;
+            argv++;
+            if(!argc || (sscanf(argv[0],"%d",&(opts->nthreads)) != 1) ||
+               (opts->nthreads < 1) || (opts->nthreads > MAXTHREADS))
+               return(FALSE);
+            break;
+         case 'p':
+            argc--;
+            argv++;
+            if(!argc || (sscanf(argv[0],"%d",&(opts->prefetch)) != 1) ||
+               (opts->prefetch < 0) || (opts->prefetch > MAXPREFETCH))
+               return(FALSE);
+            break;
+         case 'b':
+            opts->binary = TRUE;
+            break;
+         case 'c':
+            opts->binary = TRUE;
+            opts->layout = CADB_LAYOUT_COLUMN;
+            break;
+         case 'F':
+            opts->forward = TRUE;
+            break;
+         case 'a':
+            opts->angles = TRUE;
+            break;
+         case 's':
+            opts->sequence = TRUE;
+            break;
+         case 'C':
+            opts->binary = TRUE;
+            opts->layout = CADB_LAYOUT_COORD;
+            break;
+         case 'q':
+            opts->binary = TRUE;
+            opts->layout = CADB_LAYOUT_QUANT;
+            break;
+         case 'x':
+            opts->index = TRUE;
+            break;
+         case 'K':
+            opts->keys = TRUE;
+            break;
+         case 'w':
+            argc--;
+            argv++;
+            if(!argc || !SetWindowLengths(argv[0], opts))
+               return(FALSE);
+            break;
+         case 'R':
+            argc--;
+            argv++;
+            if(!argc || (sscanf(argv[0],"%lf",&(opts->dedupeTol)) != 1) ||
+               (opts->dedupeTol < 0.0))
+               return(FALSE);
+            opts->dedupe = TRUE;
+            break;
+         case 'r':
+            opts->recurse = TRUE;
+            break;
+         case 'm':
+            opts->manifest = TRUE;
+            break;
+         case 'u':
+            argc--;
+            argv++;
+            if(!argc)
+               return(FALSE);
+            strncpy(opts->prevdb, argv[0], MAXBUFF-1);
+            opts->manifest = TRUE;
+            break;
+         case 'e':
+            argc--;
+            argv++;
+            if(!argc || !SetExtensions(argv[0], opts))
+               return(FALSE);
+            break;
+         case 'f':
+            argc--;
+            argv++;
+            if(!argc)
+               return(FALSE);
+            strncpy(opts->listfile, argv[0], MAXBUFF-1);
+            strncpy(opts->pdbdir,   argv[0], MAXBUFF-1);
+            break;
+         default:
+            return(FALSE);
+            break;
+         }
+      }
+      else
+      {
+         /* With a file list, there is just an optional output file   */
+         if(opts->listfile[0])
+         {
+            if(argc > 1)
+               return(FALSE);
+            strcpy(opts->outfile, argv[0]);
+            break;
+         }
+         
+         /* Check that there is 1 or 2 arguments left                 */
+         if((argc < 1) || (argc > 2))
+            return(FALSE);
+         
+         strcpy(opts->pdbdir, argv[0]);
+
+         argc--; argv++;
+         if(argc)
+         {
+            strcpy(opts->outfile, argv[0]);
+         }
+
+         break;
+      }
+      argc--;
+      argv++;
+   }
+
+   /* A PDB directory or file list is required                          */
+   if(!opts->pdbdir[0])
+      return(FALSE);
+
+   /* When scanning subdirectories, only take PDB files by default      */
+   if(opts->recurse && !opts->nextensions)
+      SetExtensions(DEF_EXTENSIONS, opts);
+   
+   return(TRUE);
+}
+
+
+/*>BOOL OpenPrevDB(OPTIONS *opts)
+   ------------------------------
+   Inputs:     OPTIONS *opts    Command line options
+   Returns:    BOOL             Success?
+   Globals:    PREVDB  gPrevDB  The previous database
+
+   Opens the previous database given with -u and reads its manifest
+   (and, for a binary database, its chain table) so that the blocks for
+   unchanged files may be copied into the new database. The previous
+   database must have been built with the same options and must not be
+   the file that is about to be written.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL OpenPrevDB(OPTIONS *opts)
+{
+   char        filename[MAXBUFF+16];
+   struct stat prevStat,
+               outStat;
+   CADBHEADER  header;
+   
+   memset(&gPrevDB, 0, sizeof(PREVDB));
+
+   if(stat(opts->prevdb, &prevStat))
+   {
+      fprintf(stderr,"Unable to read previous database %s\n", 
+              opts->prevdb);
+      return(FALSE);
+   }
+   if(!stat(opts->outfile, &outStat) &&
+      (outStat.st_dev == prevStat.st_dev) && 
+      (outStat.st_ino == prevStat.st_ino))
+   {
+      fprintf(stderr,"The updated database must be written to a new \
+file\n");
+      return(FALSE);
+   }
+   
+   sprintf(filename, "%s%s", opts->prevdb, MANIFEST_EXT);
+   if(!ReadManifest(filename, opts))
+      return(FALSE);
+
+   if((gPrevDB.fp = fopen(opts->prevdb, "r"))==NULL)
+   {
+      fprintf(stderr,"Unable to read previous database %s\n", 
+              opts->prevdb);
+      return(FALSE);
+   }
+   
+   if(opts->binary)
+   {
+      if((CADBReadHeader(gPrevDB.fp, &header) != CADB_OK) ||
+         ((gPrevDB.chains = CADBReadChainTable(gPrevDB.fp, &header))
+          ==NULL))
+      {
+         fprintf(stderr,"Unable to read chain table from previous \
+database %s\n", opts->prevdb);
+         return(FALSE);
+      }
+      gPrevDB.nchains = header.nchains;
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadManifest(char *filename, OPTIONS *opts)
+   ------------------------------------------------
+   Inputs:     char    *filename  Manifest file
+               OPTIONS *opts      Command line options
+   Returns:    BOOL               Success?
+   Globals:    PREVDB  gPrevDB    Manifest entries stored
+
+   Reads the manifest of the previous database and checks that it was
+   built with the same options. The entries are sorted by filename so
+   that FindPrevEntry() can search them.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Checks the build filters. A manifest without them was built
+            without filters
+   16.10.26 Checks angles. A manifest without them was built without
+            angles
+   16.10.26 Checks residue types. A manifest without sequence= was 
+            built without them
+*/
+BOOL ReadManifest(char *filename, OPTIONS *opts)
+{
+   FILE          *fp;
+   char          buffer[MAXBUFF+256],
+                 filters[MAXFILTERSTRING],
+                 prevFilters[MAXFILTERSTRING],
+                 *name;
+   int           binary, layout, ndist, forward,
+                 angles = 0,
+                 sequence = 0,
+                 maxEntries = 0,
+                 nchar;
+   unsigned long long size, mtime, hash, offset, length, 
+                 firstRecord, nrecords, firstChain, nchains;
+   MANIFESTENTRY *entry,
+                 *newEntries;
+   
+   if((fp=fopen(filename, "r"))==NULL)
+   {
+      fprintf(stderr,"Unable to read manifest %s\n", filename);
+      return(FALSE);
+   }
+
+   if(!fgets(buffer, MAXBUFF+256, fp) ||
+      (sscanf(buffer, MANIFEST_MAGIC " binary=%d layout=%d ndist=%d \
+forward=%d", &binary, &layout, &ndist, &forward) != 4))
+   {
+      fprintf(stderr,"%s is not a makecadb manifest\n", filename);
+      fclose(fp);
+      return(FALSE);
+   }
+   strcpy(prevFilters, "none");
+   if((name = strstr(buffer, " filters="))!=NULL)
+      sscanf(name+9, "%63s", prevFilters);
+   if((name = strstr(buffer, " angles="))!=NULL)
+      sscanf(name+8, "%d", &angles);
+   if((name = strstr(buffer, " sequence="))!=NULL)
+      sscanf(name+10, "%d", &sequence);
+   FilterString(&(opts->filter), filters);
+   
+   if((binary  != opts->binary) ||
+      (binary  && (layout != opts->layout)) ||
+      (ndist   != opts->ndist) ||
+      (forward != opts->forward) ||
+      (angles  != opts->angles) ||
+      (sequence != opts->sequence) ||
+      strcmp(filters, prevFilters))
+   {
+      fprintf(stderr,"The previous database was built with different \
+options\n");
+      fclose(fp);
+      return(FALSE);
+   }
+   
+   while(fgets(buffer, MAXBUFF+256, fp))
+   {
+      TERMINATE(buffer);
+      if(sscanf(buffer, "%llu %llu %llx %llu %llu %llu %llu %llu %llu %n",
+                &size, &mtime, &hash, &offset, &length, &firstRecord, 
+                &nrecords, &firstChain, &nchains, &nchar) < 9)
+         continue;
+      name = buffer + nchar;
+      if(!name[0] || (strlen(name) >= MAXBUFF))
+         continue;
+      
+      if(gPrevDB.nentries >= maxEntries)
+      {
+         maxEntries += 1024;
+         if((newEntries = (MANIFESTENTRY *)realloc(gPrevDB.entries, 
+                           maxEntries * sizeof(MANIFESTENTRY)))==NULL)
+         {
+            fprintf(stderr,"No memory for manifest\n");
+            fclose(fp);
+            return(FALSE);
+         }
+         gPrevDB.entries = newEntries;
+      }
+
+      entry = &(gPrevDB.entries[gPrevDB.nentries++]);
+      strcpy(entry->filename, name);
+      entry->size        = (off_t)size;
+      entry->mtime       = (time_t)mtime;
+      entry->hash        = (uint64_t)hash;
+      entry->offset      = (uint64_t)offset;
+      entry->length      = (uint64_t)length;
+      entry->firstRecord = (uint64_t)firstRecord;
+      entry->nrecords    = (uint64_t)nrecords;
+      entry->firstChain  = (uint64_t)firstChain;
+      entry->nchains     = (uint64_t)nchains;
+   }
+   fclose(fp);
+
+   if(gPrevDB.nentries)
+      qsort(gPrevDB.entries, gPrevDB.nentries, sizeof(MANIFESTENTRY),
+            CompareEntries);
+   
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int CompareEntries(const void *entry1, const void *entry2)
+   ----------------------------------------------------------
+   Inputs:     const void *entry1    First MANIFESTENTRY
+               const void *entry2    Second MANIFESTENTRY
+   Returns:    int                   qsort() comparison result
+
+   16.10.26 Original   By: ACRM
+*/
+int CompareEntries(const void *entry1, const void *entry2)
+{
+   return(strcmp(((const MANIFESTENTRY *)entry1)->filename,
+                 ((const MANIFESTENTRY *)entry2)->filename));
+}
+
+
+/************************************************************************/
+/*>MANIFESTENTRY *FindPrevEntry(char *filename)
+   --------------------------------------------
+   Inputs:     char          *filename   A PDB file
+   Returns:    MANIFESTENTRY *           Its entry in the manifest of the
+                                         previous database (or NULL)
+   Globals:    PREVDB        gPrevDB     The previous database
+
+   16.10.26 Original   By: ACRM
+*/
+MANIFESTENTRY *FindPrevEntry(char *filename)
+{
+   MANIFESTENTRY key;
+
+   if(!gPrevDB.nentries)
+      return(NULL);
+   
+   strcpy(key.filename, filename);
+   return((MANIFESTENTRY *)bsearch(&key, gPrevDB.entries, 
+                                   gPrevDB.nentries, 
+                                   sizeof(MANIFESTENTRY),
+                                   CompareEntries));
+}
+
+
+/************************************************************************/
+/*>BOOL ReusePrevBlock(PDBJOB *job)
+   --------------------------------
+   I/O:        PDBJOB  *job     The job. Its output is filled in from 
+                                the previous database
+   Returns:    BOOL             Success?
+   Globals:    PREVDB  gPrevDB  The previous database
+
+   Copies a job's block (and, for a binary database, its chain table
+   entries) from the previous database. The chain table entries are 
+   made relative to the start of the block as they are for a newly 
+   processed file. pread() is used so that the worker threads can 
+   share the file.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL ReusePrevBlock(PDBJOB *job)
+{
+   MANIFESTENTRY *prev = job->prev;
+   uint64_t      i;
+   ssize_t       nread;
+   size_t        done = 0;
+
+   if((prev->firstChain + prev->nchains) > gPrevDB.nchains)
+      return(FALSE);
+   
+   if((job->data = (char *)malloc(prev->length ? prev->length : 1))
+      ==NULL)
+      return(FALSE);
+   job->length = (size_t)prev->length;
+   
+   while(done < job->length)
+   {
+      nread = pread(fileno(gPrevDB.fp), job->data + done, 
+                    job->length - done, (off_t)(prev->offset + done));
+      if(nread <= 0)
+         return(FALSE);
+      done += nread;
+   }
+
+   for(i=0; i<prev->nchains; i++)
+   {
+      if(!AddJobChain(job, gPrevDB.chains[prev->firstChain+i].chain, 
+                      0, 0, 0))
+         return(FALSE);
+      job->chains[job->nchains-1] = 
+         gPrevDB.chains[prev->firstChain+i];
+      job->chains[job->nchains-1].offset      -= prev->offset;
+      job->chains[job->nchains-1].firstRecord -= prev->firstRecord;
+   }
+   job->nrecords = prev->nrecords;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL ReuseOrHash(PDBJOB *job)
+   -----------------------------
+   I/O:        PDBJOB  *job     The job
+   Returns:    BOOL             Has the block from the previous database
+                                been reused?
+
+   Called when a manifest is being written. If the file is the same 
+   size and has the same modification time as when the previous 
+   database was built, its block is reused without reading the file. 
+   Otherwise the file is hashed and the block is still reused if the 
+   contents are unchanged.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL ReuseOrHash(PDBJOB *job)
+{
+   MANIFESTENTRY *prev = job->prev;
+
+   if((prev != NULL) && 
+      (prev->size == job->size) && (prev->mtime == job->mtime))
+   {
+      job->hash = prev->hash;
+   }
+   else if(!HashFile(job->filename, &(job->hash)) || 
+           (prev == NULL) || (prev->hash != job->hash))
+   {
+      return(FALSE);
+   }
+
+   if(ReusePrevBlock(job))
+   {
+      job->reused = TRUE;
+      return(TRUE);
+   }
+
+   /* Clean up and process the file instead                           */
+   fprintf(stderr,"Warning: Unable to reuse %s from previous \
+database\n", job->filename);
+   if(job->data != NULL)
+      free(job->data);
+   if(job->chains != NULL)
+      free(job->chains);
+   job->data      = NULL;
+   job->length    = 0;
+   job->chains    = NULL;
+   job->nchains   = 0;
+   job->maxChains = 0;
+   job->nrecords  = 0;
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>void ReportReuse(PDBJOB *jobs, int njobs, OPTIONS *opts)
+   --------------------------------------------------------
+   Inputs:     PDBJOB  *jobs    The jobs
+               int     njobs    Number of jobs
+               OPTIONS *opts    Command line options
+
+   Reports how many files were reused when updating a database and how
+   many files in the previous database are no longer present.
+
+   16.10.26 Original   By: ACRM
+*/
+void ReportReuse(PDBJOB *jobs, int njobs, OPTIONS *opts)
+{
+   int i,
+       nreused = 0,
+       nfound  = 0;
+
+   if(!opts->prevdb[0])
+      return;
+   
+   for(i=0; i<njobs; i++)
+   {
+      if(jobs[i].reused)
+         nreused++;
+      if(jobs[i].prev != NULL)
+         nfound++;
+   }
+   fprintf(stderr,"Reused %d of %d files from %s (%d removed)\n", 
+           nreused, njobs, opts->prevdb, gPrevDB.nentries - nfound);
+}
+
+
+/************************************************************************/
+/*>void ReportFilters(PDBJOB *jobs, int njobs, OPTIONS *opts)
+   ----------------------------------------------------------
+   Inputs:     PDBJOB  *jobs    The jobs
+               int     njobs    Number of jobs
+               OPTIONS *opts    Command line options
+
+   Reports what the build filters removed: files rejected on resolution,
+   CA atoms rejected on B-factor or occupancy and alternative positions
+   discarded. Also reports the number of files for which only the first
+   model was used. Files reused from a previous database were filtered
+   when that was built so are not counted.
+
+   16.10.26 Original   By: ACRM
+*/
+void ReportFilters(PDBJOB *jobs, int njobs, OPTIONS *opts)
+{
+   FILTER *filter = &(opts->filter);
+   int    i,
+          nPoorResol   = 0,
+          nNoResol     = 0,
+          nLaterModels = 0;
+   long   nBval        = 0,
+          nOcc         = 0,
+          nAltPos      = 0;
+
+   if((filter->maxResol <= 0.0) && (filter->maxBval <= 0.0) &&
+      (filter->minOcc <= 0.0) && !filter->altloc)
+      return;
+
+   for(i=0; i<njobs; i++)
+   {
+      if(jobs[i].reused)
+         continue;
+      if(jobs[i].stats.poorResol)
+         nPoorResol++;
+      else if(jobs[i].stats.resolution < 0.0)
+         nNoResol++;
+      if(jobs[i].stats.laterModels)
+         nLaterModels++;
+      nBval   += jobs[i].stats.nBval;
+      nOcc    += jobs[i].stats.nOcc;
+      nAltPos += jobs[i].stats.nAltPos;
+   }
+
+   if(filter->maxResol > 0.0)
+      fprintf(stderr,"Resolution filter (%.2f): %d files rejected, %d \
+files with no resolution rejected\n",
+              filter->maxResol, nPoorResol, nNoResol);
+   if(filter->maxBval > 0.0)
+      fprintf(stderr,"B-factor filter (%.2f): %ld CA atoms rejected\n",
+              filter->maxBval, nBval);
+   if(filter->minOcc > 0.0)
+      fprintf(stderr,"Occupancy filter (%.2f): %ld CA atoms rejected\n",
+              filter->minOcc, nOcc);
+   fprintf(stderr,"Alternative positions: %ld discarded", nAltPos);
+   if(filter->altloc)
+      fprintf(stderr," (preferring '%c')", filter->altloc);
+   fprintf(stderr,"\nLater models skipped in %d files\n", nLaterModels);
+}
+
+
+/************************************************************************/
+/*>void FilterString(FILTER *filter, char *buffer)
+   -----------------------------------------------
+   Inputs:     FILTER *filter    The build filters
+   Outputs:    char   *buffer    Description of the filters (at least
+                                 MAXFILTERSTRING characters)
+
+   Describes the build filters in a single word for the manifest and 
+   the checkpoint so that a database is only updated or resumed with 
+   the same filters. This is "none" if no filters are used.
+
+   16.10.26 Original   By: ACRM
+*/
+void FilterString(FILTER *filter, char *buffer)
+{
+   char word[MAXFILTERSTRING];
+
+   buffer[0] = '\0';
+   if(filter->maxResol > 0.0)
+   {
+      snprintf(word, MAXFILTERSTRING, "res=%g,", filter->maxResol);
+      strncat(buffer, word, MAXFILTERSTRING-1-strlen(buffer));
+   }
+   if(filter->maxBval > 0.0)
+   {
+      snprintf(word, MAXFILTERSTRING, "maxb=%g,", filter->maxBval);
+      strncat(buffer, word, MAXFILTERSTRING-1-strlen(buffer));
+   }
+   if(filter->minOcc > 0.0)
+   {
+      snprintf(word, MAXFILTERSTRING, "minocc=%g,", filter->minOcc);
+      strncat(buffer, word, MAXFILTERSTRING-1-strlen(buffer));
+   }
+   if(filter->altloc)
+   {
+      snprintf(word, MAXFILTERSTRING, "alt=%c,", filter->altloc);
+      strncat(buffer, word, MAXFILTERSTRING-1-strlen(buffer));
+   }
+
+   if(!buffer[0])
+      strcpy(buffer, "none");
+   else
+      buffer[strlen(buffer)-1] = '\0';
+}
+
+
+/************************************************************************/
+/*>BOOL HashFile(char *filename, uint64_t *hash)
+   ---------------------------------------------
+   Inputs:     char     *filename   File to hash
+   Outputs:    uint64_t *hash       64-bit FNV-1a hash of the contents
+   Returns:    BOOL                 Success?
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL HashFile(char *filename, uint64_t *hash)
+{
+   FILE          *fp;
+   unsigned char buffer[HASHBUFFSIZE];
+   size_t        nread,
+                 i;
+   uint64_t      h = 0xcbf29ce484222325ULL;
+   
+   if((fp=fopen(filename, "rb"))==NULL)
+      return(FALSE);
+   
+   while((nread = fread(buffer, 1, HASHBUFFSIZE, fp)) > 0)
+   {
+      for(i=0; i<nread; i++)
+      {
+         h ^= buffer[i];
+         h *= 0x100000001b3ULL;
+      }
+   }
+   fclose(fp);
+
+   *hash = h;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL AddManifestEntry(DBOUT *db, PDBJOB *job)
+   ---------------------------------------------
+   I/O:        DBOUT   *db      The database being written
+   Inputs:     PDBJOB  *job     A job about to be written
+   Returns:    BOOL             Success?
+
+   Records the position of a job's block in the database. Must be 
+   called before the job is written.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL AddManifestEntry(DBOUT *db, PDBJOB *job)
+{
+   MANIFESTENTRY *entry,
+                 *newEntries;
+
+   if(db->nentries >= db->maxEntries)
+   {
+      db->maxEntries += 1024;
+      if((newEntries = (MANIFESTENTRY *)realloc(db->entries, 
+                        db->maxEntries * sizeof(MANIFESTENTRY)))==NULL)
+         return(FALSE);
+      db->entries = newEntries;
+   }
+
+   entry = &(db->entries[db->nentries++]);
+   strcpy(entry->filename, job->filename);
+   entry->size        = job->size;
+   entry->mtime       = job->mtime;
+   entry->hash        = job->hash;
+   entry->offset      = db->offset;
+   entry->length      = job->length;
+   entry->firstRecord = db->nrecords;
+   entry->nrecords    = job->nrecords;
+   entry->firstChain  = db->nchains;
+   entry->nchains     = job->nchains;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL WriteManifest(DBOUT *db, OPTIONS *opts)
+   --------------------------------------------
+   Inputs:     DBOUT   *db      The database that has been written
+               OPTIONS *opts    Command line options
+   Returns:    BOOL             Success?
+
+   Writes the manifest for the database. This records the options used
+   and, for each PDB file, its size, modification time and hash 
+   together with the location of its block in the database.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Named from the database filename so that each shard has
+            its own manifest
+   16.10.26 Records the build filters
+   16.10.26 Records angles
+   16.10.26 Records residue types
+*/
+BOOL WriteManifest(DBOUT *db, OPTIONS *opts)
+{
+   FILE          *fp;
+   char          filename[MAXBUFF+32],
+                 filters[MAXFILTERSTRING];
+   MANIFESTENTRY *entry;
+   int           i;
+   BOOL          ok = TRUE;
+   
+   sprintf(filename, "%s%s", db->filename, MANIFEST_EXT);
+   if((fp=fopen(filename, "w"))==NULL)
+   {
+      fprintf(stderr,"Unable to write manifest %s\n", filename);
+      return(FALSE);
+   }
+
+   FilterString(&(opts->filter), filters);
+   fprintf(fp, "%s binary=%d layout=%d ndist=%d forward=%d angles=%d \
+sequence=%d filters=%s\n",
+           MANIFEST_MAGIC, (int)opts->binary, opts->layout, opts->ndist,
+           (int)opts->forward, (int)opts->angles, (int)opts->sequence,
+           filters);
+   for(i=0; i<db->nentries; i++)
+   {
+      entry = &(db->entries[i]);
+      fprintf(fp, "%llu %llu %016llx %llu %llu %llu %llu %llu %llu %s\n",
+              (unsigned long long)entry->size,
+              (unsigned long long)entry->mtime,
+              (unsigned long long)entry->hash,
+              (unsigned long long)entry->offset,
+              (unsigned long long)entry->length,
+              (unsigned long long)entry->firstRecord,
+              (unsigned long long)entry->nrecords,
+              (unsigned long long)entry->firstChain,
+              (unsigned long long)entry->nchains,
+              entry->filename);
+   }
+   
+   if(fclose(fp))
+      ok = FALSE;
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL OpenShards(DBOUT *db, OPTIONS *opts)
+   -----------------------------------------
+   Outputs:    DBOUT   *db      Array of opts->nshards shards
+   Inputs:     OPTIONS *opts    Command line options
+   Returns:    BOOL             Success?
+
+   Opens the shard files (outfile.0 ... outfile.N-1) and writes the
+   header to each. Checkpoints are not written for a sharded database.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL OpenShards(DBOUT *db, OPTIONS *opts)
+{
+   char filename[MAXBUFF+16];
+   int  i;
+
+   for(i=0; i<opts->nshards; i++)
+   {
+      sprintf(filename, "%s.%d", opts->outfile, i);
+      if((db[i].fp = fopen(filename, "w"))==NULL)
+      {
+         fprintf(stderr,"Unable to write shard %s\n", filename);
+         return(FALSE);
+      }
+      WriteHeader(&(db[i]), opts);
+      strcpy(db[i].filename, filename);
+      db[i].ckptFile[0] = '\0';
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>DBOUT *ShardForJob(DBOUT *db, PDBJOB *job, OPTIONS *opts)
+   ---------------------------------------------------------
+   Inputs:     DBOUT   *db      Array of opts->nshards shards
+               PDBJOB  *job     A processed job
+               OPTIONS *opts    Command line options
+   Returns:    DBOUT   *        The shard to which the job is written
+
+   By default, a job goes to the shard given by an FNV-1a hash of its
+   PDB code, so a given entry is always in the same shard. With
+   -balance, it goes to the shard with the fewest records so far. Since
+   the jobs are written largest first, this gives shards of very
+   similar sizes. Either way, the choice depends only on the jobs
+   written before, so it is independent of the number of threads.
+
+   16.10.26 Original   By: ACRM
+*/
+DBOUT *ShardForJob(DBOUT *db, PDBJOB *job, OPTIONS *opts)
+{
+   uint64_t h = 0xcbf29ce484222325ULL;
+   char     *c;
+   int      i,
+            best = 0;
+
+   if(opts->nshards <= 1)
+      return(db);
+
+   if(opts->balance)
+   {
+      for(i=1; i<opts->nshards; i++)
+      {
+         if(db[i].nrecords < db[best].nrecords)
+            best = i;
+      }
+      return(&(db[best]));
+   }
+
+   for(c=job->pdbcode; *c; c++)
+   {
+      h ^= (uint64_t)(unsigned char)*c;
+      h *= 0x100000001b3ULL;
+   }
+   return(&(db[h % (uint64_t)opts->nshards]));
+}
+
+
+/************************************************************************/
+/*>BOOL WriteShardManifest(DBOUT *db, OPTIONS *opts)
+   -------------------------------------------------
+   Inputs:     DBOUT   *db      Array of opts->nshards shards
+               OPTIONS *opts    Command line options
+   Returns:    BOOL             Success?
+
+   Writes the shard manifest to the output file. This lists each shard
+   and its number of records. The shards are given relative to the
+   directory containing the manifest so that the files may be moved
+   together.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL WriteShardManifest(DBOUT *db, OPTIONS *opts)
+{
+   FILE *fp;
+   char *filename;
+   int  i;
+   BOOL ok = TRUE;
+
+   if((fp=fopen(opts->outfile, "w"))==NULL)
+   {
+      fprintf(stderr,"Unable to write shard manifest %s\n",
+              opts->outfile);
+      return(FALSE);
+   }
+
+   fprintf(fp, "%s nshards=%d by=%s\n", CADB_SHARD_MAGIC, opts->nshards,
+           (opts->balance ? "balance" : "hash"));
+   for(i=0; i<opts->nshards; i++)
+   {
+      if((filename = strrchr(db[i].filename, '/'))!=NULL)
+         filename++;
+      else
+         filename = db[i].filename;
+      fprintf(fp, "%s %llu\n", filename,
+              (unsigned long long)db[i].nrecords);
+   }
+
+   if(fclose(fp))
+      ok = FALSE;
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>uint64_t HashJobList(PDBJOB *jobs, int njobs)
+   ---------------------------------------------
+   Inputs:     PDBJOB   *jobs    The jobs
+               int      njobs    Number of jobs
+   Returns:    uint64_t          FNV-1a hash of the filenames and sizes
+
+   Used to check that the list of files is the same when resuming a
+   build.
+
+   16.10.26 Original   By: ACRM
+*/
+uint64_t HashJobList(PDBJOB *jobs, int njobs)
+{
+   uint64_t h = 0xcbf29ce484222325ULL;
+   char     *c;
+   int      i,
+            j;
+
+   for(i=0; i<njobs; i++)
+   {
+      for(c=jobs[i].filename; ; c++)
+      {
+         h ^= (unsigned char)(*c);
+         h *= 0x100000001b3ULL;
+         if(*c == '\0')
+            break;
+      }
+      for(j=0; j<(int)sizeof(off_t); j++)
+      {
+         h ^= (uint64_t)((jobs[i].size >> (8*j)) & 0xff);
+         h *= 0x100000001b3ULL;
+      }
+   }
+   return(h);
+}
+
+
+/************************************************************************/
+/*>uint64_t HashBytes(uint64_t h, const void *data, size_t length)
+   ---------------------------------------------------------------
+   Inputs:     uint64_t   h        Hash so far (0 to start a new hash)
+               const void *data    Data to add (may be NULL if length
+                                   is 0)
+               size_t     length   Number of bytes
+   Returns:    uint64_t            FNV-1a hash with the data added
+
+   16.10.26 Original   By: ACRM
+*/
+uint64_t HashBytes(uint64_t h, const void *data, size_t length)
+{
+   const unsigned char *c = (const unsigned char *)data;
+   size_t              i;
+
+   if(!h)
+      h = 0xcbf29ce484222325ULL;
+   for(i=0; i<length; i++)
+   {
+      h ^= c[i];
+      h *= 0x100000001b3ULL;
+   }
+   return(h);
+}
+
+
+/************************************************************************/
+/*>void HashJobData(PDBJOB *job, OPTIONS *opts)
+   --------------------------------------------
+   I/O:        PDBJOB  *job     A processed job. dataHash is set
+   Inputs:     OPTIONS *opts    Command line options
+
+   Hashes the binary output for a job so that WriteJob() can add it to
+   the build fingerprint. This is done by whichever thread processed 
+   the job rather than by the writer.
+
+   16.10.26 Original   By: ACRM
+*/
+void HashJobData(PDBJOB *job, OPTIONS *opts)
+{
+   job->dataHash = 0;
+   if(opts->binary)
+      job->dataHash = HashBytes(0, job->data, 
+                                (job->data != NULL) ? job->length : 0);
+}
+
+
+/************************************************************************/
+/*>void MaybeCheckpoint(DBOUT *db, int njobsDone)
+   ----------------------------------------------
+   I/O:        DBOUT   *db         The database being written
+   Inputs:     int     njobsDone   Number of jobs written
+
+   Writes a checkpoint if checkpointing is enabled and the checkpoint 
+   interval has passed since the last one.
+
+   16.10.26 Original   By: ACRM
+*/
+void MaybeCheckpoint(DBOUT *db, int njobsDone)
+{
+   time_t now;
+
+   if(!db->ckptFile[0] || db->error)
+      return;
+
+   time(&now);
+   if((now - db->lastCheckpoint) < db->ckptInterval)
+      return;
+
+   if(!WriteCheckpoint(db, njobsDone))
+      fprintf(stderr,"Warning: Unable to write checkpoint %s\n",
+              db->ckptFile);
+   db->lastCheckpoint = now;
+}
+
+
+/************************************************************************/
+/*>BOOL WriteCheckpoint(DBOUT *db, int njobsDone)
+   ----------------------------------------------
+   Inputs:     DBOUT   *db         The database being written
+               int     njobsDone   Number of jobs written
+   Returns:    BOOL                Success?
+
+   Flushes the database to disk and then records how far the build has
+   got: the number of jobs written, the size of the output and, since
+   they are not written until the end, the chain table and manifest 
+   entries so far. The checkpoint is written to a temporary file which
+   is then renamed so that there is always a complete checkpoint.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Records the build filters
+   16.10.26 Records angles
+   16.10.26 Records residue types
+   16.10.26 Records the build fingerprint so far
+*/
+BOOL WriteCheckpoint(DBOUT *db, int njobsDone)
+{
+   FILE       *fp;
+   char       tmpFile[MAXBUFF+32];
+   CKPTHEADER header;
+   BOOL       ok = TRUE;
+
+   if(fflush(db->fp) || fsync(fileno(db->fp)))
+      return(FALSE);
+
+   memset(&header, 0, sizeof(CKPTHEADER));
+   memcpy(header.magic, CKPT_MAGIC, 4);
+   header.version   = CKPT_VERSION;
+   header.njobsDone = (uint64_t)njobsDone;
+   header.listHash  = db->listHash;
+   header.fingerprint = db->fingerprint;
+   header.offset    = db->offset;
+   header.nrecords  = db->nrecords;
+   header.nchains   = db->nchains;
+   header.nentries  = (uint64_t)db->nentries;
+   header.binary    = (uint32_t)db->binary;
+   header.layout    = (uint32_t)db->header.layout;
+   header.ndist     = (uint32_t)db->ndist;
+   header.forward   = (uint32_t)db->forward;
+   header.angles    = (uint32_t)db->angles;
+   header.sequence  = (uint32_t)db->sequence;
+   strcpy(header.filters, db->filters);
+   
+   sprintf(tmpFile, "%s.tmp", db->ckptFile);
+   if((fp=fopen(tmpFile, "wb"))==NULL)
+      return(FALSE);
+
+   if((fwrite(&header, sizeof(CKPTHEADER), 1, fp) != 1) ||
+      (db->nchains && 
+       (fwrite(db->chains, sizeof(CADBCHAIN), db->nchains, fp) != 
+        db->nchains)) ||
+      (db->nentries &&
+       (fwrite(db->entries, sizeof(MANIFESTENTRY), db->nentries, fp) !=
+        (size_t)db->nentries)))
+      ok = FALSE;
+   if(fflush(fp) || fsync(fileno(fp)))
+      ok = FALSE;
+   if(fclose(fp))
+      ok = FALSE;
+
+   if(ok && rename(tmpFile, db->ckptFile))
+      ok = FALSE;
+   if(!ok)
+      unlink(tmpFile);
+
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL ResumeDatabase(DBOUT *db, OPTIONS *opts)
+   ---------------------------------------------
+   Outputs:    DBOUT   *db      The database being written
+   Inputs:     OPTIONS *opts    Command line options
+   Returns:    BOOL             Success?
+
+   Reopens a partially written database and restores the state from 
+   its checkpoint. The output is truncated to the end of the last job
+   recorded in the checkpoint and ProcessAllFiles() then continues from
+   the next job. The header written by the original run is kept (for a 
+   binary database it is rewritten with the final counts as usual), so 
+   the result is the same as if the build had not stopped.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Checks the build filters
+   16.10.26 Checks angles
+   16.10.26 Checks residue types
+   16.10.26 Restores the build fingerprint
+*/
+BOOL ResumeDatabase(DBOUT *db, OPTIONS *opts)
+{
+   FILE       *fp;
+   CKPTHEADER header;
+   int        err;
+   
+   InitDatabase(db, opts);
+   sprintf(db->ckptFile, "%s%s", opts->outfile, CKPT_EXT);
+
+   if((fp=fopen(db->ckptFile, "rb"))==NULL)
+   {
+      fprintf(stderr,"No checkpoint (%s) to resume from\n", 
+              db->ckptFile);
+      return(FALSE);
+   }
+   if((fread(&header, sizeof(CKPTHEADER), 1, fp) != 1) ||
+      strncmp(header.magic, CKPT_MAGIC, 4) ||
+      (header.version != CKPT_VERSION))
+   {
+      fprintf(stderr,"%s is not a valid checkpoint\n", db->ckptFile);
+      fclose(fp);
+      return(FALSE);
+   }
+   if((header.binary  != (uint32_t)opts->binary) ||
+      (header.binary  && (header.layout != (uint32_t)opts->layout)) ||
+      (header.ndist   != (uint32_t)opts->ndist) ||
+      (header.forward != (uint32_t)opts->forward) ||
+      (header.angles  != (uint32_t)db->angles) ||
+      (header.sequence != (uint32_t)db->sequence) ||
+      strncmp(header.filters, db->filters, MAXFILTERSTRING))
+   {
+      fprintf(stderr,"The options do not match those of the build being \
+resumed\n");
+      fclose(fp);
+      return(FALSE);
+   }
+
+   db->firstJob  = (int)header.njobsDone;
+   db->listHash  = header.listHash;
+   db->fingerprint = header.fingerprint;
+   db->offset    = header.offset;
+   db->nrecords  = header.nrecords;
+   db->nchains   = header.nchains;
+   db->maxChains = header.nchains;
+   db->nentries  = (int)header.nentries;
+   db->maxEntries = db->nentries;
+
+   if(db->nchains &&
+      (((db->chains = (CADBCHAIN *)malloc(db->nchains * 
+                                          sizeof(CADBCHAIN)))==NULL) ||
+       (fread(db->chains, sizeof(CADBCHAIN), db->nchains, fp) != 
+        db->nchains)))
+   {
+      fprintf(stderr,"Unable to read chain table from checkpoint\n");
+      fclose(fp);
+      return(FALSE);
+   }
+   if(db->nentries &&
+      (((db->entries = (MANIFESTENTRY *)malloc(db->nentries * 
+                                         sizeof(MANIFESTENTRY)))==NULL) ||
+       (fread(db->entries, sizeof(MANIFESTENTRY), db->nentries, fp) != 
+        (size_t)db->nentries)))
+   {
+      fprintf(stderr,"Unable to read manifest from checkpoint\n");
+      fclose(fp);
+      return(FALSE);
+   }
+   fclose(fp);
+
+   if((db->fp = fopen(opts->outfile, "r+b"))==NULL)
+   {
+      fprintf(stderr,"Unable to open %s to resume\n", opts->outfile);
+      return(FALSE);
+   }
+   if(db->binary && 
+      ((err = CADBReadHeader(db->fp, &(db->header))) != CADB_OK))
+   {
+      fprintf(stderr,"%s: %s\n", opts->outfile, CADBError(err));
+      return(FALSE);
+   }
+   if(ftruncate(fileno(db->fp), (off_t)db->offset) ||
+      fseeko(db->fp, (off_t)db->offset, SEEK_SET))
+   {
+      fprintf(stderr,"Unable to truncate %s to resume\n", 
+              opts->outfile);
+      return(FALSE);
+   }
+
+   fprintf(stderr,"Resuming after %d files\n", db->firstJob);
    return(TRUE);
 }
 
@@ -373,17 +7217,144 @@ BOOL ParseCmdLine(int argc, char **argv, char *pdbdir, char *outfile,
    06.10.98 Original   By: ACRM
    11.01.02 V1.1
    18.01.02 V1.2
+   16.10.26 V1.3
+   16.10.26 V1.4
+   16.10.26 V1.5
+   16.10.26 V1.6
+   16.10.26 V1.7
+   16.10.26 V1.8
+   16.10.26 V1.9
+   16.10.26 V1.10
+   16.10.26 V1.11
+   16.10.26 V1.12
+   16.10.26 V1.13
+   16.10.26 V1.14
+   16.10.26 V1.15
+   16.10.26 V1.16
+   16.10.26 V1.17
+   16.10.26 V1.18
+   16.10.26 V1.19
+   16.10.26 V1.20
+   16.10.26 V1.21
+   16.10.26 V1.22
+   16.10.26 V1.23
+   16.10.26 V1.24
+   16.10.26 V1.25
+   16.10.26 V1.26
+   16.10.26 V1.27
 */
 void Usage(void)
 {
-   fprintf(stderr,"\nmakecadb V1.2 (c) 1998-2002, Dr. Andrew C.R. Martin, \
+   fprintf(stderr,"\nmakecadb V1.27 (c) 1998-2026, Dr. Andrew C.R. Martin, \
 UCL\n");
 
-   fprintf(stderr,"\nUsage: makecadb [-d ndist] [-l limit] pdbdir \
-[outfile]\n");
+   fprintf(stderr,"\nUsage: makecadb [-d ndist] [-l limit] [-t nthreads] \
+[-p depth] [-b] [-c] [-q]\n");
+   fprintf(stderr,"                [-F] [-C] [-a] [-s] [-x] \
+[-w len[,len...]] [-K] [-r]\n");
+   fprintf(stderr,"                [-e ext[,ext...]]\n");
+   fprintf(stderr,"                pdbdir [outfile]\n");
+   fprintf(stderr,"       makecadb [options] -f filelist [outfile]\n");
+   fprintf(stderr,"       makecadb [options] [-m] [-u prevdb] ... \
+outfile\n");
+   fprintf(stderr,"       makecadb [options] [-k secs] -resume ... \
+outfile\n");
+   fprintf(stderr,"       makecadb [options] -shards n [-balance] ... \
+outfile\n");
+   fprintf(stderr,"       makecadb [options] -R tol ... outfile\n");
+   fprintf(stderr,"       makecadb [options] [-res r] [-maxb b] \
+[-minocc o] [-alt c] ...\n");
+   fprintf(stderr,"       makecadb [options] -trace tracefile ...\n");
    fprintf(stderr,"       -d Specify number of distances (Default: %d)\n",
            DEF_NDIST);
    fprintf(stderr,"       -l Limit the maximum number of PDB files read\n");
+   fprintf(stderr,"       -t Number of threads used to process files \
+(Default: 1)\n");
+   fprintf(stderr,"       -p Read up to depth PDB files into memory \
+ahead of processing\n");
+   fprintf(stderr,"          them (Default: 0, no read-ahead; \
+maximum %d)\n", MAXPREFETCH);
+   fprintf(stderr,"       -b Write a binary database (requires \
+outfile)\n");
+   fprintf(stderr,"       -c Write a binary database with the distances \
+stored by column\n");
+   fprintf(stderr,"       -q Write a binary database with the distances \
+quantized and\n");
+   fprintf(stderr,"          compressed by column\n");
+   fprintf(stderr,"       -F Only store the forward (DP) distances. The \
+DM distances are\n");
+   fprintf(stderr,"          derived from these when searching\n");
+   fprintf(stderr,"       -C Write a binary database of CA coordinates. \
+Distances are\n");
+   fprintf(stderr,"          calculated when searching so -d, -F, -a \
+and -c or -q are\n");
+   fprintf(stderr,"          ignored\n");
+   fprintf(stderr,"       -a Also store the CA angle and CA torsion of \
+each residue for\n");
+   fprintf(stderr,"          the ANGLE and TORSION commands of \
+searchcadb\n");
+   fprintf(stderr,"       -s Also store the one-letter residue type of \
+each residue for the\n");
+   fprintf(stderr,"          SEQ command of searchcadb\n");
+   fprintf(stderr,"       -x Also write a range index (outfile%s) of a \
+binary distance\n", CADB_INDEX_EXT);
+   fprintf(stderr,"          database for searchcadb\n");
+   fprintf(stderr,"       -w Also write a loop window table \
+(outfile%sL) of a binary\n", CADB_WINDOW_EXT);
+   fprintf(stderr,"          distance database for each loop length \
+L (up to %d)\n", CADB_MAXWINDOWS);
+   fprintf(stderr,"       -K Also write a key index (outfile%s) of a \
+binary database for\n", CADB_KEY_EXT);
+   fprintf(stderr,"          the LOOKUP command of searchcadb\n");
+   fprintf(stderr,"       -r Also scan subdirectories of pdbdir (e.g. \
+the wwPDB divided\n");
+   fprintf(stderr,"          layout)\n");
+   fprintf(stderr,"       -e Only process files with these extensions \
+(Default with -r:\n");
+   fprintf(stderr,"          %s)\n", DEF_EXTENSIONS);
+   fprintf(stderr,"       -f Read the PDB files to process from \
+filelist (- for standard\n");
+   fprintf(stderr,"          input) rather than scanning a \
+directory\n");
+   fprintf(stderr,"       -m Write a manifest (outfile%s) recording \
+each PDB file\n", MANIFEST_EXT);
+   fprintf(stderr,"       -u Update prevdb (which must have a \
+manifest). Only new and\n");
+   fprintf(stderr,"          changed files are processed. Implies -m\n");
+   fprintf(stderr,"       -k Interval between checkpoints in seconds \
+(Default: %d)\n", DEF_CKPT_INTERVAL);
+   fprintf(stderr,"       -resume Continue a build of outfile that \
+stopped. The other\n");
+   fprintf(stderr,"          options and files must be the same as for \
+the original run\n");
+   fprintf(stderr,"       -shards Split the database into n shards \
+(outfile.0 ...). outfile\n");
+   fprintf(stderr,"          is written as a shard manifest listing \
+the shards\n");
+   fprintf(stderr,"       -balance Assign files to the shard with the \
+fewest records rather\n");
+   fprintf(stderr,"          than by a hash of the PDB code\n");
+   fprintf(stderr,"       -R Store duplicate chains once. Chains with \
+the same residues\n");
+   fprintf(stderr,"          whose distances agree to within tol \
+Angstroms (0 for\n");
+   fprintf(stderr,"          identical) are listed as aliases of the \
+first. Binary only\n");
+   fprintf(stderr,"       -res Leave out structures with a resolution \
+worse than r\n");
+   fprintf(stderr,"          Angstroms or with no resolution (e.g. NMR \
+structures)\n");
+   fprintf(stderr,"       -maxb Leave out CA atoms with a B-factor \
+above b\n");
+   fprintf(stderr,"       -minocc Leave out CA atoms with an occupancy \
+below o\n");
+   fprintf(stderr,"       -alt Use alternative position c where \
+present rather than the\n");
+   fprintf(stderr,"          one with the highest occupancy\n");
+   fprintf(stderr,"       -trace Write the time taken by each stage \
+for each PDB file to\n");
+   fprintf(stderr,"          tracefile (Chrome trace event JSON) and \
+print a summary\n");
 
    fprintf(stderr,"\nCreates a C-alpha distance matrix database for \
 use with searchdb\n");
@@ -4,11 +4,11 @@
    Program:    searchcadb
    File:       searchcadb.c
    
-   Version:    V1.0
-   Date:       08.10.98
+   Version:    V1.14
+   Date:       16.10.26
    Function:   Search a CA distance matrix database
    
-   Copyright:  (c) Dr. Andrew C. R. Martin 1998
+   Copyright:  (c) Dr. Andrew C. R. Martin 1998-2026
    Author:     Dr. Andrew C. R. Martin
    Address:    Biomolecular Structure & Modelling Unit,
                Department of Biochemistry & Molecular Biology,
@@ -41,6 +41,92 @@
    ============
    This is a reimplementation of the searchdb method from my thesis.
 
+   Both the text database and the binary database (see cadb.h) written
+   by makecadb may be searched. The format is detected from the start
+   of the file. For a binary database, the constraints are converted to
+   integer bounds in hundredths of an Angstrom and the database is
+   searched a chain at a time. If the binary database was written with
+   the column layout, only the columns for which there are constraints
+   are read.
+
+   If the database was written with only the forward (DP) distances, 
+   the DM distances are obtained from the DP distances of the preceding
+   records in the chain.
+
+   For a coordinate database, only the distances needed by the 
+   constraints are calculated, so there is no limit on the offsets 
+   that can be used.
+
+   If the database has an alias table (makecadb -R), a hit in a stored
+   chain is also reported for each chain which duplicates it.
+
+   For a quantized database, only the constrained columns are read and
+   decompressed. For each chain, every bin of a constrained column is
+   classed as inside the constraint, outside it or on its edge. Only a
+   record whose bin is on the edge needs its exact distance decoded
+   from the residual.
+
+   If the database has a range index (makecadb -x), the constraints
+   that are selective enough are looked up in the index to find the 
+   records that could satisfy them. Only the chains containing such
+   records are read; the constraints are then checked as usual so the
+   hits are exactly the same as without the index. A DM constraint at
+   offset k on the last residue of the loop is looked up in the list 
+   for DP offset k, shifted along the chain. Residues too near the end
+   of the chain for the DM constraints to be tested remain candidates.
+
+   COUNT runs the search but prints only the number of hits. For a
+   binary database, the hits are counted as they are found without 
+   reading the residue identifiers or storing the hits in the DBM hash.
+   This counts the loops found; if a chain has repeated residue 
+   identifiers, END lists each identifier once. ESTIMATE does not 
+   search at all: the fraction of records satisfying each constraint is
+   taken from the distance histograms at the end of the database and,
+   assuming the constraints to be independent, these give an estimate
+   of the number of hits. An upper bound is also given. ESTIMATE does 
+   not end the control file, so constraints may be added and the 
+   estimate repeated before running the search.
+
+   If the database has a loop window table (makecadb -w) for the loop
+   length, each row of the table holds the DP distances for a residue
+   and the DM distances for the residue at the end of the loop. The 
+   search is then a single scan of the table, split over -t threads,
+   and the database is only read for the residue identifiers of the 
+   chains with hits. As with the index, the hits are exactly the same.
+
+   If the database was built with makecadb -a, ANGLE and TORSION 
+   constrain the CA virtual bond angle and CA pseudo-torsion of a 
+   residue of the loop (given by its position, 1..LENGTH). The angles
+   are tested first and the distances of a chain are only read if some
+   loop satisfies them. For a coordinate database, the angles are 
+   calculated from the coordinates. A torsion range runs upwards from
+   the minimum to the maximum so may wrap through 180/-180. ESTIMATE
+   ignores these constraints.
+
+   SEQ restricts the residue type at a position of the loop using the
+   one-letter codes stored by makecadb -s. For a binary database, these
+   are tested from the residue identifiers before anything else is 
+   read for a chain. ESTIMATE ignores SEQ constraints too.
+
+   If the database is a shard manifest written by makecadb -shards, 
+   each shard is searched by a separate process (at most -p at a time)
+   which writes its hits to a temporary file. The hits are then merged
+   into the DBM hash and displayed as for a single database.
+
+   LOOKUP prints the stored record of a chain (pdbcode.chain) or of
+   every chain of a PDB entry (pdbcode) without running a search. For
+   a binary database, the key index written by makecadb -K is used to
+   seek straight to the chain block; without it, the chain and alias
+   tables are used. A text database is simply scanned.
+
+   INCLUDE and EXCLUDE name a file listing a pdbcode or pdbcode.chain
+   on each line and restrict the search to (or away from) those 
+   chains. A duplicate chain is selected through its own name as well
+   as that of the chain whose data it shares. For a binary database,
+   only the chain blocks or window table rows of selected chains are
+   read; a text database is filtered as it is scanned. ESTIMATE 
+   ignores these lists.
+
 **************************************************************************
 
    Usage:
@@ -51,6 +137,21 @@
    Revision History:
    =================
    V1.0 08.10.98 Original
+   V1.1 16.10.26 Added support for binary databases
+   V1.2 16.10.26 Added support for column layout binary databases
+   V1.3 16.10.26 Added support for forward-only databases
+   V1.4 16.10.26 Added support for coordinate databases
+   V1.5 16.10.26 Added support for sharded databases and -p
+   V1.6 16.10.26 Handles multi-character chain labels
+   V1.7 16.10.26 Added support for quantized databases
+   V1.8 16.10.26 Reports hits for the aliases of duplicate chains
+   V1.9 16.10.26 Uses a range index if present. Added -n
+   V1.10 16.10.26 Added COUNT and ESTIMATE
+   V1.11 16.10.26 Uses a loop window table if present. Added -w and -t
+   V1.12 16.10.26 Added ANGLE and TORSION
+   V1.13 16.10.26 Added SEQ
+   V1.14 16.10.26 Added LOOKUP, INCLUDE and EXCLUDE. Uses a key index if
+                  present
 
 *************************************************************************/
 /* Includes
@@ -58,8 +159,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <unistd.h>
 #include <math.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include <stdint.h>
 
 #ifdef GDBM
 #include <gdbm.h>
@@ -81,10 +186,30 @@
 #include "bioplib/general.h"
 #include "bioplib/array.h"
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "cadb.h"
+
 /************************************************************************/
 /* Defines and macros
 */
 #define MAXBUFF 160
+#define MAXSHARDS 256
+
+/* A constraint is only looked up in the range index if it matches at 
+   most 1/INDEX_SELECTIVE of the records. INDEX_READBUFF records are
+   read from the index at a time
+*/
+#define INDEX_SELECTIVE 4
+#define INDEX_READBUFF  65536
+
+/* Maximum number of threads used to scan a loop window table and the
+   number of rows read from it at a time
+*/
+#define MAXTHREADS      64
+#define WINDOW_READROWS 65536
 
 /* Defines for Keyword parser                                           */
 #define KEY_DATABASE 0
@@ -94,18 +219,140 @@
 #define KEY_LENGTH   4
 #define KEY_QUIT     5
 #define KEY_HELP     6
-#define NCOMM        7
-#define MAXSTRPARAM  1
+#define KEY_COUNT    7
+#define KEY_ESTIMATE 8
+#define KEY_ANGLE    9
+#define KEY_TORSION  10
+#define KEY_SEQ      11
+#define KEY_LOOKUP   12
+#define KEY_INCLUDE  13
+#define KEY_EXCLUDE  14
+#define NCOMM        15
+#define MAXSTRPARAM  2
 #define MAXREALPARAM 3
 
-/* Structure to store distance constraints                              */
+/* Flags for a chain selected by INCLUDE and EXCLUDE: the chain itself
+   and/or one of its aliases is selected. SELECT_ALLOC entries are added
+   to a list at a time
+*/
+#define SEL_CHAIN    1
+#define SEL_ALIAS    2
+#define SELECT_ALLOC 256
+
+/* Classes of the bins of a quantized column for a constraint           */
+#define QUANT_OUT    0
+#define QUANT_IN     1
+#define QUANT_EDGE   2
+
+/* Vector types for the coordinate distance kernel                      */
+#ifdef __GNUC__
+#define VLEN 4
+typedef float VFLOAT __attribute__ ((vector_size (VLEN * sizeof(float))));
+typedef int   VINT   __attribute__ ((vector_size (VLEN * sizeof(int))));
+#endif
+
+/* Structure to store distance constraints. lo and hi are the bounds in
+   the fixed point units of the binary database, lo2 and hi2 are the
+   equivalent bounds on the squared distance for a coordinate database
+   and missingOK is set if a missing distance (-1 in the text database) 
+   satisfies the constraint. qclass gives the class of each bin of the
+   column of a quantized database for the current chain. The same
+   structure holds ANGLE and TORSION constraints, where cons is the
+   position in the loop and lo and hi are in hundredths of a degree. A
+   torsion range with lo greater than hi wraps through 360
+*/
 typedef struct _constraint
 {
    struct _constraint *next;
-   REAL min, max;
-   int cons;
+   REAL  min, max;
+   int   cons,
+         lo, hi;
+   float lo2, hi2;
+   BOOL  missingOK;
+   unsigned char qclass[CADB_QMISSING+1];
 }  CONSTRAINT;
 
+/* Structure to store SEQ constraints. allowed flags the one-letter 
+   residue types (A to Z) allowed at position pos of the loop
+*/
+typedef struct _seqcons
+{
+   struct _seqcons *next;
+   int   pos;
+   BOOL  allowed[26];
+}  SEQCONS;
+
+/* A chain read from a binary database. Distance j of residue i is
+   dist[i*rowStride + j*colStride]. With the column layout, only the
+   columns listed in cols[] are read and the residue identifiers are
+   only read if there is a hit in the chain. For a coordinate database,
+   coords holds the x, y and z arrays instead of dist. For a quantized
+   database, qblocks holds the header of each column read and qraw its
+   bins and residuals, column j starting at qraw + j*colStride. hits 
+   and negHits are used to flag the residues which satisfy the 
+   constraints. angles holds the CA angles followed by the torsions
+   and angleHits flags the residues which satisfy the ANGLE and TORSION
+   constraints. angleWork is used to calculate the angles for a 
+   coordinate database. seqHits flags the residues which satisfy the
+   SEQ constraints
+*/
+typedef struct
+{
+   CADBRESID     *resids;
+   uint16_t      *dist,
+                 *angles;
+   float         *coords;
+   REAL          *angleWork;
+   CADBQBLOCK    *qblocks;
+   uint32_t      *qdir;
+   unsigned char *qraw,
+                 *qstored,
+                 *hits,
+                 *negHits,
+                 *angleHits,
+                 *seqHits;
+   int           *cols,
+                 ncols,
+                 nres,
+                 maxres,
+                 rowStride,
+                 colStride;
+   BOOL          residsRead;
+}  CHAINDATA;
+
+/* A list of PDB codes and chains read by INCLUDE or EXCLUDE, sorted 
+   with CADBCompareKeys(). An entry with an empty chain label matches 
+   every chain of the PDB entry. active is set once a file has been
+   read, so an INCLUDE of an empty file selects nothing
+*/
+typedef struct
+{
+   CADBKEY *keys;
+   int     nkeys,
+           maxkeys;
+   BOOL    active;
+}  SELLIST;
+
+/* The part of a loop window table scanned by one thread. The chains 
+   firstChain to lastChain-1 are scanned and the record numbers of the 
+   hits are stored in hits. Chains which are not selected or have no
+   candidates are skipped
+*/
+typedef struct
+{
+   CADBWINDOWHEADER *win;
+   CADBCHAIN        *chains;
+   unsigned char    *selected;
+   uint64_t         *candidates,
+                    *hits,
+                    firstChain,
+                    lastChain,
+                    nhits,
+                    maxhits;
+   int              fd;
+   BOOL             ok;
+}  WINDOWSCAN;
+
 /* Make a key to store in a dbm hash                                    */
 #define MAKEDBMKEY(MK_datum, MK_key) \
         do { (MK_datum).dptr = (MK_key); \
@@ -136,13 +383,37 @@ KeyWd      gKeys[NCOMM];
 char       *gStrParam[MAXSTRPARAM];
 REAL       gRealParam[MAXREALPARAM];
 CONSTRAINT *gPosConsList = NULL,
-           *gNegConsList = NULL;
+           *gNegConsList = NULL,
+           *gAngleConsList   = NULL,
+           *gTorsionConsList = NULL;
+SEQCONS    *gSeqConsList = NULL;
 #ifdef GDBM
 GDBM_FILE  gDbm;
 #else
 DBM        *gDbm = NULL;
 #endif
-int        gLoopLength = 0;
+int        gLoopLength = 0,
+           gNShards    = 0,
+           gMaxProcs   = 0,
+           gNThreads   = 1;
+char       gShards[MAXSHARDS][MAXBUFF],
+           gDBFile[MAXBUFF];
+BOOL       gBinary     = FALSE,
+           gForward    = FALSE,
+           gUseIndex   = TRUE,
+           gUseWindows = TRUE,
+           gCountOnly  = FALSE,
+           gAngles     = FALSE,
+           gSequence   = FALSE;
+uint64_t   gNHits      = 0;
+CADBHEADER gHeader;
+FILE       *gIndexFp   = NULL;
+CADBINDEXHEADER gIndexHeader;
+uint32_t   *gIndexBins = NULL;
+FILE       *gKeyFp     = NULL;
+CADBKEYHEADER gKeyHeader;
+SELLIST    gInclude    = {NULL, 0, 0, FALSE},
+           gExclude    = {NULL, 0, 0, FALSE};
 
 
 /************************************************************************/
@@ -152,10 +423,102 @@ int  main(int argc, char **argv);
 BOOL ParseCmdLine(int argc, char **argv, char *InFile, char *OutFile);
 BOOL SetupParser(void);
 BOOL ParseInputFile(FILE *in, FILE *out);
+BOOL OpenDBMHash(char *filename);
+void CloseDBMHash(char *filename);
+FILE *OpenDatabase(char *filename, int *ndist);
+int  ReadShardManifest(char *filename);
+BOOL RunShardedSearch(FILE *out);
+BOOL SearchShard(char *filename, FILE *out);
+void ReadTextHeader(FILE *DBfp, int *ndist);
 BOOL StorePosConstraint(int cons, REAL mindist, REAL maxdist);
 BOOL StoreNegConstraint(int cons, REAL mindist, REAL maxdist);
+BOOL StoreAngleConstraint(CONSTRAINT **ConsList, int pos, REAL min, 
+                          REAL max, BOOL torsion);
+void SetAngleBounds(CONSTRAINT *c, BOOL torsion);
+BOOL CheckAngleConstraints(void);
+BOOL AngleOK(int angle, CONSTRAINT *c);
+void CheckTextAngles(REAL *angles, char *currentKey, char **prevKeys,
+                     int keyPos, int ringSize, int nread);
+BOOL ReadAngleBlock(FILE *DBfp, CADBCHAIN *chain, int nval,
+                    CHAINDATA *data);
+void CalcCoordAngles(CHAINDATA *data);
+BOOL FindAngleHits(CHAINDATA *data);
+BOOL AngleRecordOK(CHAINDATA *data, int res, uint16_t *angles,
+                   CONSTRAINT *ConsList);
+BOOL ParseSeqPattern(char *pattern, BOOL *allowed);
+BOOL StoreSeqConstraint(int pos, BOOL *allowed);
+BOOL CheckSeqConstraints(void);
+BOOL SeqOK(char restype, SEQCONS *s);
+void CheckTextSequence(char restype, char *currentKey, char **prevKeys,
+                       int keyPos, int ringSize, int nread);
+BOOL FindSeqHits(CHAINDATA *data);
 BOOL RunSearch(FILE *DBfp, int ndist, FILE *out);
-void ReadArrayFromBuffer(char *buffer, int ndist, REAL *distArray);
+void SetIntegerBounds(CONSTRAINT *c);
+BOOL RunBinarySearch(FILE *DBfp, FILE *out);
+BOOL CheckConstraints(CONSTRAINT *ConsList, int ndist);
+BOOL RunEstimate(FILE *DBfp, FILE *out);
+BOOL EstimateHits(FILE *DBfp, CADBHEADER *header, REAL *estimate,
+                  uint64_t *maxHits);
+REAL HistFraction(CADBHISTHEADER *hist, uint64_t *counts, CONSTRAINT *c,
+                  uint64_t *nbound);
+void OpenIndex(char *dbfile);
+void OpenKeyIndex(char *dbfile);
+void CloseDatabase(FILE *DBfp);
+BOOL ReadSelectList(char *filename, SELLIST *list);
+char *SplitKey(char *key, CADBKEY *name);
+BOOL NameMatches(CADBKEY *name, CADBKEY *probe);
+BOOL InSelectList(SELLIST *list, char *pdbcode, char *chain);
+BOOL NameSelected(char *pdbcode, char *chain);
+BOOL KeySelected(char *key);
+unsigned char *SelectChains(CADBCHAIN *chains, CADBALIAS *aliases,
+                            uint64_t *naliases);
+int  RunLookup(FILE *DBfp, int ndist, char *key, FILE *out);
+int  RunShardedLookup(char *key, FILE *out);
+int  LookupText(FILE *DBfp, int ndist, char *key, FILE *out);
+int  LookupBinary(FILE *DBfp, char *key, FILE *out);
+CADBKEY *FindChainNames(FILE *DBfp, CADBKEY *probe, uint64_t *nnames);
+void PrintRecord(FILE *out, char *key, CHAINDATA *data, int res, 
+                 int ndist);
+int  StoredDist(CHAINDATA *data, int row, int col);
+uint64_t *IndexCandidates(CADBCHAIN *chains);
+BOOL IndexRange(CONSTRAINT *c, uint64_t *start, uint64_t *count);
+BOOL IndexConstraintBits(CONSTRAINT *c, int shift, uint64_t *bits, 
+                         uint64_t *work, BOOL first);
+BOOL ChainHasCandidates(uint64_t *bits, CADBCHAIN *chain);
+BOOL ChainWanted(uint64_t *candidates, unsigned char *selected,
+                 CADBCHAIN *chains, uint64_t chainNum);
+FILE *OpenWindowTable(CADBWINDOWHEADER *win);
+BOOL RunWindowSearch(FILE *DBfp, FILE *winFp, CADBWINDOWHEADER *win,
+                     CADBCHAIN *chains, CADBALIAS *aliases, 
+                     uint64_t naliases, uint64_t *candidates,
+                     unsigned char *selected);
+void *ScanWindows(void *arg);
+BOOL AddWindowHit(WINDOWSCAN *scan, uint64_t record);
+BOOL WindowRowOK(uint16_t *row, CONSTRAINT *ConsList);
+int  *ConstrainedColumns(int ndist, int *ncols);
+BOOL ReadChainBlock(FILE *DBfp, CADBCHAIN *chain, int ncol, 
+                    CHAINDATA *data);
+BOOL ReadResids(FILE *DBfp, CADBCHAIN *chain, CHAINDATA *data);
+BOOL AllocChainData(CHAINDATA *data, int nres, int nval);
+void FreeChainData(CHAINDATA *data);
+BOOL ReadCoordBlock(FILE *DBfp, CADBCHAIN *chain, CHAINDATA *data);
+BOOL ReadQuantBlock(FILE *DBfp, CADBCHAIN *chain, int ncol, 
+                    CHAINDATA *data);
+int  CompareAliases(const void *alias1, const void *alias2);
+void FindDistanceHits(CHAINDATA *data, int ndist);
+void FindQuantHits(CHAINDATA *data, int ndist);
+void SetQuantClasses(CONSTRAINT *c, CADBQBLOCK *block);
+BOOL QuantRecordOK(CHAINDATA *data, int res, int ndist, 
+                   CONSTRAINT *ConsList);
+void FindCoordHits(CHAINDATA *data);
+void CoordPairMask(float *x, float *y, float *z, int npair, int k,
+                   float lo2, float hi2, unsigned char *mask);
+BOOL BinaryRecordOK(CHAINDATA *data, int res, int ndist, 
+                    CONSTRAINT *ConsList);
+void ReadArrayFromBuffer(char *buffer, int ncol, REAL *distArray);
+void ReconstructDM(REAL *distArray, int ndist, char *currentKey, 
+                   char **prevKeys, REAL **prevDists, int keyPos, 
+                   int ringSize, int nread);
 BOOL RecordOK(REAL *distArray, int ndist, CONSTRAINT *ConsList);
 BOOL InSameChain(char *currentKey, char *prevKey);
 void FlagPosOK(char *currentKey);
@@ -171,6 +534,7 @@ void Usage(void);
    Main program
 
    08.10.98 Original   By: ACRM
+   16.10.26 DBM file handled by OpenDBMHash() and CloseDBMHash()
 */
 int main(int argc, char **argv)
 {
@@ -188,33 +552,15 @@ int main(int argc, char **argv)
          if(SetupParser())
          {
             /* initialise a DBM file                                   */
-            pid_t pid;
-            
-            pid = getpid();
-            sprintf(filename,"/tmp/scadb_%d.dbm",(int)pid);
-#ifdef GDBM
-            if((gDbm = gdbm_open(filename, BLOCK_SIZE,
-                                GDBM_WRCREAT|GDBM_FAST,
-                                MODE, NULL)) == NULL)
-#else
-            if((gDbm = dbm_open(filename, 
-                                O_RDWR|O_CREAT|O_TRUNC, 
-                                S_IRWXU)) == NULL)
-#endif
+            if(!OpenDBMHash(filename))
             {
                fprintf(stderr,"Can't open DBM file for writing\n");
                return(1);
             }
-            
 
             Success = ParseInputFile(in,out);
 
-#ifdef GDBM
-            gdbm_close(gDbm);
-#else
-            dbm_close(gDbm);
-#endif
-            unlink(filename);
+            CloseDBMHash(filename);
             
             if(!Success)
                return(1);
@@ -242,10 +588,19 @@ int main(int argc, char **argv)
    Output:  char   *InFile      Input file (or blank string)
             char   *OutFile     Output file (or blank string)
    Returns: BOOL                Success?
+   Globals: int    gMaxProcs    Maximum number of processes used to
+                                search a sharded database
+            int    gNThreads    Number of threads used to scan a loop
+                                window table
+            BOOL   gUseIndex    Use the range index?
+            BOOL   gUseWindows  Use the loop window tables?
 
    Parse the command line
    
    08.10.98 Original    By: ACRM
+   16.10.26 Added -p
+   16.10.26 Added -n
+   16.10.26 Added -w and -t
 */
 BOOL ParseCmdLine(int argc, char **argv, char *InFile, char *OutFile)
 {
@@ -261,6 +616,26 @@ BOOL ParseCmdLine(int argc, char **argv, char *InFile, char *OutFile)
       {
          switch(argv[0][1])
          {
+         case 'p':
+            argc--;
+            argv++;
+            if(!argc || (sscanf(argv[0],"%d",&gMaxProcs) != 1) ||
+               (gMaxProcs < 1))
+               return(FALSE);
+            break;
+         case 'n':
+            gUseIndex = FALSE;
+            break;
+         case 'w':
+            gUseWindows = FALSE;
+            break;
+         case 't':
+            argc--;
+            argv++;
+            if(!argc || (sscanf(argv[0],"%d",&gNThreads) != 1) ||
+               (gNThreads < 1) || (gNThreads > MAXTHREADS))
+               return(FALSE);
+            break;
          default:
             return(FALSE);
             break;
@@ -298,6 +673,10 @@ BOOL ParseCmdLine(int argc, char **argv, char *InFile, char *OutFile)
    Sets up the command parser.
 
    08.10.98 Original   By: ACRM
+   16.10.26 Added COUNT and ESTIMATE
+   16.10.26 Added ANGLE and TORSION
+   16.10.26 Added SEQ
+   16.10.26 Added LOOKUP, INCLUDE and EXCLUDE
 */
 BOOL SetupParser(void)
 {
@@ -318,6 +697,14 @@ BOOL SetupParser(void)
    MAKEKEY(gKeys[KEY_LENGTH],   "LENGTH",   NUMBER, 1);
    MAKEKEY(gKeys[KEY_QUIT],     "QUIT",     NUMBER, 0);
    MAKEKEY(gKeys[KEY_HELP],     "HELP",     NUMBER, 0);
+   MAKEKEY(gKeys[KEY_COUNT],    "COUNT",    NUMBER, 0);
+   MAKEKEY(gKeys[KEY_ESTIMATE], "ESTIMATE", NUMBER, 0);
+   MAKEKEY(gKeys[KEY_ANGLE],    "ANGLE",    NUMBER, 3);
+   MAKEKEY(gKeys[KEY_TORSION],  "TORSION",  NUMBER, 3);
+   MAKEKEY(gKeys[KEY_SEQ],      "SEQ",      STRING, 2);
+   MAKEKEY(gKeys[KEY_LOOKUP],   "LOOKUP",   STRING, 1);
+   MAKEKEY(gKeys[KEY_INCLUDE],  "INCLUDE",  STRING, 1);
+   MAKEKEY(gKeys[KEY_EXCLUDE],  "EXCLUDE",  STRING, 1);
 
    return(TRUE);
 }
@@ -334,13 +721,23 @@ BOOL SetupParser(void)
    calling routines to act on them.
 
    08.10.98 Original   By: ACRM
+   16.10.26 Recognizes binary databases and takes ndist from the header.
+            Text header now read by ReadTextHeader()
+   16.10.26 Database opened by OpenDatabase(). Added shard manifests
+   16.10.26 Added COUNT and ESTIMATE
+   16.10.26 Added ANGLE and TORSION
+   16.10.26 Added SEQ
+   16.10.26 Added LOOKUP, INCLUDE and EXCLUDE
 */
 BOOL ParseInputFile(FILE *in, FILE *out)
 {
    char buffer[MAXBUFF];
    FILE *DBfp = NULL;
    int  ndist = 20,
-        i;
+        nshards,
+        nfound,
+        key;
+   BOOL allowed[26];
    
    ERRPROMPT(in,"SEARCHCADB> ");
    
@@ -348,7 +745,7 @@ BOOL ParseInputFile(FILE *in, FILE *out)
    {
       TERMINATE(buffer);
 
-      switch(parse(buffer,NCOMM,gKeys,gRealParam,gStrParam))
+      switch(key = parse(buffer,NCOMM,gKeys,gRealParam,gStrParam))
       {
       case PARSE_ERRC:
          fprintf(stderr,"Error in command: %s\n",buffer);
@@ -357,31 +754,17 @@ BOOL ParseInputFile(FILE *in, FILE *out)
          fprintf(stderr,"Error in parameters: %s\n",buffer);
          break;
       case KEY_DATABASE:
-         if(DBfp != NULL)
+         if((DBfp != NULL) || gNShards)
          {
             fprintf(stderr,"Database already open, command ignored\n");
          }
-         else
+         else if((nshards = ReadShardManifest(gStrParam[0])) == 0)
          {
-            if((DBfp=fopen(gStrParam[0],"r"))==NULL)
-            {
-               fprintf(stderr,"Can't open database: %s\n",gStrParam[0]);
-            }
-            else
-            {
-               for(i=0; i<3; i++)
-               {
-                  if(fgets(buffer,MAXBUFF,DBfp))
-                  {
-                     TERMINATE(buffer);
-                     if(!strncmp(buffer,"!NDIST",6))
-                     {
-                        sscanf(buffer+6,"%d",&ndist);
-                        break;
-                     }
-                  }
-               }
-            }
+            DBfp = OpenDatabase(gStrParam[0], &ndist);
+         }
+         else if(nshards < 0)
+         {
+            gNShards = 0;
          }
          break;
       case KEY_DP:
@@ -400,14 +783,44 @@ BOOL ParseInputFile(FILE *in, FILE *out)
             return(FALSE);
          }
          break;
+      case KEY_ANGLE:
+      case KEY_TORSION:
+         if(!StoreAngleConstraint(((key == KEY_ANGLE) ? 
+                                   &gAngleConsList : &gTorsionConsList),
+                                  (int)gRealParam[0],
+                                  gRealParam[1], gRealParam[2],
+                                  (key == KEY_TORSION)))
+         {
+            fprintf(stderr,"No memory for constraint list\n");
+            return(FALSE);
+         }
+         break;
+      case KEY_SEQ:
+         if(!ParseSeqPattern(gStrParam[1], allowed))
+         {
+            fprintf(stderr,"Invalid SEQ pattern: %s\n",gStrParam[1]);
+            break;
+         }
+         if(!StoreSeqConstraint(atoi(gStrParam[0]), allowed))
+         {
+            fprintf(stderr,"No memory for constraint list\n");
+            return(FALSE);
+         }
+         break;
       case KEY_END:
+      case KEY_COUNT:
          if(gLoopLength == 0)
          {
             fprintf(stderr,"You must specify a loop length first!\n");
          }
          else
          {
-            if(DBfp!=NULL)
+            gCountOnly = (key == KEY_COUNT);
+            if(gNShards)
+            {
+               return(RunShardedSearch(out));
+            }
+            else if(DBfp!=NULL)
             {
                return(RunSearch(DBfp,ndist,out));
             }
@@ -417,6 +830,43 @@ BOOL ParseInputFile(FILE *in, FILE *out)
             }
          }
          break;
+      case KEY_ESTIMATE:
+         if(gLoopLength == 0)
+         {
+            fprintf(stderr,"You must specify a loop length first!\n");
+         }
+         else if(!gNShards && (DBfp==NULL))
+         {
+            fprintf(stderr,"Database must be opened first!\n");
+         }
+         else
+         {
+            RunEstimate(DBfp, out);
+         }
+         break;
+      case KEY_LOOKUP:
+         if(gNShards)
+         {
+            nfound = RunShardedLookup(gStrParam[0], out);
+         }
+         else if(DBfp!=NULL)
+         {
+            nfound = RunLookup(DBfp, ndist, gStrParam[0], out);
+         }
+         else
+         {
+            fprintf(stderr,"Database must be opened first!\n");
+            break;
+         }
+         if(nfound == 0)
+            fprintf(stderr,"No records found for %s\n",gStrParam[0]);
+         break;
+      case KEY_INCLUDE:
+      case KEY_EXCLUDE:
+         if(!ReadSelectList(gStrParam[0], 
+                            ((key == KEY_INCLUDE) ? &gInclude : &gExclude)))
+            return(FALSE);
+         break;
       case KEY_LENGTH:
          gLoopLength = (int)gRealParam[0];
          break;
@@ -436,206 +886,3904 @@ BOOL ParseInputFile(FILE *in, FILE *out)
 
 
 /************************************************************************/
-/*>BOOL StorePosConstraint(int cons, REAL mindist, REAL maxdist)
-   -------------------------------------------------------------
-   Inputs:     int        cons          Constraint number
-               REAL       mindist       Minimum distance
-               REAL       maxdist       Maximum distance
-   Returns:    BOOL                     Success?
-   Globals:    CONSTRAINT gPosConsList  +ve constraints linked list
+/*>BOOL OpenDBMHash(char *filename)
+   --------------------------------
+   Outputs:    char   *filename   Name of the DBM file
+   Returns:    BOOL               Success?
+   Globals:    gDbm               The DBM hash
 
-   Store a positive distance constraint in the linked list.
+   Creates the DBM hash used to store the hits. The file is named from
+   the process ID so each process searching a shard has its own.
 
-   08.10.98 Original   By: ACRM
+   16.10.26 Original (split from main())   By: ACRM
 */
-BOOL StorePosConstraint(int cons, REAL mindist, REAL maxdist)
+BOOL OpenDBMHash(char *filename)
 {
-   static CONSTRAINT *c;
-   
-   if(gPosConsList==NULL)
+   sprintf(filename,"/tmp/scadb_%d.dbm",(int)getpid());
+#ifdef GDBM
+   if((gDbm = gdbm_open(filename, BLOCK_SIZE,
+                        GDBM_WRCREAT|GDBM_FAST,
+                        MODE, NULL)) == NULL)
+#else
+   if((gDbm = dbm_open(filename,
+                       O_RDWR|O_CREAT|O_TRUNC,
+                       S_IRWXU)) == NULL)
+#endif
+      return(FALSE);
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void CloseDBMHash(char *filename)
+   ---------------------------------
+   Inputs:     char   *filename   Name of the DBM file
+   Globals:    gDbm               The DBM hash
+
+   Closes and removes the DBM hash.
+
+   16.10.26 Original (split from main())   By: ACRM
+*/
+void CloseDBMHash(char *filename)
+{
+#ifdef GDBM
+   gdbm_close(gDbm);
+#else
+   dbm_close(gDbm);
+#endif
+   unlink(filename);
+}
+
+
+/************************************************************************/
+/*>FILE *OpenDatabase(char *filename, int *ndist)
+   ----------------------------------------------
+   Inputs:     char   *filename   Database file
+   I/O:        int    *ndist      Number of distances
+   Returns:    FILE   *           Database file pointer (NULL on error)
+   Globals:    BOOL   gBinary     Set for a binary database
+               BOOL   gForward    Set for a forward-only database
+               CADBHEADER gHeader Header of a binary database
+               char   gDBFile     Filename of a binary database
+
+   Opens a text or binary database and reads its header. The range
+   index and key index of a binary database are also opened if there 
+   are any.
+
+   16.10.26 Original (split from ParseInputFile())   By: ACRM
+   16.10.26 Opens the range index
+   16.10.26 Stores the filename for the loop window tables
+   16.10.26 Notes whether the CA angles are available
+   16.10.26 Notes whether the residue types are available
+   16.10.26 Opens the key index
+*/
+FILE *OpenDatabase(char *filename, int *ndist)
+{
+   FILE *DBfp;
+   int  err;
+
+   if((DBfp=fopen(filename,"r"))==NULL)
    {
-      INIT(gPosConsList, CONSTRAINT);
-      c = gPosConsList;
+      fprintf(stderr,"Can't open database: %s\n",filename);
    }
-   else
+   else if((err=CADBReadHeader(DBfp, &gHeader))==CADB_OK)
    {
-      ALLOCNEXT(c, CONSTRAINT);
+      gBinary  = TRUE;
+      gForward = ((gHeader.flags & CADB_FLAG_FORWARD) != 0);
+      gAngles  = (((gHeader.flags & CADB_FLAG_ANGLES) != 0) ||
+                  (gHeader.layout == CADB_LAYOUT_COORD));
+      gSequence = ((gHeader.flags & CADB_FLAG_SEQUENCE) != 0);
+      *ndist   = (int)gHeader.ndist;
+      strncpy(gDBFile, filename, MAXBUFF-1);
+      gDBFile[MAXBUFF-1] = '\0';
+      if(gUseIndex && (gHeader.layout != CADB_LAYOUT_COORD))
+         OpenIndex(filename);
+      OpenKeyIndex(filename);
    }
-
-   if(c==NULL)
+   else if(err != CADB_ERR_MAGIC)
    {
-      if(gPosConsList)
-         FREELIST(gPosConsList, CONSTRAINT);
-      return(FALSE);
+      fprintf(stderr,"%s: %s\n",CADBError(err),filename);
+      fclose(DBfp);
+      DBfp = NULL;
    }
-   
-   c->cons = cons;
-   c->min  = mindist;
-   c->max  = maxdist;
-   
-   return(TRUE);
+   else
+   {
+      ReadTextHeader(DBfp, ndist);
+   }
+
+   return(DBfp);
 }
 
+
 /************************************************************************/
-/*>BOOL StoreNegConstraint(int cons, REAL mindist, REAL maxdist)
-   -------------------------------------------------------------
-   Inputs:     int        cons          Constraint number
-               REAL       mindist       Minimum distance
-               REAL       maxdist       Maximum distance
-   Returns:    BOOL                     Success?
-   Globals:    CONSTRAINT gNegConsList  -ve constraints linked list
+/*>void OpenIndex(char *dbfile)
+   ----------------------------
+   Inputs:     char   *dbfile     Binary database file
+   Globals:    FILE   *gIndexFp   The range index file pointer
+               CADBINDEXHEADER gIndexHeader  Header of the range index
+               uint32_t *gIndexBins  Bin directory of the range index
+               CADBHEADER gHeader Header of the database
 
-   Store a negative distance constraint in the linked list.
+   Opens the range index (dbfile.idx) written by makecadb -x if there
+   is one and reads its bin directory. An index that does not match
+   the database is ignored with a warning.
 
-   08.10.98 Original   By: ACRM
+   16.10.26 Original   By: ACRM
 */
-BOOL StoreNegConstraint(int cons, REAL mindist, REAL maxdist)
+void OpenIndex(char *dbfile)
 {
-   static CONSTRAINT *c;
-   
-   if(gNegConsList==NULL)
-   {
-      INIT(gNegConsList, CONSTRAINT);
-      c = gNegConsList;
-   }
-   else
+   char   filename[MAXBUFF+8];
+   int    err;
+   size_t ndir;
+
+   sprintf(filename, "%s%s", dbfile, CADB_INDEX_EXT);
+   if((gIndexFp = fopen(filename, "rb"))==NULL)
+      return;
+
+   if((err = CADBReadIndexHeader(gIndexFp, &gIndexHeader, &gHeader))
+      != CADB_OK)
    {
-      ALLOCNEXT(c, CONSTRAINT);
+      fprintf(stderr,"Warning: %s: %s. Index not used\n",
+              CADBError(err), filename);
+      fclose(gIndexFp);
+      gIndexFp = NULL;
+      return;
    }
 
-   if(c==NULL)
+   ndir = (size_t)gIndexHeader.ndist * (gIndexHeader.nbins + 2);
+   if(((gIndexBins = (uint32_t *)malloc(ndir * sizeof(uint32_t)))
+       ==NULL) ||
+      (fread(gIndexBins, sizeof(uint32_t), ndir, gIndexFp) != ndir))
    {
-      if(gNegConsList)
-         FREELIST(gNegConsList, CONSTRAINT);
-      return(FALSE);
+      fprintf(stderr,"Warning: Unable to read %s. Index not used\n",
+              filename);
+      if(gIndexBins != NULL)
+         free(gIndexBins);
+      gIndexBins = NULL;
+      fclose(gIndexFp);
+      gIndexFp = NULL;
    }
-   
-   c->cons = cons;
-   c->min  = mindist;
-   c->max  = maxdist;
-   
-   return(TRUE);
 }
 
+
 /************************************************************************/
-/*>BOOL RunSearch(FILE *DBfp, int ndist, FILE *out)
-   ------------------------------------------------
-   Inputs:     FILE    *DBfp       Database file pointer
-               int     ndist       Number of distance constraints in file
-               FILE    *out        Output file pointer
-   Returns:    BOOL                Success?
+/*>void OpenKeyIndex(char *dbfile)
+   -------------------------------
+   Inputs:     char   *dbfile     Binary database file
+   Globals:    FILE   *gKeyFp     The key index file pointer
+               CADBKEYHEADER gKeyHeader  Header of the key index
+               CADBHEADER gHeader Header of the database
 
-   Actually runs the search. 
+   Opens the key index (dbfile.key) written by makecadb -K if there is
+   one. A key index that does not match the database is ignored with a
+   warning.
 
-   Checking DP constraints is easy!
+   16.10.26 Original   By: ACRM
+*/
+void OpenKeyIndex(char *dbfile)
+{
+   char filename[MAXBUFF+8];
+   int  err;
 
-   For DM constraints we need to update the N-LoopLength record. This we
-   do by keeping a cyclic list (prevKeys) of the LoopLength previous keys.
-   keyPos points to the next position in which we will insert a key; once
-   the list has cycled once, it is also the position of the N-LoopLength
-   key. 
+   sprintf(filename, "%s%s", dbfile, CADB_KEY_EXT);
+   if((gKeyFp = fopen(filename, "rb"))==NULL)
+      return;
 
-   We depend on the fact that the main database file contains records in 
-   the correct order of the atoms!
+   if((err = CADBReadKeyHeader(gKeyFp, &gKeyHeader, &gHeader)) 
+      != CADB_OK)
+   {
+      fprintf(stderr,"Warning: %s: %s. Key index not used\n",
+              CADBError(err), filename);
+      fclose(gKeyFp);
+      gKeyFp = NULL;
+   }
+}
 
-   Allocates memory for the prevKeys array and distances array. Steps 
-   through the database file parsing in the set of distances. Checks
-   if the +ve constraints are OK and if so stashes this identifier in
-   a DBM hash. Once we've got enough records, then checks the -ve
-   constraints and if these fail, finds the beginning of the loop from
-   the prevKeys cyclic array and then deletes this key from the DBM hash.
 
-   08.10.98 Original   By: ACRM
+/************************************************************************/
+/*>void CloseDatabase(FILE *DBfp)
+   ------------------------------
+   Inputs:     FILE   *DBfp       Database file pointer
+   Globals:    FILE   *gIndexFp   The range index file pointer
+               uint32_t *gIndexBins  Bin directory of the range index
+               FILE   *gKeyFp     The key index file pointer
+
+   Closes a database opened by OpenDatabase() along with its range and
+   key indexes so that another may be opened.
+
+   16.10.26 Original   By: ACRM
 */
-BOOL RunSearch(FILE *DBfp, int ndist, FILE *out)
+void CloseDatabase(FILE *DBfp)
 {
-   char *buffer    = NULL,
-        **prevKeys = NULL,
-        currentKey[16];
-   int  bufferSize,
-        keyPos     = 0;
-   REAL *distArray = NULL;
-   BOOL Cycled     = FALSE;
-
-   /* Allocate string array to store the cycle of previous keys         */
-   if((prevKeys = (char**)Array2D(sizeof(char),gLoopLength,16))==NULL)
+   fclose(DBfp);
+   if(gIndexFp != NULL)
    {
-      fprintf(stderr,"No memory for previous key array\n");
-      return(FALSE);
+      fclose(gIndexFp);
+      gIndexFp = NULL;
    }
-   
-   /* buffer is used to store lines read from the database file         */
-   bufferSize = (2 * ndist * 7) + 100;
-   if((buffer=(char *)malloc(bufferSize * sizeof(char)))==NULL)
+   if(gIndexBins != NULL)
    {
-      FreeArray2D(prevKeys,gLoopLength,16);
-      fprintf(stderr,"No memory for buffer to read database file\n");
-      return(FALSE);
+      free(gIndexBins);
+      gIndexBins = NULL;
    }
+   if(gKeyFp != NULL)
+   {
+      fclose(gKeyFp);
+      gKeyFp = NULL;
+   }
+}
 
-   /* distArray stores the distances parsed oyt of the database file    */
-   if((distArray=(REAL *)malloc(2*ndist*sizeof(REAL)))==NULL)
+
+/************************************************************************/
+/*>int ReadShardManifest(char *filename)
+   -------------------------------------
+   Inputs:     char   *filename   Database file
+   Returns:    int                Number of shards, 0 if this is not a
+                                  shard manifest or -1 on error
+   Globals:    char   gShards     The shard filenames
+               int    gNShards    Number of shards
+
+   Checks whether the database is a shard manifest written by
+   makecadb -shards and, if so, reads the list of shards. Shards are
+   relative to the directory containing the manifest.
+
+   16.10.26 Original   By: ACRM
+*/
+int ReadShardManifest(char *filename)
+{
+   FILE *fp;
+   char buffer[MAXBUFF],
+        shard[MAXBUFF],
+        *slash;
+   int  dirlen = 0;
+
+   if((fp=fopen(filename,"r"))==NULL)
+      return(0);
+
+   if(!fgets(buffer,MAXBUFF,fp) ||
+      strncmp(buffer,CADB_SHARD_MAGIC,strlen(CADB_SHARD_MAGIC)))
    {
-      FreeArray2D(prevKeys,gLoopLength,16);
-      fprintf(stderr,"No memory for distance array\n");
-      free(buffer);
-      return(FALSE);
+      fclose(fp);
+      return(0);
    }
 
-   while(fgets(buffer,bufferSize,DBfp))
+   if((slash = strrchr(filename,'/'))!=NULL)
+      dirlen = (int)(slash - filename) + 1;
+
+   gNShards = 0;
+   while(fgets(buffer,MAXBUFF,fp))
    {
-      TERMINATE(buffer);
-      if((buffer[0] == '!') ||
-         (buffer[0] == '#') ||
-         !strlen(buffer))
+      if(sscanf(buffer,"%s",shard) != 1)
          continue;
 
-      sscanf(buffer,"%s",currentKey);
-      strcpy(prevKeys[keyPos],currentKey);
-      if(++keyPos >= gLoopLength)
+      if(gNShards >= MAXSHARDS)
       {
-         keyPos = 0;
-         Cycled = TRUE;
+         fprintf(stderr,"Too many shards in %s\n",filename);
+         fclose(fp);
+         return(-1);
       }
-
-      ReadArrayFromBuffer(buffer,ndist,distArray);
-
-      if(RecordOK(distArray, 0, gPosConsList))
+      if((shard[0] == '/') || !dirlen)
       {
-         FlagPosOK(currentKey);
+         strcpy(gShards[gNShards], shard);
       }
-      if(Cycled)
+      else if(dirlen + strlen(shard) < MAXBUFF)
       {
-         if(InSameChain(currentKey, prevKeys[keyPos]))
-         {
-            if(!RecordOK(distArray, ndist, gNegConsList))
+         strncpy(gShards[gNShards], filename, dirlen);
+         strcpy(gShards[gNShards]+dirlen, shard);
+      }
+      else
+      {
+         fprintf(stderr,"Shard filename too long: %s\n",shard);
+         fclose(fp);
+         return(-1);
+      }
+      gNShards++;
+   }
+   fclose(fp);
+
+   if(!gNShards)
+   {
+      fprintf(stderr,"No shards listed in %s\n",filename);
+      return(-1);
+   }
+   return(gNShards);
+}
+
+
+/************************************************************************/
+/*>BOOL RunShardedSearch(FILE *out)
+   --------------------------------
+   Inputs:     FILE    *out        Output file pointer
+   Returns:    BOOL                Success?
+   Globals:    char    gShards     The shard filenames
+               int     gNShards    Number of shards
+               int     gMaxProcs   Maximum number of processes
+
+   Searches each shard in a child process. The children write their
+   hits to temporary files; once they have all finished, the hits are
+   merged into the DBM hash and displayed. Since a PDB file is never
+   split between shards, the hits are the same as from searching a
+   single database. For COUNT, each child writes its count instead and
+   these are summed.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added COUNT
+*/
+BOOL RunShardedSearch(FILE *out)
+{
+   FILE  *results[MAXSHARDS];
+   pid_t pids[MAXSHARDS],
+         pid;
+   char  buffer[MAXBUFF];
+   unsigned long long nhits;
+   int   nprocs  = ((gMaxProcs > 0) ? gMaxProcs : gNShards),
+         nextShard = 0,
+         nrunning  = 0,
+         status,
+         i;
+   BOOL  ok = TRUE;
+
+   for(i=0; i<gNShards; i++)
+      results[i] = NULL;
+
+   fflush(out);
+   fflush(stderr);
+
+   while((ok && (nextShard < gNShards)) || nrunning)
+   {
+      /* Start as many children as are allowed                          */
+      while(ok && (nextShard < gNShards) && (nrunning < nprocs))
+      {
+         i = nextShard++;
+         if((results[i] = tmpfile())==NULL)
+         {
+            fprintf(stderr,"Unable to create results file for %s\n",
+                    gShards[i]);
+            ok = FALSE;
+            break;
+         }
+         if((pids[i] = fork()) < 0)
+         {
+            fprintf(stderr,"Unable to start search of %s\n", gShards[i]);
+            ok = FALSE;
+            break;
+         }
+         if(pids[i] == 0)
+            _exit(SearchShard(gShards[i], results[i]) ? 0 : 1);
+         nrunning++;
+      }
+      if(!nrunning)
+         break;
+
+      /* Wait for one to finish                                         */
+      if((pid = wait(&status)) < 0)
+         break;
+      for(i=0; i<nextShard; i++)
+      {
+         if(pids[i] == pid)
+         {
+            nrunning--;
+            if(!WIFEXITED(status) || WEXITSTATUS(status))
+            {
+               fprintf(stderr,"Search of %s failed\n", gShards[i]);
+               ok = FALSE;
+            }
+            break;
+         }
+      }
+   }
+
+   /* Merge the hits                                                    */
+   for(i=0; i<nextShard; i++)
+   {
+      if(results[i] == NULL)
+         continue;
+      if(ok)
+      {
+         rewind(results[i]);
+         while(fgets(buffer,MAXBUFF,results[i]))
+         {
+            TERMINATE(buffer);
+            if(gCountOnly)
+            {
+               if(sscanf(buffer,"COUNT %llu",&nhits) == 1)
+                  gNHits += (uint64_t)nhits;
+            }
+            else if(buffer[0])
             {
-               FlagNegBad(prevKeys[keyPos]);
+               FlagPosOK(buffer);
             }
          }
       }
+      fclose(results[i]);
+   }
+
+   if(ok)
+      DisplayResults(out);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL SearchShard(char *filename, FILE *out)
+   -------------------------------------------
+   Inputs:     char    *filename   Shard database file
+               FILE    *out        File to which hits are written
+   Returns:    BOOL                Success?
+
+   Runs the search on one shard in a child process. The child has its
+   own DBM hash.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL SearchShard(char *filename, FILE *out)
+{
+   FILE *DBfp;
+   char dbmFile[80];
+   int  ndist = 20;
+   BOOL ok;
+
+   if((DBfp = OpenDatabase(filename, &ndist))==NULL)
+      return(FALSE);
+
+   if(!OpenDBMHash(dbmFile))
+   {
+      fprintf(stderr,"Can't open DBM file for writing\n");
+      fclose(DBfp);
+      return(FALSE);
+   }
+
+   ok = RunSearch(DBfp, ndist, out);
+   if(fflush(out))
+      ok = FALSE;
+
+   CloseDBMHash(dbmFile);
+   fclose(DBfp);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>void ReadTextHeader(FILE *DBfp, int *ndist)
+   -------------------------------------------
+   Inputs:     FILE   *DBfp      Text database file pointer
+   I/O:        int    *ndist     Number of distances (unchanged if not
+                                 specified in the header)
+   Globals:    BOOL   gForward   Set if the database only contains the
+                                 forward distances
+               BOOL   gAngles    Set if the database contains the CA
+                                 angles and torsions
+               BOOL   gSequence  Set if the database contains the 
+                                 residue types
+
+   Reads the header lines (those starting with a !) from a text 
+   database. The file is left positioned at the first record.
+
+   16.10.26 Original (split from ParseInputFile())   By: ACRM
+   16.10.26 Added !ANGLES
+   16.10.26 Added !SEQUENCE
+*/
+void ReadTextHeader(FILE *DBfp, int *ndist)
+{
+   char  buffer[MAXBUFF];
+   off_t pos = ftello(DBfp);
+
+   while(fgets(buffer,MAXBUFF,DBfp))
+   {
+      TERMINATE(buffer);
+      if(!strncmp(buffer,"!NDIST",6))
+      {
+         sscanf(buffer+6,"%d",ndist);
+      }
+      else if(!strncmp(buffer,"!FORWARD",8))
+      {
+         gForward = TRUE;
+      }
+      else if(!strncmp(buffer,"!ANGLES",7))
+      {
+         gAngles = TRUE;
+      }
+      else if(!strncmp(buffer,"!SEQUENCE",9))
+      {
+         gSequence = TRUE;
+      }
+      else if((buffer[0] != '!') && (buffer[0] != '\0'))
+      {
+         fseeko(DBfp, pos, SEEK_SET);
+         break;
+      }
+      pos = ftello(DBfp);
+   }
+}
+
+
+/************************************************************************/
+/*>BOOL StorePosConstraint(int cons, REAL mindist, REAL maxdist)
+   -------------------------------------------------------------
+   Inputs:     int        cons          Constraint number
+               REAL       mindist       Minimum distance
+               REAL       maxdist       Maximum distance
+   Returns:    BOOL                     Success?
+   Globals:    CONSTRAINT gPosConsList  +ve constraints linked list
+
+   Store a positive distance constraint in the linked list.
+
+   08.10.98 Original   By: ACRM
+   16.10.26 Also sets the integer bounds
+*/
+BOOL StorePosConstraint(int cons, REAL mindist, REAL maxdist)
+{
+   static CONSTRAINT *c;
+   
+   if(gPosConsList==NULL)
+   {
+      INIT(gPosConsList, CONSTRAINT);
+      c = gPosConsList;
+   }
+   else
+   {
+      ALLOCNEXT(c, CONSTRAINT);
+   }
+
+   if(c==NULL)
+   {
+      if(gPosConsList)
+         FREELIST(gPosConsList, CONSTRAINT);
+      return(FALSE);
+   }
+   
+   c->cons = cons;
+   c->min  = mindist;
+   c->max  = maxdist;
+   SetIntegerBounds(c);
+   
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>BOOL StoreNegConstraint(int cons, REAL mindist, REAL maxdist)
+   -------------------------------------------------------------
+   Inputs:     int        cons          Constraint number
+               REAL       mindist       Minimum distance
+               REAL       maxdist       Maximum distance
+   Returns:    BOOL                     Success?
+   Globals:    CONSTRAINT gNegConsList  -ve constraints linked list
+
+   Store a negative distance constraint in the linked list.
+
+   08.10.98 Original   By: ACRM
+   16.10.26 Also sets the integer bounds
+*/
+BOOL StoreNegConstraint(int cons, REAL mindist, REAL maxdist)
+{
+   static CONSTRAINT *c;
+   
+   if(gNegConsList==NULL)
+   {
+      INIT(gNegConsList, CONSTRAINT);
+      c = gNegConsList;
+   }
+   else
+   {
+      ALLOCNEXT(c, CONSTRAINT);
+   }
+
+   if(c==NULL)
+   {
+      if(gNegConsList)
+         FREELIST(gNegConsList, CONSTRAINT);
+      return(FALSE);
+   }
+   
+   c->cons = cons;
+   c->min  = mindist;
+   c->max  = maxdist;
+   SetIntegerBounds(c);
+   
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>BOOL StoreAngleConstraint(CONSTRAINT **ConsList, int pos, REAL min, 
+                             REAL max, BOOL torsion)
+   -------------------------------------------------------------------
+   I/O:        CONSTRAINT **ConsList    Linked list of constraints
+   Inputs:     int        pos           Position in the loop
+               REAL       min           Minimum angle
+               REAL       max           Maximum angle
+               BOOL       torsion       Is this a torsion?
+   Returns:    BOOL                     Success?
+
+   Store an ANGLE or TORSION constraint in a linked list.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL StoreAngleConstraint(CONSTRAINT **ConsList, int pos, REAL min, 
+                          REAL max, BOOL torsion)
+{
+   CONSTRAINT *c;
+   
+   if(*ConsList==NULL)
+   {
+      INIT(c, CONSTRAINT);
+      *ConsList = c;
+   }
+   else
+   {
+      for(c=*ConsList; c->next!=NULL; NEXT(c));
+      ALLOCNEXT(c, CONSTRAINT);
+   }
+
+   if(c==NULL)
+   {
+      if(*ConsList)
+         FREELIST(*ConsList, CONSTRAINT);
+      return(FALSE);
+   }
+   
+   c->cons = pos;
+   c->min  = min;
+   c->max  = max;
+   SetAngleBounds(c, torsion);
+   
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>void SetAngleBounds(CONSTRAINT *c, BOOL torsion)
+   ------------------------------------------------
+   I/O:        CONSTRAINT *c       An ANGLE or TORSION constraint
+   Inputs:     BOOL       torsion  Is this a torsion?
+
+   Converts the minimum and maximum angles to the hundredths of a 
+   degree stored in the database. A torsion range runs upwards from the
+   minimum to the maximum, so TORSION 1 170 -170 is the range through
+   180. The bounds are mapped into 0..360 and lo is greater than hi if
+   the range wraps through 0. A range of 360 or more accepts any 
+   torsion.
+
+   16.10.26 Original   By: ACRM
+*/
+void SetAngleBounds(CONSTRAINT *c, BOOL torsion)
+{
+   REAL min = c->min,
+        max = c->max,
+        lo,
+        hi;
+
+   if(torsion)
+   {
+      if(max - min >= 360.0)
+      {
+         c->lo = 0;
+         c->hi = 36000;
+         return;
+      }
+      if((min = fmod(min, 360.0)) < 0.0) min += 360.0;
+      if((max = fmod(max, 360.0)) < 0.0) max += 360.0;
+   }
+
+   lo = ceil(min  * CADB_SCALE - 1.0e-6);
+   hi = floor(max * CADB_SCALE + 1.0e-6);
+
+   c->lo = (lo < 0.0) ? 0 : ((lo > CADB_MAXDIST) ? CADB_MAXDIST+1 :
+                             (int)lo);
+   c->hi = (hi < 0.0) ? -1 : ((hi > CADB_MAXDIST) ? CADB_MAXDIST :
+                              (int)hi);
+   if(torsion)
+   {
+      if(c->lo >= 36000) c->lo -= 36000;
+      if(c->hi >= 36000) c->hi -= 36000;
+   }
+   c->missingOK = FALSE;
+}
+
+/************************************************************************/
+/*>BOOL CheckAngleConstraints(void)
+   --------------------------------
+   Returns:    BOOL                Constraints OK?
+   Globals:    CONSTRAINT *gAngleConsList    ANGLE constraints
+               CONSTRAINT *gTorsionConsList  TORSION constraints
+               BOOL       gAngles            Database has angles?
+
+   Checks that the database has the CA angles if there are any ANGLE or
+   TORSION constraints and that each refers to a position within the
+   loop.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL CheckAngleConstraints(void)
+{
+   CONSTRAINT *c;
+   int        i;
+
+   if(((gAngleConsList != NULL) || (gTorsionConsList != NULL)) &&
+      !gAngles)
+   {
+      fprintf(stderr,"ANGLE and TORSION require a database built with \
+makecadb -a\n");
+      return(FALSE);
+   }
+   
+   for(i=0; i<2; i++)
+   {
+      for(c=(i ? gTorsionConsList : gAngleConsList); c!=NULL; NEXT(c))
+      {
+         if((c->cons < 1) || (c->cons > gLoopLength))
+         {
+            fprintf(stderr,"%s position %d is outside the loop \
+(1..%d)\n", (i ? "TORSION" : "ANGLE"), c->cons, gLoopLength);
+            return(FALSE);
+         }
+      }
+   }
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>BOOL ParseSeqPattern(char *pattern, BOOL *allowed)
+   --------------------------------------------------
+   Inputs:     char   *pattern    One-letter residue types, optionally
+                                  preceded by ^
+   Outputs:    BOOL   *allowed    Flags for each residue type A to Z
+   Returns:    BOOL               Valid pattern?
+
+   Converts the pattern given to SEQ into flags for the residue types
+   which are allowed. The pattern is the list of allowed types (e.g.
+   GP) or, if it starts with ^, the list of types which are not
+   allowed. Case is ignored.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL ParseSeqPattern(char *pattern, BOOL *allowed)
+{
+   BOOL negate = FALSE;
+   int  i;
+
+   if(*pattern == '^')
+   {
+      negate = TRUE;
+      pattern++;
+   }
+   if(*pattern == '\0')
+      return(FALSE);
+   
+   for(i=0; i<26; i++)
+      allowed[i] = negate;
+
+   for(; *pattern; pattern++)
+   {
+      if(!isalpha(*pattern))
+         return(FALSE);
+      allowed[toupper(*pattern) - 'A'] = !negate;
+   }
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>BOOL StoreSeqConstraint(int pos, BOOL *allowed)
+   -----------------------------------------------
+   Inputs:     int        pos           Position in the loop
+               BOOL       *allowed      Flags for the allowed residue
+                                        types
+   Returns:    BOOL                     Success?
+   Globals:    SEQCONS    gSeqConsList  SEQ constraints linked list
+
+   Store a SEQ constraint in the linked list.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL StoreSeqConstraint(int pos, BOOL *allowed)
+{
+   static SEQCONS *s;
+   
+   if(gSeqConsList==NULL)
+   {
+      INIT(gSeqConsList, SEQCONS);
+      s = gSeqConsList;
+   }
+   else
+   {
+      ALLOCNEXT(s, SEQCONS);
+   }
+
+   if(s==NULL)
+   {
+      if(gSeqConsList)
+         FREELIST(gSeqConsList, SEQCONS);
+      return(FALSE);
+   }
+   
+   s->pos = pos;
+   memcpy(s->allowed, allowed, 26*sizeof(BOOL));
+   
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>BOOL CheckSeqConstraints(void)
+   ------------------------------
+   Returns:    BOOL                Constraints OK?
+   Globals:    SEQCONS    *gSeqConsList  SEQ constraints
+               BOOL       gSequence      Database has residue types?
+
+   Checks that the database has the residue types if there are any SEQ
+   constraints and that each refers to a position within the loop.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL CheckSeqConstraints(void)
+{
+   SEQCONS *s;
+
+   if((gSeqConsList != NULL) && !gSequence)
+   {
+      fprintf(stderr,"SEQ requires a database with residue types \
+(rebuild it with makecadb -s)\n");
+      return(FALSE);
+   }
+   
+   for(s=gSeqConsList; s!=NULL; NEXT(s))
+   {
+      if((s->pos < 1) || (s->pos > gLoopLength))
+      {
+         fprintf(stderr,"SEQ position %d is outside the loop (1..%d)\n",
+                 s->pos, gLoopLength);
+         return(FALSE);
+      }
+   }
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>BOOL RunSearch(FILE *DBfp, int ndist, FILE *out)
+   ------------------------------------------------
+   Inputs:     FILE    *DBfp       Database file pointer
+               int     ndist       Number of distance constraints in file
+               FILE    *out        Output file pointer
+   Returns:    BOOL                Success?
+
+   Actually runs the search. 
+
+   Checking DP constraints is easy!
+
+   For DM constraints we need to update the N-LoopLength record. This we
+   do by keeping a cyclic list (prevKeys) of the previous keys. keyPos 
+   points to the next position in which we will insert a key; once
+   the list has cycled once, the key LoopLength-1 before the current
+   one is the start of the loop.
+
+   For a forward-only database, the cyclic list is made long enough to
+   hold the previous ndist records and the DP distances of each record 
+   are kept alongside the keys (prevDists) so that the DM distances can
+   be reconstructed by ReconstructDM().
+
+   We depend on the fact that the main database file contains records in 
+   the correct order of the atoms!
+
+   Allocates memory for the prevKeys array and distances array. Steps 
+   through the database file parsing in the set of distances. Checks
+   if the +ve constraints are OK and if so stashes this identifier in
+   a DBM hash. Once we've got enough records, then checks the -ve
+   constraints and if these fail, finds the beginning of the loop from
+   the prevKeys cyclic array and then deletes this key from the DBM hash.
+
+   If the database has the CA angles, these follow the distances of
+   each record and are tested by CheckTextAngles() in the same way as
+   the DM constraints. Likewise, if the database has the residue types,
+   the type is the last word of each record and is tested against the
+   SEQ constraints by CheckTextSequence().
+
+   A record is only stored as a hit if its chain is selected by the
+   INCLUDE and EXCLUDE lists (if any).
+
+   Binary databases are handed over to RunBinarySearch()
+
+   08.10.98 Original   By: ACRM
+   16.10.26 Added binary databases and forward-only databases
+   16.10.26 Keys may be up to CADB_MAXKEY characters
+   16.10.26 Added ANGLE and TORSION
+   16.10.26 Added SEQ
+   16.10.26 Added INCLUDE and EXCLUDE
+   16.10.26 The residue type is now at the end of the record
+*/
+BOOL RunSearch(FILE *DBfp, int ndist, FILE *out)
+{
+   char *buffer     = NULL,
+        **prevKeys  = NULL,
+        currentKey[CADB_MAXKEY],
+        restype     = ' ',
+        *chp;
+   int  bufferSize,
+        ringSize    = gLoopLength,
+        keyPos      = 0,
+        thisPos,
+        startPos,
+        nval        = (gForward ? ndist : 2*ndist),
+        nread       = 0;
+   REAL *distArray  = NULL,
+        **prevDists = NULL,
+        angles[2];
+
+   if(gBinary)
+      return(RunBinarySearch(DBfp, out));
+
+   if(!CheckAngleConstraints() || !CheckSeqConstraints())
+      return(FALSE);
+
+   if(gForward && (ringSize < ndist+1))
+      ringSize = ndist+1;
+
+   /* Allocate string array to store the cycle of previous keys         */
+   if((prevKeys = (char**)Array2D(sizeof(char),ringSize,CADB_MAXKEY))==NULL)
+   {
+      fprintf(stderr,"No memory for previous key array\n");
+      return(FALSE);
+   }
+
+   /* And the previous DP distances for a forward-only database         */
+   if(gForward &&
+      ((prevDists = (REAL **)Array2D(sizeof(REAL),ringSize,ndist))==NULL))
+   {
+      FreeArray2D(prevKeys,ringSize,CADB_MAXKEY);
+      fprintf(stderr,"No memory for previous distance array\n");
+      return(FALSE);
+   }
+   
+   /* buffer is used to store lines read from the database file         */
+   bufferSize = (2 * ndist * 7) + (gAngles ? 14 : 0) + 
+                (gSequence ? 2 : 0) + 100;
+   if((buffer=(char *)malloc(bufferSize * sizeof(char)))==NULL)
+   {
+      FreeArray2D(prevKeys,ringSize,CADB_MAXKEY);
+      if(prevDists != NULL)
+         FreeArray2D((char **)prevDists,ringSize,ndist);
+      fprintf(stderr,"No memory for buffer to read database file\n");
+      return(FALSE);
+   }
+
+   /* distArray stores the distances parsed oyt of the database file    */
+   if((distArray=(REAL *)malloc((2*ndist+2)*sizeof(REAL)))==NULL)
+   {
+      FreeArray2D(prevKeys,ringSize,CADB_MAXKEY);
+      if(prevDists != NULL)
+         FreeArray2D((char **)prevDists,ringSize,ndist);
+      fprintf(stderr,"No memory for distance array\n");
+      free(buffer);
+      return(FALSE);
+   }
+
+   while(fgets(buffer,bufferSize,DBfp))
+   {
+      TERMINATE(buffer);
+      if((buffer[0] == '!') ||
+         (buffer[0] == '#') ||
+         !strlen(buffer))
+         continue;
+
+      sscanf(buffer,"%s",currentKey);
+      if(gSequence)
+      {
+         /* The residue type is the last word of the record            */
+         chp = buffer + strlen(buffer) - 1;
+         while((chp > buffer) && (*chp == ' '))
+            chp--;
+         restype = *chp;
+      }
+      thisPos = keyPos;
+      strcpy(prevKeys[keyPos],currentKey);
+      if(++keyPos >= ringSize)
+         keyPos = 0;
+      nread++;
+
+      ReadArrayFromBuffer(buffer,(gAngles ? nval+2 : nval),distArray);
+      if(gAngles)
+      {
+         angles[0] = distArray[nval];
+         angles[1] = distArray[nval+1];
+      }
+      if(gForward)
+      {
+         ReconstructDM(distArray, ndist, currentKey, prevKeys, prevDists,
+                       thisPos, ringSize, nread);
+      }
+
+      if(RecordOK(distArray, 0, gPosConsList) && KeySelected(currentKey))
+      {
+         FlagPosOK(currentKey);
+      }
+      if(nread >= gLoopLength)
+      {
+         startPos = (thisPos - (gLoopLength-1) + ringSize) % ringSize;
+         if(InSameChain(currentKey, prevKeys[startPos]))
+         {
+            if(!RecordOK(distArray, ndist, gNegConsList))
+            {
+               FlagNegBad(prevKeys[startPos]);
+            }
+         }
+      }
+      if(gAngles)
+      {
+         CheckTextAngles(angles, currentKey, prevKeys, thisPos, ringSize,
+                         nread);
+      }
+      if(gSeqConsList != NULL)
+      {
+         CheckTextSequence(restype, currentKey, prevKeys, thisPos, 
+                           ringSize, nread);
+      }
+   }
+
+   /* Display the flagged records                                       */
+   DisplayResults(out);
+
+   FreeArray2D(prevKeys,ringSize,CADB_MAXKEY);
+   if(prevDists != NULL)
+      FreeArray2D((char **)prevDists,ringSize,ndist);
+   free(distArray);
+   free(buffer);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void ReconstructDM(REAL *distArray, int ndist, char *currentKey, 
+                      char **prevKeys, REAL **prevDists, int keyPos, 
+                      int ringSize, int nread)
+   ----------------------------------------------------------------
+   I/O:        REAL  *distArray   On input, the DP distances for this
+                                  record. On output the DM distances 
+                                  have been added
+   Inputs:     int   ndist        Number of distances in the database
+               char  *currentKey  Key for this record
+               char  **prevKeys   Cyclic list of previous keys
+               REAL  **prevDists  Cyclic list of previous DP distances
+               int   keyPos       Position of this record in the lists
+               int   ringSize     Size of the cyclic lists
+               int   nread        Number of records read so far
+
+   For a forward-only database, stores the DP distances for this record
+   in the cyclic list and fills in the DM distances. The DM distance at
+   offset k is the DP distance at offset k of the record k before this
+   one (or -1 if that is not in the same chain).
+
+   16.10.26 Original   By: ACRM
+*/
+void ReconstructDM(REAL *distArray, int ndist, char *currentKey, 
+                   char **prevKeys, REAL **prevDists, int keyPos, 
+                   int ringSize, int nread)
+{
+   int k,
+       pos;
+
+   memcpy(prevDists[keyPos], distArray, ndist*sizeof(REAL));
+   
+   for(k=1; k<=ndist; k++)
+   {
+      pos = (keyPos - k + ringSize) % ringSize;
+      if((k < nread) && InSameChain(currentKey, prevKeys[pos]))
+         distArray[ndist+k-1] = prevDists[pos][k-1];
+      else
+         distArray[ndist+k-1] = (-1.0);
+   }
+}
+
+
+/************************************************************************/
+/*>void SetIntegerBounds(CONSTRAINT *c)
+   ------------------------------------
+   I/O:        CONSTRAINT *c       A constraint
+
+   Converts the minimum and maximum distances to the fixed point units
+   used in the binary database. A stored distance, d, satisfies the 
+   constraint if lo <= d <= hi, which is the same test as is applied
+   to the 2 decimal place distances in the text database.
+
+   For coordinate databases, the equivalent bounds on the squared
+   distance are also set. A distance rounds to lo or more hundredths if
+   it is at least (lo-0.5)/100 and rounds to hi or fewer hundredths if
+   it is less than (hi+0.5)/100.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added lo2 and hi2
+*/
+void SetIntegerBounds(CONSTRAINT *c)
+{
+   REAL lo = ceil(c->min  * CADB_SCALE - 1.0e-6),
+        hi = floor(c->max * CADB_SCALE + 1.0e-6);
+
+   c->lo = (lo < 0.0) ? 0 : ((lo > CADB_MAXDIST) ? CADB_MAXDIST+1 :
+                             (int)lo);
+   c->hi = (hi < 0.0) ? -1 : ((hi > CADB_MAXDIST) ? CADB_MAXDIST :
+                              (int)hi);
+   c->missingOK = ((c->min <= -1.0) && (c->max >= -1.0));
+
+   lo = (c->lo > 0) ? (c->lo - 0.5) / CADB_SCALE : 0.0;
+   hi = (c->hi + 0.5) / CADB_SCALE;
+   c->lo2 = (c->lo > 0) ? (float)(lo * lo) : (float)(-1.0);
+   c->hi2 = (c->hi >= 0) ? (float)(hi * hi) : (float)(-1.0);
+}
+
+
+/************************************************************************/
+/*>BOOL RunBinarySearch(FILE *DBfp, FILE *out)
+   -------------------------------------------
+   Inputs:     FILE    *DBfp       Database file pointer
+               FILE    *out        Output file pointer
+   Returns:    BOOL                Success?
+   Globals:    CADBHEADER gHeader  Header of the database
+
+   Runs the search on a binary database. The chain table is read and 
+   each chain block is read in turn. Since the whole chain is in memory,
+   the DM constraints are simply checked on the residue gLoopLength-1 
+   further along the chain rather than needing the cycle of previous
+   keys used by RunSearch(). As with the text search, a loop which 
+   would extend beyond the end of the chain is only tested against the
+   DP constraints. Hits are stored in the DBM hash so that the results 
+   are displayed in the same way as for a text database. For COUNT, the
+   hits are simply counted in gNHits so neither the residue identifiers
+   nor the DBM hash are touched.
+
+   If there is a loop window table (makecadb -w) for gLoopLength, the
+   search is handed to RunWindowSearch() instead and the chain blocks
+   are not read at all.
+
+   SEQ constraints are tested first from the residue identifiers, then
+   ANGLE and TORSION constraints from the angle block at the end of 
+   each chain (or from the coordinates) so that the distances are not
+   read for a chain where no loop satisfies them. The window tables do
+   not hold the residue types or angles so are not used.
+
+   With INCLUDE or EXCLUDE, SelectChains() flags the chains to be 
+   searched and only their chain blocks (or window table rows) are 
+   read.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added column layout and forward-only databases
+   16.10.26 Added coordinate databases. Hits for a chain are now found
+            by FindDistanceHits() or FindCoordHits()
+   16.10.26 Added quantized databases
+   16.10.26 Hits are also reported for the aliases of each chain
+   16.10.26 Chains with no candidates in the range index are skipped
+   16.10.26 For COUNT, hits are counted rather than stored
+   16.10.26 Uses a loop window table if there is one
+   16.10.26 Added ANGLE and TORSION
+   16.10.26 Added SEQ
+   16.10.26 Added INCLUDE and EXCLUDE
+*/
+BOOL RunBinarySearch(FILE *DBfp, FILE *out)
+{
+   FILE      *winFp;
+   CADBWINDOWHEADER win;
+   CADBCHAIN *chains,
+             aliasChain;
+   CADBALIAS *aliases  = NULL;
+   CHAINDATA data;
+   uint64_t  *candidates = NULL;
+   unsigned char *selected = NULL;
+   uint64_t  chainNum,
+             naliases  = 0,
+             nextAlias = 0,
+             firstAlias,
+             a;
+   int       ndist  = (int)gHeader.ndist,
+             ncol   = (gForward ? ndist : 2*ndist),
+             res;
+   BOOL      coords = (gHeader.layout == CADB_LAYOUT_COORD),
+             quant  = (gHeader.layout == CADB_LAYOUT_QUANT),
+             angleCons = ((gAngleConsList != NULL) || 
+                          (gTorsionConsList != NULL)),
+             seqCons   = (gSeqConsList != NULL),
+             self,
+             ok;
+   char      key[CADB_MAXKEY];
+
+   if(!CheckConstraints(gPosConsList, ndist) || 
+      !CheckConstraints(gNegConsList, ndist) ||
+      !CheckAngleConstraints() ||
+      !CheckSeqConstraints())
+      return(FALSE);
+
+   if((chains = CADBReadChainTable(DBfp, &gHeader))==NULL)
+   {
+      fprintf(stderr,"Unable to read chain table from database\n");
+      return(FALSE);
+   }
+
+   /* The aliases are sorted by the chain that they duplicate so that
+      those for each chain are together
+   */
+   if(gHeader.flags & CADB_FLAG_ALIASES)
+   {
+      if((aliases = CADBReadAliases(DBfp, &gHeader, &naliases))==NULL)
+      {
+         fprintf(stderr,"Unable to read alias table from database\n");
+         free(chains);
+         return(FALSE);
+      }
+      qsort(aliases, naliases, sizeof(CADBALIAS), CompareAliases);
+   }
+   memset(&aliasChain, 0, sizeof(CADBCHAIN));
+
+   if((gInclude.active || gExclude.active) &&
+      ((selected = SelectChains(chains, aliases, &naliases))==NULL))
+   {
+      fprintf(stderr,"No memory for chain selection\n");
+      free(chains);
+      if(aliases != NULL) free(aliases);
+      return(FALSE);
+   }
+
+   if(gIndexFp != NULL)
+      candidates = IndexCandidates(chains);
+
+   if(!coords && !angleCons && !seqCons && gUseWindows && 
+      ((winFp = OpenWindowTable(&win))!=NULL))
+   {
+      ok = RunWindowSearch(DBfp, winFp, &win, chains, aliases, naliases,
+                           candidates, selected);
+      fclose(winFp);
+      free(chains);
+      if(aliases != NULL) free(aliases);
+      if(candidates != NULL) free(candidates);
+      if(selected != NULL) free(selected);
+      if(ok)
+         DisplayResults(out);
+      return(ok);
+   }
+
+   memset(&data, 0, sizeof(CHAINDATA));
+   if(!coords &&
+      ((data.cols = ConstrainedColumns(ndist, &(data.ncols)))==NULL))
+   {
+      fprintf(stderr,"No memory for column list\n");
+      free(chains);
+      if(aliases != NULL) free(aliases);
+      if(candidates != NULL) free(candidates);
+      if(selected != NULL) free(selected);
+      return(FALSE);
+   }
+
+   for(chainNum=0; chainNum<gHeader.nchains; chainNum++)
+   {
+      firstAlias = nextAlias;
+      while((nextAlias < naliases) && 
+            (aliases[nextAlias].target <= chainNum))
+         nextAlias++;
+
+      if(!ChainWanted(candidates, selected, chains, chainNum))
+         continue;
+
+      /* Whether hits are reported for the chain as well as its aliases */
+      self = ((selected == NULL) || (selected[chainNum] & SEL_CHAIN));
+
+      ok = TRUE;
+      if(seqCons)
+      {
+         if((ok = AllocChainData(&data, (int)chains[chainNum].nres, 
+                                 (coords ? 3 : ncol))))
+         {
+            data.residsRead = FALSE;
+            ok = ReadResids(DBfp, &(chains[chainNum]), &data);
+         }
+         
+         if(ok && !FindSeqHits(&data))
+            continue;
+      }
+      if(ok && angleCons)
+      {
+         if(coords)
+         {
+            if((ok = ReadCoordBlock(DBfp, &(chains[chainNum]), &data)))
+               CalcCoordAngles(&data);
+         }
+         else
+         {
+            ok = ReadAngleBlock(DBfp, &(chains[chainNum]), ncol, &data);
+         }
+         
+         if(ok && !FindAngleHits(&data))
+            continue;
+      }
+      
+      /* The coordinates have already been read for the angles       */
+      if(ok && !(coords && angleCons))
+      {
+         if(coords)
+            ok = ReadCoordBlock(DBfp, &(chains[chainNum]), &data);
+         else if(quant)
+            ok = ReadQuantBlock(DBfp, &(chains[chainNum]), ncol, &data);
+         else
+            ok = ReadChainBlock(DBfp, &(chains[chainNum]), ncol, &data);
+      }
+      if(seqCons)
+         data.residsRead = TRUE;
+      
+      if(!ok)
+      {
+         fprintf(stderr,"Error reading chain %s.%s from database\n",
+                 chains[chainNum].pdbcode, chains[chainNum].chain);
+         free(chains);
+         if(aliases != NULL) free(aliases);
+         if(candidates != NULL) free(candidates);
+         if(selected != NULL) free(selected);
+         FreeChainData(&data);
+         return(FALSE);
+      }
+
+      if(coords)
+         FindCoordHits(&data);
+      else if(quant)
+         FindQuantHits(&data, ndist);
+      else
+         FindDistanceHits(&data, ndist);
+
+      if(angleCons || seqCons)
+      {
+         for(res=0; res<data.nres; res++)
+         {
+            if(angleCons)
+               data.hits[res] &= data.angleHits[res];
+            if(seqCons)
+               data.hits[res] &= data.seqHits[res];
+         }
+      }
+
+      for(res=0; res<data.nres; res++)
+      {
+         if(data.hits[res])
+         {
+            if(gCountOnly)
+            {
+               gNHits += (self ? 1 : 0) + (nextAlias - firstAlias);
+               continue;
+            }
+            if(!data.residsRead &&
+               !ReadResids(DBfp, &(chains[chainNum]), &data))
+            {
+               fprintf(stderr,"Error reading chain %s.%s from \
+database\n", chains[chainNum].pdbcode, chains[chainNum].chain);
+               break;
+            }
+            if(self)
+            {
+               CADBMakeKey(key, &(chains[chainNum]), 
+                           &(data.resids[res]));
+               FlagPosOK(key);
+            }
+
+            for(a=firstAlias; a<nextAlias; a++)
+            {
+               memcpy(aliasChain.pdbcode, aliases[a].pdbcode, 8);
+               memcpy(aliasChain.chain,   aliases[a].chain,   8);
+               CADBMakeKey(key, &aliasChain, &(data.resids[res]));
+               FlagPosOK(key);
+            }
+         }
+      }
+   }
+
+   free(chains);
+   if(aliases != NULL) free(aliases);
+   if(candidates != NULL) free(candidates);
+   if(selected != NULL) free(selected);
+   FreeChainData(&data);
+
+   /* Display the flagged records                                       */
+   DisplayResults(out);
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int CompareAliases(const void *alias1, const void *alias2)
+   ----------------------------------------------------------
+   Inputs:     const void *alias1   First CADBALIAS
+               const void *alias2   Second CADBALIAS
+   Returns:    int                  Comparison for qsort()
+
+   Sorts aliases by the index of the chain that they duplicate.
+
+   16.10.26 Original   By: ACRM
+*/
+int CompareAliases(const void *alias1, const void *alias2)
+{
+   uint64_t target1 = ((CADBALIAS *)alias1)->target,
+            target2 = ((CADBALIAS *)alias2)->target;
+
+   if(target1 < target2)
+      return(-1);
+   if(target1 > target2)
+      return(1);
+   return(0);
+}
+
+
+/************************************************************************/
+/*>uint64_t *IndexCandidates(CADBCHAIN *chains)
+   --------------------------------------------
+   Inputs:     CADBCHAIN  *chains       The chain table
+   Returns:    uint64_t   *             Malloc'd bitmap of the records
+                                        which may start a hit (NULL if
+                                        the index is not used)
+   Globals:    CADBINDEXHEADER gIndexHeader  Header of the range index
+
+   Uses the range index to find the records which could start a loop
+   satisfying the constraints. Each constraint that matches at most 
+   1/INDEX_SELECTIVE of the records is looked up. A DP constraint 
+   applies to the record starting the loop. A DM constraint applies to
+   the record gLoopLength-1 further on, where it is only tested if 
+   that is in the same chain, so the residues too near the end of each
+   chain are added back to the DM candidates. The candidates are then
+   the records meeting all the DP constraints looked up and (if any 
+   were looked up) all the DM constraints. Constraints which a missing
+   distance satisfies are not looked up.
+
+   If no constraint is selective enough, NULL is returned and the whole
+   database is searched.
+
+   16.10.26 Original   By: ACRM
+*/
+uint64_t *IndexCandidates(CADBCHAIN *chains)
+{
+   CONSTRAINT *c;
+   uint64_t   *posBits = NULL,
+              *negBits = NULL,
+              *work    = NULL,
+              nrecords = gIndexHeader.nrecords,
+              nwords   = (nrecords + 63) / 64,
+              start,
+              count,
+              chainNum,
+              record,
+              i;
+   BOOL       ok       = TRUE,
+              posUsed  = FALSE,
+              negUsed  = FALSE;
+
+   if(((work    = (uint64_t *)malloc(nwords * sizeof(uint64_t)))==NULL) ||
+      ((posBits = (uint64_t *)malloc(nwords * sizeof(uint64_t)))==NULL) ||
+      ((negBits = (uint64_t *)malloc(nwords * sizeof(uint64_t)))==NULL))
+   {
+      if(work    != NULL) free(work);
+      if(posBits != NULL) free(posBits);
+      return(NULL);
+   }
+
+   for(c=gPosConsList; ok && (c!=NULL); NEXT(c))
+   {
+      if(IndexRange(c, &start, &count) &&
+         (count * INDEX_SELECTIVE <= nrecords))
+      {
+         ok = IndexConstraintBits(c, 0, posBits, work, !posUsed);
+         posUsed = TRUE;
+      }
+   }
+   for(c=gNegConsList; ok && (c!=NULL); NEXT(c))
+   {
+      if(IndexRange(c, &start, &count) &&
+         (count * INDEX_SELECTIVE <= nrecords))
+      {
+         ok = IndexConstraintBits(c, c->cons - (gLoopLength - 1), 
+                                  negBits, work, !negUsed);
+         negUsed = TRUE;
+      }
+   }
+   free(work);
+
+   if(ok && negUsed)
+   {
+      /* The residues at the end of each chain remain candidates        */
+      for(chainNum=0; chainNum<gHeader.nchains; chainNum++)
+      {
+         record = chains[chainNum].firstRecord + chains[chainNum].nres;
+         for(i=0; (i < (uint64_t)(gLoopLength - 1)) && 
+                  (i < chains[chainNum].nres); i++)
+         {
+            record--;
+            negBits[record / 64] |= ((uint64_t)1 << (record % 64));
+         }
+      }
+
+      for(i=0; i<nwords; i++)
+         posBits[i] = (posUsed ? (posBits[i] & negBits[i]) : negBits[i]);
+   }
+   free(negBits);
+
+   /* Search the whole database if the index could not be used          */
+   if(!ok || (!posUsed && !negUsed))
+   {
+      free(posBits);
+      return(NULL);
+   }
+   return(posBits);
+}
+
+
+/************************************************************************/
+/*>BOOL IndexRange(CONSTRAINT *c, uint64_t *start, uint64_t *count)
+   ----------------------------------------------------------------
+   Inputs:     CONSTRAINT *c        A constraint
+   Outputs:    uint64_t   *start    Start of the run of records in the
+                                    index list for the offset
+               uint64_t   *count    Number of records in the run
+   Returns:    BOOL                 Can the constraint be looked up?
+   Globals:    CADBINDEXHEADER gIndexHeader  Header of the range index
+               uint32_t *gIndexBins  Bin directory of the range index
+
+   Finds the records of the index which lie in the bins covering the 
+   constraint. These are a superset of the records which satisfy it.
+   A constraint which a missing distance satisfies is not looked up.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL IndexRange(CONSTRAINT *c, uint64_t *start, uint64_t *count)
+{
+   uint32_t *bins;
+   int      nbins = (int)gIndexHeader.nbins;
+
+   if(c->missingOK || (c->cons > (int)gIndexHeader.ndist))
+      return(FALSE);
+
+   *start = 0;
+   *count = 0;
+   if(c->lo > c->hi)
+      return(TRUE);
+
+   bins   = gIndexBins + (c->cons - 1) * (nbins + 2);
+   *start = bins[CADBIndexBin(&gIndexHeader, c->lo)];
+   *count = bins[CADBIndexBin(&gIndexHeader, c->hi) + 1] - *start;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL IndexConstraintBits(CONSTRAINT *c, int shift, uint64_t *bits,
+                            uint64_t *work, BOOL first)
+   ---------------------------------------------------------------------
+   Inputs:     CONSTRAINT *c      A constraint
+               int        shift   Offset added to each record number
+                                  from the index
+   I/O:        uint64_t   *bits   Bitmap of candidate records. The
+                                  records for this constraint are ANDed
+                                  in
+   Workspace:  uint64_t   *work   Bitmap of the same size
+               BOOL       first   Is this the first constraint for the
+                                  bitmap? If so, the records are simply
+                                  copied into it
+   Returns:    BOOL               Success?
+   Globals:    FILE       *gIndexFp      The range index file pointer
+               CADBINDEXHEADER gIndexHeader  Header of the range index
+
+   Reads the run of records for a constraint from the index and 
+   combines them with the candidates so far.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL IndexConstraintBits(CONSTRAINT *c, int shift, uint64_t *bits, 
+                         uint64_t *work, BOOL first)
+{
+   static uint32_t buffer[INDEX_READBUFF];
+   uint64_t nrecords = gIndexHeader.nrecords,
+            nwords   = (nrecords + 63) / 64,
+            start,
+            count,
+            record,
+            i;
+   size_t   nread;
+   int64_t  r;
+
+   if(!IndexRange(c, &start, &count))
+      return(FALSE);
+
+   memset(work, 0, nwords * sizeof(uint64_t));
+   if(count &&
+      fseeko(gIndexFp, (off_t)(sizeof(CADBINDEXHEADER) +
+                               (uint64_t)gIndexHeader.ndist *
+                               (gIndexHeader.nbins + 2) * 
+                               sizeof(uint32_t) +
+                               ((c->cons - 1) * nrecords + start) *
+                               sizeof(uint32_t)), SEEK_SET))
+      return(FALSE);
+
+   while(count)
+   {
+      nread = (size_t)MIN(count, INDEX_READBUFF);
+      if(fread(buffer, sizeof(uint32_t), nread, gIndexFp) != nread)
+         return(FALSE);
+      for(i=0; i<nread; i++)
+      {
+         r = (int64_t)buffer[i] + shift;
+         if((r >= 0) && ((uint64_t)r < nrecords))
+         {
+            record = (uint64_t)r;
+            work[record / 64] |= ((uint64_t)1 << (record % 64));
+         }
+      }
+      count -= nread;
+   }
+
+   for(i=0; i<nwords; i++)
+      bits[i] = (first ? work[i] : (bits[i] & work[i]));
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL ChainHasCandidates(uint64_t *bits, CADBCHAIN *chain)
+   ---------------------------------------------------------
+   Inputs:     uint64_t  *bits    Bitmap of candidate records
+               CADBCHAIN *chain   Chain table entry
+   Returns:    BOOL               Are any of the chain's records 
+                                  candidates?
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL ChainHasCandidates(uint64_t *bits, CADBCHAIN *chain)
+{
+   uint64_t first = chain->firstRecord,
+            last  = chain->firstRecord + chain->nres,
+            record;
+
+   for(record=first; record<last; )
+   {
+      if((record % 64 == 0) && (record + 64 <= last))
+      {
+         if(bits[record / 64])
+            return(TRUE);
+         record += 64;
+      }
+      else
+      {
+         if(bits[record / 64] & ((uint64_t)1 << (record % 64)))
+            return(TRUE);
+         record++;
+      }
+   }
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>BOOL ChainWanted(uint64_t *candidates, unsigned char *selected,
+                    CADBCHAIN *chains, uint64_t chainNum)
+   ---------------------------------------------------------------
+   Inputs:     uint64_t      *candidates  Candidates from the range 
+                                          index (or NULL)
+               unsigned char *selected    Chains selected by INCLUDE
+                                          and EXCLUDE (or NULL)
+               CADBCHAIN     *chains      The chain table
+               uint64_t      chainNum     The chain
+   Returns:    BOOL                       Does the chain need to be
+                                          searched?
+
+   Tests whether a chain is selected and has candidates in the range
+   index so that a chain which can have no hits is never read.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL ChainWanted(uint64_t *candidates, unsigned char *selected,
+                 CADBCHAIN *chains, uint64_t chainNum)
+{
+   if((selected != NULL) && !selected[chainNum])
+      return(FALSE);
+   if((candidates != NULL) && 
+      !ChainHasCandidates(candidates, &(chains[chainNum])))
+      return(FALSE);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>FILE *OpenWindowTable(CADBWINDOWHEADER *win)
+   --------------------------------------------
+   Outputs:    CADBWINDOWHEADER *win  Header of the window table
+   Returns:    FILE   *               Window table file pointer (NULL if
+                                      there is none or it is not usable)
+   Globals:    char   gDBFile         Filename of the database
+               int    gLoopLength     Loop length
+               CADBHEADER gHeader     Header of the database
+
+   Opens the loop window table written by makecadb -w for the current
+   loop length if there is one. A table that does not match the 
+   database is ignored with a warning.
+
+   16.10.26 Original   By: ACRM
+*/
+FILE *OpenWindowTable(CADBWINDOWHEADER *win)
+{
+   FILE *fp;
+   char filename[MAXBUFF+16];
+   int  err;
+
+   CADBWindowFilename(filename, gDBFile, gLoopLength);
+   if((fp = fopen(filename, "rb"))==NULL)
+      return(NULL);
+
+   if(((err = CADBReadWindowHeader(fp, win, &gHeader)) == CADB_OK) &&
+      (win->length != (uint32_t)gLoopLength))
+      err = CADB_ERR_STALE;
+   if(err != CADB_OK)
+   {
+      fprintf(stderr,"Warning: %s: %s. Window table not used\n",
+              CADBError(err), filename);
+      fclose(fp);
+      return(NULL);
+   }
+
+   return(fp);
+}
+
+
+/************************************************************************/
+/*>BOOL RunWindowSearch(FILE *DBfp, FILE *winFp, CADBWINDOWHEADER *win,
+                        CADBCHAIN *chains, CADBALIAS *aliases, 
+                        uint64_t naliases, uint64_t *candidates,
+                        unsigned char *selected)
+   --------------------------------------------------------------------
+   Inputs:     FILE       *DBfp        Database file pointer
+               FILE       *winFp       Window table file pointer
+               CADBWINDOWHEADER *win   Header of the window table
+               CADBCHAIN  *chains      The chain table
+               CADBALIAS  *aliases     The alias table sorted by target
+                                       (or NULL)
+               uint64_t   naliases     Number of aliases
+               uint64_t   *candidates  Candidates from the range index
+                                       (or NULL)
+               unsigned char *selected Chains selected by INCLUDE and
+                                       EXCLUDE (or NULL)
+   Returns:    BOOL                    Success?
+   Globals:    int        gNThreads    Number of threads
+               BOOL       gCountOnly   Just count the hits?
+               uint64_t   gNHits       Number of hits counted
+
+   Runs the search on the loop window table for gLoopLength. Each row
+   of the table holds all the distances needed to test the loop 
+   starting at a record, so the search is a single scan of the table.
+   The chains are split into gNThreads runs with similar numbers of
+   records, each of which is scanned by ScanWindows() in its own 
+   thread. The hits are then stored in the DBM hash (or counted) in 
+   chain order exactly as by RunBinarySearch(); the residue 
+   identifiers are only read for chains with hits.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added selected
+*/
+BOOL RunWindowSearch(FILE *DBfp, FILE *winFp, CADBWINDOWHEADER *win,
+                     CADBCHAIN *chains, CADBALIAS *aliases, 
+                     uint64_t naliases, uint64_t *candidates,
+                     unsigned char *selected)
+{
+   WINDOWSCAN scans[MAXTHREADS];
+   pthread_t  threads[MAXTHREADS];
+   BOOL       started[MAXTHREADS],
+              newChain = TRUE,
+              self     = TRUE,
+              ok       = TRUE;
+   CADBCHAIN  aliasChain,
+              *chain;
+   CHAINDATA  data;
+   uint64_t   nchains   = gHeader.nchains,
+              chainNum  = 0,
+              nextAlias = 0,
+              firstAlias = 0,
+              perThread,
+              record,
+              h, a;
+   int        nthreads = gNThreads,
+              res,
+              t;
+   char       key[CADB_MAXKEY];
+
+   if((uint64_t)nthreads > nchains)
+      nthreads = (nchains ? (int)nchains : 1);
+   perThread = (gHeader.nrecords + nthreads - 1) / nthreads;
+
+   /* Give each thread a run of whole chains                            */
+   for(t=0; t<nthreads; t++)
+   {
+      memset(&(scans[t]), 0, sizeof(WINDOWSCAN));
+      scans[t].win        = win;
+      scans[t].chains     = chains;
+      scans[t].candidates = candidates;
+      scans[t].selected   = selected;
+      scans[t].fd         = fileno(winFp);
+      scans[t].ok         = TRUE;
+      scans[t].firstChain = chainNum;
+      while((chainNum < nchains) &&
+            ((t == nthreads-1) ||
+             (chains[chainNum].firstRecord < (t+1) * perThread)))
+         chainNum++;
+      scans[t].lastChain  = chainNum;
+   }
+
+   /* The first run is scanned in this thread, as is any run for which
+      a thread could not be started
+   */
+   for(t=1; t<nthreads; t++)
+      started[t] = !pthread_create(&(threads[t]), NULL, ScanWindows, 
+                                   &(scans[t]));
+   ScanWindows(&(scans[0]));
+   for(t=1; t<nthreads; t++)
+   {
+      if(started[t])
+         pthread_join(threads[t], NULL);
+      else
+         ScanWindows(&(scans[t]));
+   }
+
+   /* Store the hits                                                    */
+   memset(&aliasChain, 0, sizeof(CADBCHAIN));
+   memset(&data, 0, sizeof(CHAINDATA));
+   chainNum = 0;
+   for(t=0; ok && (t<nthreads); t++)
+   {
+      if(!scans[t].ok)
+      {
+         fprintf(stderr,"Error scanning loop window table\n");
+         ok = FALSE;
+         break;
+      }
+
+      for(h=0; h<scans[t].nhits; h++)
+      {
+         record = scans[t].hits[h];
+         while(record >= chains[chainNum].firstRecord + 
+                         chains[chainNum].nres)
+         {
+            chainNum++;
+            newChain = TRUE;
+         }
+         chain = &(chains[chainNum]);
+         res   = (int)(record - chain->firstRecord);
+
+         if(newChain)
+         {
+            while((nextAlias < naliases) && 
+                  (aliases[nextAlias].target < chainNum))
+               nextAlias++;
+            firstAlias = nextAlias;
+            while((nextAlias < naliases) && 
+                  (aliases[nextAlias].target == chainNum))
+               nextAlias++;
+            data.residsRead = FALSE;
+            newChain        = FALSE;
+            self = ((selected == NULL) || (selected[chainNum] & SEL_CHAIN));
+         }
+
+         if(gCountOnly)
+         {
+            gNHits += (self ? 1 : 0) + (nextAlias - firstAlias);
+            continue;
+         }
+
+         if(!data.residsRead &&
+            (!AllocChainData(&data, (int)chain->nres, 1) ||
+             !ReadResids(DBfp, chain, &data)))
+         {
+            fprintf(stderr,"Error reading chain %s.%s from database\n",
+                    chain->pdbcode, chain->chain);
+            ok = FALSE;
+            break;
+         }
+         if(self)
+         {
+            CADBMakeKey(key, chain, &(data.resids[res]));
+            FlagPosOK(key);
+         }
+
+         for(a=firstAlias; a<nextAlias; a++)
+         {
+            memcpy(aliasChain.pdbcode, aliases[a].pdbcode, 8);
+            memcpy(aliasChain.chain,   aliases[a].chain,   8);
+            CADBMakeKey(key, &aliasChain, &(data.resids[res]));
+            FlagPosOK(key);
+         }
+      }
+   }
+
+   for(t=0; t<nthreads; t++)
+   {
+      if(scans[t].hits != NULL)
+         free(scans[t].hits);
+   }
+   FreeChainData(&data);
+
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>void *ScanWindows(void *arg)
+   ----------------------------
+   I/O:        void   *arg        The WINDOWSCAN to be scanned
+   Returns:    void   *           NULL
+   Globals:    CONSTRAINT *gPosConsList  DP constraints
+               CONSTRAINT *gNegConsList  DM constraints
+
+   Thread function to scan the rows of a loop window table for chains
+   firstChain to lastChain-1, storing the record number of each hit.
+   Runs of consecutive chains are read together with pread() so that
+   threads can share the file. Chains which are not selected by 
+   INCLUDE and EXCLUDE or have no candidates in the range index are 
+   skipped. As in RunBinarySearch(), a loop which would extend beyond
+   the end of the chain is only tested against the DP constraints. 
+   scan->ok is cleared on error.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Skips chains not selected by INCLUDE and EXCLUDE
+*/
+void *ScanWindows(void *arg)
+{
+   WINDOWSCAN *scan   = (WINDOWSCAN *)arg;
+   CADBCHAIN  *chains = scan->chains;
+   uint16_t   *rows   = NULL,
+              *row;
+   uint64_t   chainNum = scan->firstChain,
+              runStart,
+              c;
+   size_t     rowSize = scan->win->rowSize,
+              nrows,
+              maxrows = 0;
+   off_t      offset;
+   int        ndist   = (int)scan->win->ndist,
+              length  = (int)scan->win->length,
+              nres,
+              res;
+
+   while(scan->ok && (chainNum < scan->lastChain))
+   {
+      if(!ChainWanted(scan->candidates, scan->selected, chains, 
+                      chainNum))
+      {
+         chainNum++;
+         continue;
+      }
+
+      /* Find a run of chains which can be read together                */
+      runStart = chainNum;
+      nrows    = 0;
+      do
+      {
+         nrows += chains[chainNum++].nres;
+      }  while((chainNum < scan->lastChain) &&
+               (nrows + chains[chainNum].nres <= WINDOW_READROWS) &&
+               ChainWanted(scan->candidates, scan->selected, chains, 
+                           chainNum));
+
+      if(nrows > maxrows)
+      {
+         if(rows != NULL)
+            free(rows);
+         maxrows = nrows;
+         if((rows = (uint16_t *)malloc(maxrows * rowSize))==NULL)
+         {
+            scan->ok = FALSE;
+            break;
+         }
+      }
+
+      offset = (off_t)(sizeof(CADBWINDOWHEADER) + 
+                       chains[runStart].firstRecord * rowSize);
+      if(pread(scan->fd, rows, nrows * rowSize, offset) != 
+         (ssize_t)(nrows * rowSize))
+      {
+         scan->ok = FALSE;
+         break;
+      }
+
+      row = rows;
+      for(c=runStart; scan->ok && (c<chainNum); c++)
+      {
+         nres = (int)chains[c].nres;
+         for(res=0; res<nres; res++, row += 2*ndist)
+         {
+            if(WindowRowOK(row, gPosConsList) &&
+               ((res + length - 1 >= nres) ||
+                WindowRowOK(row + ndist, gNegConsList)))
+            {
+               if(!AddWindowHit(scan, chains[c].firstRecord + res))
+               {
+                  scan->ok = FALSE;
+                  break;
+               }
+            }
+         }
+      }
+   }
+
+   if(rows != NULL)
+      free(rows);
+   return(NULL);
+}
+
+
+/************************************************************************/
+/*>BOOL AddWindowHit(WINDOWSCAN *scan, uint64_t record)
+   ----------------------------------------------------
+   I/O:        WINDOWSCAN *scan      The scan
+   Inputs:     uint64_t   record     Record number of the hit
+   Returns:    BOOL                  Success? (FALSE if out of memory)
+
+   Adds a hit to the list for a scan, expanding the list as needed.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL AddWindowHit(WINDOWSCAN *scan, uint64_t record)
+{
+   uint64_t *hits;
+
+   if(scan->nhits == scan->maxhits)
+   {
+      scan->maxhits = (scan->maxhits ? 2 * scan->maxhits : 1024);
+      if((hits = (uint64_t *)realloc(scan->hits, 
+                                     scan->maxhits * sizeof(uint64_t)))
+         ==NULL)
+         return(FALSE);
+      scan->hits = hits;
+   }
+   scan->hits[scan->nhits++] = record;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL WindowRowOK(uint16_t *row, CONSTRAINT *ConsList)
+   -----------------------------------------------------
+   Inputs:     uint16_t   *row        Distances for offsets 1..ndist
+               CONSTRAINT *ConsList   Linked list of constraints
+   Returns:    BOOL                   Matches constraints?
+
+   Equivalent of BinaryRecordOK() for the DP or DM half of a row of a
+   loop window table.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL WindowRowOK(uint16_t *row, CONSTRAINT *ConsList)
+{
+   CONSTRAINT *c;
+   int        d;
+
+   for(c=ConsList; c!=NULL; NEXT(c))
+   {
+      d = row[c->cons - 1];
+      if(d == CADB_MISSING)
+      {
+         if(!c->missingOK)
+            return(FALSE);
+      }
+      else if((d < c->lo) || (d > c->hi))
+      {
+         return(FALSE);
+      }
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL CheckConstraints(CONSTRAINT *ConsList, int ndist)
+   ------------------------------------------------------
+   Inputs:     CONSTRAINT *ConsList    Linked list of constraints
+               int        ndist        Number of distances in database
+                                       (0 for a coordinate database)
+   Returns:    BOOL                    All constraints valid?
+
+   Checks that the constraint offsets are available in the database.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 No upper limit for a coordinate database
+*/
+BOOL CheckConstraints(CONSTRAINT *ConsList, int ndist)
+{
+   CONSTRAINT *c;
+
+   for(c=ConsList; c!=NULL; NEXT(c))
+   {
+      if(c->cons < 1)
+      {
+         fprintf(stderr,"Constraint offset %d must be at least 1\n",
+                 c->cons);
+         return(FALSE);
+      }
+      if(ndist && (c->cons > ndist))
+      {
+         fprintf(stderr,"Constraint offset %d is outside the range \
+1..%d stored in the database\n", c->cons, ndist);
+         return(FALSE);
+      }
+   }
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>BOOL RunEstimate(FILE *DBfp, FILE *out)
+   ---------------------------------------
+   Inputs:     FILE    *DBfp       Database file pointer (NULL for a
+                                   sharded database)
+               FILE    *out        Output file pointer
+   Returns:    BOOL                Success?
+   Globals:    CADBHEADER gHeader  Header of the database
+               char    gShards     The shard filenames
+               int     gNShards    Number of shards
+
+   Handles the ESTIMATE command. Estimates the number of hits from the 
+   distance histograms at the end of a binary database without 
+   searching it. For a sharded database, the estimates for the shards 
+   are summed. Prints the estimate and an upper bound on the number of
+   hits. There are no histograms of the angles so ANGLE and TORSION 
+   constraints are ignored.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL RunEstimate(FILE *DBfp, FILE *out)
+{
+   FILE       *fp;
+   CADBHEADER header;
+   REAL       estimate = 0.0;
+   uint64_t   maxHits  = 0;
+   int        i;
+   BOOL       ok = TRUE;
+
+   if(gNShards)
+   {
+      for(i=0; ok && (i<gNShards); i++)
+      {
+         if((fp=fopen(gShards[i],"r"))==NULL)
+         {
+            fprintf(stderr,"Can't open database: %s\n",gShards[i]);
+            ok = FALSE;
+         }
+         else
+         {
+            if(CADBReadHeader(fp, &header) != CADB_OK)
+            {
+               fprintf(stderr,"ESTIMATE requires a binary database: \
+%s\n", gShards[i]);
+               ok = FALSE;
+            }
+            else
+            {
+               ok = EstimateHits(fp, &header, &estimate, &maxHits);
+            }
+            fclose(fp);
+         }
+      }
+   }
+   else if(!gBinary)
+   {
+      fprintf(stderr,"ESTIMATE requires a binary database\n");
+      ok = FALSE;
+   }
+   else
+   {
+      ok = EstimateHits(DBfp, &gHeader, &estimate, &maxHits);
+   }
+
+   if(ok)
+      fprintf(out,"ESTIMATE %.0f MAX %llu\n", estimate, 
+              (unsigned long long)maxHits);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL EstimateHits(FILE *DBfp, CADBHEADER *header, REAL *estimate,
+                     uint64_t *maxHits)
+   -----------------------------------------------------------------
+   Inputs:     FILE       *DBfp      Database file pointer
+               CADBHEADER *header    Header of the database
+   I/O:        REAL       *estimate  Estimated number of hits. The 
+                                     estimate for this database is 
+                                     added
+               uint64_t   *maxHits   Upper bound on the number of hits.
+                                     The bound for this database is 
+                                     added
+   Returns:    BOOL                  Success?
+
+   Estimates the number of hits in one database from its distance
+   histograms, assuming that the constraints are independent. The
+   fraction of records passing each constraint is taken from the
+   histogram for its offset, interpolating within the bins at the ends
+   of the range. A DM constraint at offset k is estimated from the DP 
+   histogram for offset k since the DM distances are the same set of 
+   distances. As in the search, the DM constraints are not applied to
+   loops which would run off the end of the chain; these are taken to 
+   be the last gLoopLength-1 records of each chain.
+
+   The upper bound is the number of records in the bins touched by the
+   most selective DP constraint, which no search can exceed.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL EstimateHits(FILE *DBfp, CADBHEADER *header, REAL *estimate,
+                  uint64_t *maxHits)
+{
+   CADBHISTHEADER hist;
+   CONSTRAINT     *c;
+   uint64_t       *counts,
+                  bound,
+                  nbound;
+   REAL           posFrac = 1.0,
+                  negFrac = 1.0,
+                  tail    = 0.0;
+
+   if(!CheckConstraints(gPosConsList, (int)header->ndist) || 
+      !CheckConstraints(gNegConsList, (int)header->ndist))
+      return(FALSE);
+
+   if(header->layout == CADB_LAYOUT_COORD)
+   {
+      fprintf(stderr,"ESTIMATE is not available for a coordinate \
+database\n");
+      return(FALSE);
+   }
+   if((counts = CADBReadHistograms(DBfp, header, &hist))==NULL)
+   {
+      fprintf(stderr,"The database has no distance histograms. Rebuild \
+it with makecadb\n");
+      return(FALSE);
+   }
+
+   bound = hist.nrecords;
+   for(c=gPosConsList; c!=NULL; NEXT(c))
+   {
+      posFrac *= HistFraction(&hist, counts, c, &nbound);
+      bound    = MIN(bound, nbound);
+   }
+   for(c=gNegConsList; c!=NULL; NEXT(c))
+      negFrac *= HistFraction(&hist, counts, c, &nbound);
+
+   if(hist.nrecords)
+      tail = MIN(1.0, (REAL)hist.nchains * (gLoopLength - 1) /
+                      (REAL)hist.nrecords);
+
+   *estimate += (REAL)hist.nrecords * posFrac * 
+                (tail + (1.0 - tail) * negFrac);
+   *maxHits  += bound;
+
+   free(counts);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>REAL HistFraction(CADBHISTHEADER *hist, uint64_t *counts, 
+                     CONSTRAINT *c, uint64_t *nbound)
+   ---------------------------------------------------------
+   Inputs:     CADBHISTHEADER *hist     Header of the histograms
+               uint64_t       *counts   The histogram counts
+               CONSTRAINT     *c        A constraint
+   Outputs:    uint64_t       *nbound   Number of records in the bins 
+                                        which overlap the constraint
+   Returns:    REAL                     Estimated fraction of the 
+                                        records which satisfy the
+                                        constraint
+
+   Estimates the fraction of records satisfying a constraint from the
+   histogram for its offset. A bin only partly covered by the 
+   constraint contributes in proportion to the overlap.
+
+   16.10.26 Original   By: ACRM
+*/
+REAL HistFraction(CADBHISTHEADER *hist, uint64_t *counts, CONSTRAINT *c,
+                  uint64_t *nbound)
+{
+   uint64_t *col  = counts + (size_t)(c->cons - 1) * (hist->nbins + 1);
+   int      width = (int)hist->binWidth,
+            nbins = (int)hist->nbins,
+            bin,
+            lo,
+            hi;
+   REAL     n     = 0.0;
+
+   *nbound = 0;
+   if(c->missingOK)
+   {
+      n       += (REAL)col[nbins];
+      *nbound += col[nbins];
+   }
+
+   for(bin=MIN(c->lo / width, nbins - 1); 
+       (bin < nbins) && (bin * width <= c->hi); 
+       bin++)
+   {
+      lo = MAX(c->lo, bin * width);
+      hi = MIN(c->hi, (bin + 1) * width - 1);
+      if(hi < lo)
+         continue;
+      n       += (REAL)col[bin] * (hi - lo + 1) / width;
+      *nbound += col[bin];
+   }
+
+   return(hist->nrecords ? n / (REAL)hist->nrecords : 0.0);
+}
+
+
+
+/************************************************************************/
+/*>BOOL ReadSelectList(char *filename, SELLIST *list)
+   --------------------------------------------------
+   Inputs:     char    *filename   File listing PDB codes and chains
+   I/O:        SELLIST *list       The list to which they are added
+   Returns:    BOOL                Success?
+
+   Reads a file given to INCLUDE or EXCLUDE. Each line gives a PDB code
+   (e.g. 1abc), to select all of its chains, or a chain (e.g. 1abc.A)
+   as they appear in the search results. Blank lines and lines starting
+   with # are skipped. The list is sorted for InSelectList().
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL ReadSelectList(char *filename, SELLIST *list)
+{
+   FILE    *fp;
+   CADBKEY *keys;
+   char    buffer[MAXBUFF],
+           word[MAXBUFF];
+
+   if((fp=fopen(filename,"r"))==NULL)
+   {
+      fprintf(stderr,"Can't open list file: %s\n",filename);
+      return(FALSE);
+   }
+
+   while(fgets(buffer,MAXBUFF,fp))
+   {
+      if((sscanf(buffer,"%s",word) != 1) || (word[0] == '#'))
+         continue;
+
+      if(list->nkeys >= list->maxkeys)
+      {
+         if((keys = (CADBKEY *)realloc(list->keys, 
+                                       (list->maxkeys + SELECT_ALLOC) *
+                                       sizeof(CADBKEY)))==NULL)
+         {
+            fprintf(stderr,"No memory for list file: %s\n",filename);
+            fclose(fp);
+            return(FALSE);
+         }
+         list->keys     = keys;
+         list->maxkeys += SELECT_ALLOC;
+      }
+      SplitKey(word, &(list->keys[list->nkeys++]));
+   }
+   fclose(fp);
+
+   qsort(list->keys, list->nkeys, sizeof(CADBKEY), CADBCompareKeys);
+   list->active = TRUE;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>char *SplitKey(char *key, CADBKEY *name)
+   ----------------------------------------
+   Inputs:     char    *key      PDB code (1abc), chain (1abc.A) or 
+                                 residue identifier (1abc.A.52)
+   Outputs:    CADBKEY *name     The PDB code and chain label (empty if
+                                 key does not give one)
+   Returns:    char    *         The residue number part of key (NULL
+                                 if it does not give one)
+
+   Splits a key into its parts at the dots. As elsewhere, the chain 
+   label may have more than one character.
+
+   16.10.26 Original   By: ACRM
+*/
+char *SplitKey(char *key, CADBKEY *name)
+{
+   char *dot;
+
+   memset(name, 0, sizeof(CADBKEY));
+   if((dot = strchr(key, '.'))==NULL)
+   {
+      strncpy(name->pdbcode, key, 7);
+      return(NULL);
+   }
+   strncpy(name->pdbcode, key, MIN((int)(dot - key), 7));
+
+   key = dot + 1;
+   if((dot = strchr(key, '.'))==NULL)
+   {
+      strncpy(name->chain, key, 7);
+      return(NULL);
+   }
+   strncpy(name->chain, key, MIN((int)(dot - key), 7));
+
+   return(dot + 1);
+}
+
+
+/************************************************************************/
+/*>BOOL NameMatches(CADBKEY *name, CADBKEY *probe)
+   -----------------------------------------------
+   Inputs:     CADBKEY *name     PDB code and chain label of a chain
+               CADBKEY *probe    PDB code and chain label (which may be
+                                 empty) looked for
+   Returns:    BOOL              Does the chain match?
+
+   Tests whether a chain matches a PDB code and, if probe gives one, a
+   chain label.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL NameMatches(CADBKEY *name, CADBKEY *probe)
+{
+   if(strncmp(name->pdbcode, probe->pdbcode, 8))
+      return(FALSE);
+   if(probe->chain[0] && strncmp(name->chain, probe->chain, 8))
+      return(FALSE);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL InSelectList(SELLIST *list, char *pdbcode, char *chain)
+   ------------------------------------------------------------
+   Inputs:     SELLIST *list      An INCLUDE or EXCLUDE list
+               char    *pdbcode   PDB code of a chain
+               char    *chain     Chain label
+   Returns:    BOOL               Is the chain in the list?
+
+   Tests whether a chain is in a list, either by itself or through its
+   PDB code.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL InSelectList(SELLIST *list, char *pdbcode, char *chain)
+{
+   CADBKEY probe;
+
+   if(!list->nkeys)
+      return(FALSE);
+
+   memset(&probe, 0, sizeof(CADBKEY));
+   strncpy(probe.pdbcode, pdbcode, 7);
+   if(bsearch(&probe, list->keys, list->nkeys, sizeof(CADBKEY), 
+              CADBCompareKeys) != NULL)
+      return(TRUE);
+
+   strncpy(probe.chain, chain, 7);
+   return(bsearch(&probe, list->keys, list->nkeys, sizeof(CADBKEY), 
+                  CADBCompareKeys) != NULL);
+}
+
+
+/************************************************************************/
+/*>BOOL NameSelected(char *pdbcode, char *chain)
+   ---------------------------------------------
+   Inputs:     char    *pdbcode   PDB code of a chain
+               char    *chain     Chain label
+   Returns:    BOOL               Is the chain to be searched?
+   Globals:    SELLIST gInclude   The INCLUDE list
+               SELLIST gExclude   The EXCLUDE list
+
+   Tests whether a chain is selected by the INCLUDE and EXCLUDE lists.
+   If there is an INCLUDE list, the chain must be in it and it must not
+   be in the EXCLUDE list.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL NameSelected(char *pdbcode, char *chain)
+{
+   if(gInclude.active && !InSelectList(&gInclude, pdbcode, chain))
+      return(FALSE);
+   if(gExclude.active && InSelectList(&gExclude, pdbcode, chain))
+      return(FALSE);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL KeySelected(char *key)
+   ---------------------------
+   Inputs:     char    *key       Residue identifier
+   Returns:    BOOL               Is the residue to be searched?
+
+   Tests whether a residue of a text database is in a chain selected by
+   the INCLUDE and EXCLUDE lists.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL KeySelected(char *key)
+{
+   CADBKEY name;
+
+   if(!gInclude.active && !gExclude.active)
+      return(TRUE);
+
+   SplitKey(key, &name);
+   return(NameSelected(name.pdbcode, name.chain));
+}
+
+
+/************************************************************************/
+/*>unsigned char *SelectChains(CADBCHAIN *chains, CADBALIAS *aliases,
+                               uint64_t *naliases)
+   -------------------------------------------------------------------
+   Inputs:     CADBCHAIN  *chains    The chain table
+   I/O:        CADBALIAS  *aliases   The alias table sorted by target 
+                                     (or NULL). Aliases which are not
+                                     selected are removed
+               uint64_t   *naliases  Number of aliases
+   Returns:    unsigned char *       Malloc'd flags for each chain in 
+                                     the chain table (NULL if no 
+                                     memory)
+
+   Applies the INCLUDE and EXCLUDE lists to a binary database. A chain
+   is flagged with SEL_CHAIN if it is selected itself and SEL_ALIAS if
+   any of its aliases is. A chain with neither flag need not be read at
+   all. Since only the selected aliases are kept, the hits in a chain 
+   are then reported for exactly the names that were selected.
+
+   16.10.26 Original   By: ACRM
+*/
+unsigned char *SelectChains(CADBCHAIN *chains, CADBALIAS *aliases,
+                            uint64_t *naliases)
+{
+   unsigned char *selected;
+   uint64_t      chainNum,
+                 nkept = 0,
+                 a;
+
+   if((selected = (unsigned char *)malloc(gHeader.nchains + 1))==NULL)
+      return(NULL);
+
+   for(chainNum=0; chainNum<gHeader.nchains; chainNum++)
+   {
+      selected[chainNum] = (NameSelected(chains[chainNum].pdbcode, 
+                                         chains[chainNum].chain) ?
+                            SEL_CHAIN : 0);
+   }
+
+   for(a=0; a<*naliases; a++)
+   {
+      if(NameSelected(aliases[a].pdbcode, aliases[a].chain))
+      {
+         selected[aliases[a].target] |= SEL_ALIAS;
+         aliases[nkept++] = aliases[a];
+      }
+   }
+   *naliases = nkept;
+
+   return(selected);
+}
+
+
+/************************************************************************/
+/*>int RunLookup(FILE *DBfp, int ndist, char *key, FILE *out)
+   ----------------------------------------------------------
+   Inputs:     FILE    *DBfp       Database file pointer
+               int     ndist       Number of distances in the database
+               char    *key        Residue identifier, chain or PDB code
+               FILE    *out        Output file pointer
+   Returns:    int                 Number of records printed (-1 on 
+                                   error)
+
+   Runs a LOOKUP, printing the record of a residue (e.g. 1abc.A.52) or
+   the records of a chain (1abc.A) or of every chain of a PDB entry 
+   (1abc) in the form of a text database.
+
+   16.10.26 Original   By: ACRM
+*/
+int RunLookup(FILE *DBfp, int ndist, char *key, FILE *out)
+{
+   if(gBinary)
+      return(LookupBinary(DBfp, key, out));
+   return(LookupText(DBfp, ndist, key, out));
+}
+
+
+/************************************************************************/
+/*>int RunShardedLookup(char *key, FILE *out)
+   ------------------------------------------
+   Inputs:     char    *key        Residue identifier, chain or PDB code
+               FILE    *out        Output file pointer
+   Returns:    int                 Number of records printed (-1 on 
+                                   error)
+   Globals:    char    gShards     The shard filenames
+               int     gNShards    Number of shards
+
+   Runs a LOOKUP on each shard of a sharded database in turn.
+
+   16.10.26 Original   By: ACRM
+*/
+int RunShardedLookup(char *key, FILE *out)
+{
+   FILE *DBfp;
+   int  ndist,
+        nfound = 0,
+        n,
+        i;
+
+   for(i=0; i<gNShards; i++)
+   {
+      ndist = 20;
+      if((DBfp = OpenDatabase(gShards[i], &ndist))==NULL)
+         return(-1);
+      n = RunLookup(DBfp, ndist, key, out);
+      CloseDatabase(DBfp);
+      if(n < 0)
+         return(-1);
+      nfound += n;
+   }
+
+   return(nfound);
+}
+
+
+/************************************************************************/
+/*>int LookupText(FILE *DBfp, int ndist, char *key, FILE *out)
+   -----------------------------------------------------------
+   Inputs:     FILE    *DBfp       Text database file pointer
+               int     ndist       Number of distances in the database
+               char    *key        Residue identifier, chain or PDB code
+               FILE    *out        Output file pointer
+   Returns:    int                 Number of records printed (-1 on 
+                                   error)
+
+   Runs a LOOKUP on a text database. There is no index, so the records
+   are scanned for those which match and these are printed as they 
+   are. The file is returned to the first record afterwards so that a
+   search may follow.
+
+   16.10.26 Original   By: ACRM
+*/
+int LookupText(FILE *DBfp, int ndist, char *key, FILE *out)
+{
+   char  *buffer,
+         recordKey[CADB_MAXKEY],
+         *c;
+   int   bufferSize,
+         keyLen = strlen(key),
+         ndots  = 0,
+         nfound = 0;
+   off_t start;
+
+   for(c=key; *c; c++)
+   {
+      if(*c == '.')
+         ndots++;
+   }
+
+   bufferSize = (2 * ndist * 7) + (gAngles ? 14 : 0) + 
+                (gSequence ? 2 : 0) + 100;
+   if((buffer=(char *)malloc(bufferSize * sizeof(char)))==NULL)
+   {
+      fprintf(stderr,"No memory for buffer to read database file\n");
+      return(-1);
+   }
+   start = ftello(DBfp);
+
+   while(fgets(buffer,bufferSize,DBfp))
+   {
+      TERMINATE(buffer);
+      if((buffer[0] == '!') ||
+         (buffer[0] == '#') ||
+         !strlen(buffer))
+         continue;
+
+      /* A residue must match exactly; a chain or PDB code must be 
+         followed by a dot
+      */
+      sscanf(buffer,"%s",recordKey);
+      if(!strncmp(recordKey, key, keyLen) &&
+         ((recordKey[keyLen] == '\0') ||
+          ((recordKey[keyLen] == '.') && (ndots < 2))))
+      {
+         fprintf(out,"%s\n",buffer);
+         nfound++;
+      }
+   }
+
+   free(buffer);
+   if(fseeko(DBfp, start, SEEK_SET))
+   {
+      fprintf(stderr,"Unable to rewind database\n");
+      return(-1);
+   }
+   return(nfound);
+}
+
+
+/************************************************************************/
+/*>int LookupBinary(FILE *DBfp, char *key, FILE *out)
+   --------------------------------------------------
+   Inputs:     FILE    *DBfp       Binary database file pointer
+               char    *key        Residue identifier, chain or PDB code
+               FILE    *out        Output file pointer
+   Returns:    int                 Number of records printed (-1 on 
+                                   error)
+   Globals:    CADBHEADER gHeader  Header of the database
+
+   Runs a LOOKUP on a binary database. The chains are found by 
+   FindChainNames() and then only their chain table entries and chain
+   blocks are read. All the columns of each chain are read. A chain 
+   found through an alias is reported under the alias.
+
+   16.10.26 Original   By: ACRM
+*/
+int LookupBinary(FILE *DBfp, char *key, FILE *out)
+{
+   CADBKEY   probe,
+             *names;
+   CADBCHAIN chain;
+   CHAINDATA data;
+   uint64_t  nnames,
+             n;
+   char      *resid,
+             resKey[CADB_MAXKEY];
+   int       ndist  = (int)gHeader.ndist,
+             ncol   = (gForward ? ndist : 2*ndist),
+             nfound = 0,
+             res;
+   BOOL      coords = (gHeader.layout == CADB_LAYOUT_COORD),
+             quant  = (gHeader.layout == CADB_LAYOUT_QUANT),
+             ok     = TRUE;
+
+   resid = SplitKey(key, &probe);
+   if((names = FindChainNames(DBfp, &probe, &nnames))==NULL)
+   {
+      fprintf(stderr,"Unable to read chain names from database\n");
+      return(-1);
+   }
+
+   memset(&data, 0, sizeof(CHAINDATA));
+   if(!coords)
+   {
+      if((data.cols = (int *)malloc((ncol+1) * sizeof(int)))==NULL)
+      {
+         fprintf(stderr,"No memory for column list\n");
+         free(names);
+         return(-1);
+      }
+      for(data.ncols=0; data.ncols<ncol; data.ncols++)
+         data.cols[data.ncols] = data.ncols;
+   }
+
+   for(n=0; n<nnames; n++)
+   {
+      /* Read the chain table entry of the chain holding the data       */
+      if(fseeko(DBfp, (off_t)(gHeader.chainTable + 
+                              names[n].target * sizeof(CADBCHAIN)), 
+                SEEK_SET) ||
+         (fread(&chain, sizeof(CADBCHAIN), 1, DBfp) != 1))
+         ok = FALSE;
+      else if(coords)
+         ok = ReadCoordBlock(DBfp, &chain, &data);
+      else if(quant)
+         ok = ReadQuantBlock(DBfp, &chain, ncol, &data);
+      else
+         ok = ReadChainBlock(DBfp, &chain, ncol, &data);
+
+      if(ok && !coords && (gHeader.flags & CADB_FLAG_ANGLES))
+         ok = ReadAngleBlock(DBfp, &chain, ncol, &data);
+      if(ok)
+         ok = ReadResids(DBfp, &chain, &data);
+      if(!ok)
+      {
+         fprintf(stderr,"Error reading chain %s.%s from database\n",
+                 names[n].pdbcode, names[n].chain);
+         break;
+      }
+
+      memcpy(chain.pdbcode, names[n].pdbcode, 8);
+      memcpy(chain.chain,   names[n].chain,   8);
+      for(res=0; res<data.nres; res++)
+      {
+         CADBMakeKey(resKey, &chain, &(data.resids[res]));
+         if((resid == NULL) || !strcmp(resKey, key))
+         {
+            PrintRecord(out, resKey, &data, res, ndist);
+            nfound++;
+         }
+      }
+   }
+
+   free(names);
+   if(data.cols != NULL)
+      free(data.cols);
+   FreeChainData(&data);
+
+   return(ok ? nfound : -1);
+}
+
+
+/************************************************************************/
+/*>CADBKEY *FindChainNames(FILE *DBfp, CADBKEY *probe, uint64_t *nnames)
+   ---------------------------------------------------------------------
+   Inputs:     FILE     *DBfp      Binary database file pointer
+               CADBKEY  *probe     PDB code and chain label (or empty
+                                   for all chains) to find
+   Outputs:    uint64_t *nnames    Number of chains found
+   Returns:    CADBKEY  *          Malloc'd names of the chains and 
+                                   aliases found, sorted, with the 
+                                   index of the chain holding the data
+                                   in target (NULL on error)
+   Globals:    FILE     *gKeyFp    The key index file pointer
+               CADBKEYHEADER gKeyHeader  Header of the key index
+
+   Finds the chains (and aliases) matching a PDB code and chain label.
+   With a key index, the matching entries are found by a binary search
+   and are consecutive, so only a few entries are read. Otherwise the
+   chain table and alias table are read and searched.
+
+   16.10.26 Original   By: ACRM
+*/
+CADBKEY *FindChainNames(FILE *DBfp, CADBKEY *probe, uint64_t *nnames)
+{
+   CADBKEY   *names,
+             key;
+   CADBCHAIN *chains;
+   CADBALIAS *aliases  = NULL;
+   uint64_t  naliases  = 0,
+             pos,
+             i;
+
+   *nnames = 0;
+   if(gKeyFp != NULL)
+   {
+      if(!CADBFindKey(gKeyFp, &gKeyHeader, probe, &pos) ||
+         fseeko(gKeyFp, (off_t)(sizeof(CADBKEYHEADER) + 
+                                pos * sizeof(CADBKEY)), SEEK_SET))
+         return(NULL);
+
+      /* Count the matching entries and then read them together         */
+      while((pos + *nnames < gKeyHeader.nkeys) &&
+            (fread(&key, sizeof(CADBKEY), 1, gKeyFp) == 1) &&
+            NameMatches(&key, probe))
+         (*nnames)++;
+
+      if((names = (CADBKEY *)malloc((*nnames + 1) * sizeof(CADBKEY)))
+         ==NULL)
+         return(NULL);
+      if(fseeko(gKeyFp, (off_t)(sizeof(CADBKEYHEADER) + 
+                                pos * sizeof(CADBKEY)), SEEK_SET) ||
+         (fread(names, sizeof(CADBKEY), *nnames, gKeyFp) != *nnames))
+      {
+         free(names);
+         return(NULL);
+      }
+      return(names);
+   }
+
+   if((chains = CADBReadChainTable(DBfp, &gHeader))==NULL)
+      return(NULL);
+   if((gHeader.flags & CADB_FLAG_ALIASES) &&
+      ((aliases = CADBReadAliases(DBfp, &gHeader, &naliases))==NULL))
+   {
+      free(chains);
+      return(NULL);
+   }
+
+   if((names = (CADBKEY *)malloc((gHeader.nchains + naliases + 1) * 
+                                 sizeof(CADBKEY)))!=NULL)
+   {
+      for(i=0; i<gHeader.nchains; i++)
+      {
+         memcpy(names[*nnames].pdbcode, chains[i].pdbcode, 8);
+         memcpy(names[*nnames].chain,   chains[i].chain,   8);
+         names[*nnames].target = i;
+         if(NameMatches(&(names[*nnames]), probe))
+            (*nnames)++;
+      }
+      for(i=0; i<naliases; i++)
+      {
+         memcpy(names[*nnames].pdbcode, aliases[i].pdbcode, 8);
+         memcpy(names[*nnames].chain,   aliases[i].chain,   8);
+         names[*nnames].target = aliases[i].target;
+         if(NameMatches(&(names[*nnames]), probe))
+            (*nnames)++;
+      }
+      qsort(names, *nnames, sizeof(CADBKEY), CADBCompareKeys);
+   }
+
+   free(chains);
+   if(aliases != NULL) free(aliases);
+   return(names);
+}
+
+
+/************************************************************************/
+/*>void PrintRecord(FILE *out, char *key, CHAINDATA *data, int res, 
+                    int ndist)
+   ----------------------------------------------------------------
+   Inputs:     FILE      *out      Output file pointer
+               char      *key      Residue identifier
+               CHAINDATA *data     Chain data with all the columns read
+               int       res       The residue in the chain
+               int       ndist     Number of distances in the database
+
+   Prints a record of a binary database as it would appear in a text
+   database: the residue identifier, the DP and then DM distances 
+   (-1.00 where missing), the CA angle and torsion (if stored) and the
+   residue type (if stored). For a forward-only database, the DM 
+   distances are the DP distances of the earlier residues. For a 
+   coordinate database, the x, y and z coordinates are printed instead
+   of the distances.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 The residue type comes last, as in a text database
+   16.10.26 A blank insertion code is printed as a space, as in a text
+            database
+*/
+void PrintRecord(FILE *out, char *key, CHAINDATA *data, int res, 
+                 int ndist)
+{
+   int  col,
+        k,
+        d;
+   char insert = data->resids[res].insert;
+
+   fprintf(out, "%s%s ", key, 
+           (((insert == ' ') || (insert == '\0')) ? " " : ""));
+
+   if(gHeader.layout == CADB_LAYOUT_COORD)
+   {
+      for(k=0; k<3; k++)
+         fprintf(out, "%.3f ", data->coords[k * data->nres + res]);
+      if(gSequence)
+         fprintf(out, "%c ", data->resids[res].restype);
+      fprintf(out, "\n");
+      return;
+   }
+
+   for(col=0; col<2*ndist; col++)
+   {
+      k = col - ndist + 1;
+      if((col < ndist) || !gForward)
+         d = StoredDist(data, res, col);
+      else
+         d = ((res < k) ? CADB_MISSING : StoredDist(data, res-k, k-1));
+
+      if(d == CADB_MISSING)
+         fprintf(out, "-1.00 ");
+      else
+         fprintf(out, "%.2f ", (REAL)d / CADB_SCALE);
+   }
+
+   if(gHeader.flags & CADB_FLAG_ANGLES)
+   {
+      for(k=0; k<2; k++)
+      {
+         d = data->angles[k * data->nres + res];
+         if(d == CADB_MISSING)
+            fprintf(out, "-1.00 ");
+         else
+            fprintf(out, "%.2f ", (REAL)d / CADB_SCALE);
+      }
+   }
+   if(gSequence)
+      fprintf(out, "%c ", data->resids[res].restype);
+   fprintf(out, "\n");
+}
+
+
+/************************************************************************/
+/*>int StoredDist(CHAINDATA *data, int row, int col)
+   -------------------------------------------------
+   Inputs:     CHAINDATA *data     Chain data
+               int       row       Residue in the chain
+               int       col       Column stored in the database
+   Returns:    int                 Distance in hundredths of an Angstrom
+                                   or CADB_MISSING
+
+   Gets a distance from a chain of any of the distance layouts.
+
+   16.10.26 Original   By: ACRM
+*/
+int StoredDist(CHAINDATA *data, int row, int col)
+{
+   if(gHeader.layout == CADB_LAYOUT_QUANT)
+      return(CADBQuantDist(&(data->qblocks[col]), 
+                           data->qraw + col * data->colStride,
+                           data->nres, row));
+   return(data->dist[row * data->rowStride + col * data->colStride]);
+}
+
+
+/************************************************************************/
+/*>int *ConstrainedColumns(int ndist, int *ncols)
+   ----------------------------------------------
+   Inputs:     int    ndist      Number of distances in database
+   Outputs:    int    *ncols     Number of columns in the list
+   Returns:    int    *          Malloc'd list of columns (NULL if no
+                                 memory)
+
+   Builds a sorted list of the distance columns (0..2*ndist-1) for 
+   which there are DP or DM constraints. For a forward-only database,
+   a DM constraint needs the DP column with the same offset.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added forward-only databases
+*/
+int *ConstrainedColumns(int ndist, int *ncols)
+{
+   CONSTRAINT *c;
+   BOOL       *used;
+   int        *cols,
+              i;
+
+   if((used = (BOOL *)calloc(2*ndist, sizeof(BOOL)))==NULL)
+      return(NULL);
+   if((cols = (int *)malloc((2*ndist+1) * sizeof(int)))==NULL)
+   {
+      free(used);
+      return(NULL);
+   }
+
+   for(c=gPosConsList; c!=NULL; NEXT(c))
+      used[c->cons - 1] = TRUE;
+   for(c=gNegConsList; c!=NULL; NEXT(c))
+      used[(gForward ? 0 : ndist) + c->cons - 1] = TRUE;
+
+   *ncols = 0;
+   for(i=0; i<2*ndist; i++)
+   {
+      if(used[i])
+         cols[(*ncols)++] = i;
+   }
+
+   free(used);
+   return(cols);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadChainBlock(FILE *DBfp, CADBCHAIN *chain, int ncol, 
+                       CHAINDATA *data)
+   -----------------------------------------------------------
+   Inputs:     FILE      *DBfp     Database file pointer
+               CADBCHAIN *chain    Chain table entry
+               int       ncol      Number of distances per residue
+   I/O:        CHAINDATA *data     Chain data. The arrays are expanded
+                                   as required
+   Returns:    BOOL                Success?
+
+   Reads the residue identifiers and distances for a chain. For the
+   column layout, only the constrained columns are read (runs of 
+   adjacent columns being read together) and the residue identifiers
+   are left for ReadResids().
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added column layout. Allocation moved to AllocChainData()
+*/
+BOOL ReadChainBlock(FILE *DBfp, CADBCHAIN *chain, int ncol, 
+                    CHAINDATA *data)
+{
+   int    nres = (int)chain->nres,
+          i,
+          run;
+   size_t count;
+   
+   if(!AllocChainData(data, nres, ncol))
+      return(FALSE);
+
+   if(gHeader.layout == CADB_LAYOUT_COLUMN)
+   {
+      data->rowStride  = 1;
+      data->colStride  = nres;
+      data->residsRead = FALSE;
+
+      for(i=0; i<data->ncols; i+=run)
+      {
+         for(run=1; 
+             (i+run < data->ncols) && 
+             (data->cols[i+run] == data->cols[i]+run); 
+             run++);
+
+         if(fseeko(DBfp, (off_t)(chain->offset + 
+                                 nres * sizeof(CADBRESID) +
+                                 data->cols[i] * nres * sizeof(uint16_t)),
+                   SEEK_SET))
+            return(FALSE);
+         count = (size_t)(run * nres);
+         if(fread(data->dist + data->cols[i]*nres, sizeof(uint16_t), 
+                  count, DBfp) != count)
+            return(FALSE);
+      }
+      return(TRUE);
+   }
+
+   data->rowStride  = ncol;
+   data->colStride  = 1;
+   data->residsRead = TRUE;
+
+   if(fseeko(DBfp, (off_t)chain->offset, SEEK_SET))
+      return(FALSE);
+   if(fread(data->resids, sizeof(CADBRESID), nres, DBfp) != (size_t)nres)
+      return(FALSE);
+   if(fread(data->dist, sizeof(uint16_t), nres*ncol, DBfp) != 
+      (size_t)(nres*ncol))
+      return(FALSE);
+   
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadResids(FILE *DBfp, CADBCHAIN *chain, CHAINDATA *data)
+   --------------------------------------------------------------
+   Inputs:     FILE      *DBfp     Database file pointer
+               CADBCHAIN *chain    Chain table entry
+   I/O:        CHAINDATA *data     Chain data
+   Returns:    BOOL                Success?
+
+   Reads the residue identifiers for a chain if they have not already
+   been read.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL ReadResids(FILE *DBfp, CADBCHAIN *chain, CHAINDATA *data)
+{
+   if(!data->residsRead)
+   {
+      if(fseeko(DBfp, (off_t)chain->offset, SEEK_SET))
+         return(FALSE);
+      if(fread(data->resids, sizeof(CADBRESID), data->nres, DBfp) != 
+         (size_t)data->nres)
+         return(FALSE);
+      data->residsRead = TRUE;
+   }
+   return(TRUE);
+}
+
+
+/*>BOOL AllocChainData(CHAINDATA *data, int nres, int nval)
+   --------------------------------------------------------
+   I/O:        CHAINDATA *data     Chain data
+   Inputs:     int       nres      Number of residues in the chain
+               int       nval      Number of distances per residue or 3
+                                   for coordinates
+   Returns:    BOOL                Success?
+
+   Makes sure that the arrays in the chain data are big enough for a
+   chain of nres residues.
+
+   16.10.26 Original (split from ReadChainBlock())   By: ACRM
+   16.10.26 Added quantized databases
+   16.10.26 Added angles
+   16.10.26 Added seqHits
+*/
+BOOL AllocChainData(CHAINDATA *data, int nres, int nval)
+{
+   if(nres > data->maxres)
+   {
+      FreeChainData(data);
+      data->maxres  = nres;
+      data->resids  = (CADBRESID *)malloc(nres * sizeof(CADBRESID));
+      data->hits    = (unsigned char *)malloc(nres);
+      data->negHits = (unsigned char *)malloc(nres);
+      data->angles  = (uint16_t *)malloc(2 * nres * sizeof(uint16_t));
+      data->angleHits = (unsigned char *)malloc(nres);
+      data->seqHits = (unsigned char *)malloc(nres);
+      if(gHeader.layout == CADB_LAYOUT_COORD)
+      {
+         data->coords    = (float *)malloc(3 * nres * sizeof(float));
+         data->angleWork = (REAL *)malloc(5 * nres * sizeof(REAL));
+      }
+      else if(gHeader.layout == CADB_LAYOUT_QUANT)
+      {
+         data->qblocks = (CADBQBLOCK *)malloc(nval * sizeof(CADBQBLOCK));
+         data->qdir    = (uint32_t *)malloc((nval+1) * sizeof(uint32_t));
+         data->qraw    = (unsigned char *)malloc(3 * nres * nval);
+         data->qstored = (unsigned char *)malloc(3 * nres);
+      }
+      else
+      {
+         data->dist = (uint16_t *)malloc(nres * nval * sizeof(uint16_t));
+      }
+
+      if((data->resids  == NULL) || 
+         (data->hits    == NULL) || 
+         (data->negHits == NULL) ||
+         (data->angles  == NULL) ||
+         (data->angleHits == NULL) ||
+         (data->seqHits == NULL) ||
+         ((data->coords != NULL) && (data->angleWork == NULL)) ||
+         ((data->dist == NULL) && (data->coords == NULL) &&
+          (data->qstored == NULL)) ||
+         ((data->qstored != NULL) && 
+          ((data->qblocks == NULL) || (data->qdir == NULL) ||
+           (data->qraw == NULL))))
+      {
+         FreeChainData(data);
+         return(FALSE);
+      }
+   }
+   data->nres = nres;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void FreeChainData(CHAINDATA *data)
+   -----------------------------------
+   I/O:        CHAINDATA *data     Chain data
+
+   Frees the arrays in the chain data (but not the column list).
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added angles
+   16.10.26 Added seqHits
+*/
+void FreeChainData(CHAINDATA *data)
+{
+   if(data->resids  != NULL) free(data->resids);
+   if(data->dist    != NULL) free(data->dist);
+   if(data->coords  != NULL) free(data->coords);
+   if(data->hits    != NULL) free(data->hits);
+   if(data->negHits != NULL) free(data->negHits);
+   if(data->qblocks != NULL) free(data->qblocks);
+   if(data->qdir    != NULL) free(data->qdir);
+   if(data->qraw    != NULL) free(data->qraw);
+   if(data->qstored != NULL) free(data->qstored);
+   if(data->angles  != NULL) free(data->angles);
+   if(data->angleWork != NULL) free(data->angleWork);
+   if(data->angleHits != NULL) free(data->angleHits);
+   if(data->seqHits != NULL) free(data->seqHits);
+   data->resids  = NULL;
+   data->dist    = NULL;
+   data->coords  = NULL;
+   data->qblocks = NULL;
+   data->qdir    = NULL;
+   data->qraw    = NULL;
+   data->qstored = NULL;
+   data->hits    = NULL;
+   data->negHits = NULL;
+   data->angles    = NULL;
+   data->angleWork = NULL;
+   data->angleHits = NULL;
+   data->seqHits   = NULL;
+   data->maxres  = 0;
+}
+
+
+/************************************************************************/
+/*>BOOL ReadCoordBlock(FILE *DBfp, CADBCHAIN *chain, CHAINDATA *data)
+   ------------------------------------------------------------------
+   Inputs:     FILE      *DBfp     Database file pointer
+               CADBCHAIN *chain    Chain table entry
+   I/O:        CHAINDATA *data     Chain data. The arrays are expanded
+                                   as required
+   Returns:    BOOL                Success?
+
+   Reads the coordinates for a chain from a coordinate database. The
+   residue identifiers are left for ReadResids().
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL ReadCoordBlock(FILE *DBfp, CADBCHAIN *chain, CHAINDATA *data)
+{
+   int    nres  = (int)chain->nres;
+   size_t count = (size_t)(3 * nres);
+   
+   if(!AllocChainData(data, nres, 3))
+      return(FALSE);
+   data->residsRead = FALSE;
+
+   if(fseeko(DBfp, (off_t)(chain->offset + nres * sizeof(CADBRESID)),
+             SEEK_SET))
+      return(FALSE);
+   if(fread(data->coords, sizeof(float), count, DBfp) != count)
+      return(FALSE);
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadAngleBlock(FILE *DBfp, CADBCHAIN *chain, int nval,
+                       CHAINDATA *data)
+   ------------------------------------------------------------
+   Inputs:     FILE      *DBfp     Database file pointer
+               CADBCHAIN *chain    Chain table entry
+               int       nval      Number of distances per residue
+   I/O:        CHAINDATA *data     Chain data. The arrays are expanded
+                                   as required
+   Returns:    BOOL                Success?
+
+   Reads the CA angles and torsions for a chain. These are the last
+   4*nres bytes of the chain block in a database built with makecadb -a.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL ReadAngleBlock(FILE *DBfp, CADBCHAIN *chain, int nval,
+                    CHAINDATA *data)
+{
+   int    nres  = (int)chain->nres;
+   size_t count = (size_t)(2 * nres);
+
+   if(!AllocChainData(data, nres, nval))
+      return(FALSE);
+
+   if(fseeko(DBfp, (off_t)(chain->offset + chain->size - 
+                           count * sizeof(uint16_t)), SEEK_SET))
+      return(FALSE);
+   if(fread(data->angles, sizeof(uint16_t), count, DBfp) != count)
+      return(FALSE);
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void CalcCoordAngles(CHAINDATA *data)
+   -------------------------------------
+   I/O:        CHAINDATA *data     Chain data. angles[] is filled in
+
+   Calculates the CA angles and torsions for a chain read from a 
+   coordinate database by ReadCoordBlock() and stores them as they
+   would be stored by makecadb -a.
+
+   16.10.26 Original   By: ACRM
+*/
+void CalcCoordAngles(CHAINDATA *data)
+{
+   int  nres  = data->nres,
+        i;
+   REAL *x    = data->angleWork,
+        *y    = x + nres,
+        *z    = y + nres,
+        *work = z + nres;
+
+   for(i=0; i<3*nres; i++)
+      x[i] = (REAL)data->coords[i];
+
+   CADBCaAngles(x, y, z, nres, work);
+   for(i=0; i<2*nres; i++)
+      data->angles[i] = CADBEncodeDist(work[i]);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadQuantBlock(FILE *DBfp, CADBCHAIN *chain, int ncol, 
+                       CHAINDATA *data)
+   -----------------------------------------------------------
+   Inputs:     FILE      *DBfp     Database file pointer
+               CADBCHAIN *chain    Chain table entry
+               int       ncol      Number of distances per residue
+   I/O:        CHAINDATA *data     Chain data. The arrays are expanded
+                                   as required
+   Returns:    BOOL                Success?
+
+   Reads the column directory for a chain from a quantized database,
+   then reads and decompresses the constrained columns. The residue
+   identifiers are left for ReadResids(). A compressed column can only
+   be read if searchcadb was compiled with HAVE_ZLIB.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL ReadQuantBlock(FILE *DBfp, CADBCHAIN *chain, int ncol, 
+                    CHAINDATA *data)
+{
+   CADBQBLOCK    *block;
+   unsigned char *raw;
+   int           nres = (int)chain->nres,
+                 col,
+                 i;
+   size_t        rawLength;
+#ifdef HAVE_ZLIB
+   uLongf        zlength;
+#endif
+
+   if(!AllocChainData(data, nres, ncol))
+      return(FALSE);
+   data->rowStride  = 1;
+   data->colStride  = 3 * data->maxres;
+   data->residsRead = FALSE;
+
+   if(fseeko(DBfp, (off_t)(chain->offset + nres * sizeof(CADBRESID)),
+             SEEK_SET))
+      return(FALSE);
+   if(fread(data->qdir, sizeof(uint32_t), ncol+1, DBfp) != 
+      (size_t)(ncol+1))
+      return(FALSE);
+
+   for(i=0; i<data->ncols; i++)
+   {
+      col   = data->cols[i];
+      block = &(data->qblocks[col]);
+      raw   = data->qraw + col * data->colStride;
+
+      if(fseeko(DBfp, (off_t)(chain->offset + data->qdir[col]), 
+                SEEK_SET))
+         return(FALSE);
+      if(fread(block, sizeof(CADBQBLOCK), 1, DBfp) != 1)
+         return(FALSE);
+
+      if(block->shift > CADB_QMAXSHIFT)
+         return(FALSE);
+      rawLength = CADB_QRAWSIZE(nres, block->shift);
+      if(block->stored > rawLength)
+         return(FALSE);
+
+      if(block->stored == rawLength)
+      {
+         if(fread(raw, 1, rawLength, DBfp) != rawLength)
+            return(FALSE);
+      }
+      else
+      {
+#ifdef HAVE_ZLIB
+         if(fread(data->qstored, 1, block->stored, DBfp) != 
+            (size_t)block->stored)
+            return(FALSE);
+         zlength = (uLongf)rawLength;
+         if((uncompress(raw, &zlength, data->qstored, 
+                        (uLong)block->stored) != Z_OK) ||
+            (zlength != (uLongf)rawLength))
+            return(FALSE);
+#else
+         return(FALSE);
+#endif
+      }
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void FindDistanceHits(CHAINDATA *data, int ndist)
+   -------------------------------------------------
+   I/O:        CHAINDATA *data     Chain data. hits[] is filled in
+   Inputs:     int       ndist     Number of distances in the database
+
+   Flags the residues in a chain of distances which start a loop that 
+   satisfies the constraints.
+
+   16.10.26 Original (split from RunBinarySearch())   By: ACRM
+*/
+void FindDistanceHits(CHAINDATA *data, int ndist)
+{
+   int res,
+       last;
+   
+   for(res=0; res<data->nres; res++)
+   {
+      data->hits[res] = 0;
+      if(BinaryRecordOK(data, res, 0, gPosConsList))
+      {
+         last = res + gLoopLength - 1;
+         if((last >= data->nres) ||
+            BinaryRecordOK(data, last, ndist, gNegConsList))
+         {
+            data->hits[res] = 1;
+         }
+      }
    }
+}
 
-   /* Display the flagged records                                       */
-   DisplayResults(out);
 
-   free(buffer);
+/************************************************************************/
+/*>BOOL FindAngleHits(CHAINDATA *data)
+   -----------------------------------
+   I/O:        CHAINDATA *data     Chain data. angleHits[] is filled in
+   Returns:    BOOL                Do any residues satisfy the 
+                                   constraints?
+
+   Flags the residues in a chain which start a loop that satisfies the
+   ANGLE and TORSION constraints. This is done before the distances are
+   read so that a chain with no hits can be skipped.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL FindAngleHits(CHAINDATA *data)
+{
+   int  res;
+   BOOL found = FALSE;
+
+   for(res=0; res<data->nres; res++)
+   {
+      data->angleHits[res] = 
+         (AngleRecordOK(data, res, data->angles, gAngleConsList) &&
+          AngleRecordOK(data, res, data->angles + data->nres, 
+                        gTorsionConsList));
+      if(data->angleHits[res])
+         found = TRUE;
+   }
+   return(found);
+}
+
+
+/************************************************************************/
+/*>BOOL AngleRecordOK(CHAINDATA *data, int res, uint16_t *angles,
+                      CONSTRAINT *ConsList)
+   --------------------------------------------------------------
+   Inputs:     CHAINDATA  *data      Chain data
+               int        res        First residue of the loop
+               uint16_t   *angles    The angles or torsions for the
+                                     chain
+               CONSTRAINT *ConsList  ANGLE or TORSION constraints
+   Returns:    BOOL                  Matches constraints?
+
+   Tests the loop starting at res against a list of ANGLE or TORSION
+   constraints. As for the DM constraints, a position beyond the end
+   of the chain is not tested.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL AngleRecordOK(CHAINDATA *data, int res, uint16_t *angles,
+                   CONSTRAINT *ConsList)
+{
+   CONSTRAINT *c;
+   int        pos;
+
+   for(c=ConsList; c!=NULL; NEXT(c))
+   {
+      pos = res + c->cons - 1;
+      if((pos < data->nres) && !AngleOK((int)angles[pos], c))
+         return(FALSE);
+   }
    return(TRUE);
 }
 
 
 /************************************************************************/
-/*>void ReadArrayFromBuffer(char *buffer, int ndist, REAL *distArray)
+/*>BOOL FindSeqHits(CHAINDATA *data)
+   ---------------------------------
+   I/O:        CHAINDATA *data     Chain data. seqHits[] is filled in
+   Returns:    BOOL                Do any residues satisfy the 
+                                   constraints?
+
+   Flags the residues in a chain which start a loop that satisfies the
+   SEQ constraints. Only the residue identifiers need to have been
+   read. As for the DM constraints, a position beyond the end of the 
+   chain is not tested.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL FindSeqHits(CHAINDATA *data)
+{
+   SEQCONS *s;
+   int     res,
+           pos;
+   BOOL    found = FALSE;
+
+   for(res=0; res<data->nres; res++)
+   {
+      data->seqHits[res] = 1;
+      for(s=gSeqConsList; s!=NULL; NEXT(s))
+      {
+         pos = res + s->pos - 1;
+         if((pos < data->nres) && !SeqOK(data->resids[pos].restype, s))
+         {
+            data->seqHits[res] = 0;
+            break;
+         }
+      }
+      if(data->seqHits[res])
+         found = TRUE;
+   }
+   return(found);
+}
+
+
+/************************************************************************/
+/*>void FindQuantHits(CHAINDATA *data, int ndist)
+   ----------------------------------------------
+   I/O:        CHAINDATA *data     Chain data. hits[] is filled in
+   Inputs:     int       ndist     Number of distances in the database
+
+   Equivalent of FindDistanceHits() for a quantized database. The bins
+   of each constrained column are first classed against its constraint
+   since the base and shift differ from chain to chain.
+
+   16.10.26 Original   By: ACRM
+*/
+void FindQuantHits(CHAINDATA *data, int ndist)
+{
+   CONSTRAINT *c;
+   int        res,
+              last;
+
+   for(c=gPosConsList; c!=NULL; NEXT(c))
+      SetQuantClasses(c, &(data->qblocks[c->cons - 1]));
+   for(c=gNegConsList; c!=NULL; NEXT(c))
+      SetQuantClasses(c, &(data->qblocks[(gForward ? 0 : ndist) + 
+                                         c->cons - 1]));
+   
+   for(res=0; res<data->nres; res++)
+   {
+      data->hits[res] = 0;
+      if(QuantRecordOK(data, res, 0, gPosConsList))
+      {
+         last = res + gLoopLength - 1;
+         if((last >= data->nres) ||
+            QuantRecordOK(data, last, ndist, gNegConsList))
+         {
+            data->hits[res] = 1;
+         }
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>void SetQuantClasses(CONSTRAINT *c, CADBQBLOCK *block)
+   ------------------------------------------------------
+   I/O:        CONSTRAINT *c       Constraint. qclass[] is filled in
+   Inputs:     CADBQBLOCK *block   Header of the constrained column
+
+   Classes each bin of a quantized column as QUANT_IN if every distance
+   in the bin satisfies the constraint, QUANT_OUT if none does or 
+   QUANT_EDGE if the residual is needed to decide.
+
+   16.10.26 Original   By: ACRM
+*/
+void SetQuantClasses(CONSTRAINT *c, CADBQBLOCK *block)
+{
+   int q,
+       lo,
+       hi;
+
+   for(q=0; q<=CADB_QMAXBIN; q++)
+   {
+      lo = block->base + (q << block->shift);
+      hi = lo + (1 << block->shift) - 1;
+      if((hi < c->lo) || (lo > c->hi))
+         c->qclass[q] = QUANT_OUT;
+      else if((lo >= c->lo) && (hi <= c->hi))
+         c->qclass[q] = QUANT_IN;
+      else
+         c->qclass[q] = QUANT_EDGE;
+   }
+   c->qclass[CADB_QMISSING] = (c->missingOK ? QUANT_IN : QUANT_OUT);
+}
+
+
+/************************************************************************/
+/*>void FindCoordHits(CHAINDATA *data)
+   -----------------------------------
+   I/O:        CHAINDATA *data     Chain data. hits[] is filled in
+
+   Flags the residues in a chain of coordinates which start a loop that
+   satisfies the constraints. Only the distances needed by the 
+   constraints are calculated; each constraint is applied to the whole
+   chain at once by CoordPairMask(). hits[] collects the DP tests for 
+   the residue starting each loop and negHits[] the DM tests for the 
+   residue ending each loop.
+
+   16.10.26 Original   By: ACRM
+*/
+void FindCoordHits(CHAINDATA *data)
+{
+   CONSTRAINT *c;
+   int        nres = data->nres,
+              npair,
+              res,
+              last;
+   float      *x   = data->coords,
+              *y   = data->coords + nres,
+              *z   = data->coords + 2*nres;
+   
+   memset(data->hits,    1, nres);
+   memset(data->negHits, 1, nres);
+
+   for(c=gPosConsList; c!=NULL; NEXT(c))
+   {
+      /* Residue i is paired with i+k                                  */
+      npair = (c->cons < nres) ? nres - c->cons : 0;
+      CoordPairMask(x, y, z, npair, c->cons, c->lo2, c->hi2, 
+                    data->hits);
+      if(!c->missingOK)
+         memset(data->hits + npair, 0, nres - npair);
+   }
+   
+   for(c=gNegConsList; c!=NULL; NEXT(c))
+   {
+      /* Residue j is paired with j-k, so the pair starting at i is 
+         applied to residue i+k
+      */
+      npair = (c->cons < nres) ? nres - c->cons : 0;
+      CoordPairMask(x, y, z, npair, c->cons, c->lo2, c->hi2, 
+                    data->negHits + (nres - npair));
+      if(!c->missingOK)
+         memset(data->negHits, 0, nres - npair);
+   }
+
+   for(res=0; res<nres; res++)
+   {
+      last = res + gLoopLength - 1;
+      if(data->hits[res] && (last < nres) && !data->negHits[last])
+         data->hits[res] = 0;
+   }
+}
+
+
+/************************************************************************/
+/*>void CoordPairMask(float *x, float *y, float *z, int npair, int k,
+                      float lo2, float hi2, unsigned char *mask)
    ------------------------------------------------------------------
+   Inputs:     float  *x,*y,*z     Coordinates for a chain
+               int    npair        Number of pairs to test
+               int    k            Offset between the residues of a pair
+               float  lo2          Minimum squared distance
+               float  hi2          Squared distance which must not be 
+                                   reached
+   I/O:        unsigned char *mask Cleared for each pair (i, i+k) where
+                                   the distance is out of range
+
+   The distance kernel for coordinate databases. Since the constraint
+   bounds are converted to squared distances, no square roots are 
+   needed. With GCC (or a compatible compiler), the vector extensions 
+   are used to test 4 pairs at a time (SSE on x86, NEON on ARM) without 
+   needing any special compiler flags.
+
+   16.10.26 Original   By: ACRM
+*/
+void CoordPairMask(float *x, float *y, float *z, int npair, int k,
+                   float lo2, float hi2, unsigned char *mask)
+{
+   int   i = 0;
+   float dx, dy, dz, d2;
+#ifdef __GNUC__
+   VFLOAT vx0, vy0, vz0, vx1, vy1, vz1, vd2,
+          vlo = {lo2, lo2, lo2, lo2},
+          vhi = {hi2, hi2, hi2, hi2};
+   VINT   vok;
+   int    j;
+
+   for(; i+VLEN <= npair; i+=VLEN)
+   {
+      memcpy(&vx0, x+i,   sizeof(VFLOAT));
+      memcpy(&vy0, y+i,   sizeof(VFLOAT));
+      memcpy(&vz0, z+i,   sizeof(VFLOAT));
+      memcpy(&vx1, x+i+k, sizeof(VFLOAT));
+      memcpy(&vy1, y+i+k, sizeof(VFLOAT));
+      memcpy(&vz1, z+i+k, sizeof(VFLOAT));
+      vx1 -= vx0;
+      vy1 -= vy0;
+      vz1 -= vz0;
+      vd2 = vx1*vx1 + vy1*vy1 + vz1*vz1;
+      vok = (vd2 >= vlo) & (vd2 < vhi);
+      for(j=0; j<VLEN; j++)
+         mask[i+j] &= (vok[j] != 0);
+   }
+#endif
+
+   for(; i<npair; i++)
+   {
+      dx = x[i+k] - x[i];
+      dy = y[i+k] - y[i];
+      dz = z[i+k] - z[i];
+      d2 = dx*dx + dy*dy + dz*dz;
+      mask[i] &= ((d2 >= lo2) && (d2 < hi2));
+   }
+}
+
+
+/************************************************************************/
+/*>BOOL BinaryRecordOK(CHAINDATA *data, int res, int ndist, 
+                       CONSTRAINT *ConsList)
+   ------------------------------------------------------
+   Inputs:     CHAINDATA  *data       Chain data
+               int        res         Residue of interest in the chain
+               int        ndist       Column offset (see RecordOK())
+               CONSTRAINT *ConsList   Linked list of constraints
+   Returns:    BOOL                   Matches constraints?
+
+   Binary equivalent of RecordOK() using the integer bounds. For a 
+   forward-only database, the DM distance at offset k is taken from the
+   DP distance at offset k of the residue k before this one.
+
+   16.10.26 Original   By: ACRM
+   16.10.26 Added forward-only databases
+*/
+BOOL BinaryRecordOK(CHAINDATA *data, int res, int ndist, 
+                    CONSTRAINT *ConsList)
+{
+   CONSTRAINT *c;
+   int        d;
+
+   for(c=ConsList; c!=NULL; NEXT(c))
+   {
+      if(ndist && gForward)
+      {
+         d = (res < c->cons) ? CADB_MISSING : 
+             data->dist[(res - c->cons) * data->rowStride + 
+                        (c->cons - 1) * data->colStride];
+      }
+      else
+      {
+         d = data->dist[res * data->rowStride + 
+                        (c->cons + ndist - 1) * data->colStride];
+      }
+      if(d == CADB_MISSING)
+      {
+         if(!c->missingOK)
+            return(FALSE);
+      }
+      else if((d < c->lo) || (d > c->hi))
+      {
+         return(FALSE);
+      }
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL QuantRecordOK(CHAINDATA *data, int res, int ndist, 
+                      CONSTRAINT *ConsList)
+   -----------------------------------------------------
+   Inputs:     CHAINDATA  *data       Chain data
+               int        res         Residue of interest in the chain
+               int        ndist       Column offset (see RecordOK())
+               CONSTRAINT *ConsList   Linked list of constraints
+   Returns:    BOOL                   Matches constraints?
+
+   Equivalent of BinaryRecordOK() for a quantized database. The test
+   is made on the bin using the classes set by SetQuantClasses(); the
+   exact distance is only decoded for a bin on the edge of the 
+   constraint.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL QuantRecordOK(CHAINDATA *data, int res, int ndist, 
+                   CONSTRAINT *ConsList)
+{
+   CONSTRAINT    *c;
+   unsigned char *raw;
+   int           row,
+                 col,
+                 d;
+
+   for(c=ConsList; c!=NULL; NEXT(c))
+   {
+      if(ndist && gForward)
+      {
+         if(res < c->cons)
+         {
+            if(!c->missingOK)
+               return(FALSE);
+            continue;
+         }
+         row = res - c->cons;
+         col = c->cons - 1;
+      }
+      else
+      {
+         row = res;
+         col = c->cons + ndist - 1;
+      }
+
+      raw = data->qraw + col * data->colStride;
+      switch(c->qclass[raw[row]])
+      {
+      case QUANT_OUT:
+         return(FALSE);
+      case QUANT_EDGE:
+         d = CADBQuantDist(&(data->qblocks[col]), raw, data->nres, row);
+         if((d < c->lo) || (d > c->hi))
+            return(FALSE);
+         break;
+      }
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void ReadArrayFromBuffer(char *buffer, int ncol, REAL *distArray)
+   -----------------------------------------------------------------
    Inputs:     char  *buffer      Buffer read from database file
-               int   ndist        Number of distances in file
+               int   ncol         Number of distances to read
    Outputs:    REAL  *distArray   Array of parsed distances
 
    Parses a set of distances out of the buffer into the distArray
 
    08.10.98 Original   By: ACRM
+   16.10.26 Now takes the number of distances to read rather than ndist.
+            GetWord() returns NULL once it has read the last word, so
+            the last distance on the line was previously never stored
 */
-void ReadArrayFromBuffer(char *buffer, int ndist, REAL *distArray)
+void ReadArrayFromBuffer(char *buffer, int ncol, REAL *distArray)
 {
    char *chp,
         word[16];
@@ -647,9 +4795,11 @@ void ReadArrayFromBuffer(char *buffer, int ndist, REAL *distArray)
    
    /* Put the others into the distance array                   */
    i=0;
-   while(((chp=GetWord(chp,word,16))!=NULL) && (i<ndist*2))
+   while((chp!=NULL) && (i<ncol))
    {
-      sscanf(word,"%lf",&(distArray[i++]));
+      chp=GetWord(chp,word,16);
+      if(sscanf(word,"%lf",&(distArray[i])) == 1)
+         i++;
    }
 }
 
@@ -685,6 +4835,129 @@ BOOL RecordOK(REAL *distArray, int ndist, CONSTRAINT *ConsList)
    return(TRUE);
 }
 
+/************************************************************************/
+/*>BOOL AngleOK(int angle, CONSTRAINT *c)
+   --------------------------------------
+   Inputs:     int        angle       Stored angle in hundredths of a
+                                      degree
+               CONSTRAINT *c          ANGLE or TORSION constraint
+   Returns:    BOOL                   Matches constraint?
+
+   Tests a stored angle or torsion against a constraint. A missing
+   value never satisfies the constraint. A torsion stored as 360.00 is
+   the same as 0.00.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL AngleOK(int angle, CONSTRAINT *c)
+{
+   if(angle == CADB_MISSING)
+      return(FALSE);
+   if(angle >= 36000)
+      angle -= 36000;
+
+   if(c->lo > c->hi)
+      return((angle >= c->lo) || (angle <= c->hi));
+   return((angle >= c->lo) && (angle <= c->hi));
+}
+
+/************************************************************************/
+/*>void CheckTextAngles(REAL *angles, char *currentKey, char **prevKeys,
+                        int keyPos, int ringSize, int nread)
+   ---------------------------------------------------------------------
+   Inputs:     REAL  *angles      The angle and torsion for this record
+               char  *currentKey  Key for this record
+               char  **prevKeys   Cyclic list of previous keys
+               int   keyPos       Position of this record in the list
+               int   ringSize     Size of the cyclic list
+               int   nread        Number of records read so far
+
+   Tests the angle and torsion of a record from a text database against
+   the ANGLE and TORSION constraints. A constraint at position pos 
+   applies to the loop starting pos-1 records earlier and, if it is not
+   satisfied, that key is removed from the DBM hash.
+
+   16.10.26 Original   By: ACRM
+*/
+void CheckTextAngles(REAL *angles, char *currentKey, char **prevKeys,
+                     int keyPos, int ringSize, int nread)
+{
+   CONSTRAINT *c;
+   int        i,
+              startPos;
+
+   for(i=0; i<2; i++)
+   {
+      for(c=(i ? gTorsionConsList : gAngleConsList); c!=NULL; NEXT(c))
+      {
+         if(nread < c->cons)
+            continue;
+         
+         startPos = (keyPos - (c->cons-1) + ringSize) % ringSize;
+         if(InSameChain(currentKey, prevKeys[startPos]) &&
+            !AngleOK((int)CADBEncodeDist(angles[i]), c))
+         {
+            FlagNegBad(prevKeys[startPos]);
+         }
+      }
+   }
+}
+
+/************************************************************************/
+/*>BOOL SeqOK(char restype, SEQCONS *s)
+   ------------------------------------
+   Inputs:     char       restype     One-letter residue type
+               SEQCONS    *s          SEQ constraint
+   Returns:    BOOL                   Matches constraint?
+
+   Tests a residue type against a SEQ constraint.
+
+   16.10.26 Original   By: ACRM
+*/
+BOOL SeqOK(char restype, SEQCONS *s)
+{
+   if((restype < 'A') || (restype > 'Z'))
+      return(FALSE);
+   return(s->allowed[restype - 'A']);
+}
+
+/************************************************************************/
+/*>void CheckTextSequence(char restype, char *currentKey, 
+                          char **prevKeys, int keyPos, int ringSize, 
+                          int nread)
+   -------------------------------------------------------------------
+   Inputs:     char  restype      Residue type for this record
+               char  *currentKey  Key for this record
+               char  **prevKeys   Cyclic list of previous keys
+               int   keyPos       Position of this record in the list
+               int   ringSize     Size of the cyclic list
+               int   nread        Number of records read so far
+
+   Tests the residue type of a record from a text database against the
+   SEQ constraints in the same way as CheckTextAngles().
+
+   16.10.26 Original   By: ACRM
+*/
+void CheckTextSequence(char restype, char *currentKey, char **prevKeys,
+                       int keyPos, int ringSize, int nread)
+{
+   SEQCONS *s;
+   int     startPos;
+
+   for(s=gSeqConsList; s!=NULL; NEXT(s))
+   {
+      if(nread < s->pos)
+         continue;
+      
+      startPos = (keyPos - (s->pos-1) + ringSize) % ringSize;
+      if(InSameChain(currentKey, prevKeys[startPos]) &&
+         !SeqOK(restype, s))
+      {
+         FlagNegBad(prevKeys[startPos]);
+      }
+   }
+}
+
 /************************************************************************/
 /*>BOOL InSameChain(char *currentKey, char *prevKey)
    -------------------------------------------------
@@ -692,14 +4965,22 @@ BOOL RecordOK(REAL *distArray, int ndist, CONSTRAINT *ConsList)
    Outputs:    char  *prevKey       Previous identifier
    Returns:    BOOL                 In same chain?
 
-   Tests whether 2 identifiers are in the same protein chain
+   Tests whether 2 identifiers are in the same protein chain. The 
+   identifiers are compared up to the . after the chain label since
+   this may have more than one character.
 
    08.10.98 Original   By: ACRM
+   16.10.26 Handles multi-character chain labels
 */
 BOOL InSameChain(char *currentKey, char *prevKey)
 {
-   if(!strncmp(currentKey, prevKey, 6))
-      return(TRUE);
+   int ndots = 0;
+
+   for(; *currentKey == *prevKey; currentKey++, prevKey++)
+   {
+      if((*currentKey == '\0') || ((*currentKey == '.') && (++ndots == 2)))
+         return(TRUE);
+   }
 
    return(FALSE);
 }
@@ -762,13 +5043,17 @@ void FlagNegBad(char *prevKey)
    Inputs:     FILE    *out         Output file to write to
 
    Display the final results.
-   Simply steps through the DBM hash and prints out the keys
+   Simply steps through the DBM hash and prints out the keys. For COUNT,
+   the keys are counted instead and the total (with any hits counted
+   in gNHits) is printed.
 
    08.10.98 Original   By: ACRM
+   16.10.26 Added COUNT
 */
 void DisplayResults(FILE *out)
 {
-   datum dtm;
+   datum    dtm;
+   uint64_t nkeys = 0;
    
 #ifdef GDBM
    dtm=gdbm_firstkey(gDbm);
@@ -776,7 +5061,11 @@ void DisplayResults(FILE *out)
    dtm=dbm_firstkey(gDbm);
 #endif
    if(dtm.dptr != NULL)
-      fprintf(out,"%s\n",dtm.dptr);
+   {
+      nkeys++;
+      if(!gCountOnly)
+         fprintf(out,"%s\n",dtm.dptr);
+   }
 
    for(;;)
    {
@@ -788,8 +5077,13 @@ void DisplayResults(FILE *out)
       if(dtm.dptr == NULL)
          break;
 
-      fprintf(out,"%s\n",dtm.dptr);
+      nkeys++;
+      if(!gCountOnly)
+         fprintf(out,"%s\n",dtm.dptr);
    }
+
+   if(gCountOnly)
+      fprintf(out,"COUNT %llu\n",(unsigned long long)(gNHits + nkeys));
 }
 
 /************************************************************************/
@@ -798,17 +5092,52 @@ void DisplayResults(FILE *out)
    Print a help message when running the program.
 
    08.10.98 Original   By: ACRM
+   16.10.26 DATABASE may be a shard manifest
+   16.10.26 Added COUNT and ESTIMATE
+   16.10.26 Added ANGLE and TORSION
+   16.10.26 Added SEQ
+   16.10.26 Added LOOKUP, INCLUDE and EXCLUDE
 */
 void ShowHelp(void)
 {
-   fprintf(stderr,"DATABASE dbname     Specify the database written by \
-makecadb\n");
+   fprintf(stderr,"DATABASE dbname     Specify the database (or shard \
+manifest) written by\n");
+   fprintf(stderr,"                    makecadb\n");
    fprintf(stderr,"LENGTH length       Specify loop length\n");
    fprintf(stderr,"DP n min max        Distance constraint from Nter of \
 loop\n");
    fprintf(stderr,"DM n min max        Distance constraint from Cter of \
 loop\n");
    fprintf(stderr,"END                 Run the search\n");
+   fprintf(stderr,"COUNT               Run the search but only print \
+the number of hits\n");
+   fprintf(stderr,"ESTIMATE            Estimate the number of hits \
+from the distance\n");
+   fprintf(stderr,"                    histograms without running the \
+search\n");
+   fprintf(stderr,"ANGLE n min max     CA angle constraint on residue \
+n of the loop\n");
+   fprintf(stderr,"TORSION n min max   CA torsion constraint on residue \
+n of the loop\n");
+   fprintf(stderr,"                    (the range may wrap through \
+180/-180)\n");
+   fprintf(stderr,"SEQ n types         Residue n of the loop must be \
+one of the types given\n");
+   fprintf(stderr,"                    as one-letter codes (e.g. GP) or \
+not one of them\n");
+   fprintf(stderr,"                    if they are preceded by ^ \
+(e.g. ^P)\n");
+   fprintf(stderr,"LOOKUP key          Print the record of a residue \
+(e.g. 1abc.A.52) or the\n");
+   fprintf(stderr,"                    records of a chain (1abc.A) or \
+PDB entry (1abc)\n");
+   fprintf(stderr,"INCLUDE listfile    Only search the PDB entries \
+(1abc) and chains\n");
+   fprintf(stderr,"                    (1abc.A) listed in listfile, \
+one per line\n");
+   fprintf(stderr,"EXCLUDE listfile    Do not search the PDB entries \
+and chains listed in\n");
+   fprintf(stderr,"                    listfile\n");
    fprintf(stderr,"QUIT                Exit without running the \
 search\n");
 }
@@ -819,13 +5148,38 @@ search\n");
    Print a usage message
 
    08.10.98 Original   By: ACRM
+   16.10.26 V1.1
+   16.10.26 V1.2
+   16.10.26 V1.3
+   16.10.26 V1.4
+   16.10.26 V1.5
+   16.10.26 V1.6
+   16.10.26 V1.7
+   16.10.26 V1.8
+   16.10.26 V1.9
+   16.10.26 V1.10
+   16.10.26 V1.11
+   16.10.26 V1.12
+   16.10.26 V1.13
+   16.10.26 V1.14
 */
 void Usage(void)
 {
-   fprintf(stderr,"\nsearchcadb V1.0 (c) 1998, UCL, Dr. Andrew C.R. \
+   fprintf(stderr,"\nsearchcadb V1.14 (c) 1998-2026, UCL, Dr. Andrew C.R. \
 Martin\n");
 
-   fprintf(stderr,"\nUsage: searchdb [infile [outfile]]\n");
+   fprintf(stderr,"\nUsage: searchdb [-p nprocs] [-n] [-w] [-t nthreads] \
+[infile [outfile]]\n");
+   fprintf(stderr,"       -p Maximum number of processes used to \
+search a sharded\n");
+   fprintf(stderr,"          database (Default: one per shard)\n");
+   fprintf(stderr,"       -n Do not use the range index of the \
+database\n");
+   fprintf(stderr,"       -w Do not use the loop window tables of the \
+database\n");
+   fprintf(stderr,"       -t Number of threads used to scan a loop \
+window table\n");
+   fprintf(stderr,"          (Default: 1)\n");
 
    fprintf(stderr,"\nPerforms a search for loop conformations using \
 the method of \n");